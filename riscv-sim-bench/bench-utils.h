@@ -0,0 +1,205 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "elfio/elfio.hpp"
+#include "memory.h"
+#include "rv32.h"
+#include "rv32-hart.h"
+
+namespace riscv_sim::bench {
+
+/** Default program used by the benchmarks. Path is relative to the build output directory, the same as the CLI. */
+inline const std::string c_default_elf_path = "../../../../examples/c-printf-newlib/program.elf";
+
+/** Location and initial state of a guest program loaded into memory. */
+struct Guest_program
+{
+	uint32_t entry = 0;
+	uint32_t heap_top = 0;
+};
+
+/** Measures wall time since construction. */
+class Stopwatch
+{
+public:
+	double get_elapsed_seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+/** Loads the ALLOC sections of an ELF file into memory. Returns false if the file can't be loaded. */
+inline bool load_elf(Memory& memory, const std::string& file_path, Guest_program& program)
+{
+	ELFIO::elfio reader;
+	if (!reader.load(file_path) || reader.get_class() != ELFIO::ELFCLASS32)
+		return false;
+
+	program = Guest_program();
+	program.entry = static_cast<uint32_t>(reader.get_entry());
+
+	for (const auto& psec : reader.sections)
+	{
+		const auto end_addr = static_cast<uint32_t>(psec->get_address() + psec->get_size());
+		if (end_addr > program.heap_top)
+			program.heap_top = end_addr;
+
+		const char* section_data = psec->get_data();
+		if (!(psec->get_flags() & ELFIO::SHF_ALLOC) || !section_data)
+			continue;
+
+		const auto data = std::span(reinterpret_cast<const uint8_t*>(section_data), psec->get_size());
+		memory.write_block(static_cast<uint32_t>(psec->get_address()), data);
+	}
+
+	return true;
+}
+
+/**
+Loads a synthetic memory-heavy program. Each outer iteration writes, reads back and patches every word
+of a 16 KiB buffer, then the program exits with SYS_exit.
+*/
+inline void load_synthetic_program(Memory& memory, uint32_t outer_iterations, Guest_program& program)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const std::vector<uint32_t> code = {
+		E::encode_lui(s0, 0x10),                 // 0x00: s0 = buffer base (0x10000)
+		E::encode_addi(s2, zero, static_cast<int16_t>(outer_iterations)),
+		E::encode_addi(s1, zero, 0),
+		E::encode_addi(t0, s0, 0),               // 0x0C: outer loop
+		E::encode_lui(t1, 1),                    // t1 = 4096 words
+		E::encode_sw(t0, t1, 0),                 // 0x14: inner loop
+		E::encode_lw(t2, t0, 0),
+		E::encode_add(a0, a0, t2),
+		E::encode_lbu(t3, t0, 1),
+		E::encode_sb(t0, t3, 3),
+		E::encode_addi(t0, t0, 4),
+		E::encode_addi(t1, t1, -1),
+		E::encode_bne(t1, zero, -28),            // -> 0x14
+		E::encode_addi(s1, s1, 1),
+		E::encode_blt(s1, s2, -44),              // -> 0x0C
+		E::encode_addi(a7, zero, 93),            // SYS_exit
+		E::encode_ecall(),
+	};
+
+	program = Guest_program();
+	program.entry = 0x1000;
+
+	for (uint32_t i = 0; i < code.size(); ++i)
+		memory.write_32(program.entry + i * 4, code[i]);
+}
+
+/** Prepares a hart to start executing a loaded program. */
+template <typename Hart>
+void start_program(Hart& hart, const Guest_program& program)
+{
+	hart.reset();
+	hart.set_register(Rv_register_id::pc, program.entry);
+	hart.set_register(Rv_register_id::sp, 0xFFFFFFF0);
+}
+
+/**
+Services a trap with the same minimal newlib semantics as the CLI, without printing output. ECALLs are completed
+and PC moves past them. Returns true if the program has finished (SYS_exit, EBREAK or any other trap).
+*/
+template <typename Hart>
+bool service_trap(Hart& hart, Guest_program& program, Rv_trap_cause cause)
+{
+	constexpr uint32_t sys_write = 64;
+	constexpr uint32_t sys_exit = 93;
+	constexpr uint32_t sys_brk = 214;
+
+	if (cause != Rv_trap_cause::ecall)
+		return true;
+
+	const auto syscall = hart.get_register(Rv_register_id::a7);
+	if (syscall == sys_exit)
+		return true;
+
+	if (syscall == sys_brk)
+	{
+		program.heap_top += hart.get_register(Rv_register_id::a0);
+		hart.set_register(Rv_register_id::a0, program.heap_top);
+	}
+	else if (syscall == sys_write)
+	{
+		hart.set_register(Rv_register_id::a0, hart.get_register(Rv_register_id::a2));
+	}
+
+	hart.set_register(Rv_register_id::pc, hart.get_register(Rv_register_id::pc) + 4);
+	return false;
+}
+
+/** Executes the instruction at PC with execute_next and services it if it traps. Returns true if the program has finished. */
+template <typename Hart>
+bool execute_and_service(Hart& hart, Guest_program& program)
+{
+	const auto cause = hart.execute_next();
+	return cause != Rv_trap_cause::none && service_trap(hart, program, cause);
+}
+
+/**
+Runs the hart one execute_next at a time until the guest calls SYS_exit, executes EBREAK or the instruction
+limit is reached. Returns the number of instructions executed.
+*/
+template <typename Hart>
+uint64_t run_to_exit(Hart& hart, Guest_program& program, uint64_t max_instructions)
+{
+	uint64_t count = 0;
+	while (count < max_instructions)
+	{
+		++count;
+
+		if (execute_and_service(hart, program))
+			break;
+	}
+
+	return count;
+}
+
+/** Same as run_to_exit, but runs the hart with run() between traps. */
+template <typename Hart>
+uint64_t run_threaded_to_exit(Hart& hart, Guest_program& program, uint64_t max_instructions)
+{
+	uint64_t count = 0;
+	while (count < max_instructions)
+	{
+		const auto result = hart.run(max_instructions - count);
+		count += result.retired;
+		if (result.reason == Rv_stop_reason::budget_exhausted)
+			break;
+
+		// The trapping instruction counts as executed, the same as in run_to_exit
+		++count;
+
+		if (service_trap(hart, program, result.trap))
+			break;
+	}
+
+	return count;
+}
+
+/** Prints a single benchmark result line. */
+inline void print_result(const std::string& name, uint64_t instructions, double seconds)
+{
+	const double mips = seconds > 0 ? instructions / seconds / 1e6 : 0;
+
+	std::cout << std::left << std::setw(32) << name << std::right
+		<< std::setw(14) << std::dec << instructions << " inst"
+		<< std::setw(12) << std::fixed << std::setprecision(4) << seconds << " s"
+		<< std::setw(12) << std::setprecision(2) << mips << " MIPS" << std::endl;
+}
+
+}
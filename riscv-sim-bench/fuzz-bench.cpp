@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench-utils.h"
+#include "fuzzer.h"
+#include "simulation.h"
+
+using namespace std;
+using namespace riscv_sim;
+using namespace riscv_sim::bench;
+
+/*
+Measures how many inputs per second a Fuzzer runs, with both engines.
+
+Usage: fuzz-bench [executions]
+
+The target fills a 16 KiB table while it boots, then, for each input, spills to its stack, hashes the input through
+the table, stores the hash in a global and checks the input for a 4-byte magic. Each run writes three pages, the
+stack, the global and the input, which the snapshot restores.
+*/
+
+constexpr uint32_t c_start = 0x101C;
+constexpr uint32_t c_stop = 0x10A0;
+constexpr uint32_t c_input_address = 0x40000;
+constexpr uint32_t c_max_input_size = 64;
+
+/** Writes the target to an ELF file in the temporary directory. Returns its path. */
+static string write_target_elf()
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	// Branch offsets from instruction index to instruction index
+	const auto offset = [](int from, int to) { return static_cast<int16_t>((to - from) * 4); };
+	constexpr int fill_loop = 3, hash_loop = 11, hashed = 20, done = 39;
+
+	const vector<uint32_t> code = {
+		E::encode_lui(s0, 0x20),                  // 0: s0 = table (0x20000)
+		E::encode_addi(t0, zero, 0),
+		E::encode_lui(t1, 1),
+		E::encode_sh2add(t2, t0, s0),             // 3: table[i] = i
+		E::encode_sw(t2, t0, 0),
+		E::encode_addi(t0, t0, 1),
+		E::encode_bne(t0, t1, offset(6, fill_loop)),
+		E::encode_addi(sp, sp, -16),              // 7: start, with a0 = input and a1 = size
+		E::encode_sw(sp, a1, 0),
+		E::encode_addi(t3, zero, 0),
+		E::encode_add(t6, a0, a1),
+		E::encode_beq(a0, t6, offset(11, hashed)), // 11: hash the input through the table
+		E::encode_lbu(t4, a0, 0),
+		E::encode_xor(t3, t3, t4),
+		E::encode_andi(t5, t3, 0x3FF),
+		E::encode_sh2add(t5, t5, s0),
+		E::encode_lw(t5, t5, 0),
+		E::encode_add(t3, t3, t5),
+		E::encode_addi(a0, a0, 1),
+		E::encode_jal(zero, Rv_jtype_imm::from_offset(offset(19, hash_loop))),
+		E::encode_lui(t0, 0x30),                  // 20: store the hash and check the magic
+		E::encode_sw(t0, t3, 0),
+		E::encode_lw(a1, sp, 0),
+		E::encode_sub(a0, t6, a1),
+		E::encode_addi(t0, zero, 4),
+		E::encode_blt(a1, t0, offset(25, done)),
+		E::encode_lbu(t1, a0, 0),
+		E::encode_addi(t2, zero, 'F'),
+		E::encode_bne(t1, t2, offset(28, done)),
+		E::encode_lbu(t1, a0, 1),
+		E::encode_addi(t2, zero, 'U'),
+		E::encode_bne(t1, t2, offset(31, done)),
+		E::encode_lbu(t1, a0, 2),
+		E::encode_addi(t2, zero, 'Z'),
+		E::encode_bne(t1, t2, offset(34, done)),
+		E::encode_lbu(t1, a0, 3),
+		E::encode_addi(t2, zero, 'Z'),
+		E::encode_bne(t1, t2, offset(37, done)),
+		0,                                        // 38: crash
+		E::encode_addi(sp, sp, 16),               // 39: done
+		E::encode_ebreak(),                       // 40: stop
+	};
+
+	auto bytes = vector<char>();
+	for (const auto instruction : code)
+		for (int i = 0; i < 4; ++i)
+			bytes.push_back(static_cast<char>(instruction >> (i * 8)));
+
+	using namespace ELFIO;
+	elfio writer;
+	writer.create(ELFCLASS32, ELFDATA2LSB);
+	writer.set_type(ET_EXEC);
+	writer.set_machine(EM_RISCV);
+	writer.set_entry(0x1000);
+
+	section* text = writer.sections.add(".text");
+	text->set_type(SHT_PROGBITS);
+	text->set_flags(SHF_ALLOC | SHF_EXECINSTR);
+	text->set_addr_align(4);
+	text->set_address(0x1000);
+	text->set_data(bytes.data(), static_cast<Elf_Word>(bytes.size()));
+
+	const auto path = (filesystem::temp_directory_path() / "riscv-sim-fuzz-bench.elf").string();
+	if (!writer.save(path))
+	{
+		cerr << "Can't write " << path << endl;
+		exit(1);
+	}
+
+	return path;
+}
+
+static void run_benchmark(const string& name, const string& elf_path, Rv32_engine engine, uint64_t executions)
+{
+	auto simulation = Simulation(1, engine);
+	simulation.load_elf(elf_path);
+	auto fuzzer = Fuzzer(simulation, { c_start, c_stop, c_input_address, c_max_input_size });
+	fuzzer.fuzz(1000);
+
+	// The first runs translate the code and grow the corpus
+	const auto& stats = fuzzer.get_stats();
+	const auto executions_before = stats.executions;
+	auto timer = Stopwatch();
+	fuzzer.fuzz(executions);
+	const auto seconds = timer.get_elapsed_seconds();
+
+	const auto executed = stats.executions - executions_before;
+	cout << left << setw(32) << name << right
+		<< setw(12) << dec << executed << " runs"
+		<< setw(12) << fixed << setprecision(4) << seconds << " s"
+		<< setw(12) << setprecision(0) << executed / seconds << " runs/s"
+		<< setw(8) << fuzzer.get_corpus().size() << " inputs"
+		<< setw(6) << fuzzer.get_crashes().size() << " crashes" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	const uint64_t executions = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1'000'000;
+	const auto elf_path = write_target_elf();
+
+	run_benchmark("Fuzz, interpreter", elf_path, Rv32_engine::interpreter, executions);
+	run_benchmark("Fuzz, JIT", elf_path, Rv32_engine::jit, executions);
+
+	filesystem::remove(elf_path);
+	return 0;
+}
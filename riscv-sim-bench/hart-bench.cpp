@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+
+#include "bench-utils.h"
+#include "mapped-memory.h"
+#include "paged-memory.h"
+#include "rv32-hart.h"
+
+using namespace std;
+using namespace riscv_sim;
+using namespace riscv_sim::bench;
+
+/*
+Compares a hart that accesses memory through the virtual Memory interface (Rv32_hart) with harts
+bound to a concrete memory type at compile time (Basic_rv32_hart<Memory_type>).
+
+Usage: hart-bench [program.elf]
+
+Runs the c-printf-newlib example by default. If the ELF can't be loaded, a synthetic memory-heavy
+program is used instead.
+*/
+
+constexpr uint64_t c_max_instructions = 500'000'000;
+constexpr uint32_t c_synthetic_iterations = 64;
+
+template <typename Hart_memory_type, typename Memory_type>
+static void run_benchmark(const string& name, const string& elf_path)
+{
+	auto memory = Memory_type();
+	auto hart = Basic_rv32_hart<Hart_memory_type>(memory);
+	auto program = Guest_program();
+
+	if (!load_elf(memory, elf_path, program))
+		load_synthetic_program(memory, c_synthetic_iterations, program);
+
+	start_program(hart, program);
+
+	auto timer = Stopwatch();
+	const auto count = run_to_exit(hart, program, c_max_instructions);
+	print_result(name, count, timer.get_elapsed_seconds());
+}
+
+int main(int argc, char** argv)
+{
+	const string elf_path = argc > 1 ? argv[1] : c_default_elf_path;
+
+	auto probe = Paged_memory();
+	auto program = Guest_program();
+	if (load_elf(probe, elf_path, program))
+		cout << "Program: " << elf_path << endl << endl;
+	else
+		cout << "Can't load " << elf_path << ", using synthetic program." << endl << endl;
+
+	run_benchmark<Memory, Paged_memory>("Rv32_hart + Paged_memory", elf_path);
+	run_benchmark<Paged_memory, Paged_memory>("Basic_rv32_hart<Paged_memory>", elf_path);
+	run_benchmark<Memory, Mapped_memory>("Rv32_hart + Mapped_memory", elf_path);
+	run_benchmark<Mapped_memory, Mapped_memory>("Basic_rv32_hart<Mapped_memory>", elf_path);
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+
+#include "bench-utils.h"
+#include "mapped-memory.h"
+#include "paged-memory.h"
+#include "rv32-hart.h"
+
+using namespace std;
+using namespace riscv_sim;
+using namespace riscv_sim::bench;
+
+/*
+Compares stepping a hart with execute_next against running it with the threaded interpreter (run) and with the
+JIT engine.
+
+Usage: interpreter-bench [program.elf]
+
+Runs the c-printf-newlib example by default. If the ELF can't be loaded, a synthetic memory-heavy
+program is used instead.
+*/
+
+constexpr uint64_t c_max_instructions = 2'000'000'000;
+constexpr uint32_t c_synthetic_iterations = 512;
+
+enum class Interpreter { execute_next, run, jit };
+
+template <typename Hart_memory_type, typename Memory_type>
+static double run_benchmark(const string& name, const string& elf_path, Interpreter interpreter)
+{
+	auto memory = Memory_type();
+	auto hart = Basic_rv32_hart<Hart_memory_type>(memory, interpreter == Interpreter::jit ? Rv32_engine::jit : Rv32_engine::interpreter);
+	auto program = Guest_program();
+
+	if (!load_elf(memory, elf_path, program))
+		load_synthetic_program(memory, c_synthetic_iterations, program);
+
+	start_program(hart, program);
+
+	auto timer = Stopwatch();
+	const auto count = interpreter != Interpreter::execute_next
+		? run_threaded_to_exit(hart, program, c_max_instructions)
+		: run_to_exit(hart, program, c_max_instructions);
+	const auto seconds = timer.get_elapsed_seconds();
+
+	print_result(name, count, seconds);
+	return count / seconds;
+}
+
+template <typename Hart_memory_type, typename Memory_type>
+static void compare(const string& name, const string& elf_path)
+{
+	const auto stepped = run_benchmark<Hart_memory_type, Memory_type>(name + " execute_next", elf_path, Interpreter::execute_next);
+	const auto threaded = run_benchmark<Hart_memory_type, Memory_type>(name + " run", elf_path, Interpreter::run);
+	const auto jit = run_benchmark<Hart_memory_type, Memory_type>(name + " jit", elf_path, Interpreter::jit);
+	cout << "  speedup: run " << fixed << setprecision(2) << threaded / stepped << "x, jit " << jit / stepped << "x" << endl << endl;
+}
+
+int main(int argc, char** argv)
+{
+	const string elf_path = argc > 1 ? argv[1] : c_default_elf_path;
+
+	auto probe = Paged_memory();
+	auto program = Guest_program();
+	if (load_elf(probe, elf_path, program))
+		cout << "Program: " << elf_path << endl << endl;
+	else
+		cout << "Can't load " << elf_path << ", using synthetic program." << endl << endl;
+
+	compare<Memory, Paged_memory>("Rv32_hart + Paged", elf_path);
+	compare<Paged_memory, Paged_memory>("<Paged_memory>", elf_path);
+	compare<Mapped_memory, Mapped_memory>("<Mapped_memory>", elf_path);
+
+	return 0;
+}
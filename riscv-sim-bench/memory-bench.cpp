@@ -0,0 +1,65 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "bench-utils.h"
+#include "mapped-memory.h"
+#include "paged-memory.h"
+#include "rv32-hart.h"
+#include "simple-system.h"
+
+using namespace std;
+using namespace riscv_sim;
+using namespace riscv_sim::bench;
+
+/*
+Compares guest memory backends by loading and running the same program on each.
+
+Usage: memory-bench [program.elf]
+
+Runs the c-printf-newlib example by default. If the ELF can't be loaded, a synthetic memory-heavy
+program is used instead.
+*/
+
+constexpr uint64_t c_max_instructions = 500'000'000;
+constexpr uint32_t c_synthetic_iterations = 32;
+
+template <typename Memory_type>
+static void run_benchmark(const string& name, const string& elf_path)
+{
+	auto memory = Memory_type();
+	auto hart = Rv32_hart(memory);
+	auto program = Guest_program();
+
+	auto load_timer = Stopwatch();
+	if (!load_elf(memory, elf_path, program))
+		load_synthetic_program(memory, c_synthetic_iterations, program);
+	const auto load_seconds = load_timer.get_elapsed_seconds();
+
+	start_program(hart, program);
+
+	auto run_timer = Stopwatch();
+	const auto count = run_to_exit(hart, program, c_max_instructions);
+	const auto run_seconds = run_timer.get_elapsed_seconds();
+
+	cout << name << ": load " << fixed << setprecision(6) << load_seconds << " s" << endl;
+	print_result(name + " run", count, run_seconds);
+}
+
+int main(int argc, char** argv)
+{
+	const string elf_path = argc > 1 ? argv[1] : c_default_elf_path;
+
+	auto probe = Paged_memory();
+	auto program = Guest_program();
+	if (load_elf(probe, elf_path, program))
+		cout << "Program: " << elf_path << endl << endl;
+	else
+		cout << "Can't load " << elf_path << ", using synthetic program." << endl << endl;
+
+	run_benchmark<Simple_memory_subsystem>("Simple_memory_subsystem", elf_path);
+	run_benchmark<Paged_memory>("Paged_memory", elf_path);
+	run_benchmark<Mapped_memory>("Mapped_memory", elf_path);
+
+	return 0;
+}
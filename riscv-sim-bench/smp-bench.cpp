@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench-utils.h"
+#include "deterministic-system.h"
+#include "mapped-memory.h"
+#include "smp-system.h"
+
+using namespace std;
+using namespace riscv_sim;
+using namespace riscv_sim::bench;
+
+/*
+Compares harts that run freely on a shared memory (Smp_system) with harts that run deterministically in rounds
+(Deterministic_system), with both engines and several quanta.
+
+Usage: smp-bench [hart count]
+
+Each hart runs a memory-heavy loop over a 16 KiB buffer of its own: it loads, changes and stores a word in every
+iteration, so the buffered views of the deterministic harts commit writes to all 4 pages of it each round.
+*/
+
+constexpr uint64_t c_max_instructions = 200'000'000;
+
+static void load_program(Memory& memory)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const vector<uint32_t> code = {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero), // 0x00: t0 = buffer of the hart (0x100000 + 64 KiB per hart)
+		E::encode_slli(t0, t0, 16),
+		E::encode_lui(t1, 0x100),
+		E::encode_add(t0, t0, t1),
+		E::encode_lui(t2, 0x40000),                 // t2 = iterations left
+		E::encode_andi(t3, t2, 0x7FC),              // 0x14: loop
+		E::encode_sh3add(t3, t3, t0),
+		E::encode_lw(t4, t3, 0),
+		E::encode_add(t4, t4, t2),
+		E::encode_xor(t5, t4, t3),
+		E::encode_sw(t3, t5, 0),
+		E::encode_addi(t2, t2, -1),
+		E::encode_bne(t2, zero, -28),               // -> 0x14
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < code.size(); ++i)
+		memory.write_32(i * 4, code[i]);
+}
+
+static uint64_t get_total_retired(const vector<Rv_run_result>& results)
+{
+	uint64_t total = 0;
+	for (const auto& result : results)
+		total += result.retired;
+
+	return total;
+}
+
+static void run_free(const string& name, uint32_t hart_count, Rv32_engine engine)
+{
+	auto memory = Mapped_memory();
+	load_program(memory);
+	auto system = Smp_system<32, Mapped_memory>(memory, hart_count, engine);
+
+	auto timer = Stopwatch();
+	const auto results = system.run(c_max_instructions, {});
+	print_result(name, get_total_retired(results), timer.get_elapsed_seconds());
+}
+
+static void run_deterministic(const string& name, uint32_t hart_count, Rv32_engine engine, uint32_t quantum)
+{
+	auto memory = Mapped_memory();
+	load_program(memory);
+	auto system = Deterministic_system(memory, hart_count, 1, engine);
+	system.set_quantum(quantum);
+
+	auto timer = Stopwatch();
+	const auto results = system.run(c_max_instructions, {});
+	print_result(name, get_total_retired(results), timer.get_elapsed_seconds());
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t hart_count = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 4;
+	cout << "Harts: " << hart_count << endl << endl;
+
+	for (const auto engine : { Rv32_engine::interpreter, Rv32_engine::jit })
+	{
+		const string engine_name = engine == Rv32_engine::jit ? "JIT" : "interpreter";
+		run_free("Free-running, " + engine_name, hart_count, engine);
+		for (const auto quantum : { 10'000u, Deterministic_system::default_quantum, 1'000'000u })
+			run_deterministic("Quantum " + to_string(quantum) + ", " + engine_name, hart_count, engine, quantum);
+
+		cout << endl;
+	}
+
+	return 0;
+}
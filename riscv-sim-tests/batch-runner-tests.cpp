@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "batch-runner.h"
+#include "rv32.h"
+#include "test-elf.h"
+
+using namespace riscv_sim;
+
+/** Writes its first argument and exits with argc plus the argument's first character. */
+static Test_elf make_echo_elf(const std::string& name)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	return Test_elf(name, {
+		E::encode_lw(s0, sp, 0),
+		E::encode_lw(s1, sp, 8),
+		E::encode_addi(a0, zero, 1),
+		E::encode_addi(a1, s1, 0),
+		E::encode_addi(a2, zero, 1),
+		E::encode_addi(a7, zero, 64), // write
+		E::encode_ecall(),
+		E::encode_lbu(t1, s1, 0),
+		E::encode_add(a0, s0, t1),
+		E::encode_addi(a7, zero, 93), // exit
+		E::encode_ecall(),
+	});
+}
+
+TEST(parse_batch_manifest, SkipsBlankLinesAndComments) {
+
+	auto manifest = std::istringstream(
+		"# Regression tests\n"
+		"a.elf\n"
+		"\n"
+		"  b.elf --fast  7 \n"
+		"#c.elf\n");
+
+	const auto jobs = parse_batch_manifest(manifest);
+	ASSERT_EQ(jobs.size(), 2);
+	EXPECT_EQ(jobs[0].path, "a.elf");
+	EXPECT_TRUE(jobs[0].args.empty());
+	EXPECT_EQ(jobs[1].path, "b.elf");
+	EXPECT_EQ(jobs[1].args, (std::vector<std::string>{ "--fast", "7" }));
+}
+
+TEST(run_batch_job, ExitCodeAndOutput) {
+
+	const auto elf = make_echo_elf("echo-exit");
+	const auto result = run_batch_job({ elf.get_path(), { "A" } }, 1000);
+
+	EXPECT_TRUE(result.error.empty());
+	EXPECT_EQ(result.exit_code, 2 + 'A');
+	EXPECT_EQ(result.output, "A");
+	EXPECT_EQ(result.stop.retired, 9); // Serviced ECALLs don't retire
+	EXPECT_GT(result.wall_time.count(), 0);
+}
+
+TEST(run_batch_job, ReturnFromMainExitsWithA0) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const auto elf = Test_elf("return", { E::encode_addi(a0, zero, 3), E::encode_ebreak() });
+	EXPECT_EQ(run_batch_job({ elf.get_path(), {} }, 1000).exit_code, 3);
+}
+
+TEST(run_batch_job, TrapsAndHangsHaveNoExitCode) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const auto illegal = Test_elf("illegal", { E::encode_addi(a0, zero, 3), 0 });
+	auto result = run_batch_job({ illegal.get_path(), {} }, 1000);
+	EXPECT_FALSE(result.exit_code);
+	EXPECT_EQ(result.stop.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.stop.trap, Rv_trap_cause::illegal_instruction);
+
+	const auto hang = Test_elf("hang", { E::encode_jal(zero, Rv_jtype_imm::from_offset(0)) });
+	result = run_batch_job({ hang.get_path(), {} }, 1000);
+	EXPECT_FALSE(result.exit_code);
+	EXPECT_EQ(result.stop.reason, Rv_stop_reason::budget_exhausted);
+	EXPECT_EQ(result.stop.retired, 1000);
+}
+
+TEST(run_batch_job, MissingFile) {
+
+	const auto result = run_batch_job({ "does-not-exist.elf", {} }, 1000);
+	EXPECT_FALSE(result.error.empty());
+	EXPECT_FALSE(result.exit_code);
+}
+
+TEST(run_batch, ResultsAreInJobOrder) {
+
+	const auto elf = make_echo_elf("echo-batch");
+	auto jobs = std::vector<Batch_job>();
+	for (char c = 'a'; c <= 'z'; ++c)
+		jobs.push_back({ elf.get_path(), { std::string(1, c), "extra" } });
+
+	const auto results = run_batch(jobs, 1000, 4);
+	ASSERT_EQ(results.size(), jobs.size());
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		EXPECT_EQ(results[i].exit_code, 3 + 'a' + static_cast<int>(i));
+		EXPECT_EQ(results[i].output, jobs[i].args[0]);
+	}
+}
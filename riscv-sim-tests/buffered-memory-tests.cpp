@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <utility>
+#include <vector>
+
+#include "buffered-memory.h"
+#include "mapped-memory.h"
+#include "paged-memory.h"
+
+using namespace riscv_sim;
+
+TEST(Buffered_memory, ReadsSeeSharedMemoryAndOwnWrites) {
+
+	auto shared = Paged_memory();
+	shared.write_32(0x100, 0x11223344);
+	shared.write_32(0x104, 0x55667788);
+
+	auto view = Buffered_memory(shared);
+	EXPECT_EQ(view.read_32(0x100), 0x11223344);
+	EXPECT_EQ(view.get_buffered_page_count(), 0);
+
+	view.write_16(0x100, 0xAABB);
+	EXPECT_EQ(view.read_32(0x100), 0x1122AABB);
+	EXPECT_EQ(view.read_32(0x104), 0x55667788);
+	EXPECT_EQ(view.get_buffered_page_count(), 1);
+
+	// Until the view commits
+	EXPECT_EQ(shared.read_32(0x100), 0x11223344);
+}
+
+TEST(Buffered_memory, CommitCopiesWrittenBytes) {
+
+	auto shared = Paged_memory();
+	shared.write_32(0x100, 0x11223344);
+	shared.write_32(0x2000, 0x55667788);
+
+	auto view = Buffered_memory(shared);
+	view.write_8(0x101, 0xAA);
+	view.write_32(0x2000, 0x55667788);
+	view.write_8(0x2010, 1);
+
+	// The shared memory changes behind the view. Bytes the view didn't write keep the new values.
+	shared.write_32(0x100, 0x99999999);
+	shared.write_32(0x2000, 0);
+
+	auto written = std::vector<std::pair<uint32_t, uint32_t>>();
+	view.commit([&](uint32_t start, uint32_t size) { written.emplace_back(start, size); });
+
+	EXPECT_EQ(shared.read_32(0x100), 0x9999AA99);
+	EXPECT_EQ(shared.read_32(0x2000), 0x55667788);
+	EXPECT_EQ(shared.read_8(0x2010), 1);
+	EXPECT_EQ(view.get_buffered_page_count(), 0);
+
+	const auto expected = std::vector<std::pair<uint32_t, uint32_t>>{ { 0x101, 1 }, { 0x2000, 4 }, { 0x2010, 1 } };
+	EXPECT_EQ(written, expected);
+}
+
+TEST(Buffered_memory, AccessStraddlesPages) {
+
+	auto shared = Paged_memory();
+	auto view = Buffered_memory(shared);
+
+	// A word that straddles two pages and a fill whose bytes span two words of written bits
+	const uint32_t address = 2 * Buffered_memory::page_size - 2;
+	view.write_32(address, 0xAABBCCDD);
+	view.fill(0x3000 - 100, 0xEE, 100);
+	EXPECT_EQ(view.read_32(address), 0xAABBCCDD);
+	EXPECT_EQ(view.get_buffered_page_count(), 2);
+
+	auto written = std::vector<std::pair<uint32_t, uint32_t>>();
+	view.commit([&](uint32_t start, uint32_t size) { written.emplace_back(start, size); });
+
+	EXPECT_EQ(shared.read_32(address), 0xAABBCCDD);
+	EXPECT_EQ(shared.read_8(0x3000 - 100), 0xEE);
+	EXPECT_EQ(shared.read_8(0x2FFF), 0xEE);
+
+	const auto expected = std::vector<std::pair<uint32_t, uint32_t>>{ { address, 2 }, { address + 2, 2 }, { 0x3000 - 100, 100 } };
+	EXPECT_EQ(written, expected);
+}
+
+TEST(Buffered_memory, get_span) {
+
+	auto shared = Paged_memory();
+	shared.write_32(0x40, 7);
+
+	auto view = Buffered_memory(shared);
+	const auto data = view.get_span(0x40, 4);
+	ASSERT_EQ(data.size(), 4);
+	EXPECT_EQ(data[0], 7);
+
+	data[0] = 8;
+	EXPECT_EQ(view.read_32(0x40), 8);
+	EXPECT_TRUE(view.get_span(0xFFE, 4).empty());
+
+	view.commit({});
+	EXPECT_EQ(shared.read_32(0x40), 8);
+}
+
+TEST(Buffered_memory, get_host_pages) {
+
+	auto shared = Mapped_memory();
+	shared.write_32(0x1000, 5);
+
+	auto view = Buffered_memory(shared);
+	const auto host_pages = view.get_host_pages();
+	EXPECT_EQ(host_pages[1], nullptr);
+
+	// Pages of a mapped memory are mapped on request, and pages with buffered writes point to the buffers
+	view.map_host_page(0x1000);
+	EXPECT_EQ(host_pages[1], shared.get_host_pointer(0x1000));
+
+	view.write_32(0x1004, 6);
+	ASSERT_NE(host_pages[1], nullptr);
+	EXPECT_NE(host_pages[1], shared.get_host_pointer(0x1000));
+	EXPECT_EQ(host_pages[1][4], 6);
+
+	view.commit({});
+	EXPECT_EQ(host_pages[1], shared.get_host_pointer(0x1000));
+}
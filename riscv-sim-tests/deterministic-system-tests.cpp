@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "deterministic-system.h"
+#include "paged-memory.h"
+#include "rv32.h"
+#include "test-utils.h"
+
+using namespace riscv_sim;
+
+/** The system under test. Translates code on its first run when testing the JIT, like Test_hart. */
+struct Test_system : Deterministic_system
+{
+	Test_system(Paged_memory& memory, uint32_t hart_count, uint64_t seed)
+		: Deterministic_system(memory, hart_count, seed, Rv32_engine::RISCV_SIM_TEST_ENGINE)
+	{
+		for (uint32_t i = 0; i < get_hart_count(); ++i)
+			get_hart(i).set_jit_threshold(0);
+	}
+};
+
+static void write_code(Paged_memory& memory, uint32_t address, std::initializer_list<uint32_t> code)
+{
+	for (const auto instruction : code)
+	{
+		memory.write_32(address, instruction);
+		address += 4;
+	}
+}
+
+/** Stops a hart at its first trap. */
+static bool stop_hart(Deterministic_system::Hart&, const Rv_run_result&)
+{
+	return false;
+}
+
+/** What a racy program left behind: its memory, the registers of each hart and the instructions each retired. */
+struct Racy_outcome
+{
+	std::vector<uint8_t> memory;
+	std::vector<std::array<uint32_t, 32>> registers;
+	std::vector<uint64_t> retired;
+
+	bool operator==(const Racy_outcome&) const = default;
+};
+
+/**
+Runs 4 harts that race: each increments a plain counter with a load and a store and takes tickets with AMOADD
+200 times, writing its ID into a log at each ticket, and reads the time counter when it is done.
+*/
+static Racy_outcome run_racy_program(uint64_t seed, uint32_t quantum)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = Test_system(memory, 4, seed);
+	system.set_quantum(quantum);
+
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_addi(t2, zero, 200),
+		E::encode_addi(t6, zero, 1),
+		E::encode_lui(t5, 0x2),
+		E::encode_addi(t4, zero, 0x404),
+		E::encode_lw(t1, zero, 0x400),
+		E::encode_addi(t1, t1, 1),
+		E::encode_sw(zero, t1, 0x400),
+		E::encode_amoadd_w(t3, t4, t6),
+		E::encode_sh2add(t3, t3, t5),
+		E::encode_sw(t3, t0, 0),
+		E::encode_addi(t2, t2, -1),
+		E::encode_bne(t2, zero, -28),
+		E::encode_csrrs(a0, Rv_csr::time, zero),
+		E::encode_ecall(),
+	});
+
+	const auto results = system.run(100'000'000, stop_hart);
+
+	auto outcome = Racy_outcome();
+	outcome.memory.resize(0x3000);
+	memory.read_block(0, outcome.memory);
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		EXPECT_EQ(results[i].trap, Rv_trap_cause::ecall);
+
+		auto& registers = outcome.registers.emplace_back();
+		for (uint32_t r = 0; r < 32; ++r)
+			registers[r] = system.get_hart(i).get_register(Rv_register_id(r));
+
+		outcome.retired.push_back(results[i].retired);
+	}
+
+	return outcome;
+}
+
+TEST(Deterministic_system, HartsReadTheirIds) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = Test_system(memory, 4, 1);
+
+	// Each hart stores its ID + 1 in its own word
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_slli(t1, t0, 2),
+		E::encode_addi(t0, t0, 1),
+		E::encode_sw(t1, t0, 0x400),
+		E::encode_ecall(),
+	});
+
+	const auto results = system.run(1000, stop_hart);
+	ASSERT_EQ(results.size(), 4);
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		EXPECT_EQ(results[i].reason, Rv_stop_reason::trap);
+		EXPECT_EQ(results[i].trap, Rv_trap_cause::ecall);
+		EXPECT_EQ(results[i].retired, 4);
+		EXPECT_EQ(memory.read_32(0x400 + 4 * i), i + 1);
+	}
+}
+
+TEST(Deterministic_system, SameSeedRunsAreIdentical) {
+
+	const auto first = run_racy_program(7, 50);
+	EXPECT_EQ(run_racy_program(7, 50), first);
+
+	// Every ticket was taken once, and AMOs don't lose updates
+	EXPECT_EQ(first.memory[0x404], 800 & 0xFF);
+	EXPECT_EQ(first.memory[0x405], 800 >> 8);
+
+	// The time counter counts instructions
+	EXPECT_EQ(first.registers[0][uint32_t(Rv_register_id::a0)], first.retired[0] / Deterministic_system::instructions_per_microsecond);
+
+	// Other seeds commit in other orders
+	EXPECT_NE(run_racy_program(8, 50).memory, first.memory);
+}
+
+TEST(Deterministic_system, StoresBecomeVisibleAtTheEndOfTheRound) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = Test_system(memory, 2, 1);
+	system.set_quantum(100);
+
+	// Hart 1 sets a flag and hart 0 counts the loads it takes to see it
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_bne(t0, zero, 0x100),
+	});
+	write_code(memory, 0x8, {
+		E::encode_addi(a0, a0, 1),
+		E::encode_lw(t1, zero, 0x400),
+		E::encode_beq(t1, zero, -8),
+		E::encode_ecall(),
+	});
+	write_code(memory, 0x104, {
+		E::encode_addi(t1, zero, 1),
+		E::encode_sw(zero, t1, 0x400),
+		E::encode_ecall(),
+	});
+
+	const auto results = system.run(100'000, stop_hart);
+	EXPECT_EQ(results[0].trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(results[1].trap, Rv_trap_cause::ecall);
+
+	// Hart 0 loads 33 times in the first round and sees the flag with its first load of the second
+	EXPECT_EQ(system.get_hart(0).get_register(a0), 34);
+	EXPECT_EQ(memory.read_32(0x400), 1);
+}
+
+TEST(Deterministic_system, HandlersRunOneAtATimeInCommitOrder) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	// Each hart writes its ID to a buffer and passes it to a handler, which appends it to the output
+	const auto run = [](uint64_t seed) {
+		auto memory = Paged_memory();
+		auto system = Test_system(memory, 4, seed);
+		write_code(memory, 0, {
+			E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+			E::encode_addi(t1, t0, '0'),
+			E::encode_slli(a1, t0, 4),
+			E::encode_sw(a1, t1, 0x400),
+			E::encode_ecall(),
+		});
+
+		auto output = std::string();
+		system.run(1000, [&](Deterministic_system::Hart& hart, const Rv_run_result&) {
+			output += static_cast<char>(memory.read_8(0x400 + hart.get_register(a1)));
+			return false;
+		});
+
+		return output;
+	};
+
+	const auto output = run(3);
+	EXPECT_TRUE(std::is_permutation(output.begin(), output.end(), "0123"));
+	EXPECT_EQ(run(3), output);
+}
+
+TEST(Deterministic_system, request_halt) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = Test_system(memory, 3, 1);
+	system.set_quantum(1000);
+
+	// Hart 0 traps at once and halts the others, which spin to the end of the round
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_bne(t0, zero, 8),
+		E::encode_ecall(),
+		E::encode_jal(zero, Rv_jtype_imm::from_offset(0)),
+	});
+
+	const auto results = system.run(UINT64_MAX, [&](Deterministic_system::Hart&, const Rv_run_result&) {
+		system.request_halt();
+		return false;
+	});
+
+	EXPECT_EQ(results[0].trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(results[1].retired, 1000);
+	EXPECT_EQ(results[2].retired, 1000);
+}
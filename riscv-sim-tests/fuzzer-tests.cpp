@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fuzzer.h"
+#include "rv32.h"
+#include "test-elf.h"
+
+using namespace riscv_sim;
+
+/** Inputs are written here. */
+constexpr uint32_t c_input_address = 0x10000;
+
+/** Boots with one instruction, then checks the input for "FUZ", byte by byte, and runs an illegal instruction if it matches. */
+static Test_elf make_magic_elf(const std::string& name)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	return Test_elf(name, {
+		E::encode_addi(s0, zero, 7),
+		E::encode_addi(t0, zero, 3), // 0x1004: start
+		E::encode_blt(a1, t0, 0x2C),
+		E::encode_lbu(t1, a0, 0),
+		E::encode_addi(t2, zero, 'F'),
+		E::encode_bne(t1, t2, 0x20),
+		E::encode_lbu(t1, a0, 1),
+		E::encode_addi(t2, zero, 'U'),
+		E::encode_bne(t1, t2, 0x14),
+		E::encode_lbu(t1, a0, 2),
+		E::encode_addi(t2, zero, 'Z'),
+		E::encode_bne(t1, t2, 0x8),
+		0,
+		E::encode_ebreak(),          // 0x1034: stop
+	});
+}
+
+static std::vector<uint8_t> to_bytes(const std::string& text)
+{
+	return { text.begin(), text.end() };
+}
+
+TEST(Fuzzer, ExecuteRunsFromTheSnapshot) {
+
+	const auto elf = make_magic_elf("fuzz-execute");
+	auto simulation = Simulation(1, Rv32_engine::jit);
+	simulation.load_elf(elf.get_path());
+	auto fuzzer = Fuzzer(simulation, { 0x1004, 0x1034, c_input_address, 16 });
+
+	auto& hart = simulation.get_system().get_hart(0);
+	EXPECT_EQ(fuzzer.execute(to_bytes("FUZZY")), Fuzz_outcome::crash);
+	EXPECT_EQ(hart.get_register(Rv_register_id::s0), 7);
+
+	// The input of the last run is gone, and the same input covers the same edges every time
+	EXPECT_EQ(fuzzer.execute(to_bytes("FU")), Fuzz_outcome::completed);
+	EXPECT_EQ(simulation.get_memory().read_8(c_input_address + 2), 0);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x1034);
+
+	EXPECT_EQ(fuzzer.execute(to_bytes("FUN")), Fuzz_outcome::completed);
+	const auto coverage = std::vector<uint8_t>(fuzzer.get_coverage().begin(), fuzzer.get_coverage().end());
+	EXPECT_EQ(fuzzer.execute(to_bytes("FUX")), Fuzz_outcome::completed);
+	EXPECT_TRUE(std::ranges::equal(fuzzer.get_coverage(), coverage));
+	EXPECT_EQ(fuzzer.execute(to_bytes("FOX")), Fuzz_outcome::completed);
+	EXPECT_FALSE(std::ranges::equal(fuzzer.get_coverage(), coverage));
+
+	// Inputs are cut to the maximum size
+	EXPECT_EQ(fuzzer.execute(std::vector<uint8_t>(100, 'F')), Fuzz_outcome::completed);
+	EXPECT_EQ(hart.get_register(Rv_register_id::a1), 16);
+	EXPECT_EQ(fuzzer.get_stats().executions, 6);
+}
+
+TEST(Fuzzer, FindsMagicBytes) {
+
+	const auto elf = make_magic_elf("fuzz-magic");
+	auto simulation = Simulation(1, Rv32_engine::jit);
+	simulation.load_elf(elf.get_path());
+	auto fuzzer = Fuzzer(simulation, { 0x1004, 0x1034, c_input_address, 16 }, 3);
+
+	// Each byte that matches reaches a new edge, so the corpus closes in on the magic a byte at a time
+	while (fuzzer.get_crashes().empty() && fuzzer.get_stats().executions < 1'000'000)
+		fuzzer.fuzz(10'000);
+
+	ASSERT_EQ(fuzzer.get_crashes().size(), 1);
+	const auto& crash = fuzzer.get_crashes()[0];
+	ASSERT_GE(crash.size(), 3);
+	EXPECT_EQ(std::string(crash.begin(), crash.begin() + 3), "FUZ");
+	EXPECT_GE(fuzzer.get_corpus().size(), 4);
+	EXPECT_GT(fuzzer.get_stats().crashes, 0);
+	EXPECT_GT(fuzzer.get_stats().edges, 0);
+}
+
+TEST(Fuzzer, ThrowsIfTheStartIsNotReached) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const auto elf = Test_elf("fuzz-no-start", { E::encode_ebreak() });
+	auto simulation = Simulation();
+	simulation.load_elf(elf.get_path());
+	EXPECT_THROW(Fuzzer(simulation, { 0x2000, 0x2004, c_input_address, 16 }), std::runtime_error);
+	EXPECT_FALSE(simulation.get_system().get_hart(0).has_breakpoint(0x2000));
+}
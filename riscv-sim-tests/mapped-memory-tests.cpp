@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "mapped-memory.h"
+
+using namespace riscv_sim;
+
+TEST(Mapped_memory, UnwrittenMemoryReadsZero) {
+
+	auto memory = Mapped_memory();
+	EXPECT_EQ(memory.read_8(0x1234), 0);
+	EXPECT_EQ(memory.read_16(0x1234), 0);
+	EXPECT_EQ(memory.read_32(0x80000000), 0);
+	EXPECT_EQ(memory.read_32(0xFFFFFFFC), 0);
+}
+
+TEST(Mapped_memory, write_32) {
+
+	auto memory = Mapped_memory();
+	memory.write_32(0, 100);
+	EXPECT_EQ(memory.read_8(0), 100);
+	EXPECT_EQ(memory.read_8(1), 0);
+	EXPECT_EQ(memory.read_8(2), 0);
+	EXPECT_EQ(memory.read_8(3), 0);
+	EXPECT_EQ(memory.read_32(0), 100);
+
+	memory.write_32(16, 0x12345678);
+	EXPECT_EQ(memory.read_8(16), 0x78);
+	EXPECT_EQ(memory.read_8(17), 0x56);
+	EXPECT_EQ(memory.read_8(18), 0x34);
+	EXPECT_EQ(memory.read_8(19), 0x12);
+	EXPECT_EQ(memory.read_16(16), 0x5678);
+	EXPECT_EQ(memory.read_16(18), 0x1234);
+	EXPECT_EQ(memory.read_32(16), 0x12345678);
+
+	// Unaligned access across a host page boundary
+	memory.write_32(0x1FFE, 0xAABBCCDD);
+	EXPECT_EQ(memory.read_16(0x1FFE), 0xCCDD);
+	EXPECT_EQ(memory.read_16(0x2000), 0xAABB);
+	EXPECT_EQ(memory.read_32(0x1FFE), 0xAABBCCDD);
+}
+
+TEST(Mapped_memory, TopOfAddressSpace) {
+
+	auto memory = Mapped_memory();
+	memory.write_32(0xFFFFFFFC, 0xDEADBEEF);
+	EXPECT_EQ(memory.read_32(0xFFFFFFFC), 0xDEADBEEF);
+	EXPECT_EQ(memory.read_8(0xFFFFFFFF), 0xDE);
+}
+
+TEST(Mapped_memory, get_host_pointer) {
+
+	auto memory = Mapped_memory();
+	memory.write_32(0x10000, 0x12345678);
+
+	const auto ptr = memory.get_host_pointer(0x10000);
+	EXPECT_EQ(ptr[0], 0x78);
+	EXPECT_EQ(ptr[3], 0x12);
+
+	ptr[4] = 0x55;
+	EXPECT_EQ(memory.read_8(0x10004), 0x55);
+}
+
+TEST(Mapped_memory, reset) {
+
+	auto memory = Mapped_memory();
+	memory.write_32(0x500, 0x12345678);
+	memory.write_8(0x80000000, 0x12);
+
+	memory.reset();
+	EXPECT_EQ(memory.read_32(0x500), 0);
+	EXPECT_EQ(memory.read_8(0x80000000), 0);
+}
+
+TEST(Mapped_memory, write_block) {
+
+	auto memory = Mapped_memory();
+	auto data = std::vector<uint8_t>(10000);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<uint8_t>(i * 7);
+
+	memory.write_block(0x0FF6, data);
+	for (uint32_t i = 0; i < data.size(); ++i)
+		ASSERT_EQ(memory.read_8(0x0FF6 + i), data[i]);
+
+	auto read_back = std::vector<uint8_t>(data.size());
+	memory.read_block(0x0FF6, read_back);
+	EXPECT_EQ(read_back, data);
+}
+
+TEST(Mapped_memory, fill) {
+
+	auto memory = Mapped_memory();
+	memory.fill(0x1FFE, 0xAB, 4);
+	EXPECT_EQ(memory.read_32(0x1FFE), 0xABABABAB);
+	EXPECT_EQ(memory.read_8(0x1FFD), 0);
+	EXPECT_EQ(memory.read_8(0x2002), 0);
+}
+
+TEST(Mapped_memory, get_span) {
+
+	auto memory = Mapped_memory();
+	memory.write_32(0x1FFC, 0x12345678);
+
+	auto view = memory.get_span(0x1FFC, 8);
+	ASSERT_EQ(view.size(), 8);
+	EXPECT_EQ(view[0], 0x78);
+	view[4] = 0x99;
+	EXPECT_EQ(memory.read_8(0x2000), 0x99);
+
+	// Ranges that would wrap around the end of the address space are not contiguous
+	EXPECT_TRUE(memory.get_span(0xFFFFFFFC, 8).empty());
+}
+
+TEST(Mapped_memory, get_read_span) {
+
+	struct Recording_listener : Watchpoint_listener
+	{
+		void on_watchpoint_hit(const Watchpoint_hit& hit) override { hits.push_back(hit); }
+
+		std::vector<Watchpoint_hit> hits;
+	};
+
+	auto memory = Mapped_memory();
+	auto listener = Recording_listener();
+	memory.attach_watchpoint_listener(listener);
+	memory.add_watchpoint(0x2000, 4, Watch_type::read_write);
+	memory.write_32(0x1FFC, 0x12345678);
+
+	// The range is reported as read, not written
+	const auto view = memory.get_read_span(0x1FFC, 8);
+	ASSERT_EQ(view.size(), 8);
+	EXPECT_EQ(view[0], 0x78);
+	ASSERT_EQ(listener.hits.size(), 1);
+	EXPECT_EQ(listener.hits[0].address, 0x1FFC);
+	EXPECT_EQ(listener.hits[0].type, Watch_type::read);
+
+	EXPECT_TRUE(memory.get_read_span(0xFFFFFFFC, 8).empty());
+}
+
+TEST(Mapped_memory, BlocksWrapAroundTheAddressSpace) {
+
+	auto memory = Mapped_memory();
+	auto data = std::vector<uint8_t>(8);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<uint8_t>(i + 1);
+
+	memory.write_block(0xFFFFFFFC, data);
+	EXPECT_EQ(memory.read_32(0xFFFFFFFC), 0x04030201);
+	EXPECT_EQ(memory.read_32(0), 0x08070605);
+
+	auto copy = std::vector<uint8_t>(8);
+	memory.read_block(0xFFFFFFFC, copy);
+	EXPECT_EQ(copy, data);
+
+	memory.fill(0xFFFFFFFE, 0xAB, 4);
+	EXPECT_EQ(memory.read_32(0xFFFFFFFC), 0xABAB0201);
+	EXPECT_EQ(memory.read_32(0), 0x0807ABAB);
+}
@@ -0,0 +1,342 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "paged-memory.h"
+
+using namespace riscv_sim;
+
+TEST(Paged_memory, UnwrittenMemoryReadsZero) {
+
+	auto memory = Paged_memory();
+	EXPECT_EQ(memory.read_8(0x1234), 0);
+	EXPECT_EQ(memory.read_16(0x1234), 0);
+	EXPECT_EQ(memory.read_32(0xFFFFFFFC), 0);
+	EXPECT_EQ(memory.get_allocated_page_count(), 0);
+}
+
+TEST(Paged_memory, write_32) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0, 0);
+	EXPECT_EQ(memory.read_8(0), 0);
+	EXPECT_EQ(memory.read_8(1), 0);
+	EXPECT_EQ(memory.read_8(2), 0);
+	EXPECT_EQ(memory.read_8(3), 0);
+	EXPECT_EQ(memory.read_32(0), 0);
+
+	memory.write_32(0, 100);
+	EXPECT_EQ(memory.read_8(0), 100);
+	EXPECT_EQ(memory.read_8(1), 0);
+	EXPECT_EQ(memory.read_8(2), 0);
+	EXPECT_EQ(memory.read_8(3), 0);
+	EXPECT_EQ(memory.read_32(0), 100);
+
+	memory.write_32(16, 0x12345678);
+	EXPECT_EQ(memory.read_8(16), 0x78);
+	EXPECT_EQ(memory.read_8(17), 0x56);
+	EXPECT_EQ(memory.read_8(18), 0x34);
+	EXPECT_EQ(memory.read_8(19), 0x12);
+	EXPECT_EQ(memory.read_16(16), 0x5678);
+	EXPECT_EQ(memory.read_16(18), 0x1234);
+	EXPECT_EQ(memory.read_32(16), 0x12345678);
+	EXPECT_EQ(memory.get_allocated_page_count(), 1);
+}
+
+TEST(Paged_memory, AccessStraddlesPages) {
+
+	auto memory = Paged_memory();
+
+	// Last two bytes of one page and first two bytes of the next
+	const uint32_t address = 2 * Paged_memory::page_size - 2;
+	memory.write_32(address, 0xAABBCCDD);
+	EXPECT_EQ(memory.read_8(address), 0xDD);
+	EXPECT_EQ(memory.read_8(address + 1), 0xCC);
+	EXPECT_EQ(memory.read_8(address + 2), 0xBB);
+	EXPECT_EQ(memory.read_8(address + 3), 0xAA);
+	EXPECT_EQ(memory.read_16(address + 1), 0xBBCC);
+	EXPECT_EQ(memory.read_32(address), 0xAABBCCDD);
+	EXPECT_EQ(memory.get_allocated_page_count(), 2);
+}
+
+TEST(Paged_memory, TopOfAddressSpace) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0xFFFFFFFC, 0xDEADBEEF);
+	EXPECT_EQ(memory.read_32(0xFFFFFFFC), 0xDEADBEEF);
+	EXPECT_EQ(memory.read_8(0xFFFFFFFF), 0xDE);
+}
+
+TEST(Paged_memory, reset) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0x500, 0x12345678);
+	memory.write_8(0x80000000, 0x12);
+	EXPECT_EQ(memory.get_allocated_page_count(), 2);
+
+	memory.reset();
+	EXPECT_EQ(memory.get_allocated_page_count(), 0);
+	EXPECT_EQ(memory.read_32(0x500), 0);
+	EXPECT_EQ(memory.read_8(0x80000000), 0);
+}
+
+TEST(Paged_memory, write_block) {
+
+	auto memory = Paged_memory();
+	auto data = std::vector<uint8_t>(3 * Paged_memory::page_size);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<uint8_t>(i * 7);
+
+	// Unaligned start so the block spans four pages
+	const uint32_t address = Paged_memory::page_size - 10;
+	memory.write_block(address, data);
+	EXPECT_EQ(memory.get_allocated_page_count(), 4);
+
+	for (uint32_t i = 0; i < data.size(); ++i)
+		ASSERT_EQ(memory.read_8(address + i), data[i]);
+
+	auto read_back = std::vector<uint8_t>(data.size());
+	memory.read_block(address, read_back);
+	EXPECT_EQ(read_back, data);
+}
+
+TEST(Paged_memory, read_block_UnallocatedPages) {
+
+	auto memory = Paged_memory();
+	memory.write_8(0x2000, 0x55);
+
+	auto data = std::vector<uint8_t>(8, 0xFF);
+	memory.read_block(0x1FFC, data);
+	EXPECT_EQ(data, std::vector<uint8_t>({ 0, 0, 0, 0, 0x55, 0, 0, 0 }));
+	EXPECT_EQ(memory.get_allocated_page_count(), 1);
+}
+
+TEST(Paged_memory, fill) {
+
+	auto memory = Paged_memory();
+	memory.fill(0x1FFE, 0xAB, 4);
+	EXPECT_EQ(memory.read_32(0x1FFE), 0xABABABAB);
+	EXPECT_EQ(memory.read_8(0x1FFD), 0);
+	EXPECT_EQ(memory.read_8(0x2002), 0);
+
+	// Zero fill does not allocate pages
+	memory.fill(0x100000, 0, 3 * Paged_memory::page_size);
+	EXPECT_EQ(memory.get_allocated_page_count(), 2);
+}
+
+TEST(Paged_memory, get_span) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0x1000, 0x12345678);
+
+	auto view = memory.get_span(0x1000, 8);
+	ASSERT_EQ(view.size(), 8);
+	EXPECT_EQ(view[0], 0x78);
+	view[4] = 0x99;
+	EXPECT_EQ(memory.read_8(0x1004), 0x99);
+
+	// Ranges that cross a page boundary are not contiguous
+	EXPECT_TRUE(memory.get_span(0x1FFC, 8).empty());
+}
+
+TEST(Paged_memory, get_read_span) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0x1000, 0x12345678);
+
+	const auto view = memory.get_read_span(0x1000, 8);
+	ASSERT_EQ(view.size(), 8);
+	EXPECT_EQ(view[0], 0x78);
+	EXPECT_EQ(view[4], 0);
+
+	// Pages that were never written read as 0 and stay unallocated
+	const auto unwritten = memory.get_read_span(0x5000, 4);
+	ASSERT_EQ(unwritten.size(), 4);
+	EXPECT_EQ(unwritten[0], 0);
+	EXPECT_EQ(memory.get_allocated_page_count(), 1);
+
+	EXPECT_TRUE(memory.get_read_span(0x1FFC, 8).empty());
+}
+
+TEST(Paged_memory, CodePageWritesInvalidateCaches) {
+
+	struct Recording_cache : Code_cache
+	{
+		void invalidate_code_page(uint64_t page) override { pages.push_back(page); }
+		void invalidate_all_code() override { ++flushes; }
+
+		std::vector<uint64_t> pages;
+		int flushes = 0;
+	};
+
+	auto memory = Paged_memory();
+	auto cache = Recording_cache();
+	memory.attach_code_cache(cache);
+	memory.mark_code_page(0x1234);
+
+	// Writes to unmarked pages are not reported
+	memory.write_32(0x2000, 1);
+	memory.fill(0x3000, 0xFF, 16);
+	EXPECT_TRUE(cache.pages.empty());
+
+	// The first write to a marked page is reported and unmarks the page
+	memory.write_block(0x0FFE, std::vector<uint8_t>(4, 0xAA));
+	memory.write_8(0x1000, 1);
+	EXPECT_EQ(cache.pages, std::vector<uint64_t>({ 1 }));
+
+	memory.reset();
+	EXPECT_EQ(cache.flushes, 1);
+
+	memory.detach_code_cache(cache);
+	memory.mark_code_page(0x1234);
+	memory.write_8(0x1000, 1);
+	EXPECT_EQ(cache.pages.size(), 1);
+}
+
+TEST(Paged_memory, WatchpointsReportAccesses) {
+
+	struct Recording_listener : Watchpoint_listener
+	{
+		void on_watchpoint_hit(const Watchpoint_hit& hit) override { hits.push_back(hit); }
+
+		std::vector<Watchpoint_hit> hits;
+	};
+
+	auto memory = Paged_memory();
+	auto listener = Recording_listener();
+	memory.attach_watchpoint_listener(listener);
+	memory.add_watchpoint(0x1FFE, 4, Watch_type::write);
+	memory.add_watchpoint(0x5000, 1, Watch_type::read);
+	EXPECT_TRUE(memory.has_watchpoints());
+	EXPECT_TRUE(memory.has_watchpoint(0x1FFE));
+
+	// Accesses next to the watched ranges, or of the wrong type, are not reported
+	memory.write_32(0x1FFA, 1);
+	memory.write_8(0x2002, 1);
+	memory.read_32(0x1FFE);
+	memory.write_8(0x5000, 1);
+	memory.read_32(0x4FFC);
+	EXPECT_TRUE(listener.hits.empty());
+
+	// Accesses that overlap a watched range are reported with the access's own range
+	auto buffer = std::vector<uint8_t>(0x2000);
+	memory.write_16(0x1FFD, 1);
+	memory.read_block(0x4000, buffer);
+	ASSERT_EQ(listener.hits.size(), 2);
+	EXPECT_EQ(listener.hits[0].address, 0x1FFD);
+	EXPECT_EQ(listener.hits[0].size, 2);
+	EXPECT_EQ(listener.hits[0].type, Watch_type::write);
+	EXPECT_EQ(listener.hits[1].address, 0x4000);
+	EXPECT_EQ(listener.hits[1].type, Watch_type::read);
+
+	// Watchpoints are added and removed by their start address
+	memory.remove_watchpoint(0x1FFE);
+	memory.remove_watchpoint(0x5000);
+	EXPECT_FALSE(memory.has_watchpoints());
+	memory.write_32(0x1FFE, 1);
+	memory.read_8(0x5000);
+	EXPECT_EQ(listener.hits.size(), 2);
+
+	memory.detach_watchpoint_listener(listener);
+}
+
+TEST(Paged_memory, StraddlingAccessesAreReportedOnce) {
+
+	struct Recording_listener : Watchpoint_listener
+	{
+		void on_watchpoint_hit(const Watchpoint_hit& hit) override { hits.push_back(hit); }
+
+		std::vector<Watchpoint_hit> hits;
+	};
+
+	auto memory = Paged_memory();
+	auto listener = Recording_listener();
+	memory.attach_watchpoint_listener(listener);
+	memory.add_watchpoint(0x1FFC, 8, Watch_type::read_write);
+
+	memory.write_32(0x1FFE, 0x12345678);
+	memory.write_16(0x1FFF, 0x9ABC);
+	EXPECT_EQ(memory.read_32(0x1FFE), 0x129ABC78);
+	EXPECT_EQ(memory.read_16(0x1FFF), 0x9ABC);
+	memory.write_64(0x1FFA, 0x0123'4567'89AB'CDEF);
+	EXPECT_EQ(memory.read_64(0x1FFA), 0x0123'4567'89AB'CDEF);
+
+	const auto sizes = std::vector<uint32_t>{ 4, 2, 4, 2, 8, 8 };
+	ASSERT_EQ(listener.hits.size(), sizes.size());
+	for (size_t i = 0; i < sizes.size(); ++i)
+		EXPECT_EQ(listener.hits[i].size, sizes[i]);
+
+	memory.detach_watchpoint_listener(listener);
+}
+
+TEST(Paged_memory, SnapshotsRestoreWrittenPages) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0x1000, 1);
+	memory.write_32(0x3000, 3);
+	memory.take_snapshot();
+	EXPECT_TRUE(memory.has_snapshot());
+
+	// A block that spans two pages and a word in a third, which wasn't allocated when the snapshot was taken
+	const auto block = std::vector<uint8_t>(0x20, 0xAA);
+	memory.write_block(0x1FF0, block);
+	memory.write_32(0x1000, 10);
+	memory.write_32(0x8000, 8);
+	EXPECT_EQ(memory.restore_snapshot(), 3);
+	EXPECT_EQ(memory.read_32(0x1000), 1);
+	EXPECT_EQ(memory.read_32(0x1FFC), 0);
+	EXPECT_EQ(memory.read_32(0x2000), 0);
+	EXPECT_EQ(memory.read_32(0x3000), 3);
+	EXPECT_EQ(memory.read_32(0x8000), 0);
+
+	// Only pages written since the last restore are copied back
+	EXPECT_EQ(memory.restore_snapshot(), 0);
+	memory.write_8(0x3001, 1);
+	EXPECT_EQ(memory.restore_snapshot(), 1);
+	EXPECT_EQ(memory.read_32(0x3000), 3);
+
+	// A new snapshot replaces the old one
+	memory.write_32(0x1000, 2);
+	memory.take_snapshot();
+	memory.write_32(0x1000, 20);
+	EXPECT_EQ(memory.restore_snapshot(), 1);
+	EXPECT_EQ(memory.read_32(0x1000), 2);
+
+	memory.discard_snapshot();
+	EXPECT_FALSE(memory.has_snapshot());
+	memory.write_32(0x1000, 30);
+	EXPECT_EQ(memory.restore_snapshot(), 0);
+	EXPECT_EQ(memory.read_32(0x1000), 30);
+}
+
+TEST(Paged_memory, SnapshotCopiesDontHitWatchpoints) {
+
+	struct Recording_listener : Watchpoint_listener
+	{
+		void on_watchpoint_hit(const Watchpoint_hit& hit) override { hits.push_back(hit); }
+
+		std::vector<Watchpoint_hit> hits;
+	};
+
+	auto memory = Paged_memory();
+	auto listener = Recording_listener();
+	memory.attach_watchpoint_listener(listener);
+	memory.add_watchpoint(0x1000, 4, Watch_type::read_write);
+	memory.take_snapshot();
+
+	// The page is saved before the write and written back by the restore. Only the write is reported.
+	memory.write_8(0x1800, 1);
+	memory.restore_snapshot();
+	EXPECT_EQ(listener.hits.size(), 0);
+	memory.write_8(0x1000, 1);
+	EXPECT_EQ(listener.hits.size(), 1);
+
+	memory.detach_watchpoint_listener(listener);
+}
+
+TEST(Paged_memory, ResetDiscardsSnapshot) {
+
+	auto memory = Paged_memory();
+	memory.take_snapshot();
+	memory.reset();
+	EXPECT_FALSE(memory.has_snapshot());
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "radix-memory.h"
+
+using namespace riscv_sim;
+
+TEST(Radix_memory, UnwrittenMemoryReadsZero) {
+
+	auto memory = Radix_memory();
+	EXPECT_EQ(memory.read_8(0x1234), 0);
+	EXPECT_EQ(memory.read_16(0x8000'0000'1234), 0);
+	EXPECT_EQ(memory.read_32(0xFFFF'FFFF'FFFF'FFFC), 0);
+	EXPECT_EQ(memory.get_allocated_page_count(), 0);
+}
+
+TEST(Radix_memory, write_32) {
+
+	auto memory = Radix_memory();
+	memory.write_32(16, 0x12345678);
+	EXPECT_EQ(memory.read_8(16), 0x78);
+	EXPECT_EQ(memory.read_8(19), 0x12);
+	EXPECT_EQ(memory.read_16(18), 0x1234);
+	EXPECT_EQ(memory.read_32(16), 0x12345678);
+	EXPECT_EQ(memory.get_allocated_page_count(), 1);
+}
+
+TEST(Radix_memory, write_64) {
+
+	auto memory = Radix_memory();
+	memory.write_64(16, 0x0123'4567'89AB'CDEF);
+	EXPECT_EQ(memory.read_32(16), 0x89AB'CDEF);
+	EXPECT_EQ(memory.read_32(20), 0x0123'4567);
+	EXPECT_EQ(memory.read_64(16), 0x0123'4567'89AB'CDEF);
+	EXPECT_EQ(memory.read_64(0x8000'0000'0000'0000), 0);
+
+	// Across a top-level node boundary
+	const uint64_t address = 0x0010'0000'0000'0000 - 3;
+	memory.write_64(address, 0x1122'3344'5566'7788);
+	EXPECT_EQ(memory.read_8(address), 0x88);
+	EXPECT_EQ(memory.read_8(address + 7), 0x11);
+	EXPECT_EQ(memory.read_64(address), 0x1122'3344'5566'7788);
+	EXPECT_EQ(memory.get_allocated_page_count(), 3);
+}
+
+TEST(Radix_memory, HighAddressesDoNotAlias) {
+
+	auto memory = Radix_memory();
+
+	// Same low 32 bits, and same page index at every level but one
+	memory.write_32(0x1000, 1);
+	memory.write_32(0x1'0000'1000, 2);
+	memory.write_32(0x8000'0000'0000'1000, 3);
+	memory.write_32(0x0008'0000'0000'1000, 4);
+	EXPECT_EQ(memory.read_32(0x1000), 1);
+	EXPECT_EQ(memory.read_32(0x1'0000'1000), 2);
+	EXPECT_EQ(memory.read_32(0x8000'0000'0000'1000), 3);
+	EXPECT_EQ(memory.read_32(0x0008'0000'0000'1000), 4);
+	EXPECT_EQ(memory.get_allocated_page_count(), 4);
+}
+
+TEST(Radix_memory, AccessStraddlesPages) {
+
+	auto memory = Radix_memory();
+
+	// Last two bytes of one page and first two bytes of the next, across a top-level node boundary
+	const uint64_t address = 0x0010'0000'0000'0000 - 2;
+	memory.write_32(address, 0xAABBCCDD);
+	EXPECT_EQ(memory.read_8(address), 0xDD);
+	EXPECT_EQ(memory.read_8(address + 3), 0xAA);
+	EXPECT_EQ(memory.read_16(address + 1), 0xBBCC);
+	EXPECT_EQ(memory.read_32(address), 0xAABBCCDD);
+	EXPECT_EQ(memory.get_allocated_page_count(), 2);
+}
+
+TEST(Radix_memory, TopOfAddressSpace) {
+
+	auto memory = Radix_memory();
+	memory.write_32(0xFFFF'FFFF'FFFF'FFFC, 0xDEADBEEF);
+	EXPECT_EQ(memory.read_32(0xFFFF'FFFF'FFFF'FFFC), 0xDEADBEEF);
+	EXPECT_EQ(memory.read_8(0xFFFF'FFFF'FFFF'FFFF), 0xDE);
+}
+
+TEST(Radix_memory, reset) {
+
+	auto memory = Radix_memory();
+	memory.write_32(0x500, 0x12345678);
+	memory.write_8(0x4000'0000'0000, 0x12);
+	EXPECT_EQ(memory.get_allocated_page_count(), 2);
+
+	memory.reset();
+	EXPECT_EQ(memory.get_allocated_page_count(), 0);
+	EXPECT_EQ(memory.read_32(0x500), 0);
+	EXPECT_EQ(memory.read_8(0x4000'0000'0000), 0);
+}
+
+TEST(Radix_memory, write_block) {
+
+	auto memory = Radix_memory();
+	auto data = std::vector<uint8_t>(3 * Radix_memory::page_size);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<uint8_t>(i * 7);
+
+	// Unaligned start so the block spans four pages
+	const uint64_t address = 0x2'0000'0000 + Radix_memory::page_size - 10;
+	memory.write_block(address, data);
+	EXPECT_EQ(memory.get_allocated_page_count(), 4);
+
+	auto read_back = std::vector<uint8_t>(data.size());
+	memory.read_block(address, read_back);
+	EXPECT_EQ(read_back, data);
+}
+
+TEST(Radix_memory, fill) {
+
+	auto memory = Radix_memory();
+	memory.fill(0x1FFE, 0xAB, 4);
+	EXPECT_EQ(memory.read_32(0x1FFE), 0xABABABAB);
+	EXPECT_EQ(memory.read_8(0x1FFD), 0);
+	EXPECT_EQ(memory.read_8(0x2002), 0);
+
+	// Zero fill does not allocate pages
+	memory.fill(0x100000, 0, 3 * Radix_memory::page_size);
+	EXPECT_EQ(memory.get_allocated_page_count(), 2);
+}
+
+TEST(Radix_memory, get_span) {
+
+	auto memory = Radix_memory();
+	memory.write_32(0x7'0000'1000, 0x12345678);
+
+	auto view = memory.get_span(0x7'0000'1000, 8);
+	ASSERT_EQ(view.size(), 8);
+	EXPECT_EQ(view[0], 0x78);
+	view[4] = 0x99;
+	EXPECT_EQ(memory.read_8(0x7'0000'1004), 0x99);
+
+	// Ranges that cross a page boundary are not contiguous
+	EXPECT_TRUE(memory.get_span(0x7'0000'1FFC, 8).empty());
+}
+
+TEST(Radix_memory, get_read_span) {
+
+	auto memory = Radix_memory();
+	memory.write_32(0x7'0000'1000, 0x12345678);
+
+	const auto view = memory.get_read_span(0x7'0000'1000, 8);
+	ASSERT_EQ(view.size(), 8);
+	EXPECT_EQ(view[0], 0x78);
+	EXPECT_EQ(view[4], 0);
+
+	// Pages that were never written read as 0 and stay unallocated
+	const auto unwritten = memory.get_read_span(0x7'0000'5000, 4);
+	ASSERT_EQ(unwritten.size(), 4);
+	EXPECT_EQ(unwritten[0], 0);
+	EXPECT_EQ(memory.get_allocated_page_count(), 1);
+
+	EXPECT_TRUE(memory.get_read_span(0x7'0000'1FFC, 8).empty());
+}
+
+TEST(Radix_memory, CodePageWritesInvalidateCaches) {
+
+	struct Recording_cache : Code_cache
+	{
+		void invalidate_code_page(uint64_t page) override { pages.push_back(page); }
+		void invalidate_all_code() override { ++flushes; }
+
+		std::vector<uint64_t> pages;
+		int flushes = 0;
+	};
+
+	auto memory = Radix_memory();
+	auto cache = Recording_cache();
+	memory.attach_code_cache(cache);
+	memory.mark_code_page(0x1'0000'1234);
+
+	// Pages with the same low 32 bits are distinct
+	memory.write_8(0x1234, 1);
+	EXPECT_TRUE(cache.pages.empty());
+
+	memory.write_8(0x1'0000'1000, 1);
+	EXPECT_EQ(cache.pages, std::vector<uint64_t>({ 0x10'0001 }));
+
+	memory.reset();
+	EXPECT_EQ(cache.flushes, 1);
+
+	memory.detach_code_cache(cache);
+}
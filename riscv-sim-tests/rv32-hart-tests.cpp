@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <gtest/gtest.h>
+#include <limits>
 #include <map>
+#include <vector>
 
 #include "rv32.h"
 #include "rv32-hart.h"
@@ -15,7 +20,7 @@ execute_next
 TEST(execute_next, ADD) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_add(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -34,7 +39,7 @@ TEST(execute_next, ADD) {
 TEST(execute_next, ADDI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x3, 5);
 	memory.write_32(0x500, instruction);
@@ -51,7 +56,7 @@ TEST(execute_next, ADDI) {
 TEST(execute_next, AND) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_and(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -70,7 +75,7 @@ TEST(execute_next, AND) {
 TEST(execute_next, ANDI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_andi(Rv_register_id::x2, Rv_register_id::x3, 0b010);
 	memory.write_32(0x500, instruction);
@@ -87,7 +92,7 @@ TEST(execute_next, ANDI) {
 TEST(execute_next, AUIPC) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_auipc(Rv_register_id::x2, 0b1111);
 	memory.write_32(0x500, instruction);
@@ -102,7 +107,7 @@ TEST(execute_next, AUIPC) {
 TEST(execute_next, BEQ) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_beq(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -120,7 +125,7 @@ TEST(execute_next, BEQ) {
 TEST(execute_next, BGE) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_bge(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -138,7 +143,7 @@ TEST(execute_next, BGE) {
 TEST(execute_next, BGEU) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_bgeu(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -156,7 +161,7 @@ TEST(execute_next, BGEU) {
 TEST(execute_next, BLT) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_blt(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -174,7 +179,7 @@ TEST(execute_next, BLT) {
 TEST(execute_next, BLTU) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_bltu(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -192,7 +197,7 @@ TEST(execute_next, BLTU) {
 TEST(execute_next, BNE) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_bne(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -207,38 +212,183 @@ TEST(execute_next, BNE) {
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x510);
 }
 
+TEST(execute_next, BitManipulation) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// rd is a0, rs1 is a1 and rs2 is a2
+	struct Case
+	{
+		uint32_t instruction;
+		uint32_t rs1;
+		uint32_t rs2;
+		uint32_t expected;
+	};
+
+	const Case cases[] = {
+		{ E::encode_sh1add(a0, a1, a2), 5, 100, 110 },
+		{ E::encode_sh2add(a0, a1, a2), 5, 100, 120 },
+		{ E::encode_sh3add(a0, a1, a2), 5, 100, 140 },
+		{ E::encode_andn(a0, a1, a2), 0xF0F0, 0xFF00, 0x0000'00F0 },
+		{ E::encode_orn(a0, a1, a2), 0xF0F0, 0xFF00, 0xFFFF'F0FF },
+		{ E::encode_xnor(a0, a1, a2), 0xF0F0, 0xFF00, 0xFFFF'F00F },
+		{ E::encode_clz(a0, a1), 0x0001'0000, 0, 15 },
+		{ E::encode_clz(a0, a1), 0, 0, 32 },
+		{ E::encode_ctz(a0, a1), 0x0001'0000, 0, 16 },
+		{ E::encode_ctz(a0, a1), 0, 0, 32 },
+		{ E::encode_cpop(a0, a1), 0xF0F0'0001, 0, 9 },
+		{ E::encode_max(a0, a1, a2), 0xFFFF'FFFB, 3, 3 },
+		{ E::encode_maxu(a0, a1, a2), 0xFFFF'FFFB, 3, 0xFFFF'FFFB },
+		{ E::encode_min(a0, a1, a2), 0xFFFF'FFFB, 3, 0xFFFF'FFFB },
+		{ E::encode_minu(a0, a1, a2), 0xFFFF'FFFB, 3, 3 },
+		{ E::encode_sext_b(a0, a1), 0x1280, 0, 0xFFFF'FF80 },
+		{ E::encode_sext_h(a0, a1), 0x1'8000, 0, 0xFFFF'8000 },
+		{ E::encode_zext_h(a0, a1), 0xFFFF'8001, 0, 0x8001 },
+		{ E::encode_rol(a0, a1, a2), 0x8000'0001, 33, 3 },          // The amount is rs2 modulo 32
+		{ E::encode_ror(a0, a1, a2), 0x8000'0001, 1, 0xC000'0000 },
+		{ E::encode_rori(a0, a1, 8), 0x1234'5678, 0, 0x7812'3456 },
+		{ E::encode_orc_b(a0, a1), 0x00FF'0100, 0, 0x00FF'FF00 },
+		{ E::encode_orc_b(a0, a1), 0x8000'0001, 0, 0xFF00'00FF },
+		{ E::encode_rev8(a0, a1), 0x1234'5678, 0, 0x7856'3412 },
+		{ E::encode_bclr(a0, a1, a2), 0xFF, 35, 0xF7 },             // The index is rs2 modulo 32
+		{ E::encode_bext(a0, a1, a2), 0x10, 36, 1 },
+		{ E::encode_bext(a0, a1, a2), 0x10, 3, 0 },
+		{ E::encode_binv(a0, a1, a2), 0, 31, 0x8000'0000 },
+		{ E::encode_bset(a0, a1, a2), 0, 33, 2 },
+		{ E::encode_bclri(a0, a1, 31), 0xFFFF'FFFF, 0, 0x7FFF'FFFF },
+		{ E::encode_bexti(a0, a1, 31), 0x8000'0000, 0, 1 },
+		{ E::encode_binvi(a0, a1, 0), 1, 0, 0 },
+		{ E::encode_bseti(a0, a1, 5), 0, 0, 32 },
+	};
+
+	for (const auto& c : cases)
+	{
+		memory.write_32(0x500, c.instruction);
+		hart.set_register(pc, 0x500);
+		hart.set_register(a1, c.rs1);
+		hart.set_register(a2, c.rs2);
+		hart.execute_next();
+		EXPECT_EQ(hart.get_register(a0), c.expected) << std::hex << c.instruction;
+		EXPECT_EQ(hart.get_register(pc), 0x504);
+	}
+}
+
+TEST(execute_next, C_JAL) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_compressed_enabled(true);
+
+	// c.addi a0, 3; c.jal +4
+	memory.write_16(0x500, 0x050d);
+	memory.write_16(0x502, 0x2011);
+
+	hart.set_register(Rv_register_id::pc, 0x500);
+	hart.execute_next();
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x502);
+	EXPECT_EQ(hart.get_register(Rv_register_id::a0), 3);
+
+	hart.execute_next();
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x506);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x504);
+}
+
 TEST(execute_next, EBREAK) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_ebreak();
 	memory.write_32(0x500, instruction);
 
 	hart.set_register(Rv_register_id::pc, 0x500);
-	EXPECT_THROW_EX(hart.execute_next(), "ebreak");
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::breakpoint);
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x500);
 }
 
+TEST(execute_next, CSRRS_INSTRET) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// rdinstret a0; rdcycle a1; rdinstreth a2
+	memory.write_32(0x500, Rv32_encoder::encode_csrrs(a0, Rv_csr::instret, zero));
+	memory.write_32(0x504, Rv32_encoder::encode_csrrs(a1, Rv_csr::cycle, zero));
+	memory.write_32(0x508, Rv32_encoder::encode_csrrs(a2, Rv_csr::instreth, zero));
+
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+	EXPECT_EQ(hart.get_register(a0), 0);
+	EXPECT_EQ(hart.get_register(a1), 1);
+	EXPECT_EQ(hart.get_register(a2), 0);
+	EXPECT_EQ(hart.get_instret(), 3);
+}
+
+TEST(execute_next, CSR_CountersAreReadOnly) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// Any write to a counter is illegal, even one that wouldn't change it. Reads with rs1 = x0 or a zero immediate
+	// don't write.
+	memory.write_32(0x500, Rv32_encoder::encode_csrrw(a0, Rv_csr::time, zero));
+	memory.write_32(0x504, Rv32_encoder::encode_csrrs(a0, Rv_csr::cycle, a1));
+	memory.write_32(0x508, Rv32_encoder::encode_csrrci(a0, Rv_csr::instret, uint8_t(1)));
+	memory.write_32(0x50C, Rv32_encoder::encode_csrrci(a0, Rv_csr::instret, uint8_t(0)));
+
+	for (uint32_t address = 0x500; address < 0x50C; address += 4)
+	{
+		hart.set_register(pc, address);
+		hart.set_register(a0, 7);
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::illegal_instruction);
+		EXPECT_EQ(hart.get_register(pc), address);
+		EXPECT_EQ(hart.get_register(a0), 7);
+	}
+
+	hart.set_register(pc, 0x50C);
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+	EXPECT_EQ(hart.get_register(pc), 0x510);
+}
+
+TEST(execute_next, CSR_UnknownIsIllegal) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	memory.write_32(0x500, Rv32_encoder::encode_csrrs(a0, Rv_csr(0x300), zero)); // mstatus
+
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::illegal_instruction);
+	EXPECT_EQ(hart.get_register(pc), 0x500);
+}
+
 TEST(execute_next, ECALL) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_ecall();
 	memory.write_32(0x500, instruction);
 
 	hart.set_register(Rv_register_id::pc, 0x500);
-	EXPECT_THROW_EX(hart.execute_next(), "ecall");
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::ecall);
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x500);
 }
 
 TEST(execute_next, FENCE) {
 
-	// FENCE is a NOP in this implementation
+	// FENCE only orders memory accesses, which a single hart can't observe
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_fence(Rv_register_id::x0, Rv_register_id::x0, Rv_itype_imm::from_unsigned(0));
 	memory.write_32(0x500, instruction);
@@ -248,11 +398,501 @@ TEST(execute_next, FENCE) {
 
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x504);
 }
+static uint64_t boxed(float value)
+{
+	return 0xFFFF'FFFF'0000'0000 | std::bit_cast<uint32_t>(value);
+}
+
+static uint64_t boxed_bits(uint32_t bits)
+{
+	return 0xFFFF'FFFF'0000'0000 | bits;
+}
+
+static void write_code(Simple_memory_subsystem& memory, std::initializer_list<uint32_t> code)
+{
+	uint32_t address = 0x500;
+	for (auto instruction : code)
+	{
+		memory.write_32(address, instruction);
+		address += 4;
+	}
+}
+
+TEST(execute_next, FADD_S_RoundingModes) {
+
+	using enum Rv_register_id;
+	using enum Rv_rounding_mode;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// 1 + 2^-24 is halfway between 1 and the next single, 1 + 2^-23
+	write_code(memory, {
+		E::encode_fadd_s(x3, x1, x2, rne),
+		E::encode_fadd_s(x4, x1, x2, rtz),
+		E::encode_fadd_s(x5, x1, x2, rdn),
+		E::encode_fadd_s(x6, x1, x2, rup),
+		E::encode_fadd_s(x7, x1, x2, rmm),
+		E::encode_fsub_s(x8, x9, x1, rmm),
+		E::encode_fsub_s(x10, x9, x1, rdn),
+	});
+
+	hart.set_fp_register(x1, boxed(1.0f));
+	hart.set_fp_register(x2, boxed(0x1p-24f));
+	hart.set_fp_register(x9, boxed(-0x1p-24f));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 7; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x3), boxed(1.0f));
+	EXPECT_EQ(hart.get_fp_register(x4), boxed(1.0f));
+	EXPECT_EQ(hart.get_fp_register(x5), boxed(1.0f));
+	EXPECT_EQ(hart.get_fp_register(x6), boxed_bits(0x3F80'0001));
+	EXPECT_EQ(hart.get_fp_register(x7), boxed_bits(0x3F80'0001));
+	EXPECT_EQ(hart.get_fp_register(x8), boxed_bits(0xBF80'0001));
+	EXPECT_EQ(hart.get_fp_register(x10), boxed_bits(0xBF80'0001));
+}
+
+TEST(execute_next, FMUL_S_TiesToMaxMagnitude) {
+
+	using enum Rv_register_id;
+	using enum Rv_rounding_mode;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// (1 + 3 * 2^-23) * 1.5 is halfway between 1.5 + 4 * 2^-23 and 1.5 + 5 * 2^-23
+	write_code(memory, {
+		E::encode_fmul_s(x3, x1, x2, rne),
+		E::encode_fmul_s(x4, x1, x2, rmm),
+	});
+
+	hart.set_fp_register(x1, boxed_bits(0x3F80'0003));
+	hart.set_fp_register(x2, boxed(1.5f));
+	hart.set_register(pc, 0x500);
+	hart.execute_next();
+	hart.execute_next();
+
+	EXPECT_EQ(hart.get_fp_register(x3), boxed_bits(0x3FC0'0004));
+	EXPECT_EQ(hart.get_fp_register(x4), boxed_bits(0x3FC0'0005));
+}
+
+TEST(execute_next, FMADD_TiesToMaxMagnitude) {
+
+	using enum Rv_register_id;
+	using enum Rv_rounding_mode;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// (1 + 2^-52)^2 + 2^-53 - 2^-104 is halfway between 1 + 2 * 2^-52 and 1 + 3 * 2^-52. Adding 2^-53 instead is
+	// just above halfway and adding 2^-53 - 2^-103 just below. The singles are the same with 2^-23, 2^-24 and 2^-46.
+	write_code(memory, {
+		E::encode_fmadd_d(x10, x1, x1, x2, rne),
+		E::encode_fmadd_d(x11, x1, x1, x2, rmm),
+		E::encode_fnmadd_d(x12, x1, x1, x2, rmm),
+		E::encode_fmadd_d(x13, x1, x1, x3, rmm),
+		E::encode_fmadd_d(x14, x1, x1, x4, rmm),
+		E::encode_fmadd_s(x15, x5, x5, x6, rne),
+		E::encode_fmadd_s(x16, x5, x5, x6, rmm),
+		E::encode_fmsub_s(x17, x5, x5, x7, rmm),
+		E::encode_csrrs(a0, Rv_csr::fflags, zero),
+		E::encode_csrrw(zero, Rv_csr::fflags, zero),
+		E::encode_fmadd_d(x18, x8, x8, x8, rmm),
+		E::encode_csrrs(a1, Rv_csr::fflags, zero),
+	});
+
+	hart.set_fp_register(x1, std::bit_cast<uint64_t>(1 + 0x1p-52));
+	hart.set_fp_register(x2, std::bit_cast<uint64_t>(0x1p-53 - 0x1p-104));
+	hart.set_fp_register(x3, std::bit_cast<uint64_t>(0x1p-53));
+	hart.set_fp_register(x4, std::bit_cast<uint64_t>(0x1p-53 - 0x1p-103));
+	hart.set_fp_register(x5, boxed(1 + 0x1p-23f));
+	hart.set_fp_register(x6, boxed(0x1p-24f - 0x1p-46f));
+	hart.set_fp_register(x7, boxed(-0x1p-24f + 0x1p-46f));
+	hart.set_fp_register(x8, std::bit_cast<uint64_t>(1.0));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 12; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x10), 0x3FF0'0000'0000'0002);
+	EXPECT_EQ(hart.get_fp_register(x11), 0x3FF0'0000'0000'0003);
+	EXPECT_EQ(hart.get_fp_register(x12), 0xBFF0'0000'0000'0003);
+	EXPECT_EQ(hart.get_fp_register(x13), 0x3FF0'0000'0000'0003);
+	EXPECT_EQ(hart.get_fp_register(x14), 0x3FF0'0000'0000'0002);
+	EXPECT_EQ(hart.get_fp_register(x15), boxed_bits(0x3F80'0002));
+	EXPECT_EQ(hart.get_fp_register(x16), boxed_bits(0x3F80'0003));
+	EXPECT_EQ(hart.get_fp_register(x17), boxed_bits(0x3F80'0003));
+	EXPECT_EQ(hart.get_register(a0), Rv_fp_flags::inexact);
+
+	// Checking for a tie leaves no flags behind when the result is exact
+	EXPECT_EQ(hart.get_fp_register(x18), std::bit_cast<uint64_t>(2.0));
+	EXPECT_EQ(hart.get_register(a1), 0);
+}
+
+TEST(execute_next, FDIV_TiesToMaxMagnitude) {
+
+	using enum Rv_register_id;
+	using enum Rv_rounding_mode;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// Five of the smallest subnormal halved is halfway between two and three of them. One of them halved is
+	// halfway between zero and the smallest subnormal.
+	write_code(memory, {
+		E::encode_fdiv_d(x10, x1, x2, rne),
+		E::encode_fdiv_d(x11, x1, x2, rmm),
+		E::encode_fdiv_d(x12, x1, x3, rmm),
+		E::encode_fdiv_d(x13, x4, x2, rmm),
+		E::encode_fdiv_s(x14, x5, x6, rne),
+		E::encode_fdiv_s(x15, x5, x6, rmm),
+		E::encode_fdiv_d(x16, x2, x2, rmm),
+		E::encode_csrrs(a0, Rv_csr::fflags, zero),
+	});
+
+	hart.set_fp_register(x1, 5);
+	hart.set_fp_register(x2, std::bit_cast<uint64_t>(2.0));
+	hart.set_fp_register(x3, std::bit_cast<uint64_t>(-2.0));
+	hart.set_fp_register(x4, 1);
+	hart.set_fp_register(x5, boxed_bits(5));
+	hart.set_fp_register(x6, boxed(2.0f));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 8; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x10), 2);
+	EXPECT_EQ(hart.get_fp_register(x11), 3);
+	EXPECT_EQ(hart.get_fp_register(x12), 0x8000'0000'0000'0003);
+	EXPECT_EQ(hart.get_fp_register(x13), 1);
+	EXPECT_EQ(hart.get_fp_register(x14), boxed_bits(2));
+	EXPECT_EQ(hart.get_fp_register(x15), boxed_bits(3));
+	EXPECT_EQ(hart.get_fp_register(x16), std::bit_cast<uint64_t>(1.0));
+	EXPECT_EQ(hart.get_register(a0), Rv_fp_flags::inexact | Rv_fp_flags::underflow);
+}
+
+TEST(execute_next, FP_DynamicRoundingMode) {
+
+	using enum Rv_register_id;
+	using enum Rv_rounding_mode;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_code(memory, {
+		E::encode_csrrwi(zero, Rv_csr::frm, static_cast<uint8_t>(rup)),
+		E::encode_fadd_s(x3, x1, x2),
+		E::encode_csrrwi(zero, Rv_csr::frm, 5),
+		E::encode_fadd_s(x4, x1, x2, rtz),
+		E::encode_fadd_s(x5, x1, x2),
+	});
+
+	hart.set_fp_register(x1, boxed(1.0f));
+	hart.set_fp_register(x2, boxed(0x1p-24f));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x3), boxed_bits(0x3F80'0001));
+	EXPECT_EQ(hart.get_fp_register(x4), boxed(1.0f));
+
+	// A reserved dynamic rounding mode is illegal
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::illegal_instruction);
+	EXPECT_EQ(hart.get_register(pc), 0x510);
+	EXPECT_EQ(hart.get_fp_register(x5), 0);
+}
+
+TEST(execute_next, FP_AccruedExceptionFlags) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_code(memory, {
+		E::encode_fdiv_s(x3, x1, x2),
+		E::encode_csrrs(a0, Rv_csr::fflags, zero),
+		E::encode_csrrw(zero, Rv_csr::fflags, zero),
+		E::encode_fsqrt_s(x4, x9),
+		E::encode_fadd_s(x5, x1, x1),
+		E::encode_csrrs(a1, Rv_csr::fcsr, zero),
+		E::encode_fmv_w_x(x6, a2),
+		E::encode_fadd_d(x7, x8, x8),
+		E::encode_csrrs(a3, Rv_csr::fflags, zero),
+	});
+
+	hart.set_fp_register(x1, boxed(1.0f));
+	hart.set_fp_register(x2, boxed(0.0f));
+	hart.set_fp_register(x8, std::bit_cast<uint64_t>(0x1p1023));
+	hart.set_fp_register(x9, boxed(-1.0f));
+	hart.set_register(a2, 0x4000'0000);
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 9; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x3), boxed(std::numeric_limits<float>::infinity()));
+	EXPECT_EQ(hart.get_register(a0), Rv_fp_flags::divide_by_zero);
+
+	// Invalid operations give the canonical NaN. Exact results raise nothing.
+	EXPECT_EQ(hart.get_fp_register(x4), boxed_bits(0x7FC0'0000));
+	EXPECT_EQ(hart.get_fp_register(x5), boxed(2.0f));
+	EXPECT_EQ(hart.get_register(a1), Rv_fp_flags::invalid);
+	EXPECT_EQ(hart.get_fp_register(x6), boxed(2.0f));
+
+	EXPECT_EQ(hart.get_fp_register(x7), std::bit_cast<uint64_t>(std::numeric_limits<double>::infinity()));
+	EXPECT_EQ(hart.get_register(a3), Rv_fp_flags::invalid | Rv_fp_flags::overflow | Rv_fp_flags::inexact);
+}
+
+TEST(execute_next, FP_NanBoxing) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_code(memory, {
+		E::encode_fadd_s(x2, x1, x1),
+		E::encode_fsgnj_s(x3, x1, x1),
+		E::encode_fmv_x_w(a0, x1),
+		E::encode_fclass_s(a1, x1),
+		E::encode_fcvt_d_s(x4, x5),
+		E::encode_fcvt_s_d(x6, x4),
+	});
+
+	// Not NaN-boxed, so reads as the canonical NaN except when moved as bits
+	hart.set_fp_register(x1, 0x3F80'0000);
+	hart.set_fp_register(x5, boxed(1.25f));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 6; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x2), boxed_bits(0x7FC0'0000));
+	EXPECT_EQ(hart.get_fp_register(x3), boxed_bits(0x7FC0'0000));
+	EXPECT_EQ(hart.get_register(a0), 0x3F80'0000);
+	EXPECT_EQ(hart.get_register(a1), 1 << 9);
+	EXPECT_EQ(hart.get_fp_register(x4), std::bit_cast<uint64_t>(1.25));
+	EXPECT_EQ(hart.get_fp_register(x6), boxed(1.25f));
+}
+
+TEST(execute_next, FCVT_W_S) {
+
+	using enum Rv_register_id;
+	using enum Rv_rounding_mode;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_code(memory, {
+		E::encode_fcvt_w_s(a0, x1, rne),
+		E::encode_fcvt_w_s(a1, x1, rmm),
+		E::encode_fcvt_w_s(a2, x2, rtz),
+		E::encode_csrrw(a3, Rv_csr::fflags, zero),
+		E::encode_fcvt_w_s(a4, x3, rtz),
+		E::encode_fcvt_wu_s(a5, x2, rtz),
+		E::encode_fcvt_w_s(a6, x4, rtz),
+		E::encode_csrrs(a7, Rv_csr::fflags, zero),
+	});
+
+	hart.set_fp_register(x1, boxed(2.5f));
+	hart.set_fp_register(x2, boxed(-2.5f));
+	hart.set_fp_register(x3, boxed(3e9f));
+	hart.set_fp_register(x4, boxed_bits(0x7FC0'0000));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 8; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_register(a0), 2);
+	EXPECT_EQ(hart.get_register(a1), 3);
+	EXPECT_EQ(hart.get_register(a2), static_cast<uint32_t>(-2));
+	EXPECT_EQ(hart.get_register(a3), Rv_fp_flags::inexact);
+
+	// Out of range values and NaNs saturate
+	EXPECT_EQ(hart.get_register(a4), 0x7FFF'FFFF);
+	EXPECT_EQ(hart.get_register(a5), 0);
+	EXPECT_EQ(hart.get_register(a6), 0x7FFF'FFFF);
+	EXPECT_EQ(hart.get_register(a7), Rv_fp_flags::invalid);
+}
+
+TEST(execute_next, FCVT_W_S_RoundingModes) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// Results in the order of the modes: RNE, RTZ, RDN, RUP, RMM
+	struct Case
+	{
+		float value;
+		std::array<int32_t, 5> results;
+	};
+
+	const Case cases[] = {
+		{ 0.5f, { 0, 0, 0, 1, 1 } },
+		{ 1.5f, { 2, 1, 1, 2, 2 } },
+		{ 2.5f, { 2, 2, 2, 3, 3 } },
+		{ -0.5f, { 0, 0, -1, 0, -1 } },
+		{ -1.5f, { -2, -1, -2, -1, -2 } },
+		{ 0.3f, { 0, 0, 0, 1, 0 } },
+		{ -0.7f, { -1, 0, -1, 0, -1 } },
+		{ 4194304.5f, { 4194304, 4194304, 4194304, 4194305, 4194305 } },
+		{ 1e-40f, { 0, 0, 0, 1, 0 } },
+	};
+
+	// Every value is inexact, and nothing else
+	for (const auto& test : cases)
+	{
+		for (uint8_t mode = 0; mode < 5; ++mode)
+		{
+			write_code(memory, {
+				E::encode_fcvt_w_s(a0, x1, Rv_rounding_mode(mode)),
+				E::encode_csrrw(a1, Rv_csr::fflags, zero),
+			});
+
+			hart.set_fp_register(x1, boxed(test.value));
+			hart.set_register(pc, 0x500);
+			EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+			EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+			EXPECT_EQ(hart.get_register(a0), static_cast<uint32_t>(test.results[mode])) << test.value << " in mode " << int(mode);
+			EXPECT_EQ(hart.get_register(a1), Rv_fp_flags::inexact) << test.value << " in mode " << int(mode);
+		}
+	}
+}
+
+TEST(execute_next, FMIN_S_FMAX_S) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_code(memory, {
+		E::encode_fmin_s(x10, x1, x2),
+		E::encode_fmax_s(x11, x1, x2),
+		E::encode_fmin_s(x12, x3, x5),
+		E::encode_csrrw(a0, Rv_csr::fflags, zero),
+		E::encode_fmax_s(x13, x5, x4),
+		E::encode_fmin_s(x14, x3, x3),
+		E::encode_csrrw(a1, Rv_csr::fflags, zero),
+	});
+
+	hart.set_fp_register(x1, boxed(-0.0f));
+	hart.set_fp_register(x2, boxed(0.0f));
+	hart.set_fp_register(x3, boxed_bits(0x7FC1'2345));
+	hart.set_fp_register(x4, boxed_bits(0x7F80'0001));
+	hart.set_fp_register(x5, boxed(1.0f));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 7; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x10), boxed(-0.0f));
+	EXPECT_EQ(hart.get_fp_register(x11), boxed(0.0f));
+	EXPECT_EQ(hart.get_fp_register(x12), boxed(1.0f));
+	EXPECT_EQ(hart.get_register(a0), 0);
+
+	// Only signaling NaNs are invalid, and two NaNs give the canonical NaN
+	EXPECT_EQ(hart.get_fp_register(x13), boxed(1.0f));
+	EXPECT_EQ(hart.get_fp_register(x14), boxed_bits(0x7FC0'0000));
+	EXPECT_EQ(hart.get_register(a1), Rv_fp_flags::invalid);
+}
+
+TEST(execute_next, FCLASS_D) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	const uint64_t values[] = {
+		std::bit_cast<uint64_t>(-std::numeric_limits<double>::infinity()),
+		std::bit_cast<uint64_t>(-1.0),
+		std::bit_cast<uint64_t>(-std::numeric_limits<double>::denorm_min()),
+		std::bit_cast<uint64_t>(-0.0),
+		std::bit_cast<uint64_t>(0.0),
+		std::bit_cast<uint64_t>(std::numeric_limits<double>::denorm_min()),
+		std::bit_cast<uint64_t>(1.0),
+		std::bit_cast<uint64_t>(std::numeric_limits<double>::infinity()),
+		0x7FF0'0000'0000'0001,
+		0x7FF8'0000'0000'0000,
+	};
+
+	for (uint32_t i = 0; i < std::size(values); ++i)
+	{
+		memory.write_32(0x500, E::encode_fclass_d(a0, x1));
+		hart.set_fp_register(x1, values[i]);
+		hart.set_register(pc, 0x500);
+		hart.execute_next();
+		EXPECT_EQ(hart.get_register(a0), 1u << i);
+	}
+}
+
+TEST(execute_next, FMADD_D_Variants) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_code(memory, {
+		E::encode_fmadd_d(x10, x1, x2, x3),
+		E::encode_fmsub_d(x11, x1, x2, x3),
+		E::encode_fnmsub_d(x12, x1, x2, x3),
+		E::encode_fnmadd_d(x13, x1, x2, x3),
+		E::encode_fmadd_s(x14, x4, x5, x6),
+		E::encode_csrrs(a0, Rv_csr::fflags, zero),
+	});
+
+	hart.set_fp_register(x1, std::bit_cast<uint64_t>(2.0));
+	hart.set_fp_register(x2, std::bit_cast<uint64_t>(3.0));
+	hart.set_fp_register(x3, std::bit_cast<uint64_t>(1.0));
+	hart.set_fp_register(x4, boxed(std::numeric_limits<float>::infinity()));
+	hart.set_fp_register(x5, boxed(0.0f));
+	hart.set_fp_register(x6, boxed_bits(0x7FC0'0000));
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 6; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(hart.get_fp_register(x10), std::bit_cast<uint64_t>(7.0));
+	EXPECT_EQ(hart.get_fp_register(x11), std::bit_cast<uint64_t>(5.0));
+	EXPECT_EQ(hart.get_fp_register(x12), std::bit_cast<uint64_t>(-5.0));
+	EXPECT_EQ(hart.get_fp_register(x13), std::bit_cast<uint64_t>(-7.0));
+
+	// inf * 0 is invalid even when the addend is a quiet NaN
+	EXPECT_EQ(hart.get_fp_register(x14), boxed_bits(0x7FC0'0000));
+	EXPECT_EQ(hart.get_register(a0), Rv_fp_flags::invalid);
+}
+
+TEST(execute_next, FLD_FSD) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_code(memory, {
+		E::encode_fsd(a0, x1, 8),
+		E::encode_fld(x2, a0, 8),
+		E::encode_fsw(a0, x3, 16),
+		E::encode_flw(x4, a0, 16),
+	});
+
+	hart.set_fp_register(x1, 0x0123'4567'89AB'CDEF);
+	hart.set_fp_register(x3, boxed(1.5f));
+	hart.set_register(a0, 0x1000);
+	hart.set_register(pc, 0x500);
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+
+	EXPECT_EQ(memory.read_32(0x1008), 0x89AB'CDEF);
+	EXPECT_EQ(memory.read_32(0x100C), 0x0123'4567);
+	EXPECT_EQ(hart.get_fp_register(x2), 0x0123'4567'89AB'CDEF);
+	EXPECT_EQ(memory.read_32(0x1010), 0x3FC0'0000);
+	EXPECT_EQ(hart.get_fp_register(x4), boxed(1.5f));
+}
 
 TEST(execute_next, JAL) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0x20));
 	memory.write_32(0x500, instruction);
@@ -267,7 +907,7 @@ TEST(execute_next, JAL) {
 TEST(execute_next, JALR) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0x20));
 	memory.write_32(0x500, instruction);
@@ -284,7 +924,7 @@ TEST(execute_next, JALR) {
 TEST(execute_next, LB) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_lb(Rv_register_id::x2, Rv_register_id::x3, 0);
 	memory.write_32(0x500, instruction);
@@ -300,7 +940,7 @@ TEST(execute_next, LB) {
 TEST(execute_next, LBU) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_lb(Rv_register_id::x2, Rv_register_id::x3, 0);
 	memory.write_32(0x500, instruction);
@@ -316,7 +956,7 @@ TEST(execute_next, LBU) {
 TEST(execute_next, LH) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_lh(Rv_register_id::x2, Rv_register_id::x3, 0);
 	memory.write_32(0x500, instruction);
@@ -333,7 +973,7 @@ TEST(execute_next, LH) {
 TEST(execute_next, LHU) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_lhu(Rv_register_id::x2, Rv_register_id::x3, 0);
 	memory.write_32(0x500, instruction);
@@ -350,7 +990,7 @@ TEST(execute_next, LHU) {
 TEST(execute_next, LW) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_lw(Rv_register_id::x2, Rv_register_id::x3, 0);
 	memory.write_32(0x500, instruction);
@@ -366,7 +1006,7 @@ TEST(execute_next, LW) {
 TEST(execute_next, LUI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_lui(Rv_register_id::x2, 0b1111);
 	memory.write_32(0x500, instruction);
@@ -383,7 +1023,7 @@ TEST(execute_next, NOP) {
 	// NOP isn't an actual instruction, it's encoded as ADDI x0, x0, 0.
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_addi(Rv_register_id::x0, Rv_register_id::x0, 0);
 	memory.write_32(0x500, instruction);
@@ -398,7 +1038,7 @@ TEST(execute_next, NOP) {
 TEST(execute_next, OR) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_or(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -417,7 +1057,7 @@ TEST(execute_next, OR) {
 TEST(execute_next, ORI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_ori(Rv_register_id::x2, Rv_register_id::x3, 0b010);
 	memory.write_32(0x500, instruction);
@@ -434,7 +1074,7 @@ TEST(execute_next, ORI) {
 TEST(execute_next, SB) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sb(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -453,7 +1093,7 @@ TEST(execute_next, SB) {
 TEST(execute_next, SH) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sh(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -472,7 +1112,7 @@ TEST(execute_next, SH) {
 TEST(execute_next, SLL) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sll(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -491,7 +1131,7 @@ TEST(execute_next, SLL) {
 TEST(execute_next, SLLI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_slli(Rv_register_id::x2, Rv_register_id::x3, 2);
 	memory.write_32(0x500, instruction);
@@ -508,7 +1148,7 @@ TEST(execute_next, SLLI) {
 TEST(execute_next, SLT) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_slt(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -527,7 +1167,7 @@ TEST(execute_next, SLT) {
 TEST(execute_next, SLTI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_slti(Rv_register_id::x2, Rv_register_id::x3, 5);
 	memory.write_32(0x500, instruction);
@@ -544,7 +1184,7 @@ TEST(execute_next, SLTI) {
 TEST(execute_next, SLTIU) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sltiu(Rv_register_id::x2, Rv_register_id::x3, 5);
 	memory.write_32(0x500, instruction);
@@ -561,7 +1201,7 @@ TEST(execute_next, SLTIU) {
 TEST(execute_next, SLTU) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sltu(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -580,7 +1220,7 @@ TEST(execute_next, SLTU) {
 TEST(execute_next, SRA) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sra(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -599,7 +1239,7 @@ TEST(execute_next, SRA) {
 TEST(execute_next, SRAI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_srai(Rv_register_id::x2, Rv_register_id::x3, 2);
 	memory.write_32(0x500, instruction);
@@ -616,7 +1256,7 @@ TEST(execute_next, SRAI) {
 TEST(execute_next, SRL) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_srl(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -635,7 +1275,7 @@ TEST(execute_next, SRL) {
 TEST(execute_next, SRLI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_srli(Rv_register_id::x2, Rv_register_id::x3, 4);
 	memory.write_32(0x500, instruction);
@@ -652,7 +1292,7 @@ TEST(execute_next, SRLI) {
 TEST(execute_next, SUB) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sub(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -671,7 +1311,7 @@ TEST(execute_next, SUB) {
 TEST(execute_next, SW) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_sw(Rv_register_id::x2, Rv_register_id::x3, 0x10);
 	memory.write_32(0x500, instruction);
@@ -690,7 +1330,7 @@ TEST(execute_next, SW) {
 TEST(execute_next, XOR) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_xor(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
 	memory.write_32(0x500, instruction);
@@ -709,7 +1349,7 @@ TEST(execute_next, XOR) {
 TEST(execute_next, XORI) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	auto instruction = Rv32_encoder::encode_xori(Rv_register_id::x2, Rv_register_id::x3, 0b010);
 	memory.write_32(0x500, instruction);
@@ -723,6 +1363,1146 @@ TEST(execute_next, XORI) {
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x504);
 }
 
+/* --------------------------------------------------------
+Instruction cache
+-------------------------------------------------------- */
+
+TEST(instruction_cache, HostWriteInvalidates) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	memory.write_32(0x500, Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x0, 1));
+	hart.set_register(Rv_register_id::pc, 0x500);
+	hart.execute_next();
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 1);
+
+	memory.write_32(0x500, Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x0, 2));
+	hart.set_register(Rv_register_id::pc, 0x500);
+	hart.execute_next();
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 2);
+}
+
+TEST(instruction_cache, GuestStoreInvalidates) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// 0x500: sw x4, 0(x3)      overwrites the instruction at 0x504
+	// 0x504: addi x2, x0, 1
+	memory.write_32(0x500, Rv32_encoder::encode_sw(Rv_register_id::x3, Rv_register_id::x4, 0));
+	memory.write_32(0x504, Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x0, 1));
+
+	// Get 0x504 into the cache first
+	hart.set_register(Rv_register_id::pc, 0x504);
+	hart.execute_next();
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 1);
+
+	hart.set_register(Rv_register_id::x3, 0x504);
+	hart.set_register(Rv_register_id::x4, Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x0, 2));
+	hart.set_register(Rv_register_id::pc, 0x500);
+	hart.execute_next();
+	hart.execute_next();
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 2);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x508);
+}
+
+TEST(instruction_cache, MemoryResetInvalidates) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	memory.write_32(0x500, Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x0, 1));
+	hart.set_register(Rv_register_id::pc, 0x500);
+	hart.execute_next();
+
+	// Memory reads as 0 after a reset, which is not a valid instruction
+	memory.reset();
+	hart.set_register(Rv_register_id::pc, 0x500);
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::illegal_instruction);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x500);
+}
+
+TEST(instruction_cache, AliasedAddresses) {
+
+	// Addresses 64 KiB apart share a cache slot
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	memory.write_32(0x500, Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x2, 1));
+	memory.write_32(0x10500, Rv32_encoder::encode_addi(Rv_register_id::x2, Rv_register_id::x2, 10));
+
+	for (auto address : { 0x500, 0x10500, 0x500, 0x10500 })
+	{
+		hart.set_register(Rv_register_id::pc, address);
+		hart.execute_next();
+	}
+
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 22);
+}
+
+/* --------------------------------------------------------
+run
+-------------------------------------------------------- */
+
+/** Writes a loop that sums 1..n into a0 and then executes ECALL. Returns the number of instructions executed before the ECALL. */
+static uint32_t write_sum_program(Memory& memory, uint32_t address, int16_t n)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const uint32_t code[] = {
+		E::encode_addi(t0, zero, n),    // t0 = n
+		E::encode_addi(a0, zero, 0),    // a0 = 0
+		E::encode_add(a0, a0, t0),      // loop: a0 += t0
+		E::encode_addi(t0, t0, -1),
+		E::encode_bne(t0, zero, -8),
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(address + i * 4, code[i]);
+
+	return 2 + 3 * n;
+}
+
+TEST(run, StopsAtEcall) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	const auto expected_count = write_sum_program(memory, 0x500, 10);
+
+	hart.set_register(Rv_register_id::pc, 0x500);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.retired, expected_count);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(hart.get_register(Rv_register_id::a0), 55);
+
+	// The ECALL has not been executed
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x514);
+	result = hart.run(1000);
+	EXPECT_EQ(result.retired, 0);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::ecall);
+}
+
+TEST(run, CountersReadRetiredInstructions) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// Sums 1..10, reads instret and cycle, and sums again. The counters include instructions retired in earlier runs.
+	const uint32_t code[] = {
+		E::encode_addi(t0, zero, 10),
+		E::encode_add(a0, a0, t0),
+		E::encode_addi(t0, t0, -1),
+		E::encode_bne(t0, zero, -8),
+		E::encode_csrrs(a1, Rv_csr::instret, zero),
+		E::encode_csrrs(a2, Rv_csr::cycle, zero),
+		E::encode_csrrs(a3, Rv_csr::instreth, zero),
+		E::encode_addi(a4, a4, 1),
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(0x500 + i * 4, code[i]);
+
+	hart.set_register(pc, 0x500);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(result.retired, 35);
+	EXPECT_EQ(hart.get_register(a1), 31);
+	EXPECT_EQ(hart.get_register(a2), 32);
+	EXPECT_EQ(hart.get_register(a3), 0);
+	EXPECT_EQ(hart.get_instret(), 35);
+
+	hart.set_register(pc, 0x500);
+	result = hart.run(1000);
+	EXPECT_EQ(result.retired, 35);
+	EXPECT_EQ(hart.get_register(a1), 35 + 31);
+	EXPECT_EQ(hart.get_register(a2), 35 + 32);
+	EXPECT_EQ(hart.get_instret(), 70);
+}
+
+TEST(run, StopsAtTraps) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// 0x500: addi a0, a0, 1
+	// 0x504: ebreak
+	// 0x508: addi a0, a0, 1
+	// 0x50C: illegal (all zeros)
+	memory.write_32(0x500, Rv32_encoder::encode_addi(a0, a0, 1));
+	memory.write_32(0x504, Rv32_encoder::encode_ebreak());
+	memory.write_32(0x508, Rv32_encoder::encode_addi(a0, a0, 1));
+
+	hart.set_register(pc, 0x500);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.retired, 1);
+	EXPECT_EQ(result.trap, Rv_trap_cause::breakpoint);
+	EXPECT_EQ(hart.get_register(pc), 0x504);
+
+	hart.set_register(pc, 0x508);
+	result = hart.run(1000);
+	EXPECT_EQ(result.retired, 1);
+	EXPECT_EQ(result.trap, Rv_trap_cause::illegal_instruction);
+	EXPECT_EQ(hart.get_register(pc), 0x50C);
+	EXPECT_EQ(hart.get_register(a0), 2);
+}
+
+TEST(run, StopsAtInstructionLimit) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	const auto expected_count = write_sum_program(memory, 0x500, 10);
+
+	hart.set_register(Rv_register_id::pc, 0x500);
+	const auto result = hart.run(5);
+	EXPECT_EQ(result.retired, 5);
+	EXPECT_EQ(result.reason, Rv_stop_reason::budget_exhausted);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x508);
+	EXPECT_EQ(hart.run(0).retired, 0);
+
+	// Resumes where it stopped
+	EXPECT_EQ(hart.run(1000).retired, expected_count - 5);
+	EXPECT_EQ(hart.get_register(Rv_register_id::a0), 55);
+}
+
+TEST(run, StopsAtInstructionLimitInLoop) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	write_sum_program(memory, 0x500, 10);
+
+	// Warm up the loop, then stop after exactly four iterations
+	hart.set_register(Rv_register_id::pc, 0x500);
+	EXPECT_EQ(hart.run(2 + 3 * 4).retired, 2 + 3 * 4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x508);
+	EXPECT_EQ(hart.get_register(Rv_register_id::a0), 10 + 9 + 8 + 7);
+
+	EXPECT_EQ(hart.run(3 * 5 + 1).retired, 3 * 5 + 1);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x50C);
+	EXPECT_EQ(hart.get_register(Rv_register_id::a0), 55);
+}
+
+TEST(run, MatchesExecuteNext) {
+
+	auto stepped_memory = Simple_memory_subsystem();
+	auto stepped = Test_hart(stepped_memory);
+	auto threaded_memory = Simple_memory_subsystem();
+	auto threaded = Test_hart(threaded_memory);
+
+	const auto expected_count = write_sum_program(stepped_memory, 0x500, 100);
+	write_sum_program(threaded_memory, 0x500, 100);
+
+	stepped.set_register(Rv_register_id::pc, 0x500);
+	for (uint32_t i = 0; i < expected_count; ++i)
+		stepped.execute_next();
+
+	threaded.set_register(Rv_register_id::pc, 0x500);
+	EXPECT_EQ(threaded.run(expected_count * 2).retired, expected_count);
+
+	for (auto i = 0; i < std::to_underlying(Rv_register_id::_count); ++i)
+		EXPECT_EQ(threaded.get_register(Rv_register_id(i)), stepped.get_register(Rv_register_id(i)));
+}
+
+TEST(run, SelfModifyingCode) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// 0x500: addi a0, a0, 1
+	// 0x504: sw   t1, 0(t0)     overwrites 0x500 with addi a0, a0, 100
+	// 0x508: bne  a0, t2, -8
+	// 0x50C: ecall
+	memory.write_32(0x500, Rv32_encoder::encode_addi(a0, a0, 1));
+	memory.write_32(0x504, Rv32_encoder::encode_sw(t0, t1, 0));
+	memory.write_32(0x508, Rv32_encoder::encode_bne(a0, t2, -8));
+	memory.write_32(0x50C, Rv32_encoder::encode_ecall());
+
+	hart.set_register(t0, 0x500);
+	hart.set_register(t1, Rv32_encoder::encode_addi(a0, a0, 100));
+	hart.set_register(t2, 101);
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.run(1000).retired, 6);
+	EXPECT_EQ(hart.get_register(a0), 101);
+}
+
+TEST(run, StoreIntoRunningBlock) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// 0x500: sw   t1, 8(t0)     overwrites 0x508, later in the same block
+	// 0x504: addi a0, a0, 1
+	// 0x508: addi a0, a0, 1     becomes addi a0, a0, 100
+	// 0x50C: ecall
+	memory.write_32(0x500, Rv32_encoder::encode_sw(t0, t1, 8));
+	memory.write_32(0x504, Rv32_encoder::encode_addi(a0, a0, 1));
+	memory.write_32(0x508, Rv32_encoder::encode_addi(a0, a0, 1));
+	memory.write_32(0x50C, Rv32_encoder::encode_ecall());
+
+	hart.set_register(t0, 0x500);
+	hart.set_register(t1, Rv32_encoder::encode_addi(a0, a0, 100));
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.run(1000).retired, 3);
+	EXPECT_EQ(hart.get_register(a0), 101);
+}
+
+TEST(run, HostWriteInvalidatesBlocks) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	write_sum_program(memory, 0x500, 10);
+
+	hart.set_register(pc, 0x500);
+	hart.run(1000);
+	EXPECT_EQ(hart.get_register(a0), 55);
+
+	// Loop body becomes a0 -= t0
+	memory.write_32(0x508, Rv32_encoder::encode_sub(a0, a0, t0));
+	hart.set_register(pc, 0x500);
+	hart.run(1000);
+	EXPECT_EQ(hart.get_register(a0), static_cast<uint32_t>(-55));
+}
+
+TEST(run, ResetFlushesBlocks) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	write_sum_program(memory, 0x500, 10);
+
+	hart.set_register(pc, 0x500);
+	hart.run(1000);
+
+	memory.reset();
+	hart.reset();
+	hart.set_register(pc, 0x500);
+	const auto result = hart.run(1000);
+	EXPECT_EQ(result.retired, 0);
+	EXPECT_EQ(result.trap, Rv_trap_cause::illegal_instruction);
+
+	const auto expected_count = write_sum_program(memory, 0x500, 20);
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.run(1000).retired, expected_count);
+	EXPECT_EQ(hart.get_register(a0), 210);
+}
+
+TEST(run, FallsThroughLongBlocks) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// More straight-line instructions than fit in one block, running over a page boundary
+	const uint32_t start = 0x1F00;
+	const uint32_t length = 200;
+	for (uint32_t i = 0; i < length; ++i)
+		memory.write_32(start + i * 4, Rv32_encoder::encode_addi(a0, a0, 1));
+	memory.write_32(start + length * 4, Rv32_encoder::encode_ecall());
+
+	hart.set_register(pc, start);
+	EXPECT_EQ(hart.run(1000).retired, length);
+	EXPECT_EQ(hart.get_register(a0), length);
+	EXPECT_EQ(hart.get_register(pc), start + length * 4);
+}
+
+/** Writes straight-line code that uses every RV32I instruction run() executes, followed by ECALL. Data is at 0x2000. */
+static uint32_t write_all_instructions_program(Memory& memory, uint32_t address)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const uint32_t code[] = {
+		E::encode_lui(s0, 0x2),
+		E::encode_addi(t0, zero, -5),
+		E::encode_addi(t1, zero, 7),
+		E::encode_add(a0, t0, t1),
+		E::encode_sub(a1, t0, t1),
+		E::encode_and(a2, t0, t1),
+		E::encode_or(a3, t0, t1),
+		E::encode_xor(a4, t0, t1),
+		E::encode_sll(a5, t1, t0),
+		E::encode_srl(a6, t0, t1),
+		E::encode_sra(a7, t0, t1),
+		E::encode_slt(s1, t0, t1),
+		E::encode_sltu(s2, t0, t1),
+		E::encode_addi(s3, t0, -100),
+		E::encode_andi(s4, t0, 0x7F0),
+		E::encode_ori(s5, t1, -256),
+		E::encode_xori(s6, t0, -1),
+		E::encode_slti(s7, t0, 3),
+		E::encode_sltiu(s8, t1, 0xFFF),
+		E::encode_slli(s9, t0, 3),
+		E::encode_srli(s10, t0, 3),
+		E::encode_srai(s11, t0, 3),
+		E::encode_sw(s0, t0, 0),
+		E::encode_sh(s0, t1, 6),
+		E::encode_sb(s0, t0, 9),
+		E::encode_lb(t2, s0, 0),
+		E::encode_lbu(t3, s0, 0),
+		E::encode_lh(t4, s0, 0),
+		E::encode_lhu(t5, s0, 0),
+		E::encode_lw(t6, s0, 4),
+		E::encode_add(zero, t0, t1),    // Writes to x0 are dropped
+		E::encode_lw(zero, s0, 0),
+		E::encode_fence(zero, zero, Rv_itype_imm::from_unsigned(0xFF)),   // iorw, iorw: a host fence in translated code
+		E::encode_auipc(gp, 1),
+		E::encode_beq(t0, t1, 64),      // Not taken
+		E::encode_bne(t0, t1, 8),       // Taken, skips the next instruction
+		E::encode_addi(a0, a0, 1),
+		E::encode_blt(t0, t1, 8),
+		E::encode_addi(a0, a0, 1),
+		E::encode_bltu(t0, t1, 64),     // Not taken: t0 is large unsigned
+		E::encode_bge(t1, t0, 8),
+		E::encode_addi(a0, a0, 1),
+		E::encode_bgeu(t0, t1, 8),
+		E::encode_addi(a0, a0, 1),
+		E::encode_jal(ra, Rv_jtype_imm::from_offset(8)),
+		E::encode_addi(a0, a0, 1),
+		E::encode_addi(tp, ra, 19),
+		E::encode_jalr(sp, tp, Rv_itype_imm::from_signed(-2)),   // Clears bit 0 of the target
+		E::encode_addi(a0, a0, 1),
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(address + i * 4, code[i]);
+
+	return 43;
+}
+
+/** Writes A extension instructions, including SCs that fail. Returns the number of instructions before the ECALL. */
+static uint32_t write_atomic_program(Memory& memory, uint32_t address)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const uint32_t code[] = {
+		E::encode_lui(t0, 0x2),
+		E::encode_addi(t1, zero, -5),
+		E::encode_addi(t2, zero, 7),
+		E::encode_sw(t0, t1, 0),
+		E::encode_amoswap_w(a0, t0, t2),
+		E::encode_amoadd_w(a1, t0, t1),
+		E::encode_amoxor_w(a2, t0, t2),
+		E::encode_amoand_w(a3, t0, t1),
+		E::encode_amoor_w(a4, t0, t1),
+		E::encode_amomin_w(a5, t0, t2),
+		E::encode_amomax_w(a6, t0, t2, Rv_amo_ordering::aqrl),
+		E::encode_amominu_w(a7, t0, t1),
+		E::encode_amomaxu_w(s1, t0, t1),
+		E::encode_addi(s2, t0, 4),
+		E::encode_lr_w(s3, s2, Rv_amo_ordering::aq),
+		E::encode_addi(s3, s3, 42),
+		E::encode_sc_w(s4, s2, s3, Rv_amo_ordering::rl),
+		E::encode_sc_w(s5, s2, s3),     // No reservation
+		E::encode_lr_w(s6, t0),
+		E::encode_amoadd_w(zero, t0, t2),
+		E::encode_sc_w(s7, t0, t2),     // The reservation was lost to the AMO
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(address + i * 4, code[i]);
+
+	return static_cast<uint32_t>(std::size(code)) - 1;
+}
+
+/** Writes M extension instructions with the operands that have special cases. Returns the number of instructions before the ECALL. */
+static uint32_t write_muldiv_program(Memory& memory, uint32_t address)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const uint32_t code[] = {
+		E::encode_addi(t0, zero, -5),
+		E::encode_addi(t1, zero, 7),
+		E::encode_lui(t3, 0x80000),     // Most negative value
+		E::encode_addi(t4, zero, -1),
+		E::encode_lui(t5, 0x12345),
+		E::encode_addi(t5, t5, 0x678),
+		E::encode_mul(a0, t0, t1),
+		E::encode_mulh(a1, t0, t5),
+		E::encode_mulhsu(a2, t0, t4),
+		E::encode_mulhu(a3, t4, t4),
+		E::encode_div(a4, t0, t1),
+		E::encode_divu(a5, t0, t1),
+		E::encode_rem(a6, t0, t1),
+		E::encode_remu(a7, t0, t1),
+		E::encode_div(s1, t0, zero),    // Division by zero
+		E::encode_divu(s2, t1, zero),
+		E::encode_rem(s3, t0, zero),
+		E::encode_remu(s4, t1, zero),
+		E::encode_div(s5, t3, t4),      // Overflow
+		E::encode_rem(s6, t3, t4),
+		E::encode_mulh(s7, t3, t3),
+		E::encode_mulhsu(s8, t3, t4),
+		E::encode_mulhu(s9, t5, t3),
+		E::encode_mul(zero, t0, t1),    // Writes to x0 are dropped
+		E::encode_div(zero, t0, t1),
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(address + i * 4, code[i]);
+
+	return static_cast<uint32_t>(std::size(code)) - 1;
+}
+
+/** Writes Zba, Zbb and Zbs instructions. Returns the number of instructions before the ECALL. */
+static uint32_t write_bitmanip_program(Memory& memory, uint32_t address)
+{
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	const uint32_t code[] = {
+		E::encode_lui(t0, 0x80F01),
+		E::encode_addi(t0, t0, 0x234),
+		E::encode_addi(t1, zero, -37),
+		E::encode_addi(t2, zero, 0),
+		E::encode_sh1add(a0, t0, t1),
+		E::encode_sh2add(a1, t1, t0),
+		E::encode_sh3add(a2, t0, t0),
+		E::encode_andn(a3, t0, t1),
+		E::encode_orn(a4, t0, t1),
+		E::encode_xnor(a5, t0, t1),
+		E::encode_clz(a6, t0),
+		E::encode_clz(a7, t2),          // Zero
+		E::encode_ctz(s1, t0),
+		E::encode_ctz(s2, t2),
+		E::encode_cpop(s3, t1),
+		E::encode_max(s4, t0, t1),
+		E::encode_maxu(s5, t0, t1),
+		E::encode_min(s6, t0, t1),
+		E::encode_minu(s7, t0, t1),
+		E::encode_sext_b(s8, t0),
+		E::encode_sext_h(s9, t1),
+		E::encode_zext_h(s10, t1),
+		E::encode_rol(s11, t0, t1),
+		E::encode_ror(t3, t0, t1),
+		E::encode_rori(t4, t0, 13),
+		E::encode_orc_b(t5, t0),
+		E::encode_rev8(t6, t0),
+		E::encode_bclr(gp, t1, t1),
+		E::encode_bext(tp, t0, t1),
+		E::encode_binv(ra, t0, t1),
+		E::encode_bset(sp, t2, t1),
+		E::encode_bclri(s0, t1, 30),
+		E::encode_bexti(t2, t0, 31),
+		E::encode_binvi(t1, t1, 3),     // rd is rs1
+		E::encode_bseti(t0, t0, 4),
+		E::encode_cpop(zero, t0),       // Writes to x0 are dropped
+		E::encode_andn(zero, t0, t1),
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(address + i * 4, code[i]);
+
+	return static_cast<uint32_t>(std::size(code)) - 1;
+}
+
+/**
+Writes a loop of F and D instructions between integer instructions, storing its results to 0x2000. Returns the number
+of instructions retired before the ECALL.
+*/
+static uint32_t write_float_program(Memory& memory, uint32_t address)
+{
+	using enum Rv_register_id;
+	using enum Rv_rounding_mode;
+	using E = Rv32_encoder;
+
+	const uint32_t code[] = {
+		E::encode_lui(t0, 0x3F800),     // 1.0
+		E::encode_fmv_w_x(x1, t0),
+		E::encode_lui(t0, 0x3DCCD),     // 0.1
+		E::encode_addi(t0, t0, -819),
+		E::encode_fmv_w_x(x2, t0),
+		E::encode_fcvt_d_s(x3, x2),
+		E::encode_addi(t1, zero, 10),
+		E::encode_fadd_s(x4, x4, x2),   // Loop: sums 0.1 as singles and doubles
+		E::encode_fmadd_d(x5, x3, x3, x5, rmm),
+		E::encode_fdiv_s(x6, x4, x1, rup),
+		E::encode_addi(t1, t1, -1),
+		E::encode_bne(t1, zero, -16),
+		E::encode_fsqrt_d(x7, x5),
+		E::encode_fcvt_s_d(x8, x7, rtz),
+		E::encode_fcvt_w_s(a0, x4, rmm),
+		E::encode_fcvt_wu_d(a1, x5, rup),
+		E::encode_fle_s(a2, x4, x6),
+		E::encode_fclass_s(a3, x8),
+		E::encode_fsgnjn_d(x9, x5, x5),
+		E::encode_fcvt_w_d(a4, x9, rdn),
+		E::encode_fmv_x_w(a5, x6),
+		E::encode_lui(s0, 0x2),
+		E::encode_fsw(s0, x4, 0),
+		E::encode_fsd(s0, x7, 4),
+		E::encode_fsw(s0, x8, 12),
+		E::encode_csrrs(a6, Rv_csr::fcsr, zero),
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(address + i * 4, code[i]);
+
+	// 7 instructions, 10 iterations of 5 and 14 more
+	return 71;
+}
+
+/**
+Writes a program that mixes compressed and 32-bit instructions, with 32-bit instructions and jump targets at addresses
+that are not 4-byte aligned. Returns the number of instructions before the ECALL.
+*/
+static uint32_t write_compressed_program(Memory& memory, uint32_t address)
+{
+	// Assembled with the C extension. 32-bit instructions are split into halfwords, low half first.
+	const uint16_t code[] = {
+		0x4515,         // 00: c.li a0, 5
+		0x4581,         // 02: c.li a1, 0
+		0x95aa,         // 04: c.add a1, a0
+		0x157d,         // 06: c.addi a0, -1
+		0xfd75,         // 08: c.bnez a0, 04
+		0x0293, 0x2000, // 0a: addi t0, zero, 0x200
+		0x0292,         // 0e: c.slli t0, 4
+		0x8416,         // 10: c.mv s0, t0
+		0xc00c,         // 12: c.sw a1, 0(s0)
+		0x4010,         // 14: c.lw a2, 0(s0)
+		0x8122,         // 16: c.mv sp, s0
+		0x0034,         // 18: c.addi4spn a3, sp, 8
+		0xc232,         // 1a: c.swsp a2, 4(sp)
+		0x4712,         // 1c: c.lwsp a4, 4(sp)
+		0x6141,         // 1e: c.addi16sp sp, 16
+		0x77fd,         // 20: c.lui a5, 0xfffff
+		0x8391,         // 22: c.srli a5, 4
+		0x84be,         // 24: c.mv s1, a5
+		0x84a1,         // 26: c.srai s1, 8
+		0x98e9,         // 28: c.andi s1, -6
+		0x4531,         // 2a: c.li a0, 12
+		0x8d05,         // 2c: c.sub a0, s1
+		0x8d3d,         // 2e: c.xor a0, a5
+		0x8f49,         // 30: c.or a4, a0
+		0x8ef9,         // 32: c.and a3, a4
+		0x2011,         // 34: c.jal 38
+		0xa019,         // 36: c.j 3c
+		0x050d,         // 38: c.addi a0, 3
+		0x8082,         // 3a: c.jr ra
+		0x441c,         // 3c: c.lw a5, 8(s0)
+		0xc391,         // 3e: c.beqz a5, 42
+		0x0001,         // 40: c.nop
+		0x0317, 0x0000, // 42: auipc t1, 0
+		0x0313, 0x00e3, // 46: addi t1, t1, 14
+		0x9302,         // 4a: c.jalr t1
+		0x0073, 0x0000, // 4c: ecall
+		0xc448,         // 50: c.sw a0, 12(s0)
+		0x8082,         // 52: c.jr ra
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_16(address + i * 2, code[i]);
+
+	return 48;
+}
+
+/** Runs the program on a hart bound to Memory_type with the engine under test and on the interpreter, and compares the results. */
+template <typename Memory_type>
+static void expect_all_instructions_match_interpreter(Memory_type& memory, Memory& reference_memory,
+	uint32_t (*write_program)(Memory&, uint32_t) = &write_all_instructions_program, bool compressed = false)
+{
+	auto hart = Basic_rv32_hart<Memory_type>(memory, Rv32_engine::RISCV_SIM_TEST_ENGINE);
+	hart.set_jit_threshold(0);
+	hart.set_compressed_enabled(compressed);
+	auto reference = Rv32_hart(reference_memory);
+	reference.set_compressed_enabled(compressed);
+
+	const auto expected_count = write_program(memory, 0x1000);
+	write_program(reference_memory, 0x1000);
+
+	// The second run uses code translated in the first
+	for (int i = 0; i < 2; ++i)
+	{
+		hart.reset();
+		hart.set_register(Rv_register_id::pc, 0x1000);
+		reference.reset();
+		reference.set_register(Rv_register_id::pc, 0x1000);
+
+		EXPECT_EQ(hart.run(1000).retired, expected_count);
+		EXPECT_EQ(reference.run(1000).retired, expected_count);
+
+		for (auto r = 0; r < std::to_underlying(Rv_register_id::_count); ++r)
+			EXPECT_EQ(hart.get_register(Rv_register_id(r)), reference.get_register(Rv_register_id(r))) << "x" << r;
+
+		for (uint32_t a = 0x2000; a < 0x2010; a += 4)
+			EXPECT_EQ(memory.read_32(a), reference_memory.read_32(a));
+	}
+}
+
+TEST(run, AllInstructionsMatchInterpreter) {
+
+	auto memory = Simple_memory_subsystem();
+	auto reference_memory = Simple_memory_subsystem();
+	expect_all_instructions_match_interpreter<Memory>(memory, reference_memory);
+}
+
+TEST(run, AllInstructionsMatchInterpreter_Mapped_memory) {
+
+	auto memory = Mapped_memory();
+	auto reference_memory = Simple_memory_subsystem();
+	expect_all_instructions_match_interpreter(memory, reference_memory);
+}
+
+TEST(run, MultiplyDivideMatchInterpreter) {
+
+	auto memory = Mapped_memory();
+	auto reference_memory = Simple_memory_subsystem();
+	expect_all_instructions_match_interpreter(memory, reference_memory, &write_muldiv_program);
+}
+
+TEST(run, BitManipulationMatchInterpreter) {
+
+	auto memory = Mapped_memory();
+	auto reference_memory = Simple_memory_subsystem();
+	expect_all_instructions_match_interpreter(memory, reference_memory, &write_bitmanip_program);
+}
+
+TEST(run, FloatingPointMatchInterpreter) {
+
+	auto memory = Mapped_memory();
+	auto reference_memory = Simple_memory_subsystem();
+	expect_all_instructions_match_interpreter(memory, reference_memory, &write_float_program);
+}
+
+TEST(run, AtomicsMatchInterpreter) {
+
+	// The reference memory has no host storage behind get_span, so it runs the atomics without host atomics
+	auto memory = Mapped_memory();
+	auto reference_memory = Simple_memory_subsystem();
+	expect_all_instructions_match_interpreter(memory, reference_memory, &write_atomic_program);
+}
+
+TEST(run, CompressedMatchInterpreter) {
+
+	auto memory = Mapped_memory();
+	auto reference_memory = Simple_memory_subsystem();
+	expect_all_instructions_match_interpreter(memory, reference_memory, &write_compressed_program, true);
+}
+
+TEST(run, CompressedProgram) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_compressed_enabled(true);
+
+	const auto expected_count = write_compressed_program(memory, 0x1000);
+	hart.set_register(pc, 0x1000);
+	const auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(result.retired, expected_count);
+	EXPECT_EQ(hart.get_register(pc), 0x104c);
+
+	// 5 + 4 + 3 + 2 + 1
+	EXPECT_EQ(memory.read_32(0x2000), 15);
+	EXPECT_EQ(memory.read_32(0x2004), 15);
+	EXPECT_EQ(hart.get_register(a3), 0x2008 & hart.get_register(a4));
+	EXPECT_EQ(hart.get_register(a5), 0);
+	EXPECT_EQ(hart.get_register(s1), 0x000FFFFA);
+
+	// C.JALR links to the ECALL, 2 bytes after it
+	EXPECT_EQ(hart.get_register(ra), 0x104c);
+	EXPECT_EQ(memory.read_32(0x200c), hart.get_register(a0));
+}
+
+TEST(run, CompressedNeedsExtension) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	write_compressed_program(memory, 0x1000);
+	hart.set_register(pc, 0x1000);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.trap, Rv_trap_cause::illegal_instruction);
+	EXPECT_EQ(result.retired, 0);
+
+	// Enabling the extension drops instructions decoded without it
+	hart.set_compressed_enabled(true);
+	result = hart.run(1000);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(result.retired, 48);
+}
+
+TEST(run, CompressedAllowsTwoByteAlignedTargets) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_compressed_enabled(true);
+
+	memory.write_32(0x500, Rv32_encoder::encode_addi(a0, a0, 1));
+	memory.write_32(0x504, Rv32_encoder::encode_jalr(ra, t0, Rv_itype_imm::from_signed(0)));
+	memory.write_32(0x602, Rv32_encoder::encode_ecall());
+
+	hart.set_register(t0, 0x602);
+	hart.set_register(pc, 0x500);
+	const auto result = hart.run(1000);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(result.retired, 2);
+	EXPECT_EQ(hart.get_register(pc), 0x602);
+	EXPECT_EQ(hart.get_register(ra), 0x508);
+}
+
+TEST(run, MisalignedJumpTarget) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	memory.write_32(0x500, Rv32_encoder::encode_addi(a0, a0, 1));
+	memory.write_32(0x504, Rv32_encoder::encode_jalr(ra, t0, Rv_itype_imm::from_signed(0)));
+
+	hart.set_register(t0, 0x602);
+	hart.set_register(pc, 0x500);
+	const auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.trap, Rv_trap_cause::instruction_address_misaligned);
+	EXPECT_EQ(result.retired, 1);
+
+	// Everything before the jump has executed; the jump has not
+	EXPECT_EQ(hart.get_register(a0), 1);
+	EXPECT_EQ(hart.get_register(pc), 0x504);
+	EXPECT_EQ(hart.get_register(ra), 0);
+}
+
+TEST(run, StopsAtBreakpoint) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	const auto expected_count = write_sum_program(memory, 0x500, 10);
+
+	// Run the program once so its blocks exist before the breakpoint splits them
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.run(1000).retired, expected_count);
+
+	// A breakpoint in the middle of the loop body stops every iteration before the instruction runs
+	hart.add_breakpoint(0x50C);
+	EXPECT_TRUE(hart.has_breakpoint(0x50C));
+	hart.set_register(pc, 0x500);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::breakpoint);
+	EXPECT_EQ(result.retired, 3);
+	EXPECT_EQ(hart.get_register(pc), 0x50C);
+	EXPECT_EQ(hart.get_register(t0), 10);
+
+	for (int i = 9; i > 0; --i)
+	{
+		result = hart.run(1000);
+		EXPECT_EQ(result.reason, Rv_stop_reason::breakpoint);
+		EXPECT_EQ(result.retired, 3);
+		EXPECT_EQ(hart.get_register(t0), i);
+	}
+
+	// Resuming runs the instruction at the breakpoint
+	hart.remove_breakpoint(0x50C);
+	EXPECT_FALSE(hart.has_breakpoint(0x50C));
+	result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.retired, 2);
+	EXPECT_EQ(hart.get_register(a0), 55);
+
+	// A breakpoint at the start of a loop stops before it even though the loop jumps back to itself
+	hart.add_breakpoint(0x508);
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.run(1000).retired, 2);
+	EXPECT_EQ(hart.run(1000).retired, 3);
+	EXPECT_EQ(hart.get_register(pc), 0x508);
+	EXPECT_EQ(hart.run(1000).reason, Rv_stop_reason::breakpoint);
+	EXPECT_EQ(hart.get_register(t0), 8);
+
+	// The budget still applies
+	result = hart.run(1);
+	EXPECT_EQ(result.reason, Rv_stop_reason::budget_exhausted);
+	EXPECT_EQ(result.retired, 1);
+}
+
+TEST(run, BreakpointsShareCodePages) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	write_sum_program(memory, 0x500, 10);
+
+	hart.add_breakpoint(0x508);
+	hart.add_breakpoint(0x510);
+	hart.add_breakpoint(0x1508);
+	EXPECT_FALSE(hart.has_breakpoint(0x509));
+	EXPECT_FALSE(hart.has_breakpoint(0x2508));
+
+	// Removing one breakpoint keeps the others in its page
+	hart.remove_breakpoint(0x508);
+	hart.remove_breakpoint(0x508);
+	EXPECT_FALSE(hart.has_breakpoint(0x508));
+	EXPECT_TRUE(hart.has_breakpoint(0x510));
+	EXPECT_TRUE(hart.has_breakpoint(0x1508));
+
+	hart.set_register(pc, 0x500);
+	const auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::breakpoint);
+	EXPECT_EQ(result.retired, 4);
+	EXPECT_EQ(hart.get_register(pc), 0x510);
+}
+
+TEST(run, StopsAtWatchpoint) {
+
+	using enum Rv_register_id;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// 0x500: addi t0, zero, 0x100
+	// 0x504: lw   a0, 0(t0)
+	// 0x508: sw   a0, 8(t0)
+	// 0x50C: addi a1, a1, 1
+	// 0x510: ecall
+	using E = Rv32_encoder;
+	memory.write_32(0x500, E::encode_addi(t0, zero, 0x100));
+	memory.write_32(0x504, E::encode_lw(a0, t0, 0));
+	memory.write_32(0x508, E::encode_sw(t0, a0, 8));
+	memory.write_32(0x50C, E::encode_addi(a1, a1, 1));
+	memory.write_32(0x510, E::encode_ecall());
+	memory.write_32(0x100, 42);
+
+	// Warm up the blocks, which are translated again when watchpoints are added
+	hart.set_register(pc, 0x500);
+	EXPECT_EQ(hart.run(1000).retired, 4);
+
+	memory.add_watchpoint(0x108, 4, Watch_type::write);
+	memory.add_watchpoint(0x500, 0x20, Watch_type::read);
+	hart.set_register(pc, 0x500);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::watchpoint);
+	EXPECT_EQ(result.retired, 3);
+
+	// Stops right after the store. Instruction fetches from the watched code don't count.
+	EXPECT_EQ(hart.get_register(pc), 0x50C);
+	EXPECT_EQ(memory.read_32(0x108), 42);
+	EXPECT_EQ(hart.get_register(a1), 1);
+	ASSERT_TRUE(hart.get_watchpoint_hit());
+	EXPECT_EQ(hart.get_watchpoint_hit()->address, 0x108);
+	EXPECT_EQ(hart.get_watchpoint_hit()->type, Watch_type::write);
+
+	result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.retired, 1);
+	EXPECT_FALSE(hart.get_watchpoint_hit());
+
+	// A hit on the last instruction of the budget is reported too
+	memory.add_watchpoint(0x100, 4, Watch_type::read);
+	hart.set_register(pc, 0x500);
+	result = hart.run(2);
+	EXPECT_EQ(result.reason, Rv_stop_reason::watchpoint);
+	EXPECT_EQ(result.retired, 2);
+	EXPECT_EQ(hart.get_watchpoint_hit()->address, 0x100);
+
+	// Removing the watchpoints runs the program through
+	memory.remove_watchpoint(0x100);
+	memory.remove_watchpoint(0x108);
+	memory.remove_watchpoint(0x500);
+	hart.set_register(pc, 0x500);
+	result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.retired, 4);
+}
+
+TEST(run, StopsAtWatchpointInTranslatedLoads) {
+
+	using enum Rv_register_id;
+	auto memory = Mapped_memory();
+	auto hart = Basic_rv32_hart<Mapped_memory>(memory, Rv32_engine::RISCV_SIM_TEST_ENGINE);
+	hart.set_jit_threshold(0);
+
+	// 0x500: addi t1, zero, 0x100
+	// 0x504: lui  t0, 0x2
+	// 0x508: lw   a0, 0(t1)
+	// 0x50C: lw   a1, -2(t0)
+	// 0x510: lw   a2, 8(t0)
+	// 0x514: addi a3, a3, 1
+	// 0x518: ecall
+	using E = Rv32_encoder;
+	memory.write_32(0x500, E::encode_addi(t1, zero, 0x100));
+	memory.write_32(0x504, E::encode_lui(t0, 0x2));
+	memory.write_32(0x508, E::encode_lw(a0, t1, 0));
+	memory.write_32(0x50C, E::encode_lw(a1, t0, -2));
+	memory.write_32(0x510, E::encode_lw(a2, t0, 8));
+	memory.write_32(0x514, E::encode_addi(a3, a3, 1));
+	memory.write_32(0x518, E::encode_ecall());
+	memory.write_32(0x100, 1);
+	memory.write_32(0x1FFC, 0x2222'0000);
+	memory.write_32(0x2000, 0x2222);
+	memory.write_32(0x2008, 3);
+
+	// Loads from unwatched pages and unwatched bytes of a watched page run on
+	hart.set_register(pc, 0x500);
+	memory.add_watchpoint(0x2008, 4, Watch_type::read);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::watchpoint);
+	EXPECT_EQ(result.retired, 5);
+	EXPECT_EQ(hart.get_register(pc), 0x514);
+	EXPECT_EQ(hart.get_register(a0), 1);
+	EXPECT_EQ(hart.get_register(a1), 0x2222'2222);
+	EXPECT_EQ(hart.get_register(a2), 3);
+	EXPECT_EQ(hart.get_register(a3), 0);
+	ASSERT_TRUE(hart.get_watchpoint_hit());
+	EXPECT_EQ(hart.get_watchpoint_hit()->address, 0x2008);
+
+	// A load that starts on an unwatched page can still straddle into a watched range
+	memory.remove_watchpoint(0x2008);
+	memory.add_watchpoint(0x2000, 1, Watch_type::read);
+	hart.set_register(pc, 0x500);
+	result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::watchpoint);
+	EXPECT_EQ(result.retired, 4);
+	EXPECT_EQ(hart.get_register(pc), 0x510);
+	ASSERT_TRUE(hart.get_watchpoint_hit());
+	EXPECT_EQ(hart.get_watchpoint_hit()->address, 0x1FFE);
+
+	memory.remove_watchpoint(0x2000);
+	hart.set_register(pc, 0x500);
+	result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.retired, 6);
+	EXPECT_EQ(hart.get_register(a3), 1);
+}
+
+TEST(run, RequestHalt) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	const auto expected_count = write_sum_program(memory, 0x500, 10);
+
+	// A halt requested before running stops at the first block boundary
+	hart.set_register(Rv_register_id::pc, 0x500);
+	hart.request_halt();
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::halted);
+	EXPECT_LT(result.retired, expected_count);
+
+	// The request is cleared once it has stopped the hart
+	const auto retired = result.retired;
+	result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.retired, expected_count - retired);
+	EXPECT_EQ(hart.get_register(Rv_register_id::a0), 55);
+}
+
+TEST(run, RestoresSnapshots) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// Increments a counter, then overwrites its own increment with one of 100
+	const uint32_t code[] = {
+		E::encode_lw(t0, zero, 0x600),
+		E::encode_addi(t0, t0, 1),
+		E::encode_sw(zero, t0, 0x600),
+		E::encode_lw(t1, zero, 0x604),
+		E::encode_sw(zero, t1, 0x504),
+		E::encode_ecall(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(0x500 + i * 4, code[i]);
+
+	memory.write_32(0x600, 5);
+	memory.write_32(0x604, E::encode_addi(t0, t0, 100));
+
+	hart.set_register(pc, 0x500);
+	memory.take_snapshot();
+	const auto state = hart.get_state();
+
+	// Restoring brings back the counter and the code, and the code runs as it was
+	for (int i = 0; i < 2; ++i)
+	{
+		const auto result = hart.run(1000);
+		EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+		EXPECT_EQ(hart.get_register(t0), 6);
+		EXPECT_EQ(hart.get_instret(), 5);
+
+		EXPECT_EQ(memory.restore_snapshot(), 1);
+		hart.set_state(state);
+		EXPECT_EQ(memory.read_32(0x600), 5);
+		EXPECT_EQ(hart.get_register(pc), 0x500);
+		EXPECT_EQ(hart.get_register(t0), 0);
+		EXPECT_EQ(hart.get_instret(), 0);
+	}
+
+	// Without a snapshot the code keeps its change
+	memory.discard_snapshot();
+	hart.run(1000);
+	hart.set_state(state);
+	hart.run(1000);
+	EXPECT_EQ(hart.get_register(t0), 106);
+}
+
+TEST(run, CountsCoverageEdges) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+
+	// A loop whose head is inside the block before it
+	const uint32_t code[] = {
+		E::encode_addi(t0, zero, 10),
+		E::encode_addi(t0, t0, -1),
+		E::encode_bne(t0, zero, -4),
+		E::encode_ebreak(),
+	};
+
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(0x500 + i * 4, code[i]);
+
+	auto map = std::vector<uint8_t>(rv_coverage_map_size);
+	hart.set_coverage_map(map.data());
+
+	// Both engines take the edge into the run, out of the first block, around the loop 8 times and out of it
+	for (int i = 0; i < 2; ++i)
+	{
+		std::ranges::fill(map, 0);
+		hart.reset_coverage_location();
+		hart.set_register(pc, 0x500);
+		EXPECT_EQ(hart.run(1000).trap, Rv_trap_cause::breakpoint);
+
+		const auto start = get_coverage_location(0x500);
+		const auto loop = get_coverage_location(0x504);
+		auto expected = std::vector<uint8_t>(rv_coverage_map_size);
+		++expected[start];
+		++expected[loop ^ (start >> 1)];
+		expected[loop ^ (loop >> 1)] += 8;
+		++expected[get_coverage_location(0x50C) ^ (loop >> 1)];
+		EXPECT_EQ(map, expected);
+	}
+
+	hart.set_coverage_map(nullptr);
+	std::ranges::fill(map, 0);
+	hart.set_register(pc, 0x500);
+	hart.run(1000);
+	EXPECT_EQ(std::ranges::count(map, 0), rv_coverage_map_size);
+}
+
 /* --------------------------------------------------------
 ADD
 -------------------------------------------------------- */
@@ -730,7 +2510,7 @@ ADD
 TEST(execute_add, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 14);
 	hart.execute_add(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -742,7 +2522,7 @@ TEST(execute_add, DifferentRegisters) {
 TEST(execute_add, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.execute_add(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 8);
@@ -756,7 +2536,7 @@ TEST(execute_addi, AddZeroToX0) {
 
 	// Add zero and store in zero register
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.execute_addi(Rv_register_id::x0, Rv_register_id::x1, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x0), 0);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -766,7 +2546,7 @@ TEST(execute_addi, AddNonZeroToX0) {
 
 	// Add non-zero and store in zero register (zero register can't be changed)
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.execute_addi(Rv_register_id::x0, Rv_register_id::x1, Rv_itype_imm::from_signed(21));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x0), 0);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -776,7 +2556,7 @@ TEST(execute_addi, AddWithSameDestAndSrc) {
 
 	// Use same register for rd and rs1
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.execute_addi(Rv_register_id::x1, Rv_register_id::x1, Rv_itype_imm::from_signed(21));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 21);
 
@@ -790,7 +2570,7 @@ TEST(execute_addi, AddWithDiffDestAndSrc) {
 
 	// Use different register for rd and rs1
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.execute_addi(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(21));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 21);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0);
@@ -806,7 +2586,7 @@ TEST(execute_addi, OverflowIgnored) {
 
 	// Arithmetic overflow is ignored and the result is simply the low XLEN bits of the result.
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x5, 0xFFFFFFFF);
 	hart.execute_addi(Rv_register_id::x5, Rv_register_id::x5, Rv_itype_imm::from_signed(1));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 0);
@@ -816,7 +2596,7 @@ TEST(execute_addi, NOP) {
 
 	// NOP is encoded as ADDI x0, x0, 0
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.execute_addi(Rv_register_id::x0, Rv_register_id::x0, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x0), 0);
 }
@@ -825,10 +2605,74 @@ TEST(execute_addi, NOP) {
 AND
 -------------------------------------------------------- */
 
+TEST(execute_amo_w, AllOperations) {
+
+	using Hart = Basic_rv32_hart<Paged_memory>;
+	struct Amo_case
+	{
+		void (Hart::* execute)(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+		uint32_t expected;
+	};
+
+	const Amo_case cases[] = {
+		{ &Hart::execute_amoswap_w, 7 },
+		{ &Hart::execute_amoadd_w, 0x8000'000C },
+		{ &Hart::execute_amoxor_w, 0x8000'0002 },
+		{ &Hart::execute_amoand_w, 0x5 },
+		{ &Hart::execute_amoor_w, 0x8000'0007 },
+		{ &Hart::execute_amomin_w, 0x8000'0005 },
+		{ &Hart::execute_amomax_w, 7 },
+		{ &Hart::execute_amominu_w, 7 },
+		{ &Hart::execute_amomaxu_w, 0x8000'0005 },
+	};
+
+	auto memory = Paged_memory();
+	auto hart = Hart(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 7);
+
+	for (const auto& amo : cases)
+	{
+		memory.write_32(0x600, 0x8000'0005);
+		(hart.*amo.execute)(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+		EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x8000'0005);
+		EXPECT_EQ(memory.read_32(0x600), amo.expected);
+	}
+
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::none);
+}
+
+TEST(execute_amo_w, WithoutHostStorage) {
+
+	auto memory = Simple_memory_subsystem();
+	memory.write_32(0x600, 40);
+
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 2);
+	hart.execute_amoadd_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 40);
+	EXPECT_EQ(memory.read_32(0x600), 42);
+}
+
+TEST(execute_amo_w, AddressMisaligned) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0x600, 40);
+
+	auto hart = Basic_rv32_hart<Paged_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x602);
+	hart.set_register(Rv_register_id::x4, 2);
+	hart.execute_amoadd_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::store_address_misaligned);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0);
+	EXPECT_EQ(memory.read_32(0x600), 40);
+}
+
 TEST(execute_and, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b1101);
 	hart.set_register(Rv_register_id::x3, 0b1011);
 	hart.execute_and(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -840,7 +2684,7 @@ TEST(execute_and, DifferentRegisters) {
 TEST(execute_and, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0b1110);
 	hart.execute_and(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b1110);
@@ -853,7 +2697,7 @@ ANDI
 TEST(execute_andi, NoMatchingBits) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b01000000000000110);
 	hart.execute_andi(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0b1001));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -862,7 +2706,7 @@ TEST(execute_andi, NoMatchingBits) {
 TEST(execute_andi, MatchingBit) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b01000000000000110);
 	hart.execute_andi(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0b0100));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b0100);
@@ -875,7 +2719,7 @@ AUIPC
 TEST(execute_auipc, ValidInstruction) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x200);
 
 	// Only 20-bit immediate, ensure low 12 bits are ignored
@@ -890,7 +2734,7 @@ BEQ
 TEST(execute_beq, BranchTakenWithPositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -903,7 +2747,7 @@ TEST(execute_beq, BranchTakenWithPositiveOffset) {
 TEST(execute_beq, BranchTakenWithNegativeOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -916,7 +2760,7 @@ TEST(execute_beq, BranchTakenWithNegativeOffset) {
 TEST(execute_beq, BranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 7);
@@ -929,18 +2773,19 @@ TEST(execute_beq, BranchNotTaken) {
 TEST(execute_beq, AddressMisalignedAndBranchTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
 
-	EXPECT_THROW_EX(hart.execute_beq(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2)), "instruction-address-misaligned");
+	hart.execute_beq(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 TEST(execute_beq, AddressMisalignedButBranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 7);
@@ -959,7 +2804,7 @@ TEST(execute_bge, BranchTakenBecauseGreaterThan) {
 	// rs1 > rs2, branch taken
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 5);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -984,7 +2829,7 @@ TEST(execute_bge, BranchTakenBecauseEqualTo) {
 	// rs1 == rs2, branch taken
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -999,7 +2844,7 @@ TEST(execute_bge, BranchNotTaken) {
 	// rs1 < rs2, so PC gets advanced to next instruction
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1022,18 +2867,19 @@ TEST(execute_bge, BranchNotTaken) {
 TEST(execute_bge, AddressMisalignedAndBranchTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 3);
 
-	EXPECT_THROW_EX(hart.execute_bge(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2)), "instruction-address-misaligned");
+	hart.execute_bge(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 TEST(execute_bge, AddressMisalignedButBranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1052,7 +2898,7 @@ TEST(execute_bgeu, BranchTakenBecauseGreaterThan) {
 	// rs1 > rs2, branch taken
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 5);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1078,7 +2924,7 @@ TEST(execute_bgeu, BranchTakenBecauseEqualTo) {
 	// rs1 == rs2, branch taken
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1093,7 +2939,7 @@ TEST(execute_bgeu, BranchNotTaken) {
 	// rs1 < rs2, so PC gets advanced to next instruction
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1117,18 +2963,19 @@ TEST(execute_bgeu, BranchNotTaken) {
 TEST(execute_bgeu, AddressMisalignedAndBranchTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 3);
 
-	EXPECT_THROW_EX(hart.execute_bgeu(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2)), "instruction-address-misaligned");
+	hart.execute_bgeu(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 TEST(execute_bgeu, AddressMisalignedButBranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1147,7 +2994,7 @@ TEST(execute_blt, BranchTaken) {
 	// rs1 < rs2, branch taken
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1172,7 +3019,7 @@ TEST(execute_blt, BranchNotTakenBecauseEqualTo) {
 	// rs1 == rs2, so PC gets advanced to next instruction
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1187,7 +3034,7 @@ TEST(execute_blt, BranchNotTakenBecauseGreaterThan) {
 	// rs1 > rs2, so PC gets advanced to next instruction
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 5);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1210,18 +3057,19 @@ TEST(execute_blt, BranchNotTakenBecauseGreaterThan) {
 TEST(execute_blt, AddressMisalignedAndBranchTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 3);
 	hart.set_register(Rv_register_id::x3, 4);
 
-	EXPECT_THROW_EX(hart.execute_blt(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2)), "instruction-address-misaligned");
+	hart.execute_blt(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 TEST(execute_blt, AddressMisalignedButBranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 3);
@@ -1240,7 +3088,7 @@ TEST(execute_bltu, BranchTaken) {
 	// rs1 < rs2, branch taken
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1266,7 +3114,7 @@ TEST(execute_bltu, BranchNotTakenBecauseEqualTo) {
 	// rs1 == rs2, so PC gets advanced to next instruction
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1281,7 +3129,7 @@ TEST(execute_bltu, BranchNotTakenBecauseGreaterThan) {
 	// rs1 > rs2, so PC gets advanced to next instruction
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 5);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1305,18 +3153,19 @@ TEST(execute_bltu, BranchNotTakenBecauseGreaterThan) {
 TEST(execute_bltu, AddressMisalignedAndBranchTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 3);
 	hart.set_register(Rv_register_id::x3, 4);
 
-	EXPECT_THROW_EX(hart.execute_bltu(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2)), "instruction-address-misaligned");
+	hart.execute_bltu(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 TEST(execute_bltu, AddressMisalignedButBranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 3);
@@ -1333,7 +3182,7 @@ BNE
 TEST(execute_bne, BranchTakenWithPositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1346,7 +3195,7 @@ TEST(execute_bne, BranchTakenWithPositiveOffset) {
 TEST(execute_bne, BranchTakenWithNegativeOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 5);
@@ -1359,7 +3208,7 @@ TEST(execute_bne, BranchTakenWithNegativeOffset) {
 TEST(execute_bne, BranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 464);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1372,18 +3221,19 @@ TEST(execute_bne, BranchNotTaken) {
 TEST(execute_bne, AddressMisalignedAndBranchTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 7);
 
-	EXPECT_THROW_EX(hart.execute_bne(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2)), "instruction-address-misaligned");
+	hart.execute_bne(Rv_register_id::x2, Rv_register_id::x3, Rv_btype_imm::from_offset(2));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 TEST(execute_bne, AddressMisalignedButBranchNotTaken) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 400);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 4);
@@ -1393,6 +3243,66 @@ TEST(execute_bne, AddressMisalignedButBranchNotTaken) {
 	EXPECT_EQ(hart.get_register(Rv_register_id::x3), 4);
 }
 
+/* --------------------------------------------------------
+DIV
+-------------------------------------------------------- */
+
+TEST(execute_div, RoundsTowardZero) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, -7);
+	hart.set_register(Rv_register_id::x3, 2);
+	hart.execute_div(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), -3);
+}
+
+TEST(execute_div, DivideByZero) {
+
+	// Division by zero gives all ones instead of trapping
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, -7);
+	hart.set_register(Rv_register_id::x3, 0);
+	hart.execute_div(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFFFFFF);
+}
+
+TEST(execute_div, Overflow) {
+
+	// The most negative value divided by -1 overflows and gives the dividend
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0x80000000);
+	hart.set_register(Rv_register_id::x3, -1);
+	hart.execute_div(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x80000000);
+}
+
+/* --------------------------------------------------------
+DIVU
+-------------------------------------------------------- */
+
+TEST(execute_divu, LargeValues) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0xFFFFFFF0);
+	hart.set_register(Rv_register_id::x3, 2);
+	hart.execute_divu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x7FFFFFF8);
+}
+
+TEST(execute_divu, DivideByZero) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 7);
+	hart.set_register(Rv_register_id::x3, 0);
+	hart.execute_divu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFFFFFF);
+}
+
 /* --------------------------------------------------------
 JAL
 -------------------------------------------------------- */
@@ -1400,7 +3310,7 @@ JAL
 TEST(execute_jal, PositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0x20));
 	
@@ -1414,7 +3324,7 @@ TEST(execute_jal, PositiveOffset) {
 TEST(execute_jal, PositiveOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0xFFFFFFFC);
 	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 4);
@@ -1424,7 +3334,7 @@ TEST(execute_jal, PositiveOffsetWrapAround) {
 TEST(execute_jal, NegativeOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(-0x20));
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x20);
@@ -1434,7 +3344,7 @@ TEST(execute_jal, NegativeOffset) {
 TEST(execute_jal, NegativeOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(-0x60));
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), -0x20);
@@ -1446,7 +3356,7 @@ TEST(execute_jal, NoOffset) {
 	// This would result in an infinite loop, but I don't see anything that technically prohibits this
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x40);
@@ -1456,17 +3366,22 @@ TEST(execute_jal, NoOffset) {
 TEST(execute_jal, TargetAddressMisaligned) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
-	const auto expected_message = "instruction-address-misaligned";
-	
+	auto hart = Test_hart(memory);
+
+	// The jump has no effect
 	hart.set_register(Rv_register_id::pc, 0x41);
-	EXPECT_THROW_EX(hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0)), expected_message);
+	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), 0x41);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
 
 	hart.set_register(Rv_register_id::pc, 0x42);
-	EXPECT_THROW_EX(hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0)), expected_message);
+	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 	
 	hart.set_register(Rv_register_id::pc, 0x43);
-	EXPECT_THROW_EX(hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0)), expected_message);
+	hart.execute_jal(Rv_register_id::x1, Rv_jtype_imm::from_offset(0));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 /* --------------------------------------------------------
@@ -1476,7 +3391,7 @@ JALR
 TEST(execute_jalr, PositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.set_register(Rv_register_id::x2, 0x80);
 	hart.execute_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0x10));
@@ -1491,7 +3406,7 @@ TEST(execute_jalr, PositiveOffset) {
 TEST(execute_jalr, PositiveOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.set_register(Rv_register_id::x2, 0xFFFFFF00);
 	hart.execute_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0x104));
@@ -1503,7 +3418,7 @@ TEST(execute_jalr, PositiveOffsetWrapAround) {
 TEST(execute_jalr, NegativeOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.set_register(Rv_register_id::x2, 0x80);
 	hart.execute_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(-0x10));
@@ -1515,7 +3430,7 @@ TEST(execute_jalr, NegativeOffset) {
 TEST(execute_jalr, NegativeOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.set_register(Rv_register_id::x2, 0x4);
 	hart.execute_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(-0x104));
@@ -1530,7 +3445,7 @@ TEST(execute_jalr, LeastSigBitSetToZero) {
 	// is set to zero.
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::pc, 0x40);
 	hart.set_register(Rv_register_id::x2, 0x4);
 	hart.execute_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(1));
@@ -1549,10 +3464,10 @@ TEST(execute_jalr, TargetAddressMisaligned) {
 	// also a four byte boundary.
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
-	const auto expected_message = "instruction-address-misaligned";
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0x52);
-	EXPECT_THROW_EX(hart.execute_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0)), expected_message);
+	hart.execute_jalr(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0));
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::instruction_address_misaligned);
 }
 
 /* --------------------------------------------------------
@@ -1567,7 +3482,7 @@ TEST(execute_lb, PositiveOffset) {
 	memory.write_8(98, 3);
 	memory.write_8(99, 4);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lb(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 1);
@@ -1582,7 +3497,7 @@ TEST(execute_lb, PositiveOffsetWrapAround) {
 	memory.write_8(6, 30);
 	memory.write_8(7, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 0xFFFFFFFC);
 	hart.execute_lb(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 10);
@@ -1597,7 +3512,7 @@ TEST(execute_lb, NegativeOffset) {
 	memory.write_8(34, 30);
 	memory.write_8(35, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lb(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 10);
@@ -1612,7 +3527,7 @@ TEST(execute_lb, NegativeOffsetWrapAround) {
 	memory.write_8(0xFFFFFFFE, 30);
 	memory.write_8(0xFFFFFFFF, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lb(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 10);
@@ -1627,7 +3542,7 @@ TEST(execute_lb, ZeroOffset) {
 	memory.write_8(6, 30);
 	memory.write_8(7, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 6);
 	hart.execute_lb(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 30);
@@ -1644,7 +3559,7 @@ TEST(execute_lb, MisalignedAccess) {
 	memory.write_8(6, 30);
 	memory.write_8(7, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lb(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(1));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 20);
@@ -1658,7 +3573,7 @@ TEST(execute_lb, SignExtended) {
 	auto memory = Simple_memory_subsystem();
 	memory.write_8(4, 0b1000'0000);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lb(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), -1 << 7);
@@ -1676,7 +3591,7 @@ TEST(execute_lbu, PositiveOffset) {
 	memory.write_8(98, 3);
 	memory.write_8(99, 4);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lbu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 1);
@@ -1691,7 +3606,7 @@ TEST(execute_lbu, PositiveOffsetWrapAround) {
 	memory.write_8(6, 30);
 	memory.write_8(7, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 0xFFFFFFFC);
 	hart.execute_lbu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 10);
@@ -1706,7 +3621,7 @@ TEST(execute_lbu, NegativeOffset) {
 	memory.write_8(34, 30);
 	memory.write_8(35, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lbu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 10);
@@ -1721,7 +3636,7 @@ TEST(execute_lbu, NegativeOffsetWrapAround) {
 	memory.write_8(0xFFFFFFFE, 30);
 	memory.write_8(0xFFFFFFFF, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lbu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 10);
@@ -1736,7 +3651,7 @@ TEST(execute_lbu, ZeroOffset) {
 	memory.write_8(6, 30);
 	memory.write_8(7, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 6);
 	hart.execute_lbu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 30);
@@ -1753,7 +3668,7 @@ TEST(execute_lbu, MisalignedAccess) {
 	memory.write_8(6, 30);
 	memory.write_8(7, 40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lbu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(1));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 20);
@@ -1767,7 +3682,7 @@ TEST(execute_lbu, NotSignExtended) {
 	auto memory = Simple_memory_subsystem();
 	memory.write_8(4, 0b1000'0000);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lbu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0b1000'0000);
@@ -1785,7 +3700,7 @@ TEST(execute_lh, PositiveOffset) {
 	memory.write_8(98, 0x30);
 	memory.write_8(99, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lh(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1800,7 +3715,7 @@ TEST(execute_lh, PositiveOffsetWrapAround) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 0xFFFFFFFC);
 	hart.execute_lh(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1815,7 +3730,7 @@ TEST(execute_lh, NegativeOffset) {
 	memory.write_8(34, 0x30);
 	memory.write_8(35, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lh(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1830,7 +3745,7 @@ TEST(execute_lh, NegativeOffsetWrapAround) {
 	memory.write_8(0xFFFFFFFE, 0x30);
 	memory.write_8(0xFFFFFFFF, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lh(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1845,7 +3760,7 @@ TEST(execute_lh, ZeroOffset) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 6);
 	hart.execute_lh(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x4030);
@@ -1862,7 +3777,7 @@ TEST(execute_lh, MisalignedAccess) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lh(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(1));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x3020);
@@ -1877,7 +3792,7 @@ TEST(execute_lh, SignExtended) {
 	memory.write_8(4, 0b0000'0000);
 	memory.write_8(5, 0b1000'0000);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lh(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), -1 << 15);
@@ -1895,7 +3810,7 @@ TEST(execute_lhu, PositiveOffset) {
 	memory.write_8(98, 0x30);
 	memory.write_8(99, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lhu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1910,7 +3825,7 @@ TEST(execute_lhu, PositiveOffsetWrapAround) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 0xFFFFFFFC);
 	hart.execute_lhu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1925,7 +3840,7 @@ TEST(execute_lhu, NegativeOffset) {
 	memory.write_8(34, 0x30);
 	memory.write_8(35, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lhu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1940,7 +3855,7 @@ TEST(execute_lhu, NegativeOffsetWrapAround) {
 	memory.write_8(0xFFFFFFFE, 0x30);
 	memory.write_8(0xFFFFFFFF, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lhu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x2010);
@@ -1955,7 +3870,7 @@ TEST(execute_lhu, ZeroOffset) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 6);
 	hart.execute_lhu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x4030);
@@ -1972,7 +3887,7 @@ TEST(execute_lhu, MisalignedAccess) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lhu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(1));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x3020);
@@ -1987,7 +3902,7 @@ TEST(execute_lhu, SignExtended) {
 	memory.write_8(4, 0b0000'0000);
 	memory.write_8(5, 0b1000'0000);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lhu(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 1 << 15);
@@ -1997,6 +3912,156 @@ TEST(execute_lhu, SignExtended) {
 LW
 -------------------------------------------------------- */
 
+TEST(execute_lr_w, AddressMisaligned) {
+
+	auto memory = Paged_memory();
+	auto hart = Basic_rv32_hart<Paged_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x601);
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::load_address_misaligned);
+}
+
+TEST(execute_sc_w, SucceedsWithReservation) {
+
+	auto memory = Paged_memory();
+	memory.write_32(0x600, 0x8000'0000);
+
+	auto hart = Basic_rv32_hart<Paged_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 42);
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x8000'0000);
+
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 0);
+	EXPECT_EQ(memory.read_32(0x600), 42);
+
+	// The SC used up the reservation
+	hart.set_register(Rv_register_id::x4, 43);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	EXPECT_EQ(memory.read_32(0x600), 42);
+}
+
+TEST(execute_sc_w, FailsWithoutHostStorage) {
+
+	// Without host storage the SC still compares the word with the one LR read
+	auto memory = Simple_memory_subsystem();
+	memory.write_32(0x600, 1);
+
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 42);
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	memory.write_32(0x600, 2);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	EXPECT_EQ(memory.read_32(0x600), 2);
+
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 0);
+	EXPECT_EQ(memory.read_32(0x600), 42);
+}
+
+TEST(execute_sc_w, FailsAfterOtherHartsWrite) {
+
+	auto memory = Paged_memory();
+	auto hart = Basic_rv32_hart<Paged_memory>(memory);
+	auto other = Basic_rv32_hart<Paged_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 42);
+	other.set_register(Rv_register_id::x3, 0x604);
+
+	// An AMO in the same granule loses the reservation, even though the word is unchanged
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	other.execute_amoadd_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	EXPECT_EQ(memory.read_32(0x600), 0);
+
+	// So does a successful SC by another hart
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	other.set_register(Rv_register_id::x3, 0x600);
+	other.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	other.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(other.get_register(Rv_register_id::x5), 0);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+
+	// A plain store that changes the word does too
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	memory.write_32(0x600, 1);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	EXPECT_EQ(memory.read_32(0x600), 1);
+}
+
+TEST(execute_sc_w, OnlyStoresNotifyWrites) {
+
+	struct Recording_listener : Watchpoint_listener
+	{
+		void on_watchpoint_hit(const Watchpoint_hit& hit) override { types.push_back(hit.type); }
+
+		std::vector<Watch_type> types;
+	};
+
+	auto memory = Paged_memory();
+	auto hart = Basic_rv32_hart<Paged_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 42);
+	memory.write_32(0x600, 5);
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	memory.write_32(0x600, 6);
+
+	auto listener = Recording_listener();
+	memory.attach_watchpoint_listener(listener);
+	memory.add_watchpoint(0x600, 4, Watch_type::read_write);
+	memory.take_snapshot();
+
+	// An SC that fails on a changed word writes nothing, and an AMO that leaves the word as it was only reads it
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	hart.set_register(Rv_register_id::x4, 1);
+	hart.execute_amomax_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 6);
+	EXPECT_EQ(listener.types, std::vector<Watch_type>({ Watch_type::read }));
+	EXPECT_EQ(memory.restore_snapshot(), 0);
+
+	// One that changes it writes
+	hart.execute_amoadd_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(listener.types.back(), Watch_type::write);
+	EXPECT_EQ(memory.restore_snapshot(), 1);
+	EXPECT_EQ(memory.read_32(0x600), 6);
+
+	memory.detach_watchpoint_listener(listener);
+}
+
+TEST(execute_sc_w, FailsAtOtherAddress) {
+
+	auto memory = Paged_memory();
+	auto hart = Basic_rv32_hart<Paged_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 0x604);
+	hart.set_register(Rv_register_id::x6, 42);
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x4, Rv_register_id::x6);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	EXPECT_EQ(memory.read_32(0x604), 0);
+}
+
+TEST(execute_sc_w, AddressMisaligned) {
+
+	auto memory = Paged_memory();
+	auto hart = Basic_rv32_hart<Paged_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x600);
+	hart.set_register(Rv_register_id::x4, 0x602);
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x4, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::store_address_misaligned);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 0);
+}
+
 TEST(execute_lw, PositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
@@ -2005,7 +4070,7 @@ TEST(execute_lw, PositiveOffset) {
 	memory.write_8(98, 0x30);
 	memory.write_8(99, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lw(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x40302010);
@@ -2020,7 +4085,7 @@ TEST(execute_lw, PositiveOffsetWrapAround) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 0xFFFFFFFC);
 	hart.execute_lw(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x40302010);
@@ -2035,7 +4100,7 @@ TEST(execute_lw, NegativeOffset) {
 	memory.write_8(34, 0x30);
 	memory.write_8(35, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 64);
 	hart.execute_lw(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-32));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x40302010);
@@ -2050,7 +4115,7 @@ TEST(execute_lw, NegativeOffsetWrapAround) {
 	memory.write_8(0xFFFFFFFE, 0x30);
 	memory.write_8(0xFFFFFFFF, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lw(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(-8));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x40302010);
@@ -2065,7 +4130,7 @@ TEST(execute_lw, ZeroOffset) {
 	memory.write_8(6, 0x30);
 	memory.write_8(7, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lw(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(0));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x40302010);
@@ -2082,7 +4147,7 @@ TEST(execute_lw, MisalignedAccess) {
 	memory.write_8(7, 0x30);
 	memory.write_8(8, 0x40);
 
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_lw(Rv_register_id::x2, Rv_register_id::x3, Rv_itype_imm::from_signed(1));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x40302010);
@@ -2096,13 +4161,100 @@ LUI
 TEST(execute_lui, ValidInstruction) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	// Only 20-bit immediate, ensure low 12 bits are cleared
 	hart.execute_lui(Rv_register_id::x1, Rv_utype_imm::from_decoded(0b0101'1111'0101'1111'0101'1111'1111'1111));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b0101'1111'0101'1111'0101'0000'0000'0000);
 }
 
+/* --------------------------------------------------------
+MUL
+-------------------------------------------------------- */
+
+TEST(execute_mul, Signed) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, -5);
+	hart.set_register(Rv_register_id::x3, 7);
+	hart.execute_mul(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), -35);
+}
+
+TEST(execute_mul, KeepsLowBits) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0x10000);
+	hart.set_register(Rv_register_id::x3, 0x10001);
+	hart.execute_mul(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x10000);
+}
+
+/* --------------------------------------------------------
+MULH
+-------------------------------------------------------- */
+
+TEST(execute_mulh, Negative) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, -5);
+	hart.set_register(Rv_register_id::x3, 7);
+	hart.execute_mulh(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFFFFFF);
+}
+
+TEST(execute_mulh, MostNegative) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0x80000000);
+	hart.set_register(Rv_register_id::x3, 0x80000000);
+	hart.execute_mulh(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x40000000);
+}
+
+/* --------------------------------------------------------
+MULHSU
+-------------------------------------------------------- */
+
+TEST(execute_mulhsu, SignedTimesUnsigned) {
+
+	// rs2 is unsigned, so -1 x 0xFFFFFFFF is -(2^32 - 1)
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, -1);
+	hart.set_register(Rv_register_id::x3, 0xFFFFFFFF);
+	hart.execute_mulhsu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFFFFFF);
+}
+
+TEST(execute_mulhsu, Positive) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0x40000000);
+	hart.set_register(Rv_register_id::x3, 0x80000000);
+	hart.execute_mulhsu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x20000000);
+}
+
+/* --------------------------------------------------------
+MULHU
+-------------------------------------------------------- */
+
+TEST(execute_mulhu, Unsigned) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0xFFFFFFFF);
+	hart.set_register(Rv_register_id::x3, 0xFFFFFFFF);
+	hart.execute_mulhu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFFFFFE);
+}
+
 /* --------------------------------------------------------
 OR
 -------------------------------------------------------- */
@@ -2110,7 +4262,7 @@ OR
 TEST(execute_or, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b1101);
 	hart.set_register(Rv_register_id::x3, 0b1011);
 	hart.execute_or(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2122,7 +4274,7 @@ TEST(execute_or, DifferentRegisters) {
 TEST(execute_or, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0b1110);
 	hart.execute_or(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b1110);
@@ -2135,12 +4287,71 @@ ORI
 TEST(execute_ori, ValidInstruction) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b01000000000000110);
 	hart.execute_ori(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0b1001));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b01000000000001111);
 }
 
+/* --------------------------------------------------------
+REM
+-------------------------------------------------------- */
+
+TEST(execute_rem, SignOfDividend) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, -7);
+	hart.set_register(Rv_register_id::x3, 2);
+	hart.execute_rem(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), -1);
+}
+
+TEST(execute_rem, DivideByZero) {
+
+	// Division by zero gives the dividend
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, -7);
+	hart.set_register(Rv_register_id::x3, 0);
+	hart.execute_rem(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), -7);
+}
+
+TEST(execute_rem, Overflow) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0x80000000);
+	hart.set_register(Rv_register_id::x3, -1);
+	hart.execute_rem(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
+}
+
+/* --------------------------------------------------------
+REMU
+-------------------------------------------------------- */
+
+TEST(execute_remu, LargeValues) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 0xFFFFFFFF);
+	hart.set_register(Rv_register_id::x3, 10);
+	hart.execute_remu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 5);
+}
+
+TEST(execute_remu, DivideByZero) {
+
+	auto memory = Simple_memory_subsystem();
+	auto hart = Test_hart(memory);
+	hart.set_register(Rv_register_id::x2, 7);
+	hart.set_register(Rv_register_id::x3, 0);
+	hart.execute_remu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 7);
+}
+
 /* --------------------------------------------------------
 SB
 -------------------------------------------------------- */
@@ -2148,7 +4359,7 @@ SB
 TEST(execute_sb, PositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0x100);
 	hart.set_register(Rv_register_id::x2, 0x50);
 	hart.execute_sb(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0x10));
@@ -2160,7 +4371,7 @@ TEST(execute_sb, PositiveOffset) {
 TEST(execute_sb, PositiveOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0xFFFFFFFC);
 	hart.set_register(Rv_register_id::x2, 0x50);
 	hart.execute_sb(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(8));
@@ -2172,7 +4383,7 @@ TEST(execute_sb, PositiveOffsetWrapAround) {
 TEST(execute_sb, NegativeOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 64);
 	hart.set_register(Rv_register_id::x2, 0x50);
 	hart.execute_sb(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(-32));
@@ -2184,7 +4395,7 @@ TEST(execute_sb, NegativeOffset) {
 TEST(execute_sb, NegativeOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, 0x50);
 	hart.execute_sb(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(-8));
@@ -2196,7 +4407,7 @@ TEST(execute_sb, NegativeOffsetWrapAround) {
 TEST(execute_sb, ZeroOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 6);
 	hart.set_register(Rv_register_id::x2, 0x50);
 	hart.execute_sb(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0));
@@ -2210,7 +4421,7 @@ TEST(execute_sb, MisalignedAccess) {
 	// Address 5 is not on a 4 or 2 byte boundary, but that is allowed
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, 0x50);
 	hart.execute_sb(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(1));
@@ -2224,7 +4435,7 @@ TEST(execute_sb, HighBitsOfRegisterIgnored) {
 	// Only the low 8 bits of the source register are stored
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, -1 << 7);
 	hart.execute_sb(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0));
@@ -2240,7 +4451,7 @@ SH
 TEST(execute_sh, PositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0x100);
 	hart.set_register(Rv_register_id::x2, 0x4050);
 	hart.execute_sh(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0x10));
@@ -2252,7 +4463,7 @@ TEST(execute_sh, PositiveOffset) {
 TEST(execute_sh, PositiveOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0xFFFFFFFC);
 	hart.set_register(Rv_register_id::x2, 0x4050);
 	hart.execute_sh(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(8));
@@ -2264,7 +4475,7 @@ TEST(execute_sh, PositiveOffsetWrapAround) {
 TEST(execute_sh, NegativeOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 64);
 	hart.set_register(Rv_register_id::x2, 0x4050);
 	hart.execute_sh(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(-32));
@@ -2276,7 +4487,7 @@ TEST(execute_sh, NegativeOffset) {
 TEST(execute_sh, NegativeOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, 0x4050);
 	hart.execute_sh(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(-8));
@@ -2288,7 +4499,7 @@ TEST(execute_sh, NegativeOffsetWrapAround) {
 TEST(execute_sh, ZeroOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 6);
 	hart.set_register(Rv_register_id::x2, 0x4050);
 	hart.execute_sh(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0));
@@ -2302,7 +4513,7 @@ TEST(execute_sh, MisalignedAccess) {
 	// Address 5 is not on a 4 or 2 byte boundary, but that is allowed
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, 0x4050);
 	hart.execute_sh(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(1));
@@ -2316,7 +4527,7 @@ TEST(execute_sh, HighBitsOfRegisterIgnored) {
 	// Only the low 8 bits of the source register are stored
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, -1 << 15);
 	hart.execute_sh(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0));
@@ -2332,7 +4543,7 @@ SLL
 TEST(execute_sll, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 1);
 	hart.set_register(Rv_register_id::x3, 4);
 	hart.execute_sll(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2344,7 +4555,7 @@ TEST(execute_sll, DifferentRegisters) {
 TEST(execute_sll, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0b10);
 	hart.execute_sll(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b1000);
@@ -2355,7 +4566,7 @@ TEST(execute_sll, MoreThanFiveBitsSetInRs2) {
 	// Shift amount is in RS2, but only the low 5 bits are used.
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 1);
 	hart.set_register(Rv_register_id::x3, 0b100001);
 	hart.execute_sll(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2367,7 +4578,7 @@ TEST(execute_sll, MoreThanFiveBitsSetInRs2) {
 TEST(execute_sll, ShiftOutOfHighBit) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0xFFFFFFFF);
 	hart.set_register(Rv_register_id::x3, 8);
 	hart.execute_sll(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2383,7 +4594,7 @@ SLLI
 TEST(execute_slli, ValidInstruction) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b0100'0000'0000'0000'0000'0000'0000'0011);
 	hart.execute_slli(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b1100);
@@ -2396,7 +4607,7 @@ SLT
 TEST(execute_slt, LessThan) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 2);
 	hart.set_register(Rv_register_id::x3, 3);
 	hart.execute_slt(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2416,7 +4627,7 @@ TEST(execute_slt, LessThan) {
 TEST(execute_slt, Equal) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 2);
 	hart.set_register(Rv_register_id::x3, 2);
 	hart.execute_slt(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2431,7 +4642,7 @@ TEST(execute_slt, Equal) {
 TEST(execute_slt, GreaterThan) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 3);
 	hart.set_register(Rv_register_id::x3, 2);
 	hart.execute_slt(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2455,7 +4666,7 @@ SLTI
 TEST(execute_slti, SrcEqualsImm) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x5, 2);
 	hart.execute_slti(Rv_register_id::x1, Rv_register_id::x5, Rv_itype_imm::from_signed(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2468,7 +4679,7 @@ TEST(execute_slti, SrcEqualsImm) {
 TEST(execute_slti, SrcLessThanImm) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x5, 1);
 	hart.execute_slti(Rv_register_id::x1, Rv_register_id::x5, Rv_itype_imm::from_signed(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 1);
@@ -2485,7 +4696,7 @@ TEST(execute_slti, SrcLessThanImm) {
 TEST(execute_slti, SrcGreaterThanImm) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x5, 3);
 	hart.execute_slti(Rv_register_id::x1, Rv_register_id::x5, Rv_itype_imm::from_signed(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2506,7 +4717,7 @@ SLTIU
 TEST(execute_sltiu, SrcEqualsImm) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x5, 2);
 	hart.execute_sltiu(Rv_register_id::x1, Rv_register_id::x5, Rv_itype_imm::from_unsigned(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2519,7 +4730,7 @@ TEST(execute_sltiu, SrcEqualsImm) {
 TEST(execute_sltiu, SrcLessThanImm) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x5, 1);
 	hart.execute_sltiu(Rv_register_id::x1, Rv_register_id::x5, Rv_itype_imm::from_unsigned(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 1);
@@ -2541,7 +4752,7 @@ TEST(execute_sltiu, SrcLessThanImm) {
 TEST(execute_sltiu, SrcGreaterThanImm) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x5, 3);
 	hart.execute_sltiu(Rv_register_id::x1, Rv_register_id::x5, Rv_itype_imm::from_unsigned(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2561,7 +4772,7 @@ TEST(execute_sltiu, ImmIsOne) {
 	// SLTIU rd, rs1, 1 sets rd to 1 if rs1 equals zero, otherwise sets rd to 0 (assembler pseudoinstruction SEQZ rd, rs).
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 
 	// rs1 == 0
 	hart.set_register(Rv_register_id::x5, 0);
@@ -2586,7 +4797,7 @@ SLTU
 TEST(execute_sltu, LessThan) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 2);
 	hart.set_register(Rv_register_id::x3, 3);
 	hart.execute_sltu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2608,7 +4819,7 @@ TEST(execute_sltu, LessThan) {
 TEST(execute_sltu, Equal) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 2);
 	hart.set_register(Rv_register_id::x3, 2);
 	hart.execute_sltu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2623,7 +4834,7 @@ TEST(execute_sltu, Equal) {
 TEST(execute_sltu, GreaterThan) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 3);
 	hart.set_register(Rv_register_id::x3, 2);
 	hart.execute_sltu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2649,7 +4860,7 @@ SRA
 TEST(execute_sra, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b100);
 	hart.set_register(Rv_register_id::x3, 2);
 	hart.execute_sra(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2661,7 +4872,7 @@ TEST(execute_sra, DifferentRegisters) {
 TEST(execute_sra, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 80);
 	hart.execute_sra(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2672,7 +4883,7 @@ TEST(execute_sra, MoreThanFiveBitsSetInRs2) {
 	// Shift amount is in RS2, but only the low 5 bits are used.
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b100);
 	hart.set_register(Rv_register_id::x3, 0b100001);
 	hart.execute_sra(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2686,7 +4897,7 @@ TEST(execute_sra, ShiftWithSignBitSet) {
 	// Arithmetic shift fills high bits with the sign bit
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0xFF000000);
 	hart.set_register(Rv_register_id::x3, 8);
 	hart.execute_sra(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2702,7 +4913,7 @@ SRAI
 TEST(execute_srai, SignedSource) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b1000'0000'0000'0000'0000'0000'0001'0011);
 	hart.execute_srai(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_unsigned((1 << 10) | 2)); // The (1 << 10) sets the bit that indicates this is an arithmetic shift
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b1110'0000'0000'0000'0000'0000'0000'0100);
@@ -2711,7 +4922,7 @@ TEST(execute_srai, SignedSource) {
 TEST(execute_srai, UnsignedSource) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b0000'0000'0000'0000'0000'0000'0001'0011);
 	hart.execute_srai(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_unsigned((1 << 10) | 2)); // The (1 << 10) sets the bit that indicates this is an arithmetic shift
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b0000'0000'0000'0000'0000'0000'0000'0100);
@@ -2724,7 +4935,7 @@ SRL
 TEST(execute_srl, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b100);
 	hart.set_register(Rv_register_id::x3, 2);
 	hart.execute_srl(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2736,7 +4947,7 @@ TEST(execute_srl, DifferentRegisters) {
 TEST(execute_srl, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 80);
 	hart.execute_srl(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2747,7 +4958,7 @@ TEST(execute_srl, MoreThanFiveBitsSetInRs2) {
 	// Shift amount is in RS2, but only the low 5 bits are used.
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b100);
 	hart.set_register(Rv_register_id::x3, 0b100001);
 	hart.execute_srl(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2761,7 +4972,7 @@ TEST(execute_srl, ShiftWithSignBitSet) {
 	// Logical shift fills high bits with 0 regardless of sign
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0xFFFFFFFF);
 	hart.set_register(Rv_register_id::x3, 8);
 	hart.execute_srl(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2777,7 +4988,7 @@ SRLI
 TEST(execute_srli, SignedSource) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b1000'0000'0000'0000'0000'0000'0001'0011);
 	hart.execute_srli(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_unsigned(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b0010'0000'0000'0000'0000'0000'0000'0100);
@@ -2786,7 +4997,7 @@ TEST(execute_srli, SignedSource) {
 TEST(execute_srli, UnsignedSource) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b0000'0000'0000'0000'0000'0000'0001'0011);
 	hart.execute_srli(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_unsigned(2));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b0000'0000'0000'0000'0000'0000'0000'0100);
@@ -2799,7 +5010,7 @@ SUB
 TEST(execute_sub, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 4);
 	hart.set_register(Rv_register_id::x3, 14);
 	hart.execute_sub(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2811,7 +5022,7 @@ TEST(execute_sub, DifferentRegisters) {
 TEST(execute_sub, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, -4);
 	hart.execute_sub(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2824,7 +5035,7 @@ SW
 TEST(execute_sw, PositiveOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0x100);
 	hart.set_register(Rv_register_id::x2, 0x40302010);
 	hart.execute_sw(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0x10));
@@ -2836,7 +5047,7 @@ TEST(execute_sw, PositiveOffset) {
 TEST(execute_sw, PositiveOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0xFFFFFFFC);
 	hart.set_register(Rv_register_id::x2, 0x40302010);
 	hart.execute_sw(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(8));
@@ -2848,7 +5059,7 @@ TEST(execute_sw, PositiveOffsetWrapAround) {
 TEST(execute_sw, NegativeOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 64);
 	hart.set_register(Rv_register_id::x2, 0x40302010);
 	hart.execute_sw(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(-32));
@@ -2860,7 +5071,7 @@ TEST(execute_sw, NegativeOffset) {
 TEST(execute_sw, NegativeOffsetWrapAround) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, 0x40302010);
 	hart.execute_sw(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(-8));
@@ -2872,7 +5083,7 @@ TEST(execute_sw, NegativeOffsetWrapAround) {
 TEST(execute_sw, ZeroOffset) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 6);
 	hart.set_register(Rv_register_id::x2, 0x40302010);
 	hart.execute_sw(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(0));
@@ -2886,7 +5097,7 @@ TEST(execute_sw, MisalignedAccess) {
 	// Address 5 is not on a 4 or 2 byte boundary, but that is allowed
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 4);
 	hart.set_register(Rv_register_id::x2, 0x40302010);
 	hart.execute_sw(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(1));
@@ -2902,7 +5113,7 @@ XOR
 TEST(execute_xor, DifferentRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b1101);
 	hart.set_register(Rv_register_id::x3, 0b1011);
 	hart.execute_xor(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
@@ -2914,7 +5125,7 @@ TEST(execute_xor, DifferentRegisters) {
 TEST(execute_xor, SameRegisters) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x1, 0b1110);
 	hart.execute_xor(Rv_register_id::x1, Rv_register_id::x1, Rv_register_id::x1);
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
@@ -2927,7 +5138,7 @@ XORI
 TEST(execute_xori, ValidInstruction) {
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0b01000000000000110);
 	hart.execute_xori(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(0b1101));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0b01000000000001011);
@@ -2938,8 +5149,286 @@ TEST(execute_xori, BitwiseNot) {
 	// XORI rd, rs1, -1 performs a bitwise logical inversion of register rs1(assembler pseudoinstruction NOT rd, rs).
 
 	auto memory = Simple_memory_subsystem();
-	auto hart = Rv32_hart(memory);
+	auto hart = Test_hart(memory);
 	hart.set_register(Rv_register_id::x2, 0xFFFFFF00);
 	hart.execute_xori(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(-1));
 	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFF);
 }
+
+/* --------------------------------------------------------
+RV64
+-------------------------------------------------------- */
+
+TEST(Rv64_hart, RegistersAre64Bits) {
+
+	auto memory = Radix_memory();
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(Rv_register_id::x2, 0xFFFF'FFFF'0000'0001);
+	hart.execute_addi(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(-2));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFE'FFFF'FFFF);
+
+	// LUI and AUIPC sign extend their 32-bit immediate
+	hart.set_register(Rv_register_id::pc, 0x1'0000'0000);
+	hart.execute_lui(Rv_register_id::x3, Rv_utype_imm::from_decoded(0x8000'0000));
+	hart.execute_auipc(Rv_register_id::x4, Rv_utype_imm::from_decoded(0x8000'0000));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x3), 0xFFFF'FFFF'8000'0000);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x4), 0x8000'0000);
+}
+
+TEST(Rv64_hart, ShiftAmountsHaveSixBits) {
+
+	auto memory = Radix_memory();
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(Rv_register_id::x2, 0x8000'0000'0000'0001);
+	hart.execute_slli(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_unsigned(32));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x1'0000'0000);
+	hart.execute_srai(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_unsigned((1 << 10) | 63));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'FFFF'FFFF);
+
+	hart.set_register(Rv_register_id::x3, 0b100'0000 | 36); // Only the low 6 bits are used
+	hart.execute_srl(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x800'0000);
+}
+
+TEST(Rv64_hart, WordInstructionsSignExtend) {
+
+	auto memory = Radix_memory();
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(Rv_register_id::x2, 0x1234'5678'7FFF'FFFF);
+	hart.set_register(Rv_register_id::x3, 1);
+
+	hart.execute_addiw(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_signed(1));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'8000'0000);
+	hart.execute_addw(Rv_register_id::x1, Rv_register_id::x3, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 2);
+	hart.execute_slliw(Rv_register_id::x1, Rv_register_id::x3, Rv_itype_imm::from_unsigned(31));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'8000'0000);
+	hart.execute_srliw(Rv_register_id::x1, Rv_register_id::x2, Rv_itype_imm::from_unsigned(4));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x07FF'FFFF);
+	hart.execute_mulw(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x2);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 1);
+
+	// Overflow and division by zero behave as on RV32, on the low words
+	hart.set_register(Rv_register_id::x4, 0x8000'0000);
+	hart.set_register(Rv_register_id::x5, 0xFFFF'FFFF);
+	hart.execute_divw(Rv_register_id::x1, Rv_register_id::x4, Rv_register_id::x5);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'8000'0000);
+	hart.execute_remw(Rv_register_id::x1, Rv_register_id::x4, Rv_register_id::x5);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
+	hart.execute_divuw(Rv_register_id::x1, Rv_register_id::x4, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'FFFF'FFFF);
+}
+
+TEST(Rv64_hart, WordAtomicsSignExtend) {
+
+	auto memory = Radix_memory();
+	memory.write_32(0x1'0000'0600, 0x8000'0000);
+
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x1'0000'0600);
+	hart.set_register(Rv_register_id::x4, 0xFFFF'FFFF'0000'0001); // Only the low word is used
+	hart.execute_amoadd_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0xFFFF'FFFF'8000'0000);
+	EXPECT_EQ(memory.read_32(0x1'0000'0600), 0x8000'0001);
+
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0xFFFF'FFFF'8000'0001);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 0);
+	EXPECT_EQ(memory.read_32(0x1'0000'0600), 1);
+	EXPECT_EQ(memory.read_32(0x1'0000'0604), 0);
+}
+
+TEST(Rv64_hart, DoublewordAtomics) {
+
+	using Hart = Basic_rv64_hart<Radix_memory>;
+	struct Amo_case
+	{
+		void (Hart::* execute)(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+		uint64_t expected;
+	};
+
+	const Amo_case cases[] = {
+		{ &Hart::execute_amoswap_d, 7 },
+		{ &Hart::execute_amoadd_d, 0x8000'0000'0000'000C },
+		{ &Hart::execute_amoxor_d, 0x8000'0000'0000'0002 },
+		{ &Hart::execute_amoand_d, 0x5 },
+		{ &Hart::execute_amoor_d, 0x8000'0000'0000'0007 },
+		{ &Hart::execute_amomin_d, 0x8000'0000'0000'0005 },
+		{ &Hart::execute_amomax_d, 7 },
+		{ &Hart::execute_amominu_d, 7 },
+		{ &Hart::execute_amomaxu_d, 0x8000'0000'0000'0005 },
+	};
+
+	auto memory = Radix_memory();
+	auto hart = Hart(memory);
+	hart.set_register(Rv_register_id::x3, 0x1'0000'0600);
+	hart.set_register(Rv_register_id::x4, 7);
+
+	for (const auto& amo : cases)
+	{
+		memory.write_64(0x1'0000'0600, 0x8000'0000'0000'0005);
+		(hart.*amo.execute)(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+		EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x8000'0000'0000'0005);
+		EXPECT_EQ(memory.read_64(0x1'0000'0600), amo.expected);
+	}
+
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::none);
+
+	// Doublewords must be 8-byte aligned
+	hart.set_register(Rv_register_id::x3, 0x1'0000'0604);
+	hart.execute_amoadd_d(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::store_address_misaligned);
+}
+
+TEST(Rv64_hart, DoublewordLoadReservedStoreConditional) {
+
+	auto memory = Radix_memory();
+	memory.write_64(0x1'0000'0600, 0x1234'5678'9ABC'DEF0);
+
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(Rv_register_id::x3, 0x1'0000'0600);
+	hart.set_register(Rv_register_id::x4, 0xFFFF'FFFF'0000'0001);
+
+	hart.execute_lr_d(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x2), 0x1234'5678'9ABC'DEF0);
+	hart.execute_sc_d(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 0);
+	EXPECT_EQ(memory.read_64(0x1'0000'0600), 0xFFFF'FFFF'0000'0001);
+
+	// A reservation of the low word doesn't let SC.D store the doubleword, nor the other way around
+	hart.execute_lr_w(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	hart.execute_sc_d(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	hart.execute_lr_d(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	hart.execute_sc_w(Rv_register_id::x5, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x5), 1);
+	EXPECT_EQ(memory.read_64(0x1'0000'0600), 0xFFFF'FFFF'0000'0001);
+
+	hart.set_register(Rv_register_id::x3, 0x1'0000'0604);
+	hart.execute_lr_d(Rv_register_id::x2, Rv_register_id::x3, Rv_register_id::x0);
+	EXPECT_EQ(hart.get_trap(), Rv_trap_cause::load_address_misaligned);
+}
+
+TEST(Rv64_hart, RunsDoublewordAtomics) {
+
+	using E = Rv32_encoder;
+	const auto t0 = Rv_register_id::x5;
+	const auto t1 = Rv_register_id::x6;
+	const auto a0 = Rv_register_id::x10;
+
+	auto memory = Radix_memory();
+	memory.write_64(0x1'0000'0600, 0xFFFF'FFFF);
+
+	// Increments the doubleword with an LR/SC loop, then adds it to itself with an AMO
+	const uint32_t code[] = {
+		E::encode_lr_d(t0, a0),
+		E::encode_addi(t0, t0, 1),
+		E::encode_sc_d(t1, a0, t0),
+		E::encode_bne(t1, Rv_register_id::x0, -12),
+		E::encode_amoadd_d(t1, a0, t0),
+		E::encode_ecall(),
+	};
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(i * 4, code[i]);
+
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(a0, 0x1'0000'0600);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(hart.get_register(t1), 0x1'0000'0000);
+	EXPECT_EQ(memory.read_64(0x1'0000'0600), 0x2'0000'0000);
+}
+
+TEST(Rv64_hart, MultiplyHigh) {
+
+	auto memory = Radix_memory();
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(Rv_register_id::x2, 0xFFFF'FFFF'FFFF'FFFF);
+	hart.set_register(Rv_register_id::x3, 0xFFFF'FFFF'FFFF'FFFF);
+	hart.set_register(Rv_register_id::x4, 0x1234'5678'9ABC'DEF0);
+
+	hart.execute_mulhu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'FFFF'FFFE);
+	hart.execute_mulh(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3); // -1 * -1
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
+	hart.execute_mulh(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x4); // -1 * positive
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'FFFF'FFFF);
+	hart.execute_mulhsu(Rv_register_id::x1, Rv_register_id::x2, Rv_register_id::x3); // -1 * (2^64 - 1)
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0xFFFF'FFFF'FFFF'FFFF);
+	hart.execute_mulhu(Rv_register_id::x1, Rv_register_id::x4, Rv_register_id::x4);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0x014B'66DC'33F6'ACDC);
+}
+
+TEST(Rv64_hart, LoadsAndStores) {
+
+	auto memory = Radix_memory();
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+	hart.set_register(Rv_register_id::x1, 0x7F'0000'0100);
+	hart.set_register(Rv_register_id::x2, 0x8877'6655'4433'2211);
+
+	hart.execute_sd(Rv_register_id::x1, Rv_register_id::x2, Rv_stype_imm::from_offset(-8));
+	EXPECT_EQ(memory.read_32(0x7F'0000'00F8), 0x4433'2211);
+	EXPECT_EQ(memory.read_32(0x7F'0000'00FC), 0x8877'6655);
+
+	hart.execute_ld(Rv_register_id::x3, Rv_register_id::x1, Rv_itype_imm::from_signed(-8));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x3), 0x8877'6655'4433'2211);
+	hart.execute_lw(Rv_register_id::x3, Rv_register_id::x1, Rv_itype_imm::from_signed(-4));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x3), 0xFFFF'FFFF'8877'6655);
+	hart.execute_lwu(Rv_register_id::x3, Rv_register_id::x1, Rv_itype_imm::from_signed(-4));
+	EXPECT_EQ(hart.get_register(Rv_register_id::x3), 0x8877'6655);
+}
+
+TEST(Rv64_hart, RunsAboveFourGiB) {
+
+	using E = Rv32_encoder;
+	const auto t0 = Rv_register_id::x5;
+	const auto t1 = Rv_register_id::x6;
+	const auto a0 = Rv_register_id::x10;
+
+	auto memory = Radix_memory();
+	auto hart = Basic_rv64_hart<Radix_memory>(memory);
+
+	// Sums 1..10 into a0 and stores it after the code. The same code at the same low 32 bits must not be confused.
+	const uint32_t code[] = {
+		E::encode_addi(t0, Rv_register_id::x0, 10),
+		E::encode_add(a0, a0, t0),
+		E::encode_addiw(t0, t0, -1),
+		E::encode_bne(t0, Rv_register_id::x0, -8),
+		E::encode_auipc(t1, 0),
+		E::encode_sd(t1, a0, 0x100),
+		E::encode_ecall(),
+	};
+	const uint64_t address = 0x12'3456'0000;
+	for (uint32_t i = 0; i < std::size(code); ++i)
+		memory.write_32(address + i * 4, code[i]);
+
+	hart.set_register(Rv_register_id::pc, address);
+	auto result = hart.run(1000);
+	EXPECT_EQ(result.reason, Rv_stop_reason::trap);
+	EXPECT_EQ(result.trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(hart.get_register(Rv_register_id::pc), address + 24);
+	EXPECT_EQ(hart.get_register(a0), 55);
+	EXPECT_EQ(memory.read_32(address + 16 + 0x100), 55);
+
+	// Rewriting the code invalidates the cached blocks
+	memory.write_32(address, E::encode_addi(t0, Rv_register_id::x0, 2));
+	hart.set_register(a0, 0);
+	hart.set_register(Rv_register_id::pc, address);
+	hart.run(1000);
+	EXPECT_EQ(hart.get_register(a0), 3);
+}
+
+TEST(Rv64_hart, CountersAreReadWhole) {
+
+	auto memory = Radix_memory();
+	auto hart = Rv64_hart(memory);
+	memory.write_32(0, Rv32_encoder::encode_csrrs(Rv_register_id::x1, Rv_csr::instret, Rv_register_id::x0));
+	memory.write_32(4, Rv32_encoder::encode_csrrs(Rv_register_id::x1, Rv_csr::instreth, Rv_register_id::x0));
+
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::none);
+	EXPECT_EQ(hart.get_register(Rv_register_id::x1), 0);
+
+	// The high halves only exist on RV32
+	EXPECT_EQ(hart.execute_next(), Rv_trap_cause::illegal_instruction);
+}
@@ -50,6 +50,328 @@ TEST(decode_instruction_type, SLTI) {
 	EXPECT_EQ(type, Rv32i_instruction_type::slti);
 }
 
+TEST(decode_instruction_type, Rv64Instructions) {
+
+	using enum Rv32i_instruction_type;
+	const auto x1 = Rv_register_id::x1;
+	const auto x2 = Rv_register_id::x2;
+	const auto x3 = Rv_register_id::x3;
+
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_ld(x1, x2, -8)), ld);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_lwu(x1, x2, 4)), lwu);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_sd(x1, x2, 16)), sd);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_addiw(x1, x2, -1)), addiw);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_slliw(x1, x2, 31)), slliw);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_sraiw(x1, x2, 31)), sraiw);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_subw(x1, x2, x3)), subw);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_remuw(x1, x2, x3)), remuw);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_lr_d(x1, x2, Rv_amo_ordering::aq)), lr_d);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_sc_d(x1, x2, x3, Rv_amo_ordering::rl)), sc_d);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_amomaxu_d(x1, x2, x3)), amomaxu_d);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(Rv32_encoder::encode_amoadd_w(x1, x2, x3)), amoadd_w);
+
+	// None of them exist on RV32
+	EXPECT_EQ(Rv32_decoder::decode_instruction_type(Rv32_encoder::encode_ld(x1, x2, -8)), invalid);
+	EXPECT_EQ(Rv32_decoder::decode_instruction_type(Rv32_encoder::encode_sd(x1, x2, 16)), invalid);
+	EXPECT_EQ(Rv32_decoder::decode_instruction_type(Rv32_encoder::encode_addiw(x1, x2, -1)), invalid);
+	EXPECT_EQ(Rv32_decoder::decode_instruction_type(Rv32_encoder::encode_subw(x1, x2, x3)), invalid);
+	EXPECT_EQ(Rv32_decoder::decode_instruction_type(Rv32_encoder::encode_amoadd_d(x1, x2, x3)), invalid);
+}
+
+TEST(decode_instruction_type, Rv64ShiftAmountsHaveSixBits) {
+
+	// Shift amount 32 sets the low bit of funct7, which is reserved on RV32
+	const auto slli_32 = Rv32_encoder::encode_op_imm(Rv32_op_imm_funct::slli, Rv_register_id::x1, Rv_register_id::x2,
+		Rv_itype_imm::from_unsigned(32));
+	const auto srai_63 = Rv32_encoder::encode_op_imm(Rv32_op_imm_funct::srxi, Rv_register_id::x1, Rv_register_id::x2,
+		Rv_itype_imm::from_unsigned(0b0100'0011'1111));
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(slli_32), Rv32i_instruction_type::slli);
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(srai_63), Rv32i_instruction_type::srai);
+	EXPECT_EQ(Rv64_decoder::decode_itype(srai_63).imm.get_shift_amount<64>(), 63);
+	EXPECT_EQ(Rv32_decoder::decode_instruction_type(slli_32), Rv32i_instruction_type::invalid);
+
+	// The W forms keep 5-bit shift amounts
+	const auto slliw_32 = Rv32_encoder::encode_op_imm_32(Rv64_op_imm_32_funct::slliw, Rv_register_id::x1,
+		Rv_register_id::x2, Rv_itype_imm::from_unsigned(32));
+	EXPECT_EQ(Rv64_decoder::decode_instruction_type(slliw_32), Rv32i_instruction_type::invalid);
+}
+
+/**
+Reference decoding rules as (mask, match) pairs: an instruction is of a type if (instruction & mask) == match.
+These mirror the rules the simulator has always decoded with. Shift immediates and SYSTEM operands are
+decoded more permissively than the spec requires.
+*/
+struct Reference_decode_rule
+{
+	uint32_t mask;
+	uint32_t match;
+	Rv32i_instruction_type type;
+};
+
+static const Reference_decode_rule reference_decode_rules[] = {
+	{ 0x0000007F, 0x00000037, Rv32i_instruction_type::lui },
+	{ 0x0000007F, 0x00000017, Rv32i_instruction_type::auipc },
+	{ 0x0000007F, 0x0000006F, Rv32i_instruction_type::jal },
+	{ 0x0000707F, 0x00000067, Rv32i_instruction_type::jalr },
+	{ 0x0000707F, 0x00000063, Rv32i_instruction_type::beq },
+	{ 0x0000707F, 0x00001063, Rv32i_instruction_type::bne },
+	{ 0x0000707F, 0x00004063, Rv32i_instruction_type::blt },
+	{ 0x0000707F, 0x00005063, Rv32i_instruction_type::bge },
+	{ 0x0000707F, 0x00006063, Rv32i_instruction_type::bltu },
+	{ 0x0000707F, 0x00007063, Rv32i_instruction_type::bgeu },
+	{ 0x0000707F, 0x00000003, Rv32i_instruction_type::lb },
+	{ 0x0000707F, 0x00001003, Rv32i_instruction_type::lh },
+	{ 0x0000707F, 0x00002003, Rv32i_instruction_type::lw },
+	{ 0x0000707F, 0x00004003, Rv32i_instruction_type::lbu },
+	{ 0x0000707F, 0x00005003, Rv32i_instruction_type::lhu },
+	{ 0x0000707F, 0x00000023, Rv32i_instruction_type::sb },
+	{ 0x0000707F, 0x00001023, Rv32i_instruction_type::sh },
+	{ 0x0000707F, 0x00002023, Rv32i_instruction_type::sw },
+	{ 0x0000707F, 0x00000013, Rv32i_instruction_type::addi },
+	{ 0x0000707F, 0x00002013, Rv32i_instruction_type::slti },
+	{ 0x0000707F, 0x00003013, Rv32i_instruction_type::sltiu },
+	{ 0x0000707F, 0x00004013, Rv32i_instruction_type::xori },
+	{ 0x0000707F, 0x00006013, Rv32i_instruction_type::ori },
+	{ 0x0000707F, 0x00007013, Rv32i_instruction_type::andi },
+	{ 0xFE00707F, 0x00001013, Rv32i_instruction_type::slli },
+	{ 0xFE00707F, 0x00005013, Rv32i_instruction_type::srli },
+	{ 0xFE00707F, 0x40005013, Rv32i_instruction_type::srai },
+	{ 0xFFF0707F, 0x60001013, Rv32i_instruction_type::clz },
+	{ 0xFFF0707F, 0x60101013, Rv32i_instruction_type::ctz },
+	{ 0xFFF0707F, 0x60201013, Rv32i_instruction_type::cpop },
+	{ 0xFFF0707F, 0x60401013, Rv32i_instruction_type::sext_b },
+	{ 0xFFF0707F, 0x60501013, Rv32i_instruction_type::sext_h },
+	{ 0xFFF0707F, 0x28705013, Rv32i_instruction_type::orc_b },
+	{ 0xFFF0707F, 0x69805013, Rv32i_instruction_type::rev8 },
+	{ 0xFE00707F, 0x60005013, Rv32i_instruction_type::rori },
+	{ 0xFE00707F, 0x48001013, Rv32i_instruction_type::bclri },
+	{ 0xFE00707F, 0x48005013, Rv32i_instruction_type::bexti },
+	{ 0xFE00707F, 0x68001013, Rv32i_instruction_type::binvi },
+	{ 0xFE00707F, 0x28001013, Rv32i_instruction_type::bseti },
+	{ 0xFE00707F, 0x00000033, Rv32i_instruction_type::add },
+	{ 0xFE00707F, 0x40000033, Rv32i_instruction_type::sub },
+	{ 0xFE00707F, 0x00001033, Rv32i_instruction_type::sll },
+	{ 0xFE00707F, 0x00002033, Rv32i_instruction_type::slt },
+	{ 0xFE00707F, 0x00003033, Rv32i_instruction_type::sltu },
+	{ 0xFE00707F, 0x00004033, Rv32i_instruction_type::xor_ },
+	{ 0xFE00707F, 0x00005033, Rv32i_instruction_type::srl },
+	{ 0xFE00707F, 0x40005033, Rv32i_instruction_type::sra },
+	{ 0xFE00707F, 0x00006033, Rv32i_instruction_type::or_ },
+	{ 0xFE00707F, 0x00007033, Rv32i_instruction_type::and_ },
+	{ 0xFE00707F, 0x02000033, Rv32i_instruction_type::mul },
+	{ 0xFE00707F, 0x02001033, Rv32i_instruction_type::mulh },
+	{ 0xFE00707F, 0x02002033, Rv32i_instruction_type::mulhsu },
+	{ 0xFE00707F, 0x02003033, Rv32i_instruction_type::mulhu },
+	{ 0xFE00707F, 0x02004033, Rv32i_instruction_type::div },
+	{ 0xFE00707F, 0x02005033, Rv32i_instruction_type::divu },
+	{ 0xFE00707F, 0x02006033, Rv32i_instruction_type::rem },
+	{ 0xFE00707F, 0x02007033, Rv32i_instruction_type::remu },
+	{ 0xFE00707F, 0x20002033, Rv32i_instruction_type::sh1add },
+	{ 0xFE00707F, 0x20004033, Rv32i_instruction_type::sh2add },
+	{ 0xFE00707F, 0x20006033, Rv32i_instruction_type::sh3add },
+	{ 0xFE00707F, 0x40007033, Rv32i_instruction_type::andn },
+	{ 0xFE00707F, 0x40006033, Rv32i_instruction_type::orn },
+	{ 0xFE00707F, 0x40004033, Rv32i_instruction_type::xnor },
+	{ 0xFE00707F, 0x0A004033, Rv32i_instruction_type::min },
+	{ 0xFE00707F, 0x0A005033, Rv32i_instruction_type::minu },
+	{ 0xFE00707F, 0x0A006033, Rv32i_instruction_type::max },
+	{ 0xFE00707F, 0x0A007033, Rv32i_instruction_type::maxu },
+	{ 0xFE00707F, 0x60001033, Rv32i_instruction_type::rol },
+	{ 0xFE00707F, 0x60005033, Rv32i_instruction_type::ror },
+	{ 0xFFF0707F, 0x08004033, Rv32i_instruction_type::zext_h },
+	{ 0xFE00707F, 0x48001033, Rv32i_instruction_type::bclr },
+	{ 0xFE00707F, 0x48005033, Rv32i_instruction_type::bext },
+	{ 0xFE00707F, 0x68001033, Rv32i_instruction_type::binv },
+	{ 0xFE00707F, 0x28001033, Rv32i_instruction_type::bset },
+	{ 0xF9F0707F, 0x1000202F, Rv32i_instruction_type::lr_w },
+	{ 0xF800707F, 0x1800202F, Rv32i_instruction_type::sc_w },
+	{ 0xF800707F, 0x0800202F, Rv32i_instruction_type::amoswap_w },
+	{ 0xF800707F, 0x0000202F, Rv32i_instruction_type::amoadd_w },
+	{ 0xF800707F, 0x2000202F, Rv32i_instruction_type::amoxor_w },
+	{ 0xF800707F, 0x6000202F, Rv32i_instruction_type::amoand_w },
+	{ 0xF800707F, 0x4000202F, Rv32i_instruction_type::amoor_w },
+	{ 0xF800707F, 0x8000202F, Rv32i_instruction_type::amomin_w },
+	{ 0xF800707F, 0xA000202F, Rv32i_instruction_type::amomax_w },
+	{ 0xF800707F, 0xC000202F, Rv32i_instruction_type::amominu_w },
+	{ 0xF800707F, 0xE000202F, Rv32i_instruction_type::amomaxu_w },
+	{ 0x0000707F, 0x0000000F, Rv32i_instruction_type::fence },
+	{ 0xFFF0707F, 0x00000073, Rv32i_instruction_type::ecall },
+	{ 0xFFF0707F, 0x00100073, Rv32i_instruction_type::ebreak },
+	{ 0x0000707F, 0x00001073, Rv32i_instruction_type::csrrw },
+	{ 0x0000707F, 0x00002073, Rv32i_instruction_type::csrrs },
+	{ 0x0000707F, 0x00003073, Rv32i_instruction_type::csrrc },
+	{ 0x0000707F, 0x00005073, Rv32i_instruction_type::csrrwi },
+	{ 0x0000707F, 0x00006073, Rv32i_instruction_type::csrrsi },
+	{ 0x0000707F, 0x00007073, Rv32i_instruction_type::csrrci },
+	{ 0x0000707F, 0x00002007, Rv32i_instruction_type::flw },
+	{ 0x0000707F, 0x00003007, Rv32i_instruction_type::fld },
+	{ 0x0000707F, 0x00002027, Rv32i_instruction_type::fsw },
+	{ 0x0000707F, 0x00003027, Rv32i_instruction_type::fsd },
+	// Rounding modes 5 and 6 are reserved
+	{ 0x0000707F, 0x00005043, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x00006043, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x00005047, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x00006047, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x0000504B, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x0000604B, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x0000504F, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x0000604F, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x00005053, Rv32i_instruction_type::invalid },
+	{ 0x0000707F, 0x00006053, Rv32i_instruction_type::invalid },
+	{ 0x0600007F, 0x00000043, Rv32i_instruction_type::fmadd_s },
+	{ 0x0600007F, 0x02000043, Rv32i_instruction_type::fmadd_d },
+	{ 0x0600007F, 0x00000047, Rv32i_instruction_type::fmsub_s },
+	{ 0x0600007F, 0x02000047, Rv32i_instruction_type::fmsub_d },
+	{ 0x0600007F, 0x0000004B, Rv32i_instruction_type::fnmsub_s },
+	{ 0x0600007F, 0x0200004B, Rv32i_instruction_type::fnmsub_d },
+	{ 0x0600007F, 0x0000004F, Rv32i_instruction_type::fnmadd_s },
+	{ 0x0600007F, 0x0200004F, Rv32i_instruction_type::fnmadd_d },
+	{ 0xFE00007F, 0x00000053, Rv32i_instruction_type::fadd_s },
+	{ 0xFE00007F, 0x08000053, Rv32i_instruction_type::fsub_s },
+	{ 0xFE00007F, 0x10000053, Rv32i_instruction_type::fmul_s },
+	{ 0xFE00007F, 0x18000053, Rv32i_instruction_type::fdiv_s },
+	{ 0xFFF0007F, 0x58000053, Rv32i_instruction_type::fsqrt_s },
+	{ 0xFE00707F, 0x20000053, Rv32i_instruction_type::fsgnj_s },
+	{ 0xFE00707F, 0x20001053, Rv32i_instruction_type::fsgnjn_s },
+	{ 0xFE00707F, 0x20002053, Rv32i_instruction_type::fsgnjx_s },
+	{ 0xFE00707F, 0x28000053, Rv32i_instruction_type::fmin_s },
+	{ 0xFE00707F, 0x28001053, Rv32i_instruction_type::fmax_s },
+	{ 0xFE00707F, 0xA0002053, Rv32i_instruction_type::feq_s },
+	{ 0xFE00707F, 0xA0001053, Rv32i_instruction_type::flt_s },
+	{ 0xFE00707F, 0xA0000053, Rv32i_instruction_type::fle_s },
+	{ 0xFFF0007F, 0xC0000053, Rv32i_instruction_type::fcvt_w_s },
+	{ 0xFFF0007F, 0xC0100053, Rv32i_instruction_type::fcvt_wu_s },
+	{ 0xFFF0007F, 0xD0000053, Rv32i_instruction_type::fcvt_s_w },
+	{ 0xFFF0007F, 0xD0100053, Rv32i_instruction_type::fcvt_s_wu },
+	{ 0xFFF0707F, 0xE0001053, Rv32i_instruction_type::fclass_s },
+	{ 0xFE00007F, 0x02000053, Rv32i_instruction_type::fadd_d },
+	{ 0xFE00007F, 0x0A000053, Rv32i_instruction_type::fsub_d },
+	{ 0xFE00007F, 0x12000053, Rv32i_instruction_type::fmul_d },
+	{ 0xFE00007F, 0x1A000053, Rv32i_instruction_type::fdiv_d },
+	{ 0xFFF0007F, 0x5A000053, Rv32i_instruction_type::fsqrt_d },
+	{ 0xFE00707F, 0x22000053, Rv32i_instruction_type::fsgnj_d },
+	{ 0xFE00707F, 0x22001053, Rv32i_instruction_type::fsgnjn_d },
+	{ 0xFE00707F, 0x22002053, Rv32i_instruction_type::fsgnjx_d },
+	{ 0xFE00707F, 0x2A000053, Rv32i_instruction_type::fmin_d },
+	{ 0xFE00707F, 0x2A001053, Rv32i_instruction_type::fmax_d },
+	{ 0xFE00707F, 0xA2002053, Rv32i_instruction_type::feq_d },
+	{ 0xFE00707F, 0xA2001053, Rv32i_instruction_type::flt_d },
+	{ 0xFE00707F, 0xA2000053, Rv32i_instruction_type::fle_d },
+	{ 0xFFF0007F, 0xC2000053, Rv32i_instruction_type::fcvt_w_d },
+	{ 0xFFF0007F, 0xC2100053, Rv32i_instruction_type::fcvt_wu_d },
+	{ 0xFFF0007F, 0xD2000053, Rv32i_instruction_type::fcvt_d_w },
+	{ 0xFFF0007F, 0xD2100053, Rv32i_instruction_type::fcvt_d_wu },
+	{ 0xFFF0707F, 0xE2001053, Rv32i_instruction_type::fclass_d },
+	{ 0xFFF0007F, 0x40100053, Rv32i_instruction_type::fcvt_s_d },
+	{ 0xFFF0007F, 0x42000053, Rv32i_instruction_type::fcvt_d_s },
+	{ 0xFFF0707F, 0xE0000053, Rv32i_instruction_type::fmv_x_w },
+	{ 0xFFF0707F, 0xF0000053, Rv32i_instruction_type::fmv_w_x },
+};
+
+static Rv32i_instruction_type reference_decode_instruction_type(uint32_t instruction)
+{
+	for (const auto& rule : reference_decode_rules)
+	{
+		if ((instruction & rule.mask) == rule.match)
+			return rule.type;
+	}
+
+	return Rv32i_instruction_type::invalid;
+}
+
+TEST(decode_instruction_type, MatchesReferenceForAllDecodedBits) {
+
+	// The decoder only looks at the opcode (bits 0-6), funct3 (bits 12-14) and bits 20-31 (funct7, shift
+	// type, funct12). Every combination of those 22 bits is checked. The rd and rs1 fields are varied
+	// alongside to confirm they have no effect.
+
+	for (uint32_t i = 0; i < (1 << 22); ++i)
+	{
+		const uint32_t opcode = i & 0b1111111;
+		const uint32_t funct3 = (i >> 7) & 0b111;
+		const uint32_t upper = i >> 10;
+		const uint32_t rd = i % 32;
+		const uint32_t rs1 = (i / 32) % 32;
+		const uint32_t instruction = (upper << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+
+		ASSERT_EQ(Rv32_decoder::decode_instruction_type(instruction), reference_decode_instruction_type(instruction))
+			<< "instruction: " << std::hex << instruction;
+	}
+}
+
+TEST(expand_compressed, AllInstructionsWithImmediateLimits) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	// Parcels from an assembler, with the largest or most negative immediates each instruction can hold
+	const struct { uint16_t parcel; uint32_t expected; } cases[] = {
+		{ 0x1fe0, E::encode_addi(s0, sp, 1020) },                           // c.addi4spn s0, sp, 1020
+		{ 0x5cfc, E::encode_lw(a5, s1, 124) },                              // c.lw a5, 124(s1)
+		{ 0xc3a0, E::encode_sw(a5, s0, 64) },                               // c.sw s0, 64(a5)
+		{ 0x1f81, E::encode_addi(t6, t6, -32) },                            // c.addi t6, -32
+		{ 0x3001, E::encode_jal(ra, Rv_jtype_imm::from_offset(-2048)) },    // c.jal -2048
+		{ 0x40fd, E::encode_addi(ra, zero, 31) },                           // c.li ra, 31
+		{ 0x7101, E::encode_addi(sp, sp, -512) },                           // c.addi16sp sp, -512
+		{ 0x617d, E::encode_addi(sp, sp, 496) },                            // c.addi16sp sp, 496
+		{ 0x7d81, E::encode_lui(s11, 0xfffe0) },                            // c.lui s11, 0xfffe0
+		{ 0x62fd, E::encode_lui(t0, 31) },                                  // c.lui t0, 31
+		{ 0x817d, E::encode_srli(a0, a0, 31) },                             // c.srli a0, 31
+		{ 0x8485, E::encode_srai(s1, s1, 1) },                              // c.srai s1, 1
+		{ 0x9a7d, E::encode_andi(a2, a2, -1) },                             // c.andi a2, -1
+		{ 0x8c1d, E::encode_sub(s0, s0, a5) },                              // c.sub s0, a5
+		{ 0x8d2d, E::encode_xor(a0, a0, a1) },                              // c.xor a0, a1
+		{ 0x8e55, E::encode_or(a2, a2, a3) },                               // c.or a2, a3
+		{ 0x8f7d, E::encode_and(a4, a4, a5) },                              // c.and a4, a5
+		{ 0xaffd, E::encode_jal(zero, Rv_jtype_imm::from_offset(2046)) },   // c.j 2046
+		{ 0xd081, E::encode_beq(s1, zero, -256) },                          // c.beqz s1, -256
+		{ 0xeffd, E::encode_bne(a5, zero, 254) },                           // c.bnez a5, 254
+		{ 0x0ffe, E::encode_slli(t6, t6, 31) },                             // c.slli t6, 31
+		{ 0x52fe, E::encode_lw(t0, sp, 252) },                              // c.lwsp t0, 252(sp)
+		{ 0x8282, E::encode_jalr(zero, t0, Rv_itype_imm::from_signed(0)) }, // c.jr t0
+		{ 0x857e, E::encode_add(a0, zero, t6) },                            // c.mv a0, t6
+		{ 0x9002, E::encode_ebreak() },                                     // c.ebreak
+		{ 0x9582, E::encode_jalr(ra, a1, Rv_itype_imm::from_signed(0)) },   // c.jalr a1
+		{ 0x9dfe, E::encode_add(s11, s11, t6) },                            // c.add s11, t6
+		{ 0xdf86, E::encode_sw(sp, ra, 252) },                              // c.swsp ra, 252(sp)
+		{ 0x0001, E::encode_addi(zero, zero, 0) },                          // c.nop
+		{ 0x3cfc, E::encode_fld(a5, s1, 248) },                             // c.fld fa5, 248(s1)
+		{ 0x7cfc, E::encode_flw(a5, s1, 124) },                             // c.flw fa5, 124(s1)
+		{ 0xbcfc, E::encode_fsd(s1, a5, 248) },                             // c.fsd fa5, 248(s1)
+		{ 0xfcfc, E::encode_fsw(s1, a5, 124) },                             // c.fsw fa5, 124(s1)
+		{ 0x347e, E::encode_fld(s0, sp, 504) },                             // c.fldsp fs0, 504(sp)
+		{ 0x707e, E::encode_flw(zero, sp, 252) },                           // c.flwsp ft0, 252(sp)
+		{ 0xbfa2, E::encode_fsd(sp, s0, 504) },                             // c.fsdsp fs0, 504(sp)
+		{ 0xffaa, E::encode_fsw(sp, a0, 252) },                             // c.fswsp fa0, 252(sp)
+	};
+
+	for (const auto& c : cases)
+	{
+		EXPECT_TRUE(Rv32_decoder::is_compressed(c.parcel));
+		EXPECT_EQ(Rv32_decoder::expand_compressed(c.parcel), c.expected) << "parcel: " << std::hex << c.parcel;
+	}
+}
+
+TEST(expand_compressed, ReservedAndUnsupportedEncodingsAreIllegal) {
+
+	const uint16_t parcels[] = {
+		0x0000, // All zeros
+		0x0004, // c.addi4spn with a zero immediate
+		0x6101, // c.addi16sp with a zero immediate
+		0x6081, // c.lui with a zero immediate
+		0x4002, // c.lwsp with rd = x0
+		0x8002, // c.jr with rs1 = x0
+		0x9101, // c.srli with shamt[5] set (RV64)
+		0x9d0d, // c.subw (RV64)
+		0x8000, // Reserved
+	};
+
+	for (const auto parcel : parcels)
+		EXPECT_EQ(Rv32_decoder::expand_compressed(parcel), 0) << "parcel: " << std::hex << parcel;
+
+	EXPECT_FALSE(Rv32_decoder::is_compressed(Rv32_encoder::encode_ebreak()));
+}
+
 TEST(encode_btype, ValidInstruction) {
 
 	auto instruction = Rv32_encoder::encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bge, Rv_register_id::x2, Rv_register_id::x15, Rv_btype_imm::from_offset(-320));
@@ -94,6 +416,18 @@ TEST(encode_lui, ValidInstruction) {
 	EXPECT_EQ(result.imm.get_decoded(), 0b1111'1111'1111'1111'1111'0000'0000'0000);
 }
 
+TEST(encode_sc_w, ValidInstruction) {
+
+	auto instruction = Rv32_encoder::encode_sc_w(Rv_register_id::x2, Rv_register_id::x9, Rv_register_id::x5, Rv_amo_ordering::aqrl);
+	auto result = Rv32_decoder::decode_rtype(instruction);
+	EXPECT_EQ(result.opcode, Rv_opcode::amo);
+	EXPECT_EQ(result.funct3, to_underlying(Rv32_amo_funct3::w));
+	EXPECT_EQ(result.funct7, (to_underlying(Rv32_amo_funct5::sc) << 2) | to_underlying(Rv_amo_ordering::aqrl));
+	EXPECT_EQ(result.rd, Rv_register_id::x2);
+	EXPECT_EQ(result.rs1, Rv_register_id::x9);
+	EXPECT_EQ(result.rs2, Rv_register_id::x5);
+}
+
 TEST(encode_slli, ValidInstruction) {
 
 	// Set 6 bits in shift_amount and then verify that only 5 bits are used.
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <vector>
 
 #include "simple-system.h"
 
@@ -28,3 +29,21 @@ TEST(Simple_memory_subsystem, write_32) {
 	EXPECT_EQ(system.read_8(19), 0x12);
 	EXPECT_EQ(system.read_32(16), 0x12345678);
 }
+
+TEST(Simple_memory_subsystem, BlockTransfers) {
+
+	// Uses the default byte-wise Memory implementations
+
+	auto system = Simple_memory_subsystem();
+	const auto data = std::vector<uint8_t>({ 1, 2, 3, 4, 5 });
+	system.write_block(0x100, data);
+	EXPECT_EQ(system.read_32(0x100), 0x04030201);
+	EXPECT_EQ(system.read_8(0x104), 5);
+
+	system.fill(0x102, 0xEE, 2);
+	auto read_back = std::vector<uint8_t>(5);
+	system.read_block(0x100, read_back);
+	EXPECT_EQ(read_back, std::vector<uint8_t>({ 1, 2, 0xEE, 0xEE, 5 }));
+
+	EXPECT_TRUE(system.get_span(0x100, 4).empty());
+}
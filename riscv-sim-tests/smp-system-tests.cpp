@@ -0,0 +1,251 @@
+#include <array>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <stdexcept>
+
+#include "paged-memory.h"
+#include "rv32.h"
+#include "smp-system.h"
+#include "test-utils.h"
+
+using namespace riscv_sim;
+
+using Test_system = Smp_system<32, Paged_memory>;
+
+static Test_system make_system(Paged_memory& memory, uint32_t hart_count)
+{
+	auto system = Test_system(memory, hart_count, Rv32_engine::RISCV_SIM_TEST_ENGINE);
+	for (uint32_t i = 0; i < system.get_hart_count(); ++i)
+		system.get_hart(i).set_jit_threshold(0);
+
+	return system;
+}
+
+static void write_code(Paged_memory& memory, uint32_t address, std::initializer_list<uint32_t> code)
+{
+	for (const auto instruction : code)
+	{
+		memory.write_32(address, instruction);
+		address += 4;
+	}
+}
+
+/** Stops a hart at its first trap. */
+static bool stop_hart(Test_system::Hart&, const Rv_run_result&)
+{
+	return false;
+}
+
+TEST(Smp_system, HartsReadTheirIds) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = make_system(memory, 4);
+
+	// Each hart stores its ID + 1 in its own word
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_slli(t1, t0, 2),
+		E::encode_addi(t0, t0, 1),
+		E::encode_sw(t1, t0, 0x400),
+		E::encode_ecall(),
+	});
+
+	const auto results = system.run(1000, stop_hart);
+	ASSERT_EQ(results.size(), 4);
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		EXPECT_EQ(results[i].reason, Rv_stop_reason::trap);
+		EXPECT_EQ(results[i].trap, Rv_trap_cause::ecall);
+		EXPECT_EQ(results[i].retired, 4);
+		EXPECT_EQ(memory.read_32(0x400 + 4 * i), i + 1);
+		EXPECT_EQ(system.get_hart(i).get_hart_id(), i);
+	}
+}
+
+TEST(Smp_system, HartsRunConcurrently) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = make_system(memory, 4);
+
+	// Each hart increments its own counter 2000 times
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_slli(t1, t0, 2),
+		E::encode_addi(t2, zero, 2000),
+		E::encode_lw(t3, t1, 0x400),
+		E::encode_addi(t3, t3, 1),
+		E::encode_sw(t1, t3, 0x400),
+		E::encode_addi(t2, t2, -1),
+		E::encode_bne(t2, zero, -16),
+		E::encode_ecall(),
+		E::encode_jal(zero, Rv_jtype_imm::from_offset(0)),
+	});
+
+	// ECALLs are serviced and the harts spin to the end of their budget
+	constexpr uint64_t budget = 3 + 5 * 2000 + 100;
+	auto ecalls = std::array<int, 4>();
+	const auto results = system.run(budget, [&](Test_system::Hart& hart, const Rv_run_result& result) {
+		++ecalls[hart.get_hart_id()];
+		hart.set_register(pc, hart.get_register(pc) + 4);
+		return result.trap == Rv_trap_cause::ecall;
+	});
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		EXPECT_EQ(results[i].reason, Rv_stop_reason::budget_exhausted);
+		EXPECT_EQ(results[i].retired, budget);
+		EXPECT_EQ(ecalls[i], 1);
+		EXPECT_EQ(memory.read_32(0x400 + 4 * i), 2000);
+	}
+}
+
+TEST(Smp_system, AtomicsAreAtomicAcrossHarts) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = make_system(memory, 4);
+
+	// Each hart adds 1 to one counter 1000 times with AMOADD and to another with an LR/SC loop
+	write_code(memory, 0, {
+		E::encode_lui(t1, 0x1),
+		E::encode_addi(t4, t1, 0x40),
+		E::encode_addi(t2, zero, 1000),
+		E::encode_addi(t0, zero, 1),
+		E::encode_amoadd_w(zero, t1, t0),
+		E::encode_lr_w(t3, t4, Rv_amo_ordering::aq),
+		E::encode_addi(t3, t3, 1),
+		E::encode_sc_w(t5, t4, t3, Rv_amo_ordering::rl),
+		E::encode_bne(t5, zero, -12),
+		E::encode_addi(t2, t2, -1),
+		E::encode_bne(t2, zero, -24),
+		E::encode_ecall(),
+	});
+
+	const auto results = system.run(100'000'000, stop_hart);
+	for (uint32_t i = 0; i < 4; ++i)
+		EXPECT_EQ(results[i].trap, Rv_trap_cause::ecall);
+
+	EXPECT_EQ(memory.read_32(0x1000), 4000);
+	EXPECT_EQ(memory.read_32(0x1040), 4000);
+}
+
+TEST(Smp_system, CodeWrittenByAnotherHartIsRun) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = make_system(memory, 2);
+
+	// Hart 0 spins on an instruction until hart 1 patches it
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_bne(t0, zero, 0x100),
+	});
+	write_code(memory, 0x8, {
+		E::encode_addi(a0, zero, 0),
+		E::encode_beq(a0, zero, -4),
+		E::encode_ecall(),
+	});
+	write_code(memory, 0x104, {
+		E::encode_lw(t1, zero, 0x200),
+		E::encode_sw(zero, t1, 0x8),
+		E::encode_ecall(),
+	});
+	memory.write_32(0x200, E::encode_addi(a0, zero, 1));
+
+	const auto results = system.run(100'000'000, stop_hart);
+	EXPECT_EQ(results[0].reason, Rv_stop_reason::trap);
+	EXPECT_EQ(results[0].trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(system.get_hart(0).get_register(a0), 1);
+	EXPECT_EQ(results[1].trap, Rv_trap_cause::ecall);
+}
+
+TEST(Smp_system, request_halt) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = make_system(memory, 3);
+
+	// Hart 0 traps at once and halts the others, which spin forever
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_bne(t0, zero, 8),
+		E::encode_ecall(),
+		E::encode_jal(zero, Rv_jtype_imm::from_offset(0)),
+	});
+
+	const auto results = system.run(UINT64_MAX, [&](Test_system::Hart&, const Rv_run_result&) {
+		system.request_halt();
+		return false;
+	});
+
+	EXPECT_EQ(results[0].trap, Rv_trap_cause::ecall);
+	EXPECT_EQ(results[1].reason, Rv_stop_reason::halted);
+	EXPECT_EQ(results[2].reason, Rv_stop_reason::halted);
+	EXPECT_EQ(system.get_hart(1).get_register(pc), 0xC);
+}
+
+TEST(Smp_system, HaltsOfStoppedHartsAreDropped) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = make_system(memory, 1);
+	auto& hart = system.get_hart(0);
+
+	// The handler halts the system after the hart has stopped, as the debugger's does. Each run starts at the
+	// breakpoint, so continues past it and goes around the loop once.
+	write_code(memory, 0, {
+		E::encode_addi(a0, a0, 1),
+		E::encode_jal(zero, Rv_jtype_imm::from_offset(-4)),
+	});
+	hart.add_breakpoint(0x4);
+
+	const auto handler = [&](Test_system::Hart&, const Rv_run_result&) {
+		system.request_halt();
+		return false;
+	};
+
+	for (uint32_t run = 1; run <= 2; ++run)
+	{
+		const auto results = system.run(UINT64_MAX, handler);
+		EXPECT_EQ(results[0].reason, Rv_stop_reason::breakpoint);
+		EXPECT_EQ(hart.get_register(a0), run);
+		EXPECT_EQ(hart.get_register(pc), 0x4);
+	}
+}
+
+TEST(Smp_system, HandlerExceptionsHaltAllHarts) {
+
+	using enum Rv_register_id;
+	using E = Rv32_encoder;
+
+	auto memory = Paged_memory();
+	auto system = make_system(memory, 3);
+
+	// Hart 2 traps, the others spin
+	write_code(memory, 0, {
+		E::encode_csrrs(t0, Rv_csr::mhartid, zero),
+		E::encode_addi(t1, zero, 2),
+		E::encode_beq(t0, t1, 8),
+		E::encode_jal(zero, Rv_jtype_imm::from_offset(0)),
+		E::encode_ebreak(),
+	});
+
+	EXPECT_THROW(system.run(UINT64_MAX, [](Test_system::Hart&, const Rv_run_result&) -> bool {
+		throw std::runtime_error("EBREAK");
+	}), std::runtime_error);
+}
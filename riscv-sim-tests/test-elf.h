@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "elfio/elfio.hpp"
+
+/** An ELF32 file in the temporary directory that holds code at 0x1000 and is removed when it goes out of scope. */
+class Test_elf
+{
+public:
+	Test_elf(const std::string& name, std::initializer_list<uint32_t> code)
+		: path(std::filesystem::temp_directory_path() / ("riscv-sim-" + name + ".elf"))
+	{
+		using namespace ELFIO;
+
+		auto bytes = std::vector<char>();
+		for (const auto instruction : code)
+			for (int i = 0; i < 4; ++i)
+				bytes.push_back(static_cast<char>(instruction >> (i * 8)));
+
+		elfio writer;
+		writer.create(ELFCLASS32, ELFDATA2LSB);
+		writer.set_type(ET_EXEC);
+		writer.set_machine(EM_RISCV);
+		writer.set_entry(0x1000);
+
+		section* text = writer.sections.add(".text");
+		text->set_type(SHT_PROGBITS);
+		text->set_flags(SHF_ALLOC | SHF_EXECINSTR);
+		text->set_addr_align(4);
+		text->set_address(0x1000);
+		text->set_data(bytes.data(), static_cast<Elf_Word>(bytes.size()));
+
+		EXPECT_TRUE(writer.save(path.string()));
+	}
+
+	~Test_elf()
+	{
+		std::filesystem::remove(path);
+	}
+
+	std::string get_path() const
+	{
+		return path.string();
+	}
+
+private:
+	std::filesystem::path path;
+};
@@ -1,5 +1,22 @@
 #pragma once
 
+#include "rv32-hart.h"
+
+// The hart tests are built once per engine; see CMakeLists.txt
+#ifndef RISCV_SIM_TEST_ENGINE
+#define RISCV_SIM_TEST_ENGINE interpreter
+#endif
+
+/** Hart under test. Translates code on its first run when testing the JIT, so short tests exercise translated code. */
+struct Test_hart : riscv_sim::Rv32_hart
+{
+	Test_hart(riscv_sim::Memory& memory)
+		: riscv_sim::Rv32_hart(memory, riscv_sim::Rv32_engine::RISCV_SIM_TEST_ENGINE)
+	{
+		set_jit_threshold(0);
+	}
+};
+
 #define EXPECT_THROW_EX(statement, exception_message) \
 { \
 	try \
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "work-stealing-pool.h"
+
+using namespace riscv_sim;
+
+TEST(Work_stealing_pool, RunsEachTaskOnce) {
+
+	auto pool = Work_stealing_pool(4);
+	auto runs = std::vector<std::atomic<int>>(1000);
+	pool.run(runs.size(), [&](size_t index) { ++runs[index]; });
+
+	for (const auto& count : runs)
+		EXPECT_EQ(count, 1);
+
+	// Pools can be reused, and batches can be smaller than the pool
+	pool.run(2, [&](size_t index) { ++runs[index]; });
+	EXPECT_EQ(runs[0], 2);
+	EXPECT_EQ(runs[1], 2);
+	EXPECT_EQ(runs[2], 1);
+
+	pool.run(0, [&](size_t) { FAIL(); });
+}
+
+TEST(Work_stealing_pool, IdleThreadsStealWork) {
+
+	// The first thread is dealt the slow tasks. The second finishes its own at once and takes some of them over.
+	auto pool = Work_stealing_pool(2);
+	auto mutex = std::mutex();
+	auto slow_task_threads = std::set<std::thread::id>();
+	pool.run(8, [&](size_t index) {
+		if (index >= 4)
+			return;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		const auto lock = std::lock_guard(mutex);
+		slow_task_threads.insert(std::this_thread::get_id());
+	});
+
+	EXPECT_EQ(slow_task_threads.size(), 2);
+}
+
+TEST(Work_stealing_pool, DefaultsToHostCores) {
+
+	const auto pool = Work_stealing_pool();
+	EXPECT_EQ(pool.get_thread_count(), std::max(std::thread::hardware_concurrency(), 1u));
+}
+
+TEST(Work_stealing_pool, RethrowsTaskExceptions) {
+
+	auto pool = Work_stealing_pool(3);
+	EXPECT_THROW(pool.run(100, [](size_t index) {
+		if (index == 42)
+			throw std::runtime_error("Task failed");
+	}), std::runtime_error);
+}
@@ -0,0 +1,76 @@
+#include "batch-runner.h"
+
+#include <exception>
+#include <sstream>
+
+#include "simulation.h"
+#include "work-stealing-pool.h"
+
+using namespace std;
+
+namespace riscv_sim {
+
+vector<Batch_job> parse_batch_manifest(istream& manifest)
+{
+	auto jobs = vector<Batch_job>();
+	string line;
+	while (getline(manifest, line))
+	{
+		auto words = istringstream(line);
+		auto job = Batch_job();
+		if (!(words >> job.path) || job.path.starts_with('#'))
+			continue;
+
+		string arg;
+		while (words >> arg)
+			job.args.push_back(arg);
+
+		jobs.push_back(move(job));
+	}
+
+	return jobs;
+}
+
+Batch_result run_batch_job(const Batch_job& job, uint64_t max_instructions, Rv32_engine engine)
+{
+	auto result = Batch_result();
+	auto output = ostringstream();
+	const auto start = chrono::steady_clock::now();
+
+	try
+	{
+		auto simulation = Simulation(1, engine);
+		simulation.set_output(output);
+		simulation.load_elf(job.path, job.args);
+
+		const auto results = simulation.get_system().run(max_instructions, [&](Simulation::Hart& hart, const Rv_run_result& stop) {
+			return stop.trap == Rv_trap_cause::ecall && simulation.handle_ecall(hart);
+		});
+
+		result.stop = results[0];
+		result.exit_code = simulation.get_exit_code();
+		if (!result.exit_code && result.stop.trap == Rv_trap_cause::breakpoint)
+			result.exit_code = static_cast<int32_t>(simulation.get_system().get_hart(0).get_register(Rv_register_id::a0));
+	}
+	catch (const exception& e)
+	{
+		result.error = e.what();
+	}
+
+	result.wall_time = chrono::steady_clock::now() - start;
+	result.output = move(output).str();
+	return result;
+}
+
+vector<Batch_result> run_batch(span<const Batch_job> jobs, uint64_t max_instructions, uint32_t thread_count, Rv32_engine engine)
+{
+	auto results = vector<Batch_result>(jobs.size());
+	auto pool = Work_stealing_pool(thread_count);
+	pool.run(jobs.size(), [&](size_t index) {
+		results[index] = run_batch_job(jobs[index], max_instructions, engine);
+	});
+
+	return results;
+}
+
+}
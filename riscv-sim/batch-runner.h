@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "rv32-hart.h"
+
+namespace riscv_sim {
+
+/** A program to run in batch mode: an ELF file and the arguments passed to it after its path. */
+struct Batch_job
+{
+	std::string path;
+	std::vector<std::string> args;
+};
+
+/** How a batch job ended. */
+struct Batch_result
+{
+	std::optional<int32_t> exit_code; // Empty if the program neither exited nor returned from main
+	Rv_run_result stop;               // Why the program stopped running, with the instructions it retired
+	std::chrono::nanoseconds wall_time{};
+	std::string error;                // Why the job couldn't run, e.g. the file isn't an ELF32. Empty if it ran.
+	std::string output;               // What the program wrote to stdout and stderr
+};
+
+/**
+Parses a batch manifest: one job per line, the path of the ELF file followed by its arguments, separated by
+whitespace. Blank lines and lines starting with # are skipped. Arguments can't contain whitespace.
+*/
+std::vector<Batch_job> parse_batch_manifest(std::istream& manifest);
+
+/**
+Runs a job in a Simulation of its own, with one hart, until it exits or traps or max_instructions have been
+retired. ECALLs are serviced. A program that returns from main ends at the EBREAK of the examples' entry code, and
+exits with the value main returned in a0.
+*/
+Batch_result run_batch_job(const Batch_job& job, uint64_t max_instructions, Rv32_engine engine = Rv32_engine::jit);
+
+/**
+Runs the jobs on a Work_stealing_pool of thread_count threads, or of one per host core if it is 0. Returns their
+results in the order of the jobs.
+*/
+std::vector<Batch_result> run_batch(std::span<const Batch_job> jobs, uint64_t max_instructions, uint32_t thread_count = 0,
+	Rv32_engine engine = Rv32_engine::jit);
+
+}
@@ -0,0 +1,141 @@
+#include "buffered-memory.h"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+#include "mapped-memory.h"
+
+using namespace std;
+
+static_assert(endian::native == endian::little, "Buffered_memory requires a little endian host.");
+
+namespace riscv_sim {
+
+Buffered_memory::Buffered_memory(Memory& shared)
+	: shared(shared),
+	host_pages(static_cast<const uint8_t**>(calloc(size_t(1) << (32 - page_bits), sizeof(const uint8_t*))))
+{
+	if (!host_pages)
+		throw bad_alloc();
+
+	// Reads of pages without a buffer skip a virtual call when the shared memory is mapped
+	if (const auto mapped = dynamic_cast<Mapped_memory*>(&shared))
+		shared_base = mapped->get_host_pointer(0);
+}
+
+span<uint8_t> Buffered_memory::get_span(uint32_t address, uint32_t size)
+{
+	if (size == 0 || size > page_size || !fits_in_page(address, size))
+		return {};
+
+	notify_written(address, size);
+
+	auto& buffer = get_or_create_buffer(address);
+	mark_written(buffer, address & page_offset_mask, size);
+	return { buffer.data.data() + (address & page_offset_mask), size };
+}
+
+uint8_t* Buffered_memory::get_atomic_pointer(uint32_t address, uint32_t size)
+{
+	if (size == 0 || size > page_size || !fits_in_page(address, size))
+		return nullptr;
+
+	return get_or_create_buffer(address).data.data() + (address & page_offset_mask);
+}
+
+void Buffered_memory::notify_atomic_store(uint32_t address, uint32_t size)
+{
+	notify_written(address, size);
+
+	// The range lies within a page that get_atomic_pointer gave a buffer to
+	mark_written(get_or_create_buffer(address), address & page_offset_mask, size);
+}
+
+size_t Buffered_memory::get_buffered_page_count() const
+{
+	return buffered_page_count;
+}
+
+void Buffered_memory::commit(const function<void(uint32_t address, uint32_t size)>& written)
+{
+	if (buffered_page_count == 0)
+		return;
+
+	ranges::sort(buffered_pages);
+	for (const auto page : buffered_pages)
+	{
+		auto& slot = *slots.find(page);
+		auto& buffer = *slot.buffer;
+		const auto page_address = page << page_bits;
+
+		// Copy each run of written bytes, skipping the clear bits a word at a time
+		uint32_t offset = 0;
+		while (offset < page_size)
+		{
+			const auto bits = buffer.written[offset / 64] >> (offset % 64);
+			if (bits == 0)
+			{
+				offset = (offset / 64 + 1) * 64;
+				continue;
+			}
+
+			offset += countr_zero(bits);
+			const auto start = offset;
+			while (offset < page_size)
+			{
+				const auto count = static_cast<uint32_t>(countr_one(buffer.written[offset / 64] >> (offset % 64)));
+				offset += count;
+				if (count == 0 || offset % 64 != 0)
+					break;
+			}
+
+			const auto size = offset - start;
+			shared.write_block(page_address + start, span(buffer.data.data() + start, size));
+			if (written)
+				written(page_address + start, size);
+		}
+
+		buffer.written.fill(0);
+		slot.buffer = nullptr;
+		host_pages[page] = shared_base ? shared_base + page_address : nullptr;
+	}
+
+	buffered_pages.clear();
+	buffered_page_count = 0;
+	lookups.fill({});
+}
+
+auto Buffered_memory::create_buffer(uint32_t address) -> Buffer&
+{
+	if (buffered_page_count == buffers.size())
+		buffers.push_back(make_unique<Buffer>());
+
+	const auto page = address >> page_bits;
+	auto& buffer = *buffers[buffered_page_count++];
+	shared.read_block(address & ~page_offset_mask, buffer.data);
+	slots.get_or_create(page).buffer = &buffer;
+	buffered_pages.push_back(page);
+	lookups[page % lookups.size()] = { page, &buffer };
+	host_pages[page] = buffer.data.data();
+	return buffer;
+}
+
+void Buffered_memory::notify_committed(uint32_t address, uint32_t size)
+{
+	notify_written(address, size);
+}
+
+const uint8_t* const* Buffered_memory::get_host_pages() const
+{
+	return host_pages.get();
+}
+
+void Buffered_memory::map_host_page(uint32_t address)
+{
+	const auto page = address >> page_bits;
+	if (!host_pages[page] && shared_base)
+		host_pages[page] = shared_base + (page << page_bits);
+}
+
+}
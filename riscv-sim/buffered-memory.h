@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "memory.h"
+#include "radix-table.h"
+
+namespace riscv_sim {
+
+/**
+A hart's private view of a shared memory, which buffers the hart's writes until they are committed.
+
+Reads see the shared memory with the view's own buffered writes on top. The first write to a page copies the page
+from the shared memory into a buffer, and the buffer records which bytes were written. commit copies the written
+bytes to the shared memory, whether or not they changed, and discards the buffers. Until then the shared memory and
+other views don't see them, so harts bound to views of one memory can run on different threads without seeing
+each other's writes (see Deterministic_system).
+
+The view never writes to the shared memory outside of commit, and must not be used while the shared memory is
+written by anything else. Code cached by harts bound to the view is only invalidated by writes through the view
+and by notify_committed.
+*/
+class Buffered_memory final : public Memory
+{
+public:
+	static constexpr uint32_t page_bits = 12;
+	static constexpr uint32_t page_size = 1 << page_bits;
+
+	explicit Buffered_memory(Memory& shared);
+
+	void write_8(uint32_t address, uint8_t value) override;
+	void write_16(uint32_t address, uint16_t value) override;
+	void write_32(uint32_t address, uint32_t value) override;
+	void write_64(uint32_t address, uint64_t value) override;
+	uint8_t read_8(uint32_t address) const override;
+	uint16_t read_16(uint32_t address) const override;
+	uint32_t read_32(uint32_t address) const override;
+	uint64_t read_64(uint32_t address) const override;
+
+	/** Gets a view of the buffer of a range that lies within a single page. The whole range counts as written. */
+	std::span<uint8_t> get_span(uint32_t address, uint32_t size) override;
+
+	/** Gets the buffer of a range that lies within a single page. Only notify_atomic_store marks the range written. */
+	uint8_t* get_atomic_pointer(uint32_t address, uint32_t size) override;
+	void notify_atomic_store(uint32_t address, uint32_t size) override;
+
+	/** Gets the number of pages with buffered writes. */
+	size_t get_buffered_page_count() const;
+
+	/**
+	Copies the buffered writes to the shared memory in address order and discards the buffers. Calls
+	written(address, size) for each run of bytes copied.
+	*/
+	void commit(const std::function<void(uint32_t address, uint32_t size)>& written);
+
+	/** Discards code cached from a range that another view committed to the shared memory. */
+	void notify_committed(uint32_t address, uint32_t size);
+
+	/**
+	Gets a table of the host address of each page that loads can read directly, indexed by page number, for
+	translated code. Pages with buffered writes point to their buffers. Other pages of a Mapped_memory point into it
+	once map_host_page has been called for them. The rest are null. The table lives as long as the view.
+	*/
+	const uint8_t* const* get_host_pages() const;
+
+	/** Fills in the get_host_pages entry of the page containing the address if the page can be read directly. */
+	void map_host_page(uint32_t address);
+
+private:
+	static constexpr uint32_t page_offset_mask = page_size - 1;
+
+	struct Buffer
+	{
+		std::array<uint8_t, page_size> data;
+		std::array<uint64_t, page_size / 64> written; // A bit per byte of data
+	};
+
+	/** The buffer of a page, or null if the page has none. */
+	struct Slot
+	{
+		Buffer* buffer = nullptr;
+	};
+
+	/** A page looked up in slots, and its buffer or null if it has none. */
+	struct Lookup
+	{
+		uint32_t page = no_page;
+		Buffer* buffer = nullptr;
+	};
+
+	static constexpr uint32_t no_page = ~uint32_t(0);
+
+	struct Free_deleter
+	{
+		void operator()(void* pointer) const { std::free(pointer); }
+	};
+
+	static bool fits_in_page(uint32_t address, uint32_t size);
+
+	/** Stores a byte without notifying, for the byte accesses of a straddling access that has notified as a whole. */
+	void store_8(uint32_t address, uint8_t value);
+
+	/** Loads a byte without notifying, for the byte accesses of a straddling access that has notified as a whole. */
+	uint8_t load_8(uint32_t address) const;
+
+	/** Sets the written bits of size bytes from the offset, which lie within the page. */
+	static void mark_written(Buffer& buffer, uint32_t offset, uint32_t size);
+
+	/** Gets the buffer of the page containing the address, or null if the page has no buffered writes. */
+	Buffer* find_buffer(uint32_t address) const;
+
+	/** Gets the buffer of the page containing the address, copying the page from the shared memory if needed. */
+	Buffer& get_or_create_buffer(uint32_t address);
+
+	/** Copies the page containing the address, which has no buffer, from the shared memory into a new buffer. */
+	Buffer& create_buffer(uint32_t address);
+
+	Memory& shared;
+	const uint8_t* shared_base = nullptr; // The host mapping of a Mapped_memory, read without a call
+	// Buffers are kept for reuse after commits, and so are the slots of the pages that had them
+	Radix_table<Slot, 32 - page_bits, 2> slots;
+	std::vector<std::unique_ptr<Buffer>> buffers; // The first buffered_page_count are in use
+	std::vector<uint32_t> buffered_pages;
+	size_t buffered_page_count = 0;
+
+	// Direct-mapped by page number in front of buffers, for pages with and without a buffer
+	mutable std::array<Lookup, 64> lookups;
+
+	// Allocated zeroed with calloc, so only the parts of the table in use take up host memory
+	std::unique_ptr<const uint8_t*[], Free_deleter> host_pages;
+};
+
+// Accessors are defined inline for the instruction executors, like Paged_memory's. Accesses that straddle two
+// pages are notified once and split into byte accesses.
+
+inline void Buffered_memory::write_8(uint32_t address, uint8_t value)
+{
+	notify_written(address, sizeof(value));
+	store_8(address, value);
+}
+
+inline void Buffered_memory::write_16(uint32_t address, uint16_t value)
+{
+	notify_written(address, sizeof(value));
+
+	if (fits_in_page(address, sizeof(value)))
+	{
+		auto& buffer = get_or_create_buffer(address);
+		std::memcpy(buffer.data.data() + (address & page_offset_mask), &value, sizeof(value));
+		mark_written(buffer, address & page_offset_mask, sizeof(value));
+		return;
+	}
+
+	store_8(address, 0xFF & value);
+	store_8(address + 1, 0xFF & (value >> 8));
+}
+
+inline void Buffered_memory::write_32(uint32_t address, uint32_t value)
+{
+	notify_written(address, sizeof(value));
+
+	if (fits_in_page(address, sizeof(value)))
+	{
+		auto& buffer = get_or_create_buffer(address);
+		std::memcpy(buffer.data.data() + (address & page_offset_mask), &value, sizeof(value));
+		mark_written(buffer, address & page_offset_mask, sizeof(value));
+		return;
+	}
+
+	store_8(address, 0xFF & value);
+	store_8(address + 1, 0xFF & (value >> 8));
+	store_8(address + 2, 0xFF & (value >> 16));
+	store_8(address + 3, 0xFF & (value >> 24));
+}
+
+inline void Buffered_memory::write_64(uint32_t address, uint64_t value)
+{
+	notify_written(address, sizeof(value));
+
+	if (fits_in_page(address, sizeof(value)))
+	{
+		auto& buffer = get_or_create_buffer(address);
+		std::memcpy(buffer.data.data() + (address & page_offset_mask), &value, sizeof(value));
+		mark_written(buffer, address & page_offset_mask, sizeof(value));
+		return;
+	}
+
+	for (uint32_t i = 0; i < sizeof(value); ++i)
+		store_8(address + i, 0xFF & (value >> (8 * i)));
+}
+
+inline uint8_t Buffered_memory::read_8(uint32_t address) const
+{
+	notify_read(address, sizeof(uint8_t));
+	return load_8(address);
+}
+
+inline uint16_t Buffered_memory::read_16(uint32_t address) const
+{
+	notify_read(address, sizeof(uint16_t));
+
+	if (fits_in_page(address, sizeof(uint16_t)))
+	{
+		const auto buffer = find_buffer(address);
+		uint16_t value;
+		if (buffer)
+			std::memcpy(&value, buffer->data.data() + (address & page_offset_mask), sizeof(value));
+		else if (shared_base)
+			std::memcpy(&value, shared_base + address, sizeof(value));
+		else
+			return shared.read_16(address);
+
+		return value;
+	}
+
+	return (load_8(address)
+		| (load_8(address + 1) << 8));
+}
+
+inline uint32_t Buffered_memory::read_32(uint32_t address) const
+{
+	notify_read(address, sizeof(uint32_t));
+
+	if (fits_in_page(address, sizeof(uint32_t)))
+	{
+		const auto buffer = find_buffer(address);
+		uint32_t value;
+		if (buffer)
+			std::memcpy(&value, buffer->data.data() + (address & page_offset_mask), sizeof(value));
+		else if (shared_base)
+			std::memcpy(&value, shared_base + address, sizeof(value));
+		else
+			return shared.read_32(address);
+
+		return value;
+	}
+
+	return (load_8(address)
+		| (load_8(address + 1) << 8)
+		| (load_8(address + 2) << 16)
+		| (load_8(address + 3) << 24));
+}
+
+inline uint64_t Buffered_memory::read_64(uint32_t address) const
+{
+	notify_read(address, sizeof(uint64_t));
+
+	if (fits_in_page(address, sizeof(uint64_t)))
+	{
+		const auto buffer = find_buffer(address);
+		uint64_t value;
+		if (buffer)
+			std::memcpy(&value, buffer->data.data() + (address & page_offset_mask), sizeof(value));
+		else if (shared_base)
+			std::memcpy(&value, shared_base + address, sizeof(value));
+		else
+			return shared.read_64(address);
+
+		return value;
+	}
+
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < sizeof(value); ++i)
+		value |= uint64_t(load_8(address + i)) << (8 * i);
+
+	return value;
+}
+
+inline bool Buffered_memory::fits_in_page(uint32_t address, uint32_t size)
+{
+	return (address & page_offset_mask) <= page_size - size;
+}
+
+inline void Buffered_memory::store_8(uint32_t address, uint8_t value)
+{
+	auto& buffer = get_or_create_buffer(address);
+	buffer.data[address & page_offset_mask] = value;
+	mark_written(buffer, address & page_offset_mask, sizeof(value));
+}
+
+inline uint8_t Buffered_memory::load_8(uint32_t address) const
+{
+	if (const auto buffer = find_buffer(address))
+		return buffer->data[address & page_offset_mask];
+
+	if (shared_base)
+		return shared_base[address];
+
+	return shared.read_8(address);
+}
+
+inline void Buffered_memory::mark_written(Buffer& buffer, uint32_t offset, uint32_t size)
+{
+	// Single accesses set bits of one word unless they are misaligned
+	if (size < 64 && offset % 64 + size <= 64) [[likely]]
+	{
+		buffer.written[offset / 64] |= ((uint64_t(1) << size) - 1) << (offset % 64);
+		return;
+	}
+
+	const auto end = offset + size;
+	while (offset < end)
+	{
+		const auto bit = offset % 64;
+		const auto count = std::min(64 - bit, end - offset);
+		buffer.written[offset / 64] |= (count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << bit;
+		offset += count;
+	}
+}
+
+inline auto Buffered_memory::find_buffer(uint32_t address) const -> Buffer*
+{
+	// Harts read far more than they write, often between commits with nothing buffered
+	if (buffered_page_count == 0)
+		return nullptr;
+
+	const auto page = address >> page_bits;
+	auto& lookup = lookups[page % lookups.size()];
+	if (lookup.page != page) [[unlikely]]
+	{
+		const auto slot = slots.find(page);
+		lookup = { page, slot ? slot->buffer : nullptr };
+	}
+
+	return lookup.buffer;
+}
+
+inline auto Buffered_memory::get_or_create_buffer(uint32_t address) -> Buffer&
+{
+	if (const auto buffer = find_buffer(address)) [[likely]]
+		return *buffer;
+
+	return create_buffer(address);
+}
+
+}
@@ -0,0 +1,201 @@
+#include "deterministic-system.h"
+
+#include <algorithm>
+#include <barrier>
+#include <thread>
+
+using namespace std;
+
+namespace riscv_sim {
+
+Deterministic_system::Deterministic_system(Memory& memory, uint32_t hart_count, uint64_t seed, Rv32_engine engine)
+	: random(seed)
+{
+	views.reserve(hart_count);
+	harts.reserve(hart_count);
+	for (uint32_t i = 0; i < hart_count; ++i)
+	{
+		views.push_back(make_unique<Buffered_memory>(memory));
+		harts.push_back(make_unique<Hart>(*views.back(), engine));
+		harts.back()->set_hart_id(i);
+		harts.back()->set_virtual_time(instructions_per_microsecond);
+		order.push_back(i);
+	}
+}
+
+uint32_t Deterministic_system::get_hart_count() const
+{
+	return static_cast<uint32_t>(harts.size());
+}
+
+auto Deterministic_system::get_hart(uint32_t index) -> Hart&
+{
+	return *harts.at(index);
+}
+
+void Deterministic_system::set_quantum(uint32_t instructions)
+{
+	quantum = max(instructions, 1u);
+}
+
+vector<Rv_run_result> Deterministic_system::run(uint64_t max_instructions, const Stop_handler& handler)
+{
+	auto states = vector<Hart_state>(harts.size());
+	for (auto& state : states)
+	{
+		state.remaining = max_instructions;
+		state.active = max_instructions != 0;
+	}
+
+	// The last thread to finish its quantum commits, runs the harts that stopped and decides whether there is
+	// another round. The barrier orders all of it between the quanta of the rounds before and after.
+	bool done = harts.empty() || max_instructions == 0;
+	exception_ptr error;
+	const auto end_round = [&]() noexcept {
+		for (auto& state : states)
+		{
+			if (state.error && !error)
+				error = state.error;
+		}
+
+		try
+		{
+			shuffle_order();
+			for (const auto index : order)
+				commit(index);
+
+			for (const auto index : order)
+			{
+				if (!error && states[index].stop)
+					finish_quantum(index, states[index], handler);
+			}
+		}
+		catch (...)
+		{
+			error = current_exception();
+		}
+
+		done = error || halt_requested.load() || none_of(states.begin(), states.end(), [](const Hart_state& state) {
+			return state.active;
+		});
+	};
+
+	auto round = barrier(static_cast<ptrdiff_t>(harts.size()), end_round);
+	const auto work = [&](uint32_t index) {
+		while (!done)
+		{
+			try
+			{
+				run_quantum(*harts[index], states[index]);
+			}
+			catch (...)
+			{
+				states[index].error = current_exception();
+			}
+
+			round.arrive_and_wait();
+		}
+	};
+
+	{
+		auto threads = vector<jthread>();
+		threads.reserve(harts.size());
+		for (uint32_t i = 1; i < harts.size(); ++i)
+			threads.emplace_back(work, i);
+
+		if (!done)
+			work(0);
+	}
+
+	halt_requested.store(false);
+	if (error)
+		rethrow_exception(error);
+
+	auto results = vector<Rv_run_result>();
+	for (const auto& state : states)
+		results.push_back(state.total);
+
+	return results;
+}
+
+void Deterministic_system::request_halt()
+{
+	halt_requested.store(true);
+}
+
+void Deterministic_system::run_quantum(Hart& hart, Hart_state& state)
+{
+	if (!state.active || state.error)
+		return;
+
+	hart.set_stop_before_atomics(true);
+	state.quantum_left = min<uint64_t>(quantum, state.remaining);
+
+	const auto result = hart.run(state.quantum_left);
+	state.total = { state.total.retired + result.retired, result.reason, result.trap };
+	state.remaining -= result.retired;
+	state.quantum_left -= result.retired;
+
+	if (result.reason != Rv_stop_reason::budget_exhausted)
+		state.stop = result;
+	else if (state.remaining == 0)
+		state.active = false;
+}
+
+void Deterministic_system::finish_quantum(uint32_t index, Hart_state& state, const Stop_handler& handler)
+{
+	auto& hart = *harts[index];
+	hart.set_stop_before_atomics(false);
+
+	auto stop = *state.stop;
+	state.stop.reset();
+	for (;;)
+	{
+		// Atomics just run now. Handlers see the hart's writes in the shared memory.
+		if (stop.reason != Rv_stop_reason::atomic)
+		{
+			commit(index);
+			if (!handler || !handler(hart, stop))
+			{
+				state.active = false;
+				break;
+			}
+		}
+
+		if (state.quantum_left == 0)
+			break;
+
+		stop = hart.run(state.quantum_left);
+		state.total = { state.total.retired + stop.retired, stop.reason, stop.trap };
+		state.remaining -= stop.retired;
+		state.quantum_left -= stop.retired;
+
+		if (stop.reason == Rv_stop_reason::budget_exhausted)
+			break;
+	}
+
+	if (state.remaining == 0)
+		state.active = false;
+
+	commit(index);
+}
+
+void Deterministic_system::commit(uint32_t index)
+{
+	views[index]->commit([&](uint32_t address, uint32_t size) {
+		for (uint32_t i = 0; i < views.size(); ++i)
+		{
+			if (i != index)
+				views[i]->notify_committed(address, size);
+		}
+	});
+}
+
+void Deterministic_system::shuffle_order()
+{
+	// Fisher-Yates with the generator's raw output, which the standard fixes, unlike std::shuffle
+	for (auto i = order.size(); i > 1; --i)
+		swap(order[i - 1], order[random() % i]);
+}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "buffered-memory.h"
+#include "rv32-hart.h"
+
+namespace riscv_sim {
+
+/**
+Several RV32 harts that share one memory and run reproducibly: the same seed and starting state give bit-identical
+registers, memory, output and instruction counts on every run, whatever the host's timing.
+
+The harts run in rounds. In each round every hart runs a quantum of instructions on its own host thread, bound to a
+Buffered_memory view of the shared memory, so it sees memory as it was when the round started plus its own writes.
+The harts can't observe each other during the quantum, so they run in parallel without interacting. When all of
+them are done, the views commit their writes to the shared memory one after another, in an order the seed
+shuffles each round. Writes of different harts to the same byte in a round resolve to the last hart to commit.
+
+A hart that stops within its quantum, at a trap (such as an ECALL), a breakpoint or an atomic instruction, finishes
+its quantum after the commits, with no other hart running. The harts that stopped do so one at a time in the commit
+order, and commit before each stop handler runs and once they finish. Atomics and handlers therefore see the writes
+of all harts before them and are atomic with respect to the others, and handlers can read and write the shared
+memory directly. Code handlers overwrite isn't discarded from the harts' caches.
+
+The time counter of the harts counts instructions (see Basic_rv_hart::set_virtual_time), so it reads the same in
+every run too.
+
+To the harts, this is a multiprocessor whose stores become visible to the other harts at the end of the round. Plain
+loads and stores that race within a round see the old values; programs that synchronize, with atomics or flags and
+FENCE, wait a round or more for each other. Longer quanta amortize the commits and the synchronization of the
+threads, and shorter ones make harts that wait for each other react sooner.
+*/
+class Deterministic_system
+{
+public:
+	using Hart = Basic_rv32_hart<Buffered_memory>;
+
+	/**
+	Called with no other hart running when a hart's run() stops for anything other than its budget. Returns whether
+	the hart carries on, e.g. after it has serviced an ECALL and moved PC past it.
+	*/
+	using Stop_handler = std::function<bool(Hart& hart, const Rv_run_result& result)>;
+
+	static constexpr uint32_t default_quantum = 100'000;
+
+	/** The rate of the harts' time counters: a nominal 100 MHz. */
+	static constexpr uint32_t instructions_per_microsecond = 100;
+
+	Deterministic_system(Memory& memory, uint32_t hart_count, uint64_t seed, Rv32_engine engine = Rv32_engine::interpreter);
+
+	uint32_t get_hart_count() const;
+	Hart& get_hart(uint32_t index);
+
+	/** Sets the number of instructions each hart runs per round. */
+	void set_quantum(uint32_t instructions);
+
+	/**
+	Runs every hart for up to max_instructions in rounds and waits for all of them. Hart 0 runs on the calling
+	thread. Returns a result per hart: the instructions it retired in total and why it last stopped. The order of
+	the commits carries on from the last run, so a sequence of runs is reproducible from construction.
+	An exception thrown by a hart or a handler ends the run at the end of the round and is rethrown.
+	*/
+	std::vector<Rv_run_result> run(uint64_t max_instructions, const Stop_handler& handler);
+
+	/**
+	Stops run() at the end of the current round. Can be called from any thread. From a stop handler, it stops every
+	run with the same seed at the same instruction.
+	*/
+	void request_halt();
+
+private:
+	struct Hart_state
+	{
+		Rv_run_result total;
+		uint64_t remaining = 0;            // Instructions left of max_instructions
+		uint64_t quantum_left = 0;         // Instructions left of the current quantum
+		std::optional<Rv_run_result> stop; // Why the hart stopped within its quantum, until it is handled
+		bool active = false;               // Whether the hart runs in the next round
+		std::exception_ptr error;          // Thrown by the hart's quantum
+	};
+
+	/** Runs the quantum of a hart that is still active, up to the first stop. */
+	void run_quantum(Hart& hart, Hart_state& state);
+
+	/** Handles the stop of a hart that stopped within its quantum and runs the rest of the quantum. */
+	void finish_quantum(uint32_t index, Hart_state& state, const Stop_handler& handler);
+
+	/** Commits the buffered writes of a hart and discards the code they overwrote from the other harts' caches. */
+	void commit(uint32_t index);
+
+	/** Shuffles the commit order with the seeded generator. */
+	void shuffle_order();
+
+	std::vector<std::unique_ptr<Buffered_memory>> views;
+	std::vector<std::unique_ptr<Hart>> harts; // Destroyed before the views they are registered with
+	std::vector<uint32_t> order;
+	std::mt19937_64 random;
+	uint32_t quantum = default_quantum;
+	std::atomic<bool> halt_requested = false;
+};
+
+}
@@ -0,0 +1,272 @@
+#include "fuzzer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace riscv_sim {
+
+/** AFL's buckets for hit counts: 1, 2, 3, 4-7, 8-15, 16-31, 32-127 and 128-255, one bit each. */
+static constexpr auto s_count_buckets = [] {
+	auto buckets = array<uint8_t, 256>();
+	for (uint32_t count = 1; count < 256; ++count)
+	{
+		buckets[count] = count <= 2 ? uint8_t(count) : count == 3 ? 4 : count < 8 ? 8 : count < 16 ? 16
+			: count < 32 ? 32 : count < 128 ? 64 : 128;
+	}
+
+	return buckets;
+}();
+
+/** Byte values that often sit at boundaries programs check. */
+static constexpr int8_t s_interesting_bytes[] = { -128, -1, 0, 1, 16, 32, 64, 100, 127 };
+
+Fuzzer::Fuzzer(Simulation& simulation, const Fuzz_target& target, uint64_t seed)
+	: simulation(simulation), hart(simulation.get_system().get_hart(0)), target(target), random(seed)
+{
+	virgin.fill(0xFF);
+	virgin_crashes.fill(0xFF);
+
+	// Run the program's setup once, servicing its system calls on the way
+	hart.add_breakpoint(target.start);
+	uint64_t budget = target.max_instructions;
+	while (hart.get_register(Rv_register_id::pc) != target.start)
+	{
+		const auto result = hart.run(budget);
+		budget -= result.retired;
+		if (result.reason == Rv_stop_reason::trap && result.trap == Rv_trap_cause::ecall && budget != 0
+			&& simulation.handle_ecall(hart))
+		{
+			continue;
+		}
+
+		if (result.reason != Rv_stop_reason::breakpoint)
+		{
+			hart.remove_breakpoint(target.start);
+			throw runtime_error("The program stopped before it reached the start address of the fuzz target.");
+		}
+	}
+
+	hart.remove_breakpoint(target.start);
+	hart.add_breakpoint(target.stop);
+	hart.set_coverage_map(coverage.data());
+	simulation.take_snapshot();
+}
+
+Fuzzer::~Fuzzer()
+{
+	hart.set_coverage_map(nullptr);
+	hart.remove_breakpoint(target.stop);
+}
+
+Fuzz_outcome Fuzzer::execute(span<const uint8_t> input)
+{
+	simulation.restore_snapshot();
+	hart.reset_coverage_location();
+	for (const auto chunk : hit_chunks)
+		memset(coverage.data() + chunk, 0, c_chunk_size);
+
+	input = input.first(min<size_t>(input.size(), target.max_input_size));
+	simulation.get_memory().write_block(target.input_address, input);
+	hart.set_register(Rv_register_id::a0, target.input_address);
+	hart.set_register(Rv_register_id::a1, static_cast<uint32_t>(input.size()));
+	++stats.executions;
+
+	auto outcome = Fuzz_outcome::completed;
+	uint64_t budget = target.max_instructions;
+	for (;;)
+	{
+		const auto result = hart.run(budget);
+		budget -= result.retired;
+		if (result.reason == Rv_stop_reason::budget_exhausted)
+		{
+			outcome = Fuzz_outcome::hang;
+		}
+		else if (result.reason == Rv_stop_reason::trap)
+		{
+			if (result.trap == Rv_trap_cause::ecall && budget != 0 && simulation.handle_ecall(hart))
+				continue;
+
+			// Exits and EBREAKs end a run normally
+			if (result.trap != Rv_trap_cause::ecall && result.trap != Rv_trap_cause::breakpoint)
+				outcome = Fuzz_outcome::crash;
+		}
+		else if (result.reason == Rv_stop_reason::watchpoint)
+		{
+			outcome = Fuzz_outcome::crash;
+		}
+
+		break;
+	}
+
+	classify_coverage();
+	return outcome;
+}
+
+Fuzz_outcome Fuzzer::add_input(span<const uint8_t> input)
+{
+	const auto outcome = execute(input);
+	if (outcome == Fuzz_outcome::crash)
+	{
+		++stats.crashes;
+		if (merge_coverage(virgin_crashes))
+			crashes.emplace_back(input.begin(), input.end());
+	}
+	else if (outcome == Fuzz_outcome::hang)
+	{
+		++stats.hangs;
+	}
+	else if (merge_coverage(virgin))
+	{
+		corpus.emplace_back(input.begin(), input.end());
+		stats.edges = static_cast<uint32_t>(ranges::count_if(virgin, [](uint8_t bits) { return bits != 0xFF; }));
+	}
+
+	return outcome;
+}
+
+void Fuzzer::fuzz(uint64_t count)
+{
+	if (corpus.empty())
+		add_input({});
+
+	auto input = vector<uint8_t>();
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		// The corpus can still be empty if the empty input crashed or hung
+		if (corpus.empty())
+			input.clear();
+		else
+			input = corpus[random_below(static_cast<uint32_t>(corpus.size()))];
+
+		mutate(input);
+		add_input(input);
+	}
+}
+
+span<const uint8_t> Fuzzer::get_coverage() const
+{
+	return coverage;
+}
+
+auto Fuzzer::get_stats() const -> const Stats&
+{
+	return stats;
+}
+
+const vector<vector<uint8_t>>& Fuzzer::get_corpus() const
+{
+	return corpus;
+}
+
+const vector<vector<uint8_t>>& Fuzzer::get_crashes() const
+{
+	return crashes;
+}
+
+/** Reads the 8-byte word at the index of a coverage map. */
+static uint64_t read_word(const uint8_t* map, size_t index)
+{
+	uint64_t word;
+	memcpy(&word, map + index * 8, 8);
+	return word;
+}
+
+void Fuzzer::classify_coverage()
+{
+	hit_chunks.clear();
+	for (uint32_t chunk = 0; chunk < coverage.size(); chunk += c_chunk_size)
+	{
+		// Whole words are ORed so the scan of the zeros vectorizes
+		uint64_t bits = 0;
+		for (uint32_t i = 0; i < c_chunk_size / 8; ++i)
+			bits |= read_word(coverage.data() + chunk, i);
+
+		if (bits == 0) [[likely]]
+			continue;
+
+		hit_chunks.push_back(chunk);
+		for (uint32_t i = chunk; i < chunk + c_chunk_size; ++i)
+			coverage[i] = s_count_buckets[coverage[i]];
+	}
+}
+
+bool Fuzzer::merge_coverage(Coverage_map& virgin_bits)
+{
+	bool found = false;
+	for (const auto chunk : hit_chunks)
+	{
+		for (uint32_t i = 0; i < c_chunk_size / 8; ++i)
+		{
+			const auto bits = read_word(coverage.data() + chunk, i);
+			auto virgin_word = read_word(virgin_bits.data() + chunk, i);
+			if ((bits & virgin_word) == 0)
+				continue;
+
+			virgin_word &= ~bits;
+			memcpy(virgin_bits.data() + chunk + i * 8, &virgin_word, 8);
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+void Fuzzer::mutate(vector<uint8_t>& input)
+{
+	// A stack of 2 to 32 mutations, like AFL's havoc stage
+	const auto mutations = 2u << random_below(5);
+	for (uint32_t i = 0; i < mutations; ++i)
+	{
+		// Empty inputs can only grow
+		const auto kind = input.empty() ? 0 : random_below(7);
+		const auto position = input.empty() ? 0 : random_below(static_cast<uint32_t>(input.size()));
+		switch (kind)
+		{
+		case 0: // Insert a random byte
+			if (input.size() < target.max_input_size)
+				input.insert(input.begin() + random_below(static_cast<uint32_t>(input.size()) + 1), static_cast<uint8_t>(random()));
+			break;
+
+		case 1: // Flip a bit
+			input[position] ^= static_cast<uint8_t>(1 << random_below(8));
+			break;
+
+		case 2: // Set a random byte
+			input[position] = static_cast<uint8_t>(random());
+			break;
+
+		case 3: // Add or subtract up to 35
+			input[position] += static_cast<uint8_t>(random_below(71) - 35);
+			break;
+
+		case 4: // Set an interesting value
+			input[position] = static_cast<uint8_t>(s_interesting_bytes[random_below(size(s_interesting_bytes))]);
+			break;
+
+		case 5: // Delete a byte
+			input.erase(input.begin() + position);
+			break;
+
+		case 6: // Copy in bytes from the same place in another input of the corpus
+		{
+			const auto& other = corpus.empty() ? input : corpus[random_below(static_cast<uint32_t>(corpus.size()))];
+			if (&other != &input && position < other.size())
+			{
+				const auto length = 1 + random_below(static_cast<uint32_t>(min(input.size(), other.size()) - position));
+				copy_n(other.begin() + position, length, input.begin() + position);
+			}
+			break;
+		}
+		}
+	}
+}
+
+uint32_t Fuzzer::random_below(uint32_t limit)
+{
+	return static_cast<uint32_t>(random() % limit);
+}
+
+}
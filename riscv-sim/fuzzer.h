@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "simulation.h"
+
+namespace riscv_sim {
+
+/** Where a Fuzzer runs a program and where it puts the inputs. */
+struct Fuzz_target
+{
+	uint32_t start;                         // Each input runs from here, with a0 pointing at it and its size in a1
+	uint32_t stop;                          // Reaching this address ends a run, e.g. the return from the code under test
+	uint32_t input_address;                 // Where inputs are written
+	uint32_t max_input_size;
+	uint64_t max_instructions = 1'000'000; // Runs that retire this many instructions are hangs
+};
+
+/** How a run of one input ended. */
+enum class Fuzz_outcome
+{
+	completed, // Reached the stop address or an EBREAK, or exited
+	crash,     // Trapped or hit a watchpoint
+	hang,      // Retired max_instructions
+};
+
+/**
+Fuzzes a program in process, AFL style. The program runs on hart 0 of a Simulation once, from where it is to the
+start address, and the Fuzzer takes a snapshot there. Each input is written into guest memory and run from the
+snapshot, which is restored afterwards by copying back only the pages the run wrote. The hart counts the edges
+taken between blocks in a 64 KiB coverage map (see Basic_rv_hart::set_coverage_map). Inputs that reach new edges,
+or hit known ones a new number of times, are kept as the corpus that later inputs are mutated from.
+
+ECALLs are serviced by the Simulation, so programs may allocate and write output. Breakpoints other than the stop
+address, and watchpoints, must not be set while the Fuzzer exists, except watchpoints on memory no input may touch.
+*/
+class Fuzzer
+{
+public:
+	struct Stats
+	{
+		uint64_t executions = 0;
+		uint64_t crashes = 0; // Crashing runs, including ones with coverage seen before
+		uint64_t hangs = 0;
+		uint32_t edges = 0;   // Coverage map entries hit by any run
+	};
+
+	/**
+	Runs hart 0 of the loaded program to the start address and takes a snapshot. Throws std::runtime_error if the
+	program stops anywhere else or doesn't get there in max_instructions. The simulation's snapshot, and hart 0's
+	coverage map and breakpoints at start and stop, belong to the Fuzzer until it is destroyed.
+	*/
+	Fuzzer(Simulation& simulation, const Fuzz_target& target, uint64_t seed = 1);
+	~Fuzzer();
+
+	Fuzzer(const Fuzzer&) = delete;
+	Fuzzer& operator=(const Fuzzer&) = delete;
+
+	/** Runs the input from the snapshot, truncated to max_input_size. The coverage map holds its edges afterwards. */
+	Fuzz_outcome execute(std::span<const uint8_t> input);
+
+	/** Runs the input and adds it to the corpus if it finds new coverage. Returns how the run ended. */
+	Fuzz_outcome add_input(std::span<const uint8_t> input);
+
+	/**
+	Runs count inputs, each mutated from an entry of the corpus. Starts from an empty input if the corpus is empty.
+	Crashing inputs with new coverage are kept with the crashes.
+	*/
+	void fuzz(uint64_t count);
+
+	/** Gets the coverage map of the last run, with counts bucketed as AFL does: 1, 2, 3, 4-7, 8-15, ..., 128+. */
+	std::span<const uint8_t> get_coverage() const;
+
+	const Stats& get_stats() const;
+	const std::vector<std::vector<uint8_t>>& get_corpus() const;
+	const std::vector<std::vector<uint8_t>>& get_crashes() const;
+
+private:
+	using Coverage_map = std::array<uint8_t, rv_coverage_map_size>;
+
+	/** Buckets the counts of the coverage map and lists the chunks of it the run hit. */
+	void classify_coverage();
+
+	/** Clears the bits of the bucketed coverage map from virgin_bits. Returns whether any were set. */
+	bool merge_coverage(Coverage_map& virgin_bits);
+
+	/** Changes the input in place with a stack of random mutations. */
+	void mutate(std::vector<uint8_t>& input);
+
+	uint32_t random_below(uint32_t limit);
+
+	Simulation& simulation;
+	Simulation::Hart& hart;
+	Fuzz_target target;
+	std::mt19937_64 random;
+
+	alignas(64) Coverage_map coverage{};
+	Coverage_map virgin;         // Bits of the buckets no run has hit yet
+	Coverage_map virgin_crashes; // The same for crashing runs
+
+	// Runs hit few edges, so the map is only scanned once per run. Clearing and merging it only visit the chunks of
+	// c_chunk_size bytes that the last run hit.
+	static constexpr uint32_t c_chunk_size = 64;
+	std::vector<uint32_t> hit_chunks;
+
+	Stats stats;
+	std::vector<std::vector<uint8_t>> corpus;
+	std::vector<std::vector<uint8_t>> crashes;
+};
+
+}
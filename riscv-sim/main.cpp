@@ -1,68 +1,75 @@
-﻿#include <iomanip>
-#include <set>
-#include <utility>
-
-#include "simple-system.h"
-#include "elfio/elfio.hpp"
+﻿#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "batch-runner.h"
+#include "fuzzer.h"
 #include "rv32-hart.h"
 #include "rv-disassembler.h"
+#include "simulation.h"
 
 using namespace std;
-using namespace ELFIO;
 using namespace riscv_sim;
 
-static auto s_memory = Simple_memory_subsystem();
-static auto s_hart = Rv32_hart(s_memory);
+using Cli_hart = Simulation::Hart;
 
-static auto s_program_name_to_path = map<string, string>() = {
-	{ "c-printf-newlib", "../../../../examples/c-printf-newlib/program.elf" }
-};
+/** The program the CLI debugs. Each hart runs on its own thread. The "harts" command sets how many there are. */
+static auto s_simulation = Simulation();
 
+/** Instructions a batch job may retire before it is stopped as hung. */
+static constexpr uint64_t s_batch_instruction_limit = 10'000'000'000;
 
-static auto s_breakpoints = set<uint32_t>();
+/** Instructions a fuzzed input may retire before its run counts as a hang. */
+static constexpr uint64_t s_fuzz_instruction_limit = 1'000'000;
 
-static uint64_t s_heap_base = 0;
-static uint64_t s_heap_top = 0;
+static auto s_program_name_to_path = map<string, string>() = {
+	{ "c-printf-newlib", "../../../../examples/c-printf-newlib/program.elf" }
+};
 
-void print_next_instruction(Rv32_hart& hart)
+void print_next_instruction(Cli_hart& hart)
 {
 	uint32_t pc = hart.get_register(Rv_register_id::pc);
-	uint32_t instruction = s_memory.read_32(pc);
+	uint32_t instruction = s_simulation.get_memory().read_32(pc);
+	if (hart.is_compressed_enabled() && Rv32_decoder::is_compressed(instruction))
+		instruction = Rv32_decoder::expand_compressed(static_cast<uint16_t>(instruction));
+
 	auto result = Rv_disassembler::disassemble(instruction);
 
 	const string& mnemonic = Rv_disassembler::get_mnemonic(result.type);
 	cout << "Next instruction: " << hex << "(" << pc << ")" << "     " << mnemonic << " ";
 
 	bool need_comma = false;
+	const auto print_register = [&](Rv_register_id reg, bool fp) {
+		if (reg == Rv_register_id::_unused)
+			return;
 
-	if (result.rd != Rv_register_id::_unused)
-	{
-		cout << Rv_disassembler::get_register_abi_name(result.rd);
-		need_comma = true;
-	}
-
-	if (result.rs1 != Rv_register_id::_unused)
-	{
-		cout << (need_comma ? ", " : "") << Rv_disassembler::get_register_abi_name(result.rs1);
+		const auto& name = fp ? Rv_disassembler::get_fp_register_abi_name(reg) : Rv_disassembler::get_register_abi_name(reg);
+		cout << (need_comma ? ", " : "") << name;
 		need_comma = true;
-	}
+	};
 
-	if (result.rs2 != Rv_register_id::_unused)
-	{
-		cout << (need_comma ? ", " : "") << Rv_disassembler::get_register_abi_name(result.rs2);
-		need_comma = true;
-	}
+	print_register(result.rd, result.rd_fp);
+	print_register(result.rs1, result.rs1_fp);
+	print_register(result.rs2, result.rs2_fp);
+	print_register(result.rs3, result.rs3_fp);
 
-	if (result.format != Rv32_instruction_format::rtype)
+	if (result.format != Rv32_instruction_format::rtype && result.format != Rv32_instruction_format::r4type)
 		cout << (need_comma ? ", " : "") << hex << result.imm;
 
 	cout << endl;
 }
 
-void print_registers()
+void print_registers(Cli_hart& hart)
 {
-	const auto reg = [](Rv_register_id reg_id) {
-		return s_hart.get_register(reg_id);
+	const auto reg = [&](Rv_register_id reg_id) {
+		return hart.get_register(reg_id);
 	};
 
 	const string right_pad = "  |  ";
@@ -106,210 +113,186 @@ void print_registers()
 
 void load_elf(const string& file_path)
 {
-	elfio reader;
-
-	// Load ELF data
-	if (!reader.load(file_path)) {
-		cout << "Error: Can't find or process ELF file " << file_path << endl << endl;
+	try
+	{
+		s_simulation.load_elf(file_path, {}, &cout);
+	}
+	catch (const runtime_error& e)
+	{
+		cout << "Error: " << e.what() << endl << endl;
 		return;
 	}
 
-	// Verify 32 bit ELF
-	if (reader.get_class() != ELFCLASS32)
-		cout << "Error: Only ELF32 is supported." << endl << endl;
-
-	// Verify little endian
-	if (reader.get_encoding() != ELFDATA2LSB)
-		cout << "Error: Only little endian is supported." << endl << endl;
-
-	// Reset system state
-	s_memory.reset();
-	s_hart.reset();
-
-	// Reset heap pointer (will be initialized to right after the data segments)
-	s_heap_base = 0;
-
-	// Print ELF file sections info
-	Elf_Half sec_num = reader.sections.size();
-	cout << "Number of sections: " << sec_num << endl;
-	for (int i = 0; i < sec_num; ++i) {
-		const section* psec = reader.sections[i];
-		std::cout << " [" << i << "] "
-			<< psec->get_name()
-			<< "\t"
-			<< psec->get_size()
-			<< "\t"
-			<< hex << psec->get_address()
-			<< "\t"
-			<< hex << psec->get_flags()
-			<< std::endl;
-
-		// Update heap pointer if needed
-		auto end_addr = psec->get_address() + psec->get_size();
-		if (end_addr > s_heap_base)
-			s_heap_base = end_addr;
-
-		// Load any sections into memory with the ALLOC flag
-		if (psec->get_flags() & SHF_ALLOC) {
-
-			// Access section's data
-			const char* section_data = reader.sections[i]->get_data();
-			if (!section_data)
-				continue;
-
-			for (int j = 0; j < psec->get_size(); ++j) {
-				s_memory.write_8(psec->get_address() + j, *(section_data + j));
+	cout << "Loaded " << file_path << endl << endl;
+
+	print_next_instruction(s_simulation.get_system().get_hart(0));
+}
+
+void execute(bool single_step)
+{
+	// Harts stop on their own threads. ECALLs and output are serialized, and anything but an ECALL stops all harts.
+	auto handler_mutex = mutex();
+	auto& system = s_simulation.get_system();
+	const bool several_harts = system.get_hart_count() > 1;
+	const auto handler = [&](Cli_hart& hart, const Rv_run_result& result) {
+		const auto lock = lock_guard(handler_mutex);
+		if (several_harts)
+			cout << "Hart " << dec << hart.get_hart_id() << ": ";
+
+		if (result.reason == Rv_stop_reason::trap) {
+			if (result.trap == Rv_trap_cause::ecall) {
+				cout << "ECALL" << endl;
+				if (s_simulation.handle_ecall(hart))
+					return !single_step;
+
+				cout << "EXIT: " << dec << *s_simulation.get_exit_code() << endl << endl;
+			}
+			else if (result.trap == Rv_trap_cause::breakpoint) {
+				cout << "EBREAK" << endl << endl;
+				print_registers(hart);
+			}
+			else {
+				cout << "TRAP: " << get_trap_cause_name(result.trap) << " at " << hex << hart.get_register(Rv_register_id::pc) << endl << endl;
+				print_registers(hart);
 			}
 		}
-	}
-
-	s_heap_top = s_heap_base;
+		else if (result.reason == Rv_stop_reason::breakpoint)
+		{
+			uint32_t pc = hart.get_register(Rv_register_id::pc);
+			print_registers(hart);
+			print_next_instruction(hart);
+			cout << "BREAKPOINT: " << hex << pc << endl;
+		}
+		else if (result.reason == Rv_stop_reason::watchpoint)
+		{
+			const auto hit = *hart.get_watchpoint_hit();
+			print_registers(hart);
+			print_next_instruction(hart);
+			cout << "WATCHPOINT: " << (hit.type == Watch_type::write ? "write" : "read") << " of " << dec << hit.size
+				<< " bytes at " << hex << hit.address << endl;
+		}
 
-	// Set program counter to program entry point
-	s_hart.set_register(riscv_sim::Rv_register_id::pc, reader.get_entry());
+		system.request_halt();
+		return false;
+	};
 
-	// Reset stack pointer to top of memory space
-	s_hart.set_register(riscv_sim::Rv_register_id::sp, 0xFFFFFFFF);
+	const auto results = system.run(single_step ? 1 : numeric_limits<uint64_t>::max(), handler);
 
-	cout << "Loaded " << file_path << endl << endl;
+	if (single_step)
+	{
+		for (uint32_t i = 0; i < system.get_hart_count(); ++i)
+		{
+			if (several_harts)
+				cout << "Hart " << dec << i << ":" << endl;
 
-	print_next_instruction(s_hart);
+			print_registers(system.get_hart(i));
+			print_next_instruction(system.get_hart(i));
+		}
+	}
 }
 
-#define SYS_getcwd 17
-#define SYS_dup 23
-#define SYS_fcntl 25
-#define SYS_faccessat 48
-#define SYS_chdir 49
-#define SYS_openat 56
-#define SYS_close 57
-#define SYS_getdents 61
-#define SYS_lseek 62
-#define SYS_read 63
-#define SYS_write 64
-#define SYS_writev 66
-#define SYS_pread 67
-#define SYS_pwrite 68
-#define SYS_fstatat 79
-#define SYS_fstat 80
-#define SYS_exit 93
-#define SYS_exit_group 94
-#define SYS_kill 129
-#define SYS_rt_sigaction 134
-#define SYS_times 153
-#define SYS_uname 160
-#define SYS_gettimeofday 169
-#define SYS_getpid 172
-#define SYS_getuid 174
-#define SYS_geteuid 175
-#define SYS_getgid 176
-#define SYS_getegid 177
-#define SYS_brk 214
-#define SYS_munmap 215
-#define SYS_mremap 216
-#define SYS_mmap 222
-#define SYS_open 1024
-#define SYS_link 1025
-#define SYS_unlink 1026
-#define SYS_mkdir 1030
-#define SYS_access 1033
-#define SYS_stat 1038
-#define SYS_lstat 1039
-#define SYS_time 1062
-#define SYS_getmainvars 2011
-
-void ecall_handler(Rv32_hart& hart)
+static const char* get_stop_reason_name(Rv_stop_reason reason)
 {
-	// Using newlib as the C library.
-
-	// Parameters passed by registers
-	// a7 is the type of syscall
-	// a0-a5 are parameters
-	// return value is passed back in a0
-	// https://git.kernel.org/pub/scm/docs/man-pages/man-pages.git/tree/man2/syscall.2?h=man-pages-5.04#n200
-	// https://stackoverflow.com/questions/59800430/risc-v-ecall-syscall-calling-convention-on-pk-linux
-
-	// List of syscall IDs:
-	// https://github.com/riscvarchive/riscv-newlib/blob/7a526cdc28a3c4acce98e8a99b06562452c90d07/libgloss/riscv/machine/syscall.h#L43
-
-	auto a0 = hart.get_register(Rv_register_id::a0);
-	auto a1 = hart.get_register(Rv_register_id::a1);
-	auto a2 = hart.get_register(Rv_register_id::a2);
-	auto a3 = hart.get_register(Rv_register_id::a3);
-	auto a4 = hart.get_register(Rv_register_id::a4);
-	auto a5 = hart.get_register(Rv_register_id::a5);
-	auto a6 = hart.get_register(Rv_register_id::a6);
-	auto a7 = hart.get_register(Rv_register_id::a7);
-
-	uint32_t ret_val = a0; // TODO : Default to 0?
-
-	switch (a7)
+	switch (reason)
 	{
-	case SYS_brk:
-		s_heap_top += a0;
-		ret_val = s_heap_top;
-		break;
+	case Rv_stop_reason::budget_exhausted: return "instruction limit reached";
+	case Rv_stop_reason::trap: return "trap";
+	case Rv_stop_reason::breakpoint: return "breakpoint";
+	case Rv_stop_reason::halted: return "halted";
+	case Rv_stop_reason::watchpoint: return "watchpoint";
+	case Rv_stop_reason::atomic: return "atomic";
+	}
+
+	return "unknown";
+}
 
-	case SYS_write:
-		cout << "SYS_write:" << endl;
+/** Runs the jobs of a manifest on all host cores and reports each. Returns whether they all exited with 0. */
+bool run_batch_manifest(const string& manifest_path)
+{
+	auto manifest = ifstream(manifest_path);
+	if (!manifest) {
+		cout << "Error: Can't open manifest " << manifest_path << endl << endl;
+		return false;
+	}
 
-		/*
-		_write(int file, const void *ptr, size_t len)
-		*/
+	const auto jobs = parse_batch_manifest(manifest);
+	const auto results = run_batch(jobs, s_batch_instruction_limit);
 
-		uint32_t buf_addr = a1;
-		uint32_t count = a2;
+	// One line per job: exit code, retired instructions, wall time and the ELF file
+	size_t passed = 0;
+	cout << "exit\tretired\tms\tjob" << endl;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const auto& result = results[i];
+		if (result.exit_code)
+			cout << dec << *result.exit_code;
+		else
+			cout << "-";
 
-		for (int i = 0; i < count; ++i)
-		{
-			cout << s_memory.read_8(buf_addr + i);
-		}
+		const auto milliseconds = chrono::duration<double, milli>(result.wall_time).count();
+		cout << "\t" << dec << result.stop.retired << "\t" << fixed << setprecision(3) << milliseconds << "\t" << jobs[i].path;
 
-		cout << endl << endl;
+		if (!result.error.empty())
+			cout << " (error: " << result.error << ")";
+		else if (!result.exit_code)
+			cout << " (" << get_stop_reason_name(result.stop.reason) << (result.stop.reason == Rv_stop_reason::trap ? string(": ") + get_trap_cause_name(result.stop.trap) : "") << ")";
 
-		ret_val = count;
-		break;
-	}
+		cout << endl;
 
-	// Return value
-	hart.set_register(Rv_register_id::a0, ret_val);
+		if (result.exit_code == 0)
+			++passed;
+	}
 
-	// Increment PC
-	hart.set_register(Rv_register_id::pc, hart.get_register(Rv_register_id::pc) + 4);
+	cout << dec << passed << " of " << jobs.size() << " jobs exited with 0" << endl << endl;
+	return passed == jobs.size();
 }
 
-void execute(bool single_step)
+/**
+Fuzzes the program loaded in the simulation from start to stop, with inputs of up to max_input_size bytes written
+at input_address, and reports what it found. Returns whether no input crashed.
+*/
+bool fuzz(Simulation& simulation, uint32_t start, uint32_t stop, uint32_t input_address, uint32_t max_input_size, uint64_t runs)
 {
-	while (1) {
-		try {
-			s_hart.execute_next();
-		}
-		catch (const Rv_ebreak_exception& ex) {
-			cout << "EBREAK" << endl << endl;
-			print_registers();
-			return;
-		}
-		catch (const Rv_ecall_exception& ex) {
-			cout << "ECALL" << endl;
-			ecall_handler(s_hart);
-		}
+	// The program's output would drown the report
+	auto discarded = ostream(nullptr);
+	simulation.set_output(discarded);
 
-		uint32_t pc = s_hart.get_register(Rv_register_id::pc);
-		if (s_breakpoints.contains(pc))
+	auto crash_count = size_t(0);
+	try
+	{
+		auto fuzzer = Fuzzer(simulation, { start, stop, input_address, max_input_size, s_fuzz_instruction_limit });
+		const auto start_time = chrono::steady_clock::now();
+		fuzzer.fuzz(runs);
+		const auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+
+		const auto& stats = fuzzer.get_stats();
+		cout << dec << stats.executions << " runs in " << fixed << setprecision(3) << seconds << " s ("
+			<< setprecision(0) << stats.executions / seconds << " runs/s), " << stats.edges << " edges, "
+			<< fuzzer.get_corpus().size() << " inputs in the corpus, " << stats.crashes << " crashing runs, "
+			<< stats.hangs << " hangs" << endl;
+
+		// One line per crash with new coverage: the input in hex
+		for (const auto& crash : fuzzer.get_crashes())
 		{
-			print_registers();
-			print_next_instruction(s_hart);
-			cout << "BREAKPOINT: " << hex << pc << endl;
-			return;
-		}
+			cout << "Crash:";
+			for (const auto byte : crash)
+				cout << " " << hex << setfill('0') << setw(2) << static_cast<uint32_t>(byte);
 
-		if (single_step)
-		{
-			print_registers();
-			print_next_instruction(s_hart);
-			return;
+			cout << setfill(' ') << endl;
 		}
+
+		cout << endl;
+		crash_count = fuzzer.get_crashes().size();
+	}
+	catch (const runtime_error& e)
+	{
+		cout << "Error: " << e.what() << endl << endl;
+		simulation.set_output(cout);
+		return false;
 	}
+
+	simulation.set_output(cout);
+	return crash_count == 0;
 }
 
 bool prompt()
@@ -338,14 +321,73 @@ bool prompt()
 	else if (command == "run") {
 		execute(false);
 	}
+	else if (command == "snapshot") {
+		// Typically taken once the program has booted, at a breakpoint
+		s_simulation.take_snapshot();
+		cout << "Snapshot taken" << endl << endl;
+	}
+	else if (command == "restore" || command == "rerun") {
+		if (!s_simulation.restore_snapshot()) {
+			cout << "Error: No snapshot has been taken since the program was loaded." << endl << endl;
+		}
+		else if (command == "rerun") {
+			execute(false);
+		}
+		else {
+			print_next_instruction(s_simulation.get_system().get_hart(0));
+		}
+	}
 	else if (command == "break") {
 		uint32_t addr;
 		cin >> hex >> addr;
 
-		if (s_breakpoints.contains(addr))
-			s_breakpoints.erase(addr);
+		// Breakpoints stop every hart
+		auto& system = s_simulation.get_system();
+		const bool remove = system.get_hart(0).has_breakpoint(addr);
+		for (uint32_t i = 0; i < system.get_hart_count(); ++i)
+		{
+			if (remove)
+				system.get_hart(i).remove_breakpoint(addr);
+			else
+				system.get_hart(i).add_breakpoint(addr);
+		}
+	}
+	else if (command == "harts") {
+		uint32_t count;
+		cin >> dec >> count;
+
+		// Takes effect at the next load
+		if (count == 0)
+			cout << "Error: At least one hart is needed." << endl << endl;
+		else
+			s_simulation.set_hart_count(count);
+	}
+	else if (command == "watch") {
+		uint32_t addr;
+		uint32_t size;
+		cin >> hex >> addr >> dec >> size;
+
+		auto& memory = s_simulation.get_memory();
+		if (memory.has_watchpoint(addr))
+			memory.remove_watchpoint(addr);
 		else
-			s_breakpoints.insert(addr);
+			memory.add_watchpoint(addr, size, Watch_type::read_write);
+	}
+	else if (command == "batch") {
+		string manifest_path;
+		cin >> manifest_path;
+		run_batch_manifest(manifest_path);
+	}
+	else if (command == "fuzz") {
+		uint32_t start;
+		uint32_t stop;
+		uint32_t input_address;
+		uint32_t max_input_size;
+		uint64_t runs;
+		cin >> hex >> start >> stop >> input_address >> dec >> max_input_size >> runs;
+
+		// The snapshot the fuzzer leaves behind restores the program at the start address
+		fuzz(s_simulation, start, stop, input_address, max_input_size, runs);
 	}
 	else {
 		cout << "Unknown command: " << command << endl << endl;
@@ -354,8 +396,30 @@ bool prompt()
 	return true;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+	// "riscv-sim batch <manifest>" runs the jobs without prompting and fails unless they all exit with 0
+	if (argc == 3 && string(argv[1]) == "batch")
+		return run_batch_manifest(argv[2]) ? 0 : 1;
+
+	// "riscv-sim fuzz <elf> <start> <stop> <input address> <max input size> <runs>" fails if an input crashes.
+	// Addresses are hex.
+	if (argc == 8 && string(argv[1]) == "fuzz")
+	{
+		auto simulation = Simulation(1, Rv32_engine::jit);
+		try
+		{
+			simulation.load_elf(argv[2]);
+			const auto address = [&](int index) { return static_cast<uint32_t>(stoul(argv[index], nullptr, 16)); };
+			return fuzz(simulation, address(3), address(4), address(5), static_cast<uint32_t>(stoul(argv[6])), stoull(argv[7])) ? 0 : 1;
+		}
+		catch (const exception& e)
+		{
+			cout << "Error: " << e.what() << endl;
+			return 1;
+		}
+	}
+
 	cout << "RISC-V Simulator" << endl << endl;
 
 	while (prompt())
@@ -0,0 +1,206 @@
+#include "mapped-memory.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+// Multi-byte accesses copy guest bytes straight into host integers.
+static_assert(endian::native == endian::little, "Mapped_memory requires a little endian host.");
+static_assert(sizeof(void*) >= 8, "Mapped_memory requires a 64-bit host.");
+
+namespace riscv_sim {
+
+/**
+Extra space reserved past the end of the guest address space. Multi-byte accesses that start in the last
+few bytes of the address space land here instead of wrapping around to address 0, which keeps the
+access path free of bounds checks.
+*/
+static constexpr uint64_t c_tail_size = 64 * 1024;
+
+static constexpr uint64_t c_reservation_size = Mapped_memory::address_space_size + c_tail_size;
+
+#ifdef _WIN32
+
+// Windows charges committed pages against the system commit limit whether they are touched or not, so the whole
+// address space can't be committed up front. It is only reserved, and the first access to each chunk of
+// c_commit_size bytes faults into a vectored exception handler that commits the chunk and retries the access.
+
+static constexpr uint64_t c_commit_size = 64 * 1024;
+
+static shared_mutex s_reservations_mutex;
+static vector<uint8_t*> s_reservations; // Bases of the live Mapped_memory reservations
+
+/** Commits the chunk of a live reservation that an access violation hit, so the faulting access can be retried. */
+static LONG CALLBACK commit_on_access(EXCEPTION_POINTERS* exception)
+{
+	const auto record = exception->ExceptionRecord;
+	if (record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || record->NumberParameters < 2)
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	const auto address = reinterpret_cast<uint8_t*>(record->ExceptionInformation[1]);
+	const auto lock = shared_lock(s_reservations_mutex);
+	for (const auto base : s_reservations)
+	{
+		if (address < base || address >= base + c_reservation_size)
+			continue;
+
+		const auto chunk = base + (uint64_t(address - base) & ~(c_commit_size - 1));
+		if (!VirtualAlloc(chunk, c_commit_size, MEM_COMMIT, PAGE_READWRITE))
+			return EXCEPTION_CONTINUE_SEARCH;
+
+		return EXCEPTION_CONTINUE_EXECUTION;
+	}
+
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void add_reservation(uint8_t* base)
+{
+	const auto lock = unique_lock(s_reservations_mutex);
+	static const auto handler = AddVectoredExceptionHandler(1, commit_on_access);
+	if (!handler)
+		throw runtime_error("Unable to install the guest memory exception handler.");
+
+	s_reservations.push_back(base);
+}
+
+static void remove_reservation(uint8_t* base)
+{
+	const auto lock = unique_lock(s_reservations_mutex);
+	erase(s_reservations, base);
+}
+
+#endif
+
+Mapped_memory::Mapped_memory()
+{
+#ifdef _WIN32
+	void* reservation = VirtualAlloc(nullptr, c_reservation_size, MEM_RESERVE, PAGE_NOACCESS);
+	if (!reservation)
+		throw runtime_error("Unable to reserve guest address space.");
+
+	try
+	{
+		add_reservation(static_cast<uint8_t*>(reservation));
+	}
+	catch (...)
+	{
+		VirtualFree(reservation, 0, MEM_RELEASE);
+		throw;
+	}
+#else
+	void* reservation = mmap(nullptr, c_reservation_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (reservation == MAP_FAILED)
+		throw runtime_error("Unable to reserve guest address space.");
+#endif
+
+	base = static_cast<uint8_t*>(reservation);
+}
+
+Mapped_memory::~Mapped_memory()
+{
+#ifdef _WIN32
+	remove_reservation(base);
+	VirtualFree(base, 0, MEM_RELEASE);
+#else
+	munmap(base, c_reservation_size);
+#endif
+}
+
+/** Gets how much of a range of the size fits before the end of the address space. The rest wraps around to 0. */
+static size_t get_size_to_end(uint32_t address, size_t size)
+{
+	return min<size_t>(size, Mapped_memory::address_space_size - address);
+}
+
+void Mapped_memory::write_block(uint32_t address, span<const uint8_t> data)
+{
+	notify_written(address, static_cast<uint32_t>(data.size()));
+
+	const auto size_to_end = get_size_to_end(address, data.size());
+	memcpy(base + address, data.data(), size_to_end);
+	memcpy(base, data.data() + size_to_end, data.size() - size_to_end);
+}
+
+void Mapped_memory::read_block(uint32_t address, span<uint8_t> data) const
+{
+	notify_read(address, static_cast<uint32_t>(data.size()));
+
+	const auto size_to_end = get_size_to_end(address, data.size());
+	memcpy(data.data(), base + address, size_to_end);
+	memcpy(data.data() + size_to_end, base, data.size() - size_to_end);
+}
+
+void Mapped_memory::fill(uint32_t address, uint8_t value, uint32_t size)
+{
+	notify_written(address, size);
+
+	const auto size_to_end = get_size_to_end(address, size);
+	memset(base + address, value, size_to_end);
+	memset(base, value, size - size_to_end);
+}
+
+span<uint8_t> Mapped_memory::get_span(uint32_t address, uint32_t size)
+{
+	// Ranges that run past the end of the address space would wrap around in the guest
+	if (uint64_t(address) + size > address_space_size)
+		return {};
+
+	notify_written(address, size);
+	return { base + address, size };
+}
+
+span<const uint8_t> Mapped_memory::get_read_span(uint32_t address, uint32_t size) const
+{
+	if (uint64_t(address) + size > address_space_size)
+		return {};
+
+	notify_read(address, size);
+
+#ifdef _WIN32
+	// The view is for host system calls, which fail on uncommitted pages instead of raising an exception
+	if (size != 0 && !VirtualAlloc(base + address, size, MEM_COMMIT, PAGE_READWRITE))
+		return {};
+#endif
+
+	return { base + address, size };
+}
+
+uint8_t* Mapped_memory::get_atomic_pointer(uint32_t address, uint32_t size)
+{
+	if (uint64_t(address) + size > address_space_size)
+		return nullptr;
+
+	return base + address;
+}
+
+void Mapped_memory::reset()
+{
+	notify_reset();
+
+#ifdef _WIN32
+	// Decommitting discards the contents. Chunks are committed zero-filled again when they are next touched.
+	if (!VirtualFree(base, c_reservation_size, MEM_DECOMMIT))
+		throw runtime_error("Unable to release guest memory.");
+#else
+	// Private anonymous pages read back as zero after being discarded
+	madvise(base, c_reservation_size, MADV_DONTNEED);
+#endif
+}
+
+}
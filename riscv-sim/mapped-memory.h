@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "memory.h"
+
+namespace riscv_sim {
+
+/**
+Guest memory backed by a single reservation of host virtual memory covering the entire 4 GiB RV32 address space.
+
+A guest address is translated to a host pointer with a single add. Host pages are committed on first touch, by the
+operating system or on Windows by an exception handler, so only memory the guest actually uses consumes physical
+memory or commit charge.
+Requires a 64-bit host.
+*/
+class Mapped_memory final : public Memory
+{
+public:
+	/** Size of the guest address space. */
+	static constexpr uint64_t address_space_size = uint64_t(1) << 32;
+
+	Mapped_memory();
+	~Mapped_memory();
+
+	Mapped_memory(const Mapped_memory&) = delete;
+	Mapped_memory& operator=(const Mapped_memory&) = delete;
+
+	void write_8(uint32_t address, uint8_t value) override;
+	void write_16(uint32_t address, uint16_t value) override;
+	void write_32(uint32_t address, uint32_t value) override;
+	void write_64(uint32_t address, uint64_t value) override;
+	uint8_t read_8(uint32_t address) const override;
+	uint16_t read_16(uint32_t address) const override;
+	uint32_t read_32(uint32_t address) const override;
+	uint64_t read_64(uint32_t address) const override;
+
+	void write_block(uint32_t address, std::span<const uint8_t> data) override;
+	void read_block(uint32_t address, std::span<uint8_t> data) const override;
+	void fill(uint32_t address, uint8_t value, uint32_t size) override;
+	std::span<uint8_t> get_span(uint32_t address, uint32_t size) override;
+	std::span<const uint8_t> get_read_span(uint32_t address, uint32_t size) const override;
+	uint8_t* get_atomic_pointer(uint32_t address, uint32_t size) override;
+
+	/** Gets the host pointer that backs a guest address. The mapping is contiguous from the address to the end of the address space. */
+	uint8_t* get_host_pointer(uint32_t address) const;
+
+	/** Releases all committed host pages back to the operating system. All memory reads as 0 afterwards. */
+	void reset();
+
+private:
+	uint8_t* base;
+};
+
+// Accessors are defined inline so harts bound to Mapped_memory can inline them into the instruction executors.
+
+inline void Mapped_memory::write_8(uint32_t address, uint8_t value)
+{
+	notify_written(address, sizeof(value));
+
+	base[address] = value;
+}
+
+inline void Mapped_memory::write_16(uint32_t address, uint16_t value)
+{
+	notify_written(address, sizeof(value));
+
+	std::memcpy(base + address, &value, sizeof(value));
+}
+
+inline void Mapped_memory::write_32(uint32_t address, uint32_t value)
+{
+	notify_written(address, sizeof(value));
+
+	std::memcpy(base + address, &value, sizeof(value));
+}
+
+inline void Mapped_memory::write_64(uint32_t address, uint64_t value)
+{
+	notify_written(address, sizeof(value));
+
+	std::memcpy(base + address, &value, sizeof(value));
+}
+
+inline uint8_t Mapped_memory::read_8(uint32_t address) const
+{
+	notify_read(address, sizeof(uint8_t));
+
+	return base[address];
+}
+
+inline uint16_t Mapped_memory::read_16(uint32_t address) const
+{
+	notify_read(address, sizeof(uint16_t));
+
+	uint16_t value;
+	std::memcpy(&value, base + address, sizeof(value));
+	return value;
+}
+
+inline uint32_t Mapped_memory::read_32(uint32_t address) const
+{
+	notify_read(address, sizeof(uint32_t));
+
+	uint32_t value;
+	std::memcpy(&value, base + address, sizeof(value));
+	return value;
+}
+
+inline uint64_t Mapped_memory::read_64(uint32_t address) const
+{
+	notify_read(address, sizeof(uint64_t));
+
+	uint64_t value;
+	std::memcpy(&value, base + address, sizeof(value));
+	return value;
+}
+
+inline uint8_t* Mapped_memory::get_host_pointer(uint32_t address) const
+{
+	return base + address;
+}
+
+}
@@ -0,0 +1,374 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+using namespace std;
+
+namespace riscv_sim {
+
+/** Set while the memory copies pages for a snapshot on this thread. The copies don't hit watchpoints. */
+static thread_local bool t_copying_snapshot = false;
+
+/** Sets t_copying_snapshot for its lifetime. */
+struct Snapshot_copy_scope
+{
+	Snapshot_copy_scope() { t_copying_snapshot = true; }
+	~Snapshot_copy_scope() { t_copying_snapshot = false; }
+};
+
+template <unsigned Page_number_bits>
+Page_bitmap<Page_number_bits>::Page_bitmap()
+{
+	if constexpr (flat)
+		words = make_unique<uint64_t[]>((uint64_t(1) << Page_number_bits) / 64);
+}
+
+template <unsigned Page_number_bits>
+void Page_bitmap<Page_number_bits>::set(uint64_t page)
+{
+	uint64_t* word;
+	if constexpr (flat)
+		word = &words[page / 64];
+	else
+		word = &words.get_or_create(page >> leaf_bits)[(page / 64) % Leaf().size()];
+
+	atomic_ref(*word).fetch_or(uint64_t(1) << (page % 64), memory_order_relaxed);
+}
+
+template <unsigned Page_number_bits>
+bool Page_bitmap<Page_number_bits>::reset(uint64_t page)
+{
+	const auto word = find_word(page);
+	const auto bit = uint64_t(1) << (page % 64);
+	if (!word || !(atomic_ref(*word).load(memory_order_relaxed) & bit))
+		return false;
+
+	// Only one of several threads that reset the bit at once sees it set
+	return (atomic_ref(*word).fetch_and(~bit, memory_order_relaxed) & bit) != 0;
+}
+
+template <unsigned Page_number_bits>
+void Page_bitmap<Page_number_bits>::clear()
+{
+	if constexpr (flat)
+		fill_n(words.get(), (uint64_t(1) << Page_number_bits) / 64, 0);
+	else
+		words.clear();
+}
+
+template <unsigned Page_number_bits>
+const uint64_t* Page_bitmap<Page_number_bits>::get_words() const
+{
+	if constexpr (flat)
+		return words.get();
+	else
+		return nullptr;
+}
+
+template <typename Address>
+void Basic_memory<Address>::write_block(Address address, span<const uint8_t> data)
+{
+	for (size_t i = 0; i < data.size(); ++i)
+		write_8(address + static_cast<Address>(i), data[i]);
+}
+
+template <typename Address>
+void Basic_memory<Address>::read_block(Address address, span<uint8_t> data) const
+{
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = read_8(address + static_cast<Address>(i));
+}
+
+template <typename Address>
+void Basic_memory<Address>::fill(Address address, uint8_t value, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; ++i)
+		write_8(address + i, value);
+}
+
+template <typename Address>
+span<uint8_t> Basic_memory<Address>::get_span(Address, uint32_t)
+{
+	// No contiguous host storage by default
+	return {};
+}
+
+template <typename Address>
+span<const uint8_t> Basic_memory<Address>::get_read_span(Address, uint32_t) const
+{
+	return {};
+}
+
+template <typename Address>
+uint8_t* Basic_memory<Address>::get_atomic_pointer(Address, uint32_t)
+{
+	return nullptr;
+}
+
+template <typename Address>
+void Basic_memory<Address>::notify_atomic_load(Address address, uint32_t size) const
+{
+	notify_read(address, size);
+}
+
+template <typename Address>
+void Basic_memory<Address>::notify_atomic_store(Address address, uint32_t size)
+{
+	notify_written(address, size);
+}
+
+template <typename Address>
+void Basic_memory<Address>::attach_code_cache(Code_cache& cache)
+{
+	code_caches.push_back(&cache);
+}
+
+template <typename Address>
+void Basic_memory<Address>::detach_code_cache(Code_cache& cache)
+{
+	erase(code_caches, &cache);
+}
+
+template <typename Address>
+void Basic_memory<Address>::mark_code_page(Address address)
+{
+	code_pages.set(address >> code_page_bits);
+}
+
+template <typename Address>
+void Basic_memory<Address>::attach_watchpoint_listener(Watchpoint_listener& listener)
+{
+	watchpoint_listeners.push_back(&listener);
+}
+
+template <typename Address>
+void Basic_memory<Address>::detach_watchpoint_listener(Watchpoint_listener& listener)
+{
+	erase(watchpoint_listeners, &listener);
+}
+
+template <typename Address>
+void Basic_memory<Address>::add_watchpoint(Address address, uint32_t size, Watch_type type)
+{
+	if (size == 0)
+		return;
+
+	erase_if(watchpoints, [address](const Watchpoint& watchpoint) { return watchpoint.address == address; });
+	watchpoints.push_back({ address, size, type });
+	update_watched_pages();
+}
+
+template <typename Address>
+void Basic_memory<Address>::remove_watchpoint(Address address)
+{
+	if (erase_if(watchpoints, [address](const Watchpoint& watchpoint) { return watchpoint.address == address; }) != 0)
+		update_watched_pages();
+}
+
+template <typename Address>
+bool Basic_memory<Address>::has_watchpoint(Address address) const
+{
+	return ranges::any_of(watchpoints, [address](const Watchpoint& watchpoint) { return watchpoint.address == address; });
+}
+
+template <typename Address>
+bool Basic_memory<Address>::has_watchpoints() const
+{
+	return !watchpoints.empty();
+}
+
+template <typename Address>
+const uint64_t* Basic_memory<Address>::get_watched_page_words() const
+{
+	return watched_pages ? watched_pages->get_words() : nullptr;
+}
+
+template <typename Address>
+void Basic_memory<Address>::update_watched_pages()
+{
+	if (watchpoints.empty())
+	{
+		watched_pages.reset();
+	}
+	else
+	{
+		watched_pages = make_unique<Page_bitmap<page_number_bits>>();
+
+		for (const auto& watchpoint : watchpoints)
+		{
+			const Address first_page = watchpoint.address >> code_page_bits;
+			const Address last_page = Address(watchpoint.address + watchpoint.size - 1) >> code_page_bits;
+
+			for (Address page = first_page; ; page = (page + 1) & page_number_mask)
+			{
+				watched_pages->set(page);
+
+				if (page == last_page)
+					break;
+			}
+		}
+	}
+
+	for (auto cache : code_caches)
+		cache->invalidate_all_code();
+}
+
+template <typename Address>
+void Basic_memory<Address>::take_snapshot()
+{
+	if (!snapshot)
+	{
+		snapshot = make_unique<Snapshot>();
+		return;
+	}
+
+	// Only the pages saved for the old snapshot have anything to clear
+	for (const auto page : snapshot->dirty_page_list)
+		snapshot->dirty_pages.reset(page);
+
+	snapshot->dirty_page_list.clear();
+	snapshot->saved_pages.clear();
+}
+
+template <typename Address>
+size_t Basic_memory<Address>::restore_snapshot()
+{
+	if (!snapshot)
+		return 0;
+
+	// The pages are still marked dirty while they are written back, so writing them doesn't save them again.
+	// Their cached code is invalidated like that of any other write.
+	const auto copy_scope = Snapshot_copy_scope();
+	for (const auto page : snapshot->dirty_page_list)
+	{
+		write_block(page << code_page_bits, *snapshot->saved_pages.find(page));
+		snapshot->dirty_pages.reset(page);
+	}
+
+	const auto count = snapshot->dirty_page_list.size();
+	snapshot->dirty_page_list.clear();
+	return count;
+}
+
+template <typename Address>
+void Basic_memory<Address>::discard_snapshot()
+{
+	snapshot.reset();
+}
+
+template <typename Address>
+bool Basic_memory<Address>::has_snapshot() const
+{
+	return snapshot != nullptr;
+}
+
+template <typename Address>
+void Basic_memory<Address>::save_snapshot_pages(Address address, uint32_t size)
+{
+	if (size == 0)
+		return;
+
+	const Address first_page = address >> code_page_bits;
+	const Address last_page = Address(address + size - 1) >> code_page_bits;
+
+	const auto lock = lock_guard(snapshot->mutex);
+	for (Address page = first_page; ; page = (page + 1) & page_number_mask)
+	{
+		// The page is marked dirty only once it is saved, since other threads write it without taking the lock then
+		if (!snapshot->dirty_pages.test(page))
+		{
+			if (!snapshot->saved_pages.find(page))
+			{
+				const auto copy_scope = Snapshot_copy_scope();
+				read_block(page << code_page_bits, snapshot->saved_pages.get_or_create(page));
+			}
+
+			snapshot->dirty_page_list.push_back(page);
+			snapshot->dirty_pages.set(page);
+		}
+
+		if (page == last_page)
+			break;
+	}
+}
+
+template <typename Address>
+void Basic_memory<Address>::check_watchpoints(Address address, uint32_t size, Watch_type type) const
+{
+	if (size == 0 || t_copying_snapshot)
+		return;
+
+	const Address first_page = address >> code_page_bits;
+	const Address last_page = Address(address + size - 1) >> code_page_bits;
+
+	bool watched = false;
+	for (Address page = first_page; !watched; page = (page + 1) & page_number_mask)
+	{
+		watched = watched_pages->test(page);
+
+		if (page == last_page)
+			break;
+	}
+
+	if (!watched)
+		return;
+
+	for (const auto& watchpoint : watchpoints)
+	{
+		if ((to_underlying(watchpoint.type) & to_underlying(type)) == 0)
+			continue;
+
+		// Offsets from the start of the watchpoint, so ranges that wrap around the address space compare correctly
+		const Address start = address - watchpoint.address;
+		if (start < watchpoint.size || start > Address(0) - size)
+		{
+			const auto hit = Watchpoint_hit{ address, size, type };
+			for (auto listener : watchpoint_listeners)
+				listener->on_watchpoint_hit(hit);
+
+			return;
+		}
+	}
+}
+
+template <typename Address>
+void Basic_memory<Address>::notify_reset()
+{
+	code_pages.clear();
+	snapshot.reset();
+
+	for (auto cache : code_caches)
+		cache->invalidate_all_code();
+}
+
+template <typename Address>
+void Basic_memory<Address>::invalidate_written_code(Address address, uint32_t size)
+{
+	if (size == 0)
+		return;
+
+	const Address first_page = address >> code_page_bits;
+	const Address last_page = Address(address + size - 1) >> code_page_bits;
+
+	// Walk the pages in the range, wrapping around the end of the address space
+	for (Address page = first_page; ; page = (page + 1) & page_number_mask)
+	{
+		if (code_pages.reset(page))
+		{
+			for (auto cache : code_caches)
+				cache->invalidate_code_page(page);
+		}
+
+		if (page == last_page)
+			break;
+	}
+}
+
+template class Page_bitmap<20>;
+template class Page_bitmap<52>;
+template class Basic_memory<uint32_t>;
+template class Basic_memory<uint64_t>;
+
+}
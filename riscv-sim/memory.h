@@ -1,17 +1,337 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "radix-table.h"
+#include "reservation-table.h"
 
 namespace riscv_sim {
 
-class Memory {
+/** A cache of code decoded from guest memory. Memory notifies attached caches when the code they hold is overwritten. */
+class Code_cache
+{
+public:
+	virtual ~Code_cache() = default;
+
+	/** Discards anything cached from the code page (address >> Memory::code_page_bits). */
+	virtual void invalidate_code_page(uint64_t page) = 0;
+
+	/** Discards everything in the cache. */
+	virtual void invalidate_all_code() = 0;
+};
+
+/** Kinds of guest access a watchpoint stops on. */
+enum class Watch_type : uint8_t
+{
+	read = 1,
+	write = 2,
+	read_write = read | write,
+};
+
+/** A guest access to a watched range. type is read or write. */
+struct Watchpoint_hit
+{
+	uint64_t address = 0;
+	uint32_t size = 0;
+	Watch_type type = Watch_type::read;
+};
+
+/** Receives accesses to watched guest memory. Memory notifies attached listeners before the access is made. */
+class Watchpoint_listener
+{
+public:
+	virtual ~Watchpoint_listener() = default;
+
+	virtual void on_watchpoint_hit(const Watchpoint_hit& hit) = 0;
+};
+
+/**
+One bit per page of a Page_number_bits-bit page number space.
+
+Small spaces are a flat array. Larger ones, such as the pages of a 64-bit address space, keep their bits in
+leaves of 4096 pages that are allocated in a radix table the first time one of their bits is set.
+
+Bits are tested, set and reset atomically, so harts on different threads can share a bitmap. clear must not run
+concurrently with anything else.
+*/
+template <unsigned Page_number_bits>
+class Page_bitmap
+{
 public:
-	virtual void write_8(uint32_t address, uint8_t value) = 0;
-	virtual void write_16(uint32_t address, uint16_t value) = 0;
-	virtual void write_32(uint32_t address, uint32_t value) = 0;
-	virtual uint8_t read_8(uint32_t address) const = 0;
-	virtual uint16_t read_16(uint32_t address) const = 0;
-	virtual uint32_t read_32(uint32_t address) const = 0;
+	Page_bitmap();
+
+	bool test(uint64_t page) const;
+	void set(uint64_t page);
+
+	/** Clears the bit of the page. Returns whether it was set. */
+	bool reset(uint64_t page);
+
+	/** Clears all bits. */
+	void clear();
+
+	/** Gets the words of a flat bitmap, with the bit of page p in bit p % 64 of word p / 64, or null if it isn't flat. */
+	const uint64_t* get_words() const;
+
+private:
+	static constexpr bool flat = Page_number_bits <= 24;
+	static constexpr unsigned leaf_bits = 12;
+
+	using Leaf = std::array<uint64_t, (1 << leaf_bits) / 64>;
+	using Words = std::conditional_t<flat, std::unique_ptr<uint64_t[]>, Radix_table<Leaf, (flat ? 1 : Page_number_bits - leaf_bits)>>;
+
+	/** Gets the word that holds the bit of the page, or null if it has not been allocated. */
+	uint64_t* find_word(uint64_t page) const;
+
+	Words words;
+};
+
+/**
+Guest memory with Address-sized guest addresses. Accesses are at most 64 bits wide. Wider accesses are split.
+Memory is the 32-bit address space of RV32 harts and Memory_64 the 64-bit one of RV64 harts.
+
+Harts on different host threads can share a memory (see Smp_system). Guest loads and stores are then plain host
+accesses: aligned accesses are single-copy atomic on the hosts supported (x86-64 and AArch64) and unordered
+between harts except by FENCE. AMOs are host atomic operations on the backing storage, and LR/SC reservations
+are kept in the memory's reservation table. Code tracking is safe to use from several threads. Attaching caches
+and listeners, watchpoints and reset must only be used while no hart runs.
+*/
+template <typename Address>
+class Basic_memory {
+public:
+	static_assert(std::is_same_v<Address, uint32_t> || std::is_same_v<Address, uint64_t>);
+
+	/** Granularity used to track pages that hold cached code. */
+	static constexpr uint32_t code_page_bits = 12;
+
+	virtual ~Basic_memory() = default;
+
+	virtual void write_8(Address address, uint8_t value) = 0;
+	virtual void write_16(Address address, uint16_t value) = 0;
+	virtual void write_32(Address address, uint32_t value) = 0;
+	virtual void write_64(Address address, uint64_t value) = 0;
+	virtual uint8_t read_8(Address address) const = 0;
+	virtual uint16_t read_16(Address address) const = 0;
+	virtual uint32_t read_32(Address address) const = 0;
+	virtual uint64_t read_64(Address address) const = 0;
+
+	// Bulk transfers. The default implementations fall back to byte accesses. Backends override them
+	// with block copies where their storage allows it.
+
+	/** Copies a block of bytes into memory starting at the address. */
+	virtual void write_block(Address address, std::span<const uint8_t> data);
+
+	/** Copies a block of bytes out of memory starting at the address. */
+	virtual void read_block(Address address, std::span<uint8_t> data) const;
+
+	/** Sets size bytes of memory starting at the address to a value. */
+	virtual void fill(Address address, uint8_t value, uint32_t size);
+
+	/**
+	Gets a view of the host memory that backs a guest address range, without copying. Writes through the
+	view modify guest memory. Cached code in the range is invalidated when the view is handed out, so the
+	view must not be held across instruction execution if it is used to modify code.
+	Returns an empty span if the range is not backed by contiguous host memory.
+	*/
+	virtual std::span<uint8_t> get_span(Address address, uint32_t size);
+
+	/**
+	Gets a read-only view of the host memory that backs a guest address range, without copying. The range counts
+	as read, so neither code nor snapshots treat it as written. Returns an empty span if the range is not backed by
+	contiguous host memory.
+	*/
+	virtual std::span<const uint8_t> get_read_span(Address address, uint32_t size) const;
+
+	/**
+	Gets the host memory that backs a guest range, for atomic accesses, or null if the range is not backed by
+	contiguous host memory. Nothing is notified: callers notify the access with notify_atomic_load or, before they
+	store through the pointer, with notify_atomic_store.
+	*/
+	virtual uint8_t* get_atomic_pointer(Address address, uint32_t size);
+
+	/** Notifies an atomic access through get_atomic_pointer that only reads. */
+	void notify_atomic_load(Address address, uint32_t size) const;
+
+	/** Notifies an atomic store through get_atomic_pointer that is about to be made, like any other write. */
+	virtual void notify_atomic_store(Address address, uint32_t size);
+
+	// Cached code tracking. Caches mark the pages they decode code from. Writes to a marked page unmark it
+	// and invalidate the page in every attached cache. Writes to unmarked pages only cost a bit test.
+
+	void attach_code_cache(Code_cache& cache);
+	void detach_code_cache(Code_cache& cache);
+
+	/** Marks the page containing the address as holding cached code. */
+	void mark_code_page(Address address);
+
+	// Watchpoints. Pages that overlap a watchpoint are marked as watched and only accesses to them are compared
+	// with the watchpoints. Without watchpoints, accesses only test a null pointer. Adding or removing watchpoints
+	// invalidates all cached code, so caches can compile differently while watchpoints are set.
+
+	void attach_watchpoint_listener(Watchpoint_listener& listener);
+	void detach_watchpoint_listener(Watchpoint_listener& listener);
+
+	/** Watches size bytes starting at the address. Replaces any watchpoint that starts at the same address. */
+	void add_watchpoint(Address address, uint32_t size, Watch_type type);
+
+	/** Removes the watchpoint that starts at the address. */
+	void remove_watchpoint(Address address);
+
+	bool has_watchpoint(Address address) const;
+	bool has_watchpoints() const;
+
+	/**
+	Gets the words of the watched page bitmap (see Page_bitmap::get_words), or null if there are no watchpoints or
+	the address space is too large for a flat bitmap. Valid until watchpoints are next added or removed.
+	*/
+	const uint64_t* get_watched_page_words() const;
+
+	/** Gets the LR/SC reservations of the harts that share the memory. */
+	Reservation_table& get_reservations();
+
+	// Snapshots. Taking a snapshot copies nothing: each page is saved the first time it is written afterwards, and
+	// restoring copies back only the pages written since the snapshot was taken or last restored. Without a
+	// snapshot, writes only test a null pointer. Snapshots must only be taken and restored while no hart runs, and
+	// reset discards them.
+
+	/** Saves the contents of memory, replacing any earlier snapshot. */
+	void take_snapshot();
+
+	/** Restores the contents the memory had when the snapshot was taken. Returns the number of pages copied back. */
+	size_t restore_snapshot();
+
+	void discard_snapshot();
+	bool has_snapshot() const;
+
+protected:
+	/** Must be called by backends when guest memory in the range is written. */
+	void notify_written(Address address, uint32_t size);
+
+	/** Must be called by backends when guest memory in the range is read. */
+	void notify_read(Address address, uint32_t size) const;
+
+	/** Must be called by backends when all guest memory is reset. */
+	void notify_reset();
+
+private:
+	static constexpr unsigned page_number_bits = 8 * sizeof(Address) - code_page_bits;
+	static constexpr Address page_number_mask = Address(-1) >> code_page_bits;
+
+	struct Watchpoint
+	{
+		Address address;
+		uint32_t size;
+		Watch_type type;
+	};
+
+	bool is_code_page(Address address) const;
+	void invalidate_written_code(Address address, uint32_t size);
+
+	/** Notifies listeners if the access overlaps a watchpoint of the type. */
+	void check_watchpoints(Address address, uint32_t size, Watch_type type) const;
+
+	/** Marks the pages of all watchpoints as watched, or frees the bitmap if there are none. */
+	void update_watched_pages();
+
+	/** A snapshot page, the same size as a code page. */
+	using Snapshot_page = std::array<uint8_t, size_t(1) << code_page_bits>;
+
+	struct Snapshot
+	{
+		Radix_table<Snapshot_page, page_number_bits> saved_pages; // Contents when the snapshot was taken
+		Page_bitmap<page_number_bits> dirty_pages;                // Written since the snapshot was taken or restored
+		std::vector<Address> dirty_page_list;
+		std::mutex mutex; // Serializes saving pages written by harts on several threads
+	};
+
+	/** Saves the pages in the range that are about to be written for the first time since the snapshot. */
+	void save_snapshot_pages(Address address, uint32_t size);
+
+	Page_bitmap<page_number_bits> code_pages;
+	std::vector<Code_cache*> code_caches;
+
+	std::vector<Watchpoint> watchpoints;
+	std::unique_ptr<Page_bitmap<page_number_bits>> watched_pages; // Null if there are no watchpoints
+	std::vector<Watchpoint_listener*> watchpoint_listeners;
+
+	std::unique_ptr<Snapshot> snapshot; // Null if there is no snapshot
+
+	Reservation_table reservations;
 };
 
+using Memory = Basic_memory<uint32_t>;
+using Memory_64 = Basic_memory<uint64_t>;
+
+extern template class Page_bitmap<20>;
+extern template class Page_bitmap<52>;
+extern template class Basic_memory<uint32_t>;
+extern template class Basic_memory<uint64_t>;
+
+template <unsigned Page_number_bits>
+inline uint64_t* Page_bitmap<Page_number_bits>::find_word(uint64_t page) const
+{
+	if constexpr (flat)
+	{
+		return &words[page / 64];
+	}
+	else
+	{
+		const auto leaf = words.find(page >> leaf_bits);
+		return leaf ? &(*leaf)[(page / 64) % leaf->size()] : nullptr;
+	}
+}
+
+template <unsigned Page_number_bits>
+inline bool Page_bitmap<Page_number_bits>::test(uint64_t page) const
+{
+	const auto word = find_word(page);
+	return word && ((std::atomic_ref(*word).load(std::memory_order_relaxed) >> (page % 64)) & 1);
+}
+
+template <typename Address>
+inline void Basic_memory<Address>::notify_written(Address address, uint32_t size)
+{
+	if (watched_pages) [[unlikely]]
+		check_watchpoints(address, size, Watch_type::write);
+
+	// Pages already written since the snapshot was taken or restored are saved
+	if (snapshot) [[unlikely]]
+	{
+		const auto last = Address(address + size - 1);
+		if (size > 8 || !snapshot->dirty_pages.test(address >> code_page_bits) || !snapshot->dirty_pages.test(last >> code_page_bits))
+			save_snapshot_pages(address, size);
+	}
+
+	// Fast path for single accesses to pages with no cached code
+	if (size <= 8 && !is_code_page(address) && !is_code_page(address + size - 1))
+		return;
+
+	invalidate_written_code(address, size);
+}
+
+template <typename Address>
+inline void Basic_memory<Address>::notify_read(Address address, uint32_t size) const
+{
+	if (watched_pages) [[unlikely]]
+		check_watchpoints(address, size, Watch_type::read);
+}
+
+template <typename Address>
+inline Reservation_table& Basic_memory<Address>::get_reservations()
+{
+	return reservations;
+}
+
+template <typename Address>
+inline bool Basic_memory<Address>::is_code_page(Address address) const
+{
+	return code_pages.test(address >> code_page_bits);
+}
+
 }
@@ -0,0 +1,115 @@
+#include "paged-memory.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace std;
+
+// Multi-byte accesses copy guest bytes straight into host integers.
+static_assert(endian::native == endian::little, "Paged_memory requires a little endian host.");
+
+namespace riscv_sim {
+
+/** Backs read-only views of pages that have not been allocated, which read as 0. */
+static constexpr array<uint8_t, Paged_memory::page_size> c_zero_page{};
+
+size_t Paged_memory::get_allocated_page_count() const
+{
+	size_t count = 0;
+	pages.for_each([&count](uint64_t, const Page&) { ++count; });
+	return count;
+}
+
+/** Splits a guest range into chunks that each lie within a single page and calls chunk_func(address, offset, size) for each. */
+template <typename Chunk_func>
+static void for_each_page_chunk(uint32_t address, size_t size, Chunk_func chunk_func)
+{
+	size_t offset = 0;
+	while (offset < size)
+	{
+		const uint32_t chunk_address = address + static_cast<uint32_t>(offset);
+		const uint32_t space_in_page = Paged_memory::page_size - (chunk_address & (Paged_memory::page_size - 1));
+		const uint32_t chunk_size = static_cast<uint32_t>(min<size_t>(space_in_page, size - offset));
+
+		chunk_func(chunk_address, offset, chunk_size);
+		offset += chunk_size;
+	}
+}
+
+void Paged_memory::write_block(uint32_t address, span<const uint8_t> data)
+{
+	notify_written(address, static_cast<uint32_t>(data.size()));
+
+	for_each_page_chunk(address, data.size(), [&](uint32_t chunk_address, size_t offset, uint32_t chunk_size) {
+		memcpy(get_or_create_page(chunk_address) + (chunk_address & page_offset_mask), data.data() + offset, chunk_size);
+	});
+}
+
+void Paged_memory::read_block(uint32_t address, span<uint8_t> data) const
+{
+	notify_read(address, static_cast<uint32_t>(data.size()));
+
+	for_each_page_chunk(address, data.size(), [&](uint32_t chunk_address, size_t offset, uint32_t chunk_size) {
+		const auto page = find_page(chunk_address);
+		if (page)
+			memcpy(data.data() + offset, page + (chunk_address & page_offset_mask), chunk_size);
+		else
+			memset(data.data() + offset, 0, chunk_size);
+	});
+}
+
+void Paged_memory::fill(uint32_t address, uint8_t value, uint32_t size)
+{
+	notify_written(address, size);
+
+	for_each_page_chunk(address, size, [&](uint32_t chunk_address, size_t, uint32_t chunk_size) {
+		// Unallocated pages already read as 0
+		if (value == 0 && !find_page(chunk_address))
+			return;
+
+		memset(get_or_create_page(chunk_address) + (chunk_address & page_offset_mask), value, chunk_size);
+	});
+}
+
+span<uint8_t> Paged_memory::get_span(uint32_t address, uint32_t size)
+{
+	if (size == 0 || size > page_size || !fits_in_page(address, size))
+		return {};
+
+	notify_written(address, size);
+	return { get_or_create_page(address) + (address & page_offset_mask), size };
+}
+
+span<const uint8_t> Paged_memory::get_read_span(uint32_t address, uint32_t size) const
+{
+	if (size == 0 || size > page_size || !fits_in_page(address, size))
+		return {};
+
+	notify_read(address, size);
+
+	const auto page = find_page(address);
+	return { (page ? page : c_zero_page.data()) + (address & page_offset_mask), size };
+}
+
+uint8_t* Paged_memory::get_atomic_pointer(uint32_t address, uint32_t size)
+{
+	if (size == 0 || size > page_size || !fits_in_page(address, size))
+		return nullptr;
+
+	return get_or_create_page(address) + (address & page_offset_mask);
+}
+
+void Paged_memory::reset()
+{
+	notify_reset();
+
+	pages.clear();
+}
+
+uint8_t* Paged_memory::allocate_page(uint32_t address)
+{
+	return pages.get_or_create(address >> page_bits).data();
+}
+
+}
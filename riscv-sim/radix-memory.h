@@ -0,0 +1,258 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "memory.h"
+#include "radix-table.h"
+
+namespace riscv_sim {
+
+/**
+Guest memory for 64-bit address spaces, stored as 4 KiB pages in a four-level radix table indexed by page number.
+
+Pages are allocated lazily on the first write to them. Reads from pages that have never been written return 0.
+Accesses that fall within a single page are served by a single host load or store. The last page looked up is
+remembered, so runs of accesses to the same page skip the table walk. Pages can be allocated by harts on several
+threads at once.
+*/
+class Radix_memory final : public Memory_64
+{
+public:
+	static constexpr uint32_t page_bits = 12;
+	static constexpr uint32_t page_size = 1 << page_bits;
+
+	void write_8(uint64_t address, uint8_t value) override;
+	void write_16(uint64_t address, uint16_t value) override;
+	void write_32(uint64_t address, uint32_t value) override;
+	void write_64(uint64_t address, uint64_t value) override;
+	uint8_t read_8(uint64_t address) const override;
+	uint16_t read_16(uint64_t address) const override;
+	uint32_t read_32(uint64_t address) const override;
+	uint64_t read_64(uint64_t address) const override;
+
+	void write_block(uint64_t address, std::span<const uint8_t> data) override;
+	void read_block(uint64_t address, std::span<uint8_t> data) const override;
+	void fill(uint64_t address, uint8_t value, uint32_t size) override;
+
+	/** Gets a view of a range that lies within a single page, allocating the page if needed. Ranges that span pages return an empty span. */
+	std::span<uint8_t> get_span(uint64_t address, uint32_t size) override;
+
+	/** Gets a read-only view of a range that lies within a single page. Ranges that span pages return an empty span. */
+	std::span<const uint8_t> get_read_span(uint64_t address, uint32_t size) const override;
+
+	/** Gets the host memory of a range that lies within a single page, allocating the page if needed, or null if the range spans pages. */
+	uint8_t* get_atomic_pointer(uint64_t address, uint32_t size) override;
+
+	/** Gets the number of pages that are currently allocated. */
+	size_t get_allocated_page_count() const;
+
+	/** Frees all pages. All memory reads as 0 afterwards. */
+	void reset();
+
+private:
+	// Address layout:  63     51 | 50     38 | 37     25 | 24     12 | 11      0
+	//                  level 0      level 1     level 2     level 3     page offset
+	static constexpr uint64_t page_offset_mask = page_size - 1;
+
+	struct Page
+	{
+		std::array<uint8_t, page_size> data;
+
+		// Set once the page is in the table. Until then it matches no page number.
+		std::atomic<uint64_t> number = ~uint64_t(0);
+	};
+
+	/** Checks if an access of the given size starting at the address stays within a single page. */
+	static bool fits_in_page(uint64_t address, uint32_t size);
+
+	/** Stores a byte without notifying, for the byte accesses of a straddling access that has notified as a whole. */
+	void store_8(uint64_t address, uint8_t value);
+
+	/** Loads a byte without notifying, for the byte accesses of a straddling access that has notified as a whole. */
+	uint8_t load_8(uint64_t address) const;
+
+	/** Gets the page containing the address, or null if the page has not been allocated. */
+	uint8_t* find_page(uint64_t address) const;
+
+	/** Gets the page containing the address, allocating it if needed. */
+	uint8_t* get_or_create_page(uint64_t address);
+
+	/** Allocates the page containing the address and any node needed to hold it. */
+	uint8_t* allocate_page(uint64_t address);
+
+	Radix_table<Page, 64 - page_bits> pages;
+
+	// The last page found. Pages are only freed by reset, which forgets it. The page holds its number, so a
+	// single pointer is enough and threads that share the memory never see a torn entry.
+	mutable std::atomic<Page*> last_page = nullptr;
+};
+
+// Accessors are defined inline so harts bound to Radix_memory can inline them into the instruction executors.
+// Accesses that straddle two pages are notified once and split into byte accesses.
+
+inline void Radix_memory::write_8(uint64_t address, uint8_t value)
+{
+	notify_written(address, sizeof(value));
+	store_8(address, value);
+}
+
+inline void Radix_memory::write_16(uint64_t address, uint16_t value)
+{
+	notify_written(address, sizeof(value));
+
+	if (fits_in_page(address, sizeof(value)))
+	{
+		std::memcpy(get_or_create_page(address) + (address & page_offset_mask), &value, sizeof(value));
+		return;
+	}
+
+	store_8(address, 0xFF & value);
+	store_8(address + 1, 0xFF & (value >> 8));
+}
+
+inline void Radix_memory::write_32(uint64_t address, uint32_t value)
+{
+	notify_written(address, sizeof(value));
+
+	if (fits_in_page(address, sizeof(value)))
+	{
+		std::memcpy(get_or_create_page(address) + (address & page_offset_mask), &value, sizeof(value));
+		return;
+	}
+
+	store_8(address, 0xFF & value);
+	store_8(address + 1, 0xFF & (value >> 8));
+	store_8(address + 2, 0xFF & (value >> 16));
+	store_8(address + 3, 0xFF & (value >> 24));
+}
+
+inline void Radix_memory::write_64(uint64_t address, uint64_t value)
+{
+	notify_written(address, sizeof(value));
+
+	if (fits_in_page(address, sizeof(value)))
+	{
+		std::memcpy(get_or_create_page(address) + (address & page_offset_mask), &value, sizeof(value));
+		return;
+	}
+
+	for (uint32_t i = 0; i < sizeof(value); ++i)
+		store_8(address + i, 0xFF & (value >> (8 * i)));
+}
+
+inline uint8_t Radix_memory::read_8(uint64_t address) const
+{
+	notify_read(address, sizeof(uint8_t));
+	return load_8(address);
+}
+
+inline uint16_t Radix_memory::read_16(uint64_t address) const
+{
+	notify_read(address, sizeof(uint16_t));
+
+	if (fits_in_page(address, sizeof(uint16_t)))
+	{
+		const auto page = find_page(address);
+		if (!page)
+			return 0;
+
+		uint16_t value;
+		std::memcpy(&value, page + (address & page_offset_mask), sizeof(value));
+		return value;
+	}
+
+	return (load_8(address)
+		| (load_8(address + 1) << 8));
+}
+
+inline uint32_t Radix_memory::read_32(uint64_t address) const
+{
+	notify_read(address, sizeof(uint32_t));
+
+	if (fits_in_page(address, sizeof(uint32_t)))
+	{
+		const auto page = find_page(address);
+		if (!page)
+			return 0;
+
+		uint32_t value;
+		std::memcpy(&value, page + (address & page_offset_mask), sizeof(value));
+		return value;
+	}
+
+	return (load_8(address)
+		| (load_8(address + 1) << 8)
+		| (load_8(address + 2) << 16)
+		| (load_8(address + 3) << 24));
+}
+
+inline uint64_t Radix_memory::read_64(uint64_t address) const
+{
+	notify_read(address, sizeof(uint64_t));
+
+	if (fits_in_page(address, sizeof(uint64_t)))
+	{
+		const auto page = find_page(address);
+		if (!page)
+			return 0;
+
+		uint64_t value;
+		std::memcpy(&value, page + (address & page_offset_mask), sizeof(value));
+		return value;
+	}
+
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < sizeof(value); ++i)
+		value |= uint64_t(load_8(address + i)) << (8 * i);
+
+	return value;
+}
+
+inline bool Radix_memory::fits_in_page(uint64_t address, uint32_t size)
+{
+	return (address & page_offset_mask) <= page_size - size;
+}
+
+inline void Radix_memory::store_8(uint64_t address, uint8_t value)
+{
+	get_or_create_page(address)[address & page_offset_mask] = value;
+}
+
+inline uint8_t Radix_memory::load_8(uint64_t address) const
+{
+	const auto page = find_page(address);
+	if (!page)
+		return 0;
+
+	return page[address & page_offset_mask];
+}
+
+inline uint8_t* Radix_memory::find_page(uint64_t address) const
+{
+	const uint64_t page_number = address >> page_bits;
+	const auto last = last_page.load(std::memory_order_acquire);
+	if (last && last->number.load(std::memory_order_relaxed) == page_number)
+		return last->data.data();
+
+	const auto page = pages.find(page_number);
+	if (!page)
+		return nullptr;
+
+	last_page.store(page, std::memory_order_release);
+	return page->data.data();
+}
+
+inline uint8_t* Radix_memory::get_or_create_page(uint64_t address)
+{
+	const auto page = find_page(address);
+	if (page)
+		return page;
+
+	return allocate_page(address);
+}
+
+}
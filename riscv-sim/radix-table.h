@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace riscv_sim {
+
+/**
+A sparse map from Key_bits-bit keys to leaves, stored as a radix tree with a fixed number of levels.
+
+Each level indexes the next (Key_bits / Levels) bits of the key, from the most significant down. Nodes and leaves
+are allocated on first use, so memory grows with the number of distinct key ranges used rather than the key space.
+Lookups take one dependent load per level and no comparisons.
+
+find and get_or_create can be called from several threads at once. Threads that race to create the same node or
+leaf agree on the one that is published first, and the others free theirs. clear must not run concurrently with
+anything else.
+*/
+template <typename Leaf, unsigned Key_bits, unsigned Levels = 4>
+class Radix_table
+{
+public:
+	static_assert(Key_bits > 0 && Key_bits <= 64 && Levels > 0);
+
+	Radix_table() = default;
+	~Radix_table();
+
+	Radix_table(const Radix_table&) = delete;
+	Radix_table& operator=(const Radix_table&) = delete;
+
+	/** Gets the leaf for the key, or null if it has not been created. */
+	Leaf* find(uint64_t key) const;
+
+	/** Gets the leaf for the key, creating it and any node needed to hold it. New leaves are value initialized. */
+	Leaf& get_or_create(uint64_t key);
+
+	/** Frees all nodes and leaves. */
+	void clear();
+
+	/** Calls func(key, leaf) for each leaf that has been created, in key order. */
+	template <typename Func>
+	void for_each(Func func) const;
+
+private:
+	static constexpr unsigned level_bits = (Key_bits + Levels - 1) / Levels;
+	static constexpr size_t fanout = size_t(1) << level_bits;
+
+	template <unsigned Depth>
+	struct Node
+	{
+		using Child = std::conditional_t<Depth + 1 == Levels, Leaf, Node<Depth + 1>>;
+
+		~Node()
+		{
+			for (auto& child : children)
+				delete child.load(std::memory_order_relaxed);
+		}
+
+		std::array<std::atomic<Child*>, fanout> children{};
+	};
+
+	/** Gets the object in the slot, creating it if the slot is empty. */
+	template <typename T>
+	static T& get_or_create_in(std::atomic<T*>& slot);
+
+	template <unsigned Depth>
+	static size_t get_index(uint64_t key);
+
+	template <unsigned Depth>
+	static Leaf* find_in(const Node<Depth>& node, uint64_t key);
+
+	template <unsigned Depth>
+	static Leaf& create_in(Node<Depth>& node, uint64_t key);
+
+	template <unsigned Depth, typename Func>
+	static void for_each_in(const Node<Depth>& node, uint64_t key_prefix, Func& func);
+
+	std::atomic<Node<0>*> root = nullptr;
+};
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+Radix_table<Leaf, Key_bits, Levels>::~Radix_table()
+{
+	clear();
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+template <typename T>
+T& Radix_table<Leaf, Key_bits, Levels>::get_or_create_in(std::atomic<T*>& slot)
+{
+	T* existing = slot.load(std::memory_order_acquire);
+	if (existing)
+		return *existing;
+
+	// Publish the new object with release so threads that find it see it initialized
+	auto created = new T();
+	if (slot.compare_exchange_strong(existing, created, std::memory_order_acq_rel, std::memory_order_acquire))
+		return *created;
+
+	delete created;
+	return *existing;
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+template <unsigned Depth>
+inline size_t Radix_table<Leaf, Key_bits, Levels>::get_index(uint64_t key)
+{
+	constexpr unsigned shift = level_bits * (Levels - 1 - Depth);
+	if constexpr (shift >= 64)
+		return 0;
+	else
+		return (key >> shift) & (fanout - 1);
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+inline Leaf* Radix_table<Leaf, Key_bits, Levels>::find(uint64_t key) const
+{
+	const auto node = root.load(std::memory_order_acquire);
+	if (!node)
+		return nullptr;
+
+	return find_in<0>(*node, key);
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+template <unsigned Depth>
+inline Leaf* Radix_table<Leaf, Key_bits, Levels>::find_in(const Node<Depth>& node, uint64_t key)
+{
+	const auto child = node.children[get_index<Depth>(key)].load(std::memory_order_acquire);
+	if constexpr (Depth + 1 == Levels)
+		return child;
+	else
+		return child ? find_in<Depth + 1>(*child, key) : nullptr;
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+Leaf& Radix_table<Leaf, Key_bits, Levels>::get_or_create(uint64_t key)
+{
+	return create_in<0>(get_or_create_in(root), key);
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+template <unsigned Depth>
+Leaf& Radix_table<Leaf, Key_bits, Levels>::create_in(Node<Depth>& node, uint64_t key)
+{
+	auto& child = get_or_create_in(node.children[get_index<Depth>(key)]);
+	if constexpr (Depth + 1 == Levels)
+		return child;
+	else
+		return create_in<Depth + 1>(child, key);
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+void Radix_table<Leaf, Key_bits, Levels>::clear()
+{
+	delete root.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+template <typename Func>
+void Radix_table<Leaf, Key_bits, Levels>::for_each(Func func) const
+{
+	if (const auto node = root.load(std::memory_order_acquire))
+		for_each_in<0>(*node, 0, func);
+}
+
+template <typename Leaf, unsigned Key_bits, unsigned Levels>
+template <unsigned Depth, typename Func>
+void Radix_table<Leaf, Key_bits, Levels>::for_each_in(const Node<Depth>& node, uint64_t key_prefix, Func& func)
+{
+	for (size_t i = 0; i < fanout; ++i)
+	{
+		const auto child = node.children[i].load(std::memory_order_acquire);
+		if (!child)
+			continue;
+
+		const uint64_t key = (key_prefix << level_bits) | i;
+		if constexpr (Depth + 1 == Levels)
+			func(key, static_cast<const Leaf&>(*child));
+		else
+			for_each_in<Depth + 1>(*child, key, func);
+	}
+}
+
+}
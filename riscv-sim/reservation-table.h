@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace riscv_sim {
+
+/**
+Tracks the LR reservations of the harts that share a memory, so SC can tell whether another hart's atomic write
+to the reserved granule came in between.
+
+Each granule hashes to a version counter. Reservations record the version of their granule, and atomic writes (AMOs
+and successful SCs) bump it, but only while some reservation is outstanding: with none, an atomic write pays one
+load of a shared counter and ordinary loads and stores pay nothing. Granules that hash to the same counter can make
+an SC fail spuriously, which the ISA allows.
+
+Plain stores aren't tracked. SC compares the reserved word with the value LR read instead, so a plain store that
+changes the word fails it, but one that writes back the same value doesn't.
+*/
+class Reservation_table
+{
+public:
+	/** Reservations cover naturally aligned 64-byte granules, the cache line size of the supported hosts. */
+	static constexpr unsigned granule_bits = 6;
+
+	/** Makes a reservation on the granule of the address. Returns its version, which release() doesn't need. */
+	uint32_t reserve(uint64_t address);
+
+	/** Drops a reservation made with reserve(). */
+	void release();
+
+	/** Checks that no atomic write to the granule of the address has been made since version was read. */
+	bool is_current(uint64_t address, uint32_t version) const;
+
+	/** Must be called after an atomic write to the address. */
+	void notify_atomic_write(uint64_t address);
+
+private:
+	static constexpr unsigned version_bits = 10;
+
+	static size_t get_index(uint64_t address);
+
+	std::atomic<uint32_t> outstanding = 0;
+	std::array<std::atomic<uint32_t>, 1 << version_bits> versions{};
+};
+
+inline size_t Reservation_table::get_index(uint64_t address)
+{
+	return (address >> granule_bits) & ((1 << version_bits) - 1);
+}
+
+inline uint32_t Reservation_table::reserve(uint64_t address)
+{
+	// Sequentially consistent, so an atomic write either sees the reservation or is seen by the load that follows
+	outstanding.fetch_add(1, std::memory_order_seq_cst);
+	return versions[get_index(address)].load(std::memory_order_seq_cst);
+}
+
+inline void Reservation_table::release()
+{
+	outstanding.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline bool Reservation_table::is_current(uint64_t address, uint32_t version) const
+{
+	return versions[get_index(address)].load(std::memory_order_seq_cst) == version;
+}
+
+inline void Reservation_table::notify_atomic_write(uint64_t address)
+{
+	if (outstanding.load(std::memory_order_seq_cst) != 0) [[unlikely]]
+		versions[get_index(address)].fetch_add(1, std::memory_order_seq_cst);
+}
+
+}
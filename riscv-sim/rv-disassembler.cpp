@@ -25,6 +25,21 @@ static Rv_disassembled_instruction disassemble_btype(uint32_t instruction, Rv32i
 	return dis;
 }
 
+static Rv_disassembled_instruction disassemble_csr(uint32_t instruction, Rv32i_instruction_type type)
+{
+	auto itype = Rv32_decoder::decode_itype(instruction);
+
+	// The CSR address is unsigned. The immediate forms keep their 5-bit immediate in rs1.
+	auto dis = Rv_disassembled_instruction();
+	dis.type = type;
+	dis.format = Rv32_instruction_format::itype;
+	dis.rd = itype.rd;
+	dis.rs1 = itype.rs1;
+	dis.rs2 = Rv_register_id::_unused;
+	dis.imm = itype.imm.get_unsigned();
+	return dis;
+}
+
 static Rv_disassembled_instruction disassemble_itype(uint32_t instruction, Rv32i_instruction_type type)
 {
 	auto itype = Rv32_decoder::decode_itype(instruction);
@@ -95,6 +110,93 @@ static Rv_disassembled_instruction disassemble_utype(uint32_t instruction, Rv32i
 	return dis;
 }
 
+/** Zbb instructions and LR with one source. rs2 or the immediate selects the operation, so it isn't an operand. */
+static Rv_disassembled_instruction disassemble_unary(uint32_t instruction, Rv32i_instruction_type type)
+{
+	auto dis = disassemble_rtype(instruction, type);
+	dis.rs2 = Rv_register_id::_unused;
+	return dis;
+}
+
+/** Zbb and Zbs instructions with a shift amount or bit index in the immediate. */
+static Rv_disassembled_instruction disassemble_shift_imm(uint32_t instruction, Rv32i_instruction_type type)
+{
+	auto dis = disassemble_itype(instruction, type);
+	dis.imm = Rv32_decoder::decode_itype(instruction).imm.get_shift_amount();
+	return dis;
+}
+
+/** OP-FP instructions. Which operands are floating-point registers depends on the instruction. */
+static Rv_disassembled_instruction disassemble_fp(uint32_t instruction, Rv32i_instruction_type type)
+{
+	using enum Rv32i_instruction_type;
+
+	auto dis = disassemble_rtype(instruction, type);
+	dis.rd_fp = true;
+	dis.rs1_fp = true;
+	dis.rs2_fp = true;
+
+	switch (type)
+	{
+	// rs2 selects the variant of unary instructions
+	case fsqrt_s: case fsqrt_d: case fcvt_s_d: case fcvt_d_s:
+		dis.rs2 = Rv_register_id::_unused;
+		break;
+
+	case fcvt_w_s: case fcvt_wu_s: case fcvt_w_d: case fcvt_wu_d: case fmv_x_w: case fclass_s: case fclass_d:
+		dis.rd_fp = false;
+		dis.rs2 = Rv_register_id::_unused;
+		break;
+
+	case fcvt_s_w: case fcvt_s_wu: case fcvt_d_w: case fcvt_d_wu: case fmv_w_x:
+		dis.rs1_fp = false;
+		dis.rs2 = Rv_register_id::_unused;
+		break;
+
+	case feq_s: case flt_s: case fle_s: case feq_d: case flt_d: case fle_d:
+		dis.rd_fp = false;
+		break;
+
+	default:
+		break;
+	}
+
+	return dis;
+}
+
+static Rv_disassembled_instruction disassemble_fp_load(uint32_t instruction, Rv32i_instruction_type type)
+{
+	auto dis = disassemble_itype(instruction, type);
+	dis.rd_fp = true;
+	return dis;
+}
+
+static Rv_disassembled_instruction disassemble_fp_store(uint32_t instruction, Rv32i_instruction_type type)
+{
+	auto dis = disassemble_stype(instruction, type);
+	dis.rs2_fp = true;
+	return dis;
+}
+
+static Rv_disassembled_instruction disassemble_r4type(uint32_t instruction, Rv32i_instruction_type type)
+{
+	auto r4type = Rv32_decoder::decode_r4type(instruction);
+
+	auto dis = Rv_disassembled_instruction();
+	dis.type = type;
+	dis.format = Rv32_instruction_format::r4type;
+	dis.rd = r4type.rd;
+	dis.rs1 = r4type.rs1;
+	dis.rs2 = r4type.rs2;
+	dis.rs3 = r4type.rs3;
+	dis.imm = 0;
+	dis.rd_fp = true;
+	dis.rs1_fp = true;
+	dis.rs2_fp = true;
+	dis.rs3_fp = true;
+	return dis;
+}
+
 static const map<Rv32i_instruction_type, disassembly_func> s_disassembly_func_map = {
 
 	// B-type
@@ -118,6 +220,11 @@ static const map<Rv32i_instruction_type, disassembly_func> s_disassembly_func_ma
 	{ Rv32i_instruction_type::lhu, &disassemble_itype },
 	{ Rv32i_instruction_type::lw, &disassemble_itype },
 
+	// I-type - LOAD-FP
+
+	{ Rv32i_instruction_type::fld, &disassemble_fp_load },
+	{ Rv32i_instruction_type::flw, &disassemble_fp_load },
+
 	// I-type - MISC-MEM
 
 	{ Rv32i_instruction_type::fence, &disassemble_itype },
@@ -134,11 +241,35 @@ static const map<Rv32i_instruction_type, disassembly_func> s_disassembly_func_ma
 	{ Rv32i_instruction_type::srai, &disassemble_itype },
 	{ Rv32i_instruction_type::xori, &disassemble_itype },
 
+	// I-type - OP-IMM - Zbb and Zbs
+
+	{ Rv32i_instruction_type::bclri, &disassemble_shift_imm },
+	{ Rv32i_instruction_type::bexti, &disassemble_shift_imm },
+	{ Rv32i_instruction_type::binvi, &disassemble_shift_imm },
+	{ Rv32i_instruction_type::bseti, &disassemble_shift_imm },
+	{ Rv32i_instruction_type::clz, &disassemble_unary },
+	{ Rv32i_instruction_type::cpop, &disassemble_unary },
+	{ Rv32i_instruction_type::ctz, &disassemble_unary },
+	{ Rv32i_instruction_type::orc_b, &disassemble_unary },
+	{ Rv32i_instruction_type::rev8, &disassemble_unary },
+	{ Rv32i_instruction_type::rori, &disassemble_shift_imm },
+	{ Rv32i_instruction_type::sext_b, &disassemble_unary },
+	{ Rv32i_instruction_type::sext_h, &disassemble_unary },
+
 	// I-type - SYSTEM
 
 	{ Rv32i_instruction_type::ebreak, &disassemble_itype },
 	{ Rv32i_instruction_type::ecall, &disassemble_itype },
 
+	// I-type - SYSTEM - Zicsr
+
+	{ Rv32i_instruction_type::csrrc, &disassemble_csr },
+	{ Rv32i_instruction_type::csrrci, &disassemble_csr },
+	{ Rv32i_instruction_type::csrrs, &disassemble_csr },
+	{ Rv32i_instruction_type::csrrsi, &disassemble_csr },
+	{ Rv32i_instruction_type::csrrw, &disassemble_csr },
+	{ Rv32i_instruction_type::csrrwi, &disassemble_csr },
+
 	// J-type
 
 	{ Rv32i_instruction_type::jal, &disassemble_jtype },
@@ -156,12 +287,119 @@ static const map<Rv32i_instruction_type, disassembly_func> s_disassembly_func_ma
 	{ Rv32i_instruction_type::srl, &disassemble_rtype },
 	{ Rv32i_instruction_type::xor_, &disassemble_rtype },
 
+	// R-type - M extension
+
+	{ Rv32i_instruction_type::mul, &disassemble_rtype },
+	{ Rv32i_instruction_type::mulh, &disassemble_rtype },
+	{ Rv32i_instruction_type::mulhsu, &disassemble_rtype },
+	{ Rv32i_instruction_type::mulhu, &disassemble_rtype },
+	{ Rv32i_instruction_type::div, &disassemble_rtype },
+	{ Rv32i_instruction_type::divu, &disassemble_rtype },
+	{ Rv32i_instruction_type::rem, &disassemble_rtype },
+	{ Rv32i_instruction_type::remu, &disassemble_rtype },
+
+	// R-type - A extension
+
+	{ Rv32i_instruction_type::lr_w, &disassemble_unary },
+	{ Rv32i_instruction_type::sc_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amoswap_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amoadd_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amoxor_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amoand_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amoor_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amomin_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amomax_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amominu_w, &disassemble_rtype },
+	{ Rv32i_instruction_type::amomaxu_w, &disassemble_rtype },
+
+	// R-type - Zba, Zbb and Zbs
+
+	{ Rv32i_instruction_type::sh1add, &disassemble_rtype },
+	{ Rv32i_instruction_type::sh2add, &disassemble_rtype },
+	{ Rv32i_instruction_type::sh3add, &disassemble_rtype },
+	{ Rv32i_instruction_type::andn, &disassemble_rtype },
+	{ Rv32i_instruction_type::orn, &disassemble_rtype },
+	{ Rv32i_instruction_type::xnor, &disassemble_rtype },
+	{ Rv32i_instruction_type::max, &disassemble_rtype },
+	{ Rv32i_instruction_type::maxu, &disassemble_rtype },
+	{ Rv32i_instruction_type::min, &disassemble_rtype },
+	{ Rv32i_instruction_type::minu, &disassemble_rtype },
+	{ Rv32i_instruction_type::rol, &disassemble_rtype },
+	{ Rv32i_instruction_type::ror, &disassemble_rtype },
+	{ Rv32i_instruction_type::zext_h, &disassemble_unary },
+	{ Rv32i_instruction_type::bclr, &disassemble_rtype },
+	{ Rv32i_instruction_type::bext, &disassemble_rtype },
+	{ Rv32i_instruction_type::binv, &disassemble_rtype },
+	{ Rv32i_instruction_type::bset, &disassemble_rtype },
+
+	// R-type - F extension
+
+	{ Rv32i_instruction_type::fadd_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fsub_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fmul_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fdiv_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fsqrt_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fsgnj_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fsgnjn_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fsgnjx_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fmin_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fmax_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_w_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_wu_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fmv_x_w, &disassemble_fp },
+	{ Rv32i_instruction_type::feq_s, &disassemble_fp },
+	{ Rv32i_instruction_type::flt_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fle_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fclass_s, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_s_w, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_s_wu, &disassemble_fp },
+	{ Rv32i_instruction_type::fmv_w_x, &disassemble_fp },
+
+	// R-type - D extension
+
+	{ Rv32i_instruction_type::fadd_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fsub_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fmul_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fdiv_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fsqrt_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fsgnj_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fsgnjn_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fsgnjx_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fmin_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fmax_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_s_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_d_s, &disassemble_fp },
+	{ Rv32i_instruction_type::feq_d, &disassemble_fp },
+	{ Rv32i_instruction_type::flt_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fle_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fclass_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_w_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_wu_d, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_d_w, &disassemble_fp },
+	{ Rv32i_instruction_type::fcvt_d_wu, &disassemble_fp },
+
+	// R4-type - fused multiply-add
+
+	{ Rv32i_instruction_type::fmadd_s, &disassemble_r4type },
+	{ Rv32i_instruction_type::fmsub_s, &disassemble_r4type },
+	{ Rv32i_instruction_type::fnmsub_s, &disassemble_r4type },
+	{ Rv32i_instruction_type::fnmadd_s, &disassemble_r4type },
+	{ Rv32i_instruction_type::fmadd_d, &disassemble_r4type },
+	{ Rv32i_instruction_type::fmsub_d, &disassemble_r4type },
+	{ Rv32i_instruction_type::fnmsub_d, &disassemble_r4type },
+	{ Rv32i_instruction_type::fnmadd_d, &disassemble_r4type },
+
 	// S-type
 
 	{ Rv32i_instruction_type::sb, &disassemble_stype },
 	{ Rv32i_instruction_type::sh, &disassemble_stype },
 	{ Rv32i_instruction_type::sw, &disassemble_stype },
 
+	// S-type - STORE-FP
+
+	{ Rv32i_instruction_type::fsd, &disassemble_fp_store },
+	{ Rv32i_instruction_type::fsw, &disassemble_fp_store },
+
 	// U-type
 
 	{ Rv32i_instruction_type::auipc, &disassemble_utype },
@@ -191,6 +429,11 @@ static const map<Rv32i_instruction_type, string> s_mnemonic_map = {
 	{ Rv32i_instruction_type::lhu, "lhu" },
 	{ Rv32i_instruction_type::lw, "lw" },
 
+	// I-type - LOAD-FP
+
+	{ Rv32i_instruction_type::fld, "fld" },
+	{ Rv32i_instruction_type::flw, "flw" },
+
 	// I-type - MISC-MEM
 
 	{ Rv32i_instruction_type::fence, "fence" },
@@ -207,11 +450,35 @@ static const map<Rv32i_instruction_type, string> s_mnemonic_map = {
 	{ Rv32i_instruction_type::srai, "srai" },
 	{ Rv32i_instruction_type::xori, "xori" },
 
+	// I-type - OP-IMM - Zbb and Zbs
+
+	{ Rv32i_instruction_type::bclri, "bclri" },
+	{ Rv32i_instruction_type::bexti, "bexti" },
+	{ Rv32i_instruction_type::binvi, "binvi" },
+	{ Rv32i_instruction_type::bseti, "bseti" },
+	{ Rv32i_instruction_type::clz, "clz" },
+	{ Rv32i_instruction_type::cpop, "cpop" },
+	{ Rv32i_instruction_type::ctz, "ctz" },
+	{ Rv32i_instruction_type::orc_b, "orc.b" },
+	{ Rv32i_instruction_type::rev8, "rev8" },
+	{ Rv32i_instruction_type::rori, "rori" },
+	{ Rv32i_instruction_type::sext_b, "sext.b" },
+	{ Rv32i_instruction_type::sext_h, "sext.h" },
+
 	// I-type - SYSTEM
 
 	{ Rv32i_instruction_type::ebreak, "ebreak" },
 	{ Rv32i_instruction_type::ecall, "ecall" },
 
+	// I-type - SYSTEM - Zicsr
+
+	{ Rv32i_instruction_type::csrrc, "csrrc" },
+	{ Rv32i_instruction_type::csrrci, "csrrci" },
+	{ Rv32i_instruction_type::csrrs, "csrrs" },
+	{ Rv32i_instruction_type::csrrsi, "csrrsi" },
+	{ Rv32i_instruction_type::csrrw, "csrrw" },
+	{ Rv32i_instruction_type::csrrwi, "csrrwi" },
+
 	// J-type
 
 	{ Rv32i_instruction_type::jal, "jal" },
@@ -229,12 +496,119 @@ static const map<Rv32i_instruction_type, string> s_mnemonic_map = {
 	{ Rv32i_instruction_type::srl, "srl" },
 	{ Rv32i_instruction_type::xor_, "xor" },
 
+	// R-type - M extension
+
+	{ Rv32i_instruction_type::mul, "mul" },
+	{ Rv32i_instruction_type::mulh, "mulh" },
+	{ Rv32i_instruction_type::mulhsu, "mulhsu" },
+	{ Rv32i_instruction_type::mulhu, "mulhu" },
+	{ Rv32i_instruction_type::div, "div" },
+	{ Rv32i_instruction_type::divu, "divu" },
+	{ Rv32i_instruction_type::rem, "rem" },
+	{ Rv32i_instruction_type::remu, "remu" },
+
+	// R-type - A extension
+
+	{ Rv32i_instruction_type::lr_w, "lr.w" },
+	{ Rv32i_instruction_type::sc_w, "sc.w" },
+	{ Rv32i_instruction_type::amoswap_w, "amoswap.w" },
+	{ Rv32i_instruction_type::amoadd_w, "amoadd.w" },
+	{ Rv32i_instruction_type::amoxor_w, "amoxor.w" },
+	{ Rv32i_instruction_type::amoand_w, "amoand.w" },
+	{ Rv32i_instruction_type::amoor_w, "amoor.w" },
+	{ Rv32i_instruction_type::amomin_w, "amomin.w" },
+	{ Rv32i_instruction_type::amomax_w, "amomax.w" },
+	{ Rv32i_instruction_type::amominu_w, "amominu.w" },
+	{ Rv32i_instruction_type::amomaxu_w, "amomaxu.w" },
+
+	// R-type - Zba, Zbb and Zbs
+
+	{ Rv32i_instruction_type::sh1add, "sh1add" },
+	{ Rv32i_instruction_type::sh2add, "sh2add" },
+	{ Rv32i_instruction_type::sh3add, "sh3add" },
+	{ Rv32i_instruction_type::andn, "andn" },
+	{ Rv32i_instruction_type::orn, "orn" },
+	{ Rv32i_instruction_type::xnor, "xnor" },
+	{ Rv32i_instruction_type::max, "max" },
+	{ Rv32i_instruction_type::maxu, "maxu" },
+	{ Rv32i_instruction_type::min, "min" },
+	{ Rv32i_instruction_type::minu, "minu" },
+	{ Rv32i_instruction_type::rol, "rol" },
+	{ Rv32i_instruction_type::ror, "ror" },
+	{ Rv32i_instruction_type::zext_h, "zext.h" },
+	{ Rv32i_instruction_type::bclr, "bclr" },
+	{ Rv32i_instruction_type::bext, "bext" },
+	{ Rv32i_instruction_type::binv, "binv" },
+	{ Rv32i_instruction_type::bset, "bset" },
+
+	// R-type - F extension
+
+	{ Rv32i_instruction_type::fadd_s, "fadd.s" },
+	{ Rv32i_instruction_type::fsub_s, "fsub.s" },
+	{ Rv32i_instruction_type::fmul_s, "fmul.s" },
+	{ Rv32i_instruction_type::fdiv_s, "fdiv.s" },
+	{ Rv32i_instruction_type::fsqrt_s, "fsqrt.s" },
+	{ Rv32i_instruction_type::fsgnj_s, "fsgnj.s" },
+	{ Rv32i_instruction_type::fsgnjn_s, "fsgnjn.s" },
+	{ Rv32i_instruction_type::fsgnjx_s, "fsgnjx.s" },
+	{ Rv32i_instruction_type::fmin_s, "fmin.s" },
+	{ Rv32i_instruction_type::fmax_s, "fmax.s" },
+	{ Rv32i_instruction_type::fcvt_w_s, "fcvt.w.s" },
+	{ Rv32i_instruction_type::fcvt_wu_s, "fcvt.wu.s" },
+	{ Rv32i_instruction_type::fmv_x_w, "fmv.x.w" },
+	{ Rv32i_instruction_type::feq_s, "feq.s" },
+	{ Rv32i_instruction_type::flt_s, "flt.s" },
+	{ Rv32i_instruction_type::fle_s, "fle.s" },
+	{ Rv32i_instruction_type::fclass_s, "fclass.s" },
+	{ Rv32i_instruction_type::fcvt_s_w, "fcvt.s.w" },
+	{ Rv32i_instruction_type::fcvt_s_wu, "fcvt.s.wu" },
+	{ Rv32i_instruction_type::fmv_w_x, "fmv.w.x" },
+
+	// R-type - D extension
+
+	{ Rv32i_instruction_type::fadd_d, "fadd.d" },
+	{ Rv32i_instruction_type::fsub_d, "fsub.d" },
+	{ Rv32i_instruction_type::fmul_d, "fmul.d" },
+	{ Rv32i_instruction_type::fdiv_d, "fdiv.d" },
+	{ Rv32i_instruction_type::fsqrt_d, "fsqrt.d" },
+	{ Rv32i_instruction_type::fsgnj_d, "fsgnj.d" },
+	{ Rv32i_instruction_type::fsgnjn_d, "fsgnjn.d" },
+	{ Rv32i_instruction_type::fsgnjx_d, "fsgnjx.d" },
+	{ Rv32i_instruction_type::fmin_d, "fmin.d" },
+	{ Rv32i_instruction_type::fmax_d, "fmax.d" },
+	{ Rv32i_instruction_type::fcvt_s_d, "fcvt.s.d" },
+	{ Rv32i_instruction_type::fcvt_d_s, "fcvt.d.s" },
+	{ Rv32i_instruction_type::feq_d, "feq.d" },
+	{ Rv32i_instruction_type::flt_d, "flt.d" },
+	{ Rv32i_instruction_type::fle_d, "fle.d" },
+	{ Rv32i_instruction_type::fclass_d, "fclass.d" },
+	{ Rv32i_instruction_type::fcvt_w_d, "fcvt.w.d" },
+	{ Rv32i_instruction_type::fcvt_wu_d, "fcvt.wu.d" },
+	{ Rv32i_instruction_type::fcvt_d_w, "fcvt.d.w" },
+	{ Rv32i_instruction_type::fcvt_d_wu, "fcvt.d.wu" },
+
+	// R4-type - fused multiply-add
+
+	{ Rv32i_instruction_type::fmadd_s, "fmadd.s" },
+	{ Rv32i_instruction_type::fmsub_s, "fmsub.s" },
+	{ Rv32i_instruction_type::fnmsub_s, "fnmsub.s" },
+	{ Rv32i_instruction_type::fnmadd_s, "fnmadd.s" },
+	{ Rv32i_instruction_type::fmadd_d, "fmadd.d" },
+	{ Rv32i_instruction_type::fmsub_d, "fmsub.d" },
+	{ Rv32i_instruction_type::fnmsub_d, "fnmsub.d" },
+	{ Rv32i_instruction_type::fnmadd_d, "fnmadd.d" },
+
 	// S-type
 
 	{ Rv32i_instruction_type::sb, "sb" },
 	{ Rv32i_instruction_type::sh, "sh" },
 	{ Rv32i_instruction_type::sw, "sw" },
 
+	// S-type - STORE-FP
+
+	{ Rv32i_instruction_type::fsd, "fsd" },
+	{ Rv32i_instruction_type::fsw, "fsw" },
+
 	// U-type
 
 	{ Rv32i_instruction_type::auipc, "auipc" },
@@ -278,6 +652,41 @@ static const map<Rv_register_id, string> s_register_abi_name_map = {
 	{ Rv_register_id::pc, "pc" },
 };
 
+static const map<Rv_register_id, string> s_fp_register_abi_name_map = {
+	{ Rv_register_id::x0, "ft0" },
+	{ Rv_register_id::x1, "ft1" },
+	{ Rv_register_id::x2, "ft2" },
+	{ Rv_register_id::x3, "ft3" },
+	{ Rv_register_id::x4, "ft4" },
+	{ Rv_register_id::x5, "ft5" },
+	{ Rv_register_id::x6, "ft6" },
+	{ Rv_register_id::x7, "ft7" },
+	{ Rv_register_id::x8, "fs0" },
+	{ Rv_register_id::x9, "fs1" },
+	{ Rv_register_id::x10, "fa0" },
+	{ Rv_register_id::x11, "fa1" },
+	{ Rv_register_id::x12, "fa2" },
+	{ Rv_register_id::x13, "fa3" },
+	{ Rv_register_id::x14, "fa4" },
+	{ Rv_register_id::x15, "fa5" },
+	{ Rv_register_id::x16, "fa6" },
+	{ Rv_register_id::x17, "fa7" },
+	{ Rv_register_id::x18, "fs2" },
+	{ Rv_register_id::x19, "fs3" },
+	{ Rv_register_id::x20, "fs4" },
+	{ Rv_register_id::x21, "fs5" },
+	{ Rv_register_id::x22, "fs6" },
+	{ Rv_register_id::x23, "fs7" },
+	{ Rv_register_id::x24, "fs8" },
+	{ Rv_register_id::x25, "fs9" },
+	{ Rv_register_id::x26, "fs10" },
+	{ Rv_register_id::x27, "fs11" },
+	{ Rv_register_id::x28, "ft8" },
+	{ Rv_register_id::x29, "ft9" },
+	{ Rv_register_id::x30, "ft10" },
+	{ Rv_register_id::x31, "ft11" },
+};
+
 Rv_disassembled_instruction Rv_disassembler::disassemble(uint32_t instruction)
 {
 	auto type = Rv32_decoder::decode_instruction_type(instruction);
@@ -313,4 +722,12 @@ const string& Rv_disassembler::get_register_abi_name(Rv_register_id reg)
 	return c_unknown;
 }
 
+const string& Rv_disassembler::get_fp_register_abi_name(Rv_register_id reg)
+{
+	if (s_fp_register_abi_name_map.contains(reg))
+		return s_fp_register_abi_name_map.at(reg);
+
+	return c_unknown;
+}
+
 }
@@ -13,6 +13,13 @@ struct Rv_disassembled_instruction {
 	Rv_register_id rs1;
 	Rv_register_id rs2;
 	uint32_t imm;
+	Rv_register_id rs3 = Rv_register_id::_unused; // Fused multiply-adds only
+
+	// Operands that are floating-point registers
+	bool rd_fp = false;
+	bool rs1_fp = false;
+	bool rs2_fp = false;
+	bool rs3_fp = false;
 };
 
 class Rv_disassembler
@@ -22,6 +29,7 @@ public:
 	static Rv_disassembled_instruction disassemble(uint32_t instruction);
 	static const std::string& get_mnemonic(Rv32i_instruction_type type);
 	static const std::string& get_register_abi_name(Rv_register_id reg);
+	static const std::string& get_fp_register_abi_name(Rv_register_id reg);
 };
 
 }
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <array>
+#include <cfenv>
+#include <cstdlib>
+#include <initializer_list>
+
+#include "rv-float.h"
+
+namespace riscv_sim {
+
+namespace {
+
+/*
+Ties under RMM need the exact result, which the host can't round to. The checks below scale the operands so that
+every product and sum of doubles they make is exact, then test whether the exact result minus the halfway value
+adds up to zero. They leave the host flags as they were.
+*/
+
+/** Saves the host's accrued exception flags and restores them when it goes out of scope. */
+class Saved_host_fp_flags
+{
+public:
+	Saved_host_fp_flags() { fegetexceptflag(&flags, FE_ALL_EXCEPT); }
+	~Saved_host_fp_flags() { fesetexceptflag(&flags, FE_ALL_EXCEPT); }
+
+	Saved_host_fp_flags(const Saved_host_fp_flags&) = delete;
+	Saved_host_fp_flags& operator=(const Saved_host_fp_flags&) = delete;
+
+private:
+	fexcept_t flags;
+};
+
+/**
+Whether terms that are far from overflowing add up to exactly zero. Each term is added to parts that keep the
+rounding errors of the sums, so the parts add up to the terms exactly. They don't overlap, so the largest nonzero
+part outweighs the rest, and the sum is zero only if every part is.
+*/
+bool is_exact_sum_zero(std::initializer_list<double> terms)
+{
+	std::array<double, 8> parts;
+	size_t count = 0;
+	for (double term : terms)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const double sum = term + parts[i];
+			const double part = sum - term;
+			parts[i] = (term - (sum - part)) + (parts[i] - part);
+			term = sum;
+		}
+
+		parts[count++] = term;
+	}
+
+	return std::all_of(parts.begin(), parts.begin() + count, [](double part) { return part == 0; });
+}
+
+/** Gets the exponent of half the last place of a finite value. Zeros and subnormals share the smallest place. */
+template <std::floating_point T>
+int get_half_place_exponent(T value)
+{
+	using Limits = std::numeric_limits<T>;
+	if (std::fabs(value) < Limits::min())
+		return Limits::min_exponent - Limits::digits - 1;
+
+	return std::ilogb(value) - Limits::digits;
+}
+
+/**
+Three nonzero terms that add up to zero are within this many binades of each other: the smallest is at least the
+last place of one of the other two, and products of doubles have 106 bits.
+*/
+constexpr int max_tie_exponent_range = 2 * std::numeric_limits<double>::digits + 4;
+
+}
+
+template <std::floating_point T>
+bool is_fused_tie(T a, T b, T c, T result)
+{
+	if (!std::isfinite(a) || !std::isfinite(b) || !std::isfinite(c) || !std::isfinite(result) || a == 0 || b == 0)
+		return false;
+
+	// The product, the addend and the negated halfway value must add up to zero
+	const int half_place = get_half_place_exponent(result);
+	const int product_exponent = std::ilogb(a) + std::ilogb(b);
+	const int result_exponent = result == 0 ? half_place : std::ilogb(result);
+	const int addend_exponent = c == 0 ? product_exponent : std::ilogb(c);
+	const auto [smallest, largest] = std::minmax({ product_exponent, result_exponent, addend_exponent });
+	if (largest - smallest > max_tie_exponent_range)
+		return false;
+
+	// Scaling the largest term to about 1 keeps the rest clear of underflow, so the product's rounding error is exact
+	const Saved_host_fp_flags saved_flags;
+	const int scale = -largest;
+	const double a_scaled = std::scalbn(static_cast<double>(a), -std::ilogb(a));
+	const double b_scaled = std::scalbn(static_cast<double>(b), std::ilogb(a) + scale);
+	const double product = a_scaled * b_scaled;
+	const double product_error = std::fma(a_scaled, b_scaled, -product);
+	const double half = std::copysign(std::scalbn(1.0, half_place + scale), result);
+	return is_exact_sum_zero({ product, product_error, std::scalbn(static_cast<double>(c), scale),
+		-std::scalbn(static_cast<double>(result), scale), -half });
+}
+
+template bool is_fused_tie(float a, float b, float c, float result);
+template bool is_fused_tie(double a, double b, double c, double result);
+
+template <std::floating_point T>
+bool is_quotient_tie(T a, T b, T result)
+{
+	if (!std::isfinite(a) || !std::isfinite(b) || !std::isfinite(result) || a == 0 || b == 0)
+		return false;
+
+	// b times the halfway value must be a, so both sides have about the same exponent
+	const int half_place = get_half_place_exponent(result);
+	const int result_exponent = result == 0 ? half_place : std::ilogb(result);
+	if (std::abs(std::ilogb(b) + result_exponent - std::ilogb(a)) > 2)
+		return false;
+
+	// Scaled to about 1, b times the result has an exact rounding error and b times half a place is exact
+	const Saved_host_fp_flags saved_flags;
+	const int result_scale = std::ilogb(b) - std::ilogb(a);
+	const double b_scaled = std::scalbn(static_cast<double>(b), -std::ilogb(b));
+	const double result_scaled = std::scalbn(static_cast<double>(result), result_scale);
+	const double half = std::copysign(std::scalbn(1.0, half_place + result_scale), result);
+	const double product = b_scaled * result_scaled;
+	const double product_error = std::fma(b_scaled, result_scaled, -product);
+	return is_exact_sum_zero({ product, product_error, b_scaled * half,
+		-std::scalbn(static_cast<double>(a), -std::ilogb(a)) });
+}
+
+template bool is_quotient_tie(float a, float b, float result);
+template bool is_quotient_tie(double a, double b, double result);
+
+uint32_t get_host_fp_flags()
+{
+	const auto host = fetestexcept(FE_ALL_EXCEPT);
+	if (host == 0) [[likely]]
+		return 0;
+
+	uint32_t flags = 0;
+	if (host & FE_INEXACT) flags |= Rv_fp_flags::inexact;
+	if (host & FE_UNDERFLOW) flags |= Rv_fp_flags::underflow;
+	if (host & FE_OVERFLOW) flags |= Rv_fp_flags::overflow;
+	if (host & FE_DIVBYZERO) flags |= Rv_fp_flags::divide_by_zero;
+	if (host & FE_INVALID) flags |= Rv_fp_flags::invalid;
+	return flags;
+}
+
+void clear_host_fp_flags()
+{
+	// Reading the flags is cheaper than writing them
+	if (fetestexcept(FE_ALL_EXCEPT) != 0)
+		feclearexcept(FE_ALL_EXCEPT);
+}
+
+Host_rounding_mode::Host_rounding_mode(Rv_rounding_mode mode)
+{
+	switch (mode)
+	{
+	case Rv_rounding_mode::rtz: fesetround(FE_TOWARDZERO); break;
+	case Rv_rounding_mode::rdn: fesetround(FE_DOWNWARD); break;
+	case Rv_rounding_mode::rup: fesetround(FE_UPWARD); break;
+	default: break;
+	}
+}
+
+Host_rounding_mode::~Host_rounding_mode()
+{
+	fesetround(FE_TONEAREST);
+}
+
+}
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+
+#include "rv32.h"
+
+namespace riscv_sim {
+
+/*
+Floating-point helpers for the F and D extensions.
+
+Arithmetic runs on the host FPU, which already implements IEEE 754 binary32 and binary64. The helpers here
+cover where RISC-V differs from what C++ gives: canonical NaNs, NaN boxing, min/max and comparisons with their
+exact flag rules, saturating conversions to integers and round to nearest, ties to max magnitude (RMM), which no
+host rounding mode provides.
+
+Flags that the host FPU raises are collected with get_host_fp_flags. Helpers that decide a result themselves
+(comparisons, min/max, conversions to integers) raise no host flags and add theirs to a flags argument instead.
+*/
+
+template <std::floating_point T>
+struct Fp_bits;
+
+template <>
+struct Fp_bits<float>
+{
+	using Bits = uint32_t;
+	static constexpr Bits canonical_nan = 0x7FC0'0000;
+	static constexpr Bits quiet_bit = 0x0040'0000;
+};
+
+template <>
+struct Fp_bits<double>
+{
+	using Bits = uint64_t;
+	static constexpr Bits canonical_nan = 0x7FF8'0000'0000'0000;
+	static constexpr Bits quiet_bit = 0x0008'0000'0000'0000;
+};
+
+template <std::floating_point T>
+constexpr T canonical_nan()
+{
+	return std::bit_cast<T>(Fp_bits<T>::canonical_nan);
+}
+
+template <std::floating_point T>
+constexpr bool is_signaling_nan(T value)
+{
+	return std::isnan(value) && (std::bit_cast<typename Fp_bits<T>::Bits>(value) & Fp_bits<T>::quiet_bit) == 0;
+}
+
+/** Replaces any NaN with the canonical NaN, which is what RISC-V arithmetic returns instead of propagating payloads. */
+template <std::floating_point T>
+constexpr T canonicalize(T value)
+{
+	return std::isnan(value) ? canonical_nan<T>() : value;
+}
+
+/** Singles are kept in the 64-bit floating-point registers with the upper 32 bits set. */
+constexpr uint64_t nan_box(uint32_t bits)
+{
+	return 0xFFFF'FFFF'0000'0000 | bits;
+}
+
+/** Gets the single in a register. A value that isn't properly NaN-boxed reads as the canonical NaN. */
+constexpr float nan_unbox(uint64_t bits)
+{
+	return (bits >> 32) == 0xFFFF'FFFF ? std::bit_cast<float>(static_cast<uint32_t>(bits)) : canonical_nan<float>();
+}
+
+/** Gets the value with its sign bit set or cleared. Only bits move, so NaNs keep their payloads. */
+template <std::floating_point T>
+constexpr T fp_with_sign(T value, bool negative)
+{
+	using Bits = typename Fp_bits<T>::Bits;
+	constexpr Bits sign = Bits(1) << (sizeof(Bits) * 8 - 1);
+	const auto bits = std::bit_cast<Bits>(value);
+	return std::bit_cast<T>(negative ? bits | sign : bits & ~sign);
+}
+
+/** Gets the host's accrued exception flags as Rv_fp_flags. */
+uint32_t get_host_fp_flags();
+
+/** Clears the host's accrued exception flags. */
+void clear_host_fp_flags();
+
+/**
+Switches the host to a directed rounding mode (RTZ, RDN or RUP) for its lifetime, then back to round to nearest.
+The simulator expects the host to be in round to nearest otherwise.
+*/
+class Host_rounding_mode
+{
+public:
+	explicit Host_rounding_mode(Rv_rounding_mode mode);
+	~Host_rounding_mode();
+
+	Host_rounding_mode(const Host_rounding_mode&) = delete;
+	Host_rounding_mode& operator=(const Host_rounding_mode&) = delete;
+};
+
+/** Gets the FCLASS mask: one of bits 0-9 for -inf, -normal, -subnormal, -0, +0, +subnormal, +normal, +inf, sNaN and qNaN. */
+template <std::floating_point T>
+uint32_t classify(T value)
+{
+	const bool negative = std::signbit(value);
+	switch (std::fpclassify(value))
+	{
+	case FP_INFINITE: return negative ? 1 << 0 : 1 << 7;
+	case FP_NORMAL: return negative ? 1 << 1 : 1 << 6;
+	case FP_SUBNORMAL: return negative ? 1 << 2 : 1 << 5;
+	case FP_ZERO: return negative ? 1 << 3 : 1 << 4;
+	default: return is_signaling_nan(value) ? 1 << 8 : 1 << 9;
+	}
+}
+
+/** FEQ is a quiet comparison: only signaling NaNs are invalid. */
+template <std::floating_point T>
+bool fp_equal(T a, T b, uint32_t& flags)
+{
+	if (std::isnan(a) || std::isnan(b))
+	{
+		if (is_signaling_nan(a) || is_signaling_nan(b))
+			flags |= Rv_fp_flags::invalid;
+
+		return false;
+	}
+
+	return a == b;
+}
+
+/** FLT and FLE are signaling comparisons: any NaN is invalid. */
+template <std::floating_point T>
+bool fp_less(T a, T b, uint32_t& flags)
+{
+	if (std::isnan(a) || std::isnan(b))
+	{
+		flags |= Rv_fp_flags::invalid;
+		return false;
+	}
+
+	return a < b;
+}
+
+template <std::floating_point T>
+bool fp_less_equal(T a, T b, uint32_t& flags)
+{
+	if (std::isnan(a) || std::isnan(b))
+	{
+		flags |= Rv_fp_flags::invalid;
+		return false;
+	}
+
+	return a <= b;
+}
+
+/**
+FMIN and FMAX return the other operand if one is a NaN and the canonical NaN if both are. -0 is less than +0.
+Signaling NaNs are invalid.
+*/
+template <std::floating_point T>
+T fp_min_max(T a, T b, bool max, uint32_t& flags)
+{
+	if (is_signaling_nan(a) || is_signaling_nan(b))
+		flags |= Rv_fp_flags::invalid;
+
+	if (std::isnan(a))
+		return std::isnan(b) ? canonical_nan<T>() : b;
+
+	if (std::isnan(b))
+		return a;
+
+	if (a == b)
+		return std::signbit(a) != max ? a : b;
+
+	return (a < b) != max ? a : b;
+}
+
+/**
+Rounds a value that isn't a NaN to an integral value with the rounding mode, which must be valid. Works on the bits,
+so unlike std::trunc, std::nearbyint and the like, which may raise inexact on the host, it raises no host flags.
+*/
+template <std::floating_point T>
+T round_to_integral(T value, Rv_rounding_mode mode)
+{
+	using Bits = typename Fp_bits<T>::Bits;
+	constexpr int fraction_bits = std::numeric_limits<T>::digits - 1;
+	constexpr int exponent_bias = std::numeric_limits<T>::max_exponent - 1;
+	constexpr Bits magnitude_mask = ~Bits(0) >> 1;
+
+	const auto bits = std::bit_cast<Bits>(value);
+	const bool negative = std::signbit(value);
+	const auto magnitude = bits & magnitude_mask;
+	const int exponent = static_cast<int>(magnitude >> fraction_bits) - exponent_bias;
+
+	// Infinities and values this large are integral already, and so are zeros
+	if (exponent >= fraction_bits || magnitude == 0)
+		return value;
+
+	// The magnitude is below 1, so the result is 0 or 1 with the value's sign
+	if (exponent < 0)
+	{
+		bool one;
+		switch (mode)
+		{
+		case Rv_rounding_mode::rtz: one = false; break;
+		case Rv_rounding_mode::rdn: one = negative; break;
+		case Rv_rounding_mode::rup: one = !negative; break;
+		case Rv_rounding_mode::rmm: one = exponent == -1; break;
+		default: one = exponent == -1 && magnitude != std::bit_cast<Bits>(T(0.5)); break;
+		}
+
+		return fp_with_sign(one ? T(1) : T(0), negative);
+	}
+
+	// Otherwise the fraction bits below the binary point are dropped. Carries out of the significand move into
+	// the exponent, which gives the next power of two.
+	const Bits unit = Bits(1) << (fraction_bits - exponent);
+	const Bits fraction = bits & (unit - 1);
+	const Bits truncated = bits - fraction;
+	if (fraction == 0)
+		return value;
+
+	const Bits half = unit >> 1;
+	bool away;
+	switch (mode)
+	{
+	case Rv_rounding_mode::rtz: away = false; break;
+	case Rv_rounding_mode::rdn: away = negative; break;
+	case Rv_rounding_mode::rup: away = !negative; break;
+	case Rv_rounding_mode::rmm: away = fraction >= half; break;
+	default: away = fraction > half || (fraction == half && (truncated & unit) != 0); break;
+	}
+
+	return std::bit_cast<T>(away ? truncated + unit : truncated);
+}
+
+/**
+Converts to a 32-bit integer with the rounding mode, which must be valid. Out of range values and NaNs are invalid
+and saturate, with NaNs converting to the largest integer. In range results that aren't exact are inexact.
+*/
+template <std::integral Integer>
+Integer convert_to_integer(double value, Rv_rounding_mode mode, uint32_t& flags)
+{
+	using Limits = std::numeric_limits<Integer>;
+
+	if (std::isnan(value))
+	{
+		flags |= Rv_fp_flags::invalid;
+		return Limits::max();
+	}
+
+	// Comparisons of numbers and conversions of in range integral values raise no host flags either
+	const double rounded = round_to_integral(value, mode);
+
+	// Integer limits are exact as doubles
+	if (rounded < static_cast<double>(Limits::min()))
+	{
+		flags |= Rv_fp_flags::invalid;
+		return Limits::min();
+	}
+
+	if (rounded > static_cast<double>(Limits::max()))
+	{
+		flags |= Rv_fp_flags::invalid;
+		return Limits::max();
+	}
+
+	if (rounded != value)
+		flags |= Rv_fp_flags::inexact;
+
+	return static_cast<Integer>(rounded);
+}
+
+/** Gets the next value away from zero. Incrementing the magnitude bits does that without raising host flags. */
+template <std::floating_point T>
+T next_away_from_zero(T value)
+{
+	return std::bit_cast<T>(std::bit_cast<typename Fp_bits<T>::Bits>(value) + 1);
+}
+
+/**
+Corrects a result rounded to nearest, ties to even, to ties to max magnitude. The exact value is result + residual,
+where the residual is exact in its type, which can be wider than the result's. Ties differ from ties to even only
+when the result was rounded toward zero, that is when the residual has the result's sign and is half the distance
+to the next value away from zero.
+*/
+template <std::floating_point T, std::floating_point Residual>
+T round_ties_away(T result, Residual residual)
+{
+	if (residual == 0 || !std::isfinite(result) || std::signbit(residual) != std::signbit(result))
+		return result;
+
+	// The distance between neighbouring values is a power of two, exact in both types
+	const T away = next_away_from_zero(result);
+	const auto distance = static_cast<Residual>(away) - static_cast<Residual>(result);
+	return std::isfinite(away) && distance == residual + residual ? away : result;
+}
+
+/** a + b rounded to nearest, with ties to even or, if ties_away, to max magnitude. */
+template <std::floating_point T>
+T fp_add(T a, T b, bool ties_away)
+{
+	const T sum = a + b;
+	if (!ties_away)
+		return sum;
+
+	// TwoSum gives the exact residual of a rounded sum
+	const T b_part = sum - a;
+	const T residual = (a - (sum - b_part)) + (b - b_part);
+	return round_ties_away(sum, residual);
+}
+
+template <std::floating_point T>
+T fp_multiply(T a, T b, bool ties_away)
+{
+	const T product = a * b;
+	if (!ties_away)
+		return product;
+
+	// The residual of a product is exact unless it underflows
+	return round_ties_away(product, std::fma(a, b, -product));
+}
+
+/**
+Whether the exact a / b is halfway between result, its quotient rounded to nearest, ties to even, and the next value
+away from zero. Only subnormal quotients can be.
+*/
+template <std::floating_point T>
+bool is_quotient_tie(T a, T b, T result);
+
+template <std::floating_point T>
+T fp_divide(T a, T b, bool ties_away)
+{
+	const T quotient = a / b;
+	if (!ties_away || !std::isfinite(quotient) || std::fabs(quotient) >= std::numeric_limits<T>::min())
+		return quotient;
+
+	return is_quotient_tie(a, b, quotient) ? next_away_from_zero(quotient) : quotient;
+}
+
+/**
+Converts a value to a narrower type. The residual is computed in the wider type, where the value and the rounded
+result are both exact.
+*/
+template <std::floating_point T, std::floating_point Wide>
+T fp_narrow(Wide value, bool ties_away)
+{
+	const T result = static_cast<T>(value);
+	if (!ties_away || !std::isfinite(result))
+		return result;
+
+	return round_ties_away(result, value - static_cast<Wide>(result));
+}
+
+/** Whether the exact a * b + c is halfway between result, its fused result rounded to nearest, ties to even, and the next value away from zero. */
+template <std::floating_point T>
+bool is_fused_tie(T a, T b, T c, T result);
+
+/**
+Fused a * b + c, rounded to nearest with ties to even or, if ties_away, to max magnitude. Invalid if inf is
+multiplied by zero, even when c is a quiet NaN.
+*/
+template <std::floating_point T>
+T fp_fused_multiply_add(T a, T b, T c, bool ties_away, uint32_t& flags)
+{
+	if ((std::isinf(a) && b == 0) || (a == 0 && std::isinf(b)))
+		flags |= Rv_fp_flags::invalid;
+
+	const T result = std::fma(a, b, c);
+	if (!ties_away)
+		return result;
+
+	return is_fused_tie(a, b, c, result) ? next_away_from_zero(result) : result;
+}
+
+}
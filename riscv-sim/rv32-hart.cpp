@@ -1,7 +1,23 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <stdexcept>
+#include <thread>
+#include <type_traits>
 #include <utility>
 
+#include "buffered-memory.h"
+#include "mapped-memory.h"
+#include "paged-memory.h"
+#include "radix-memory.h"
+#include "rv-float.h"
 #include "rv32.h"
 #include "rv32-hart.h"
 
@@ -15,35 +31,86 @@ raised.
 
 Unconditional branch instructions will generate an instruction-address-misaligned exception if the
 target address is not aligned to a four-byte boundary.
+
+With the C extension, targets only need to be aligned to a two-byte boundary. Branch offsets are even and JALR
+clears the lowest bit, so no target is misaligned then.
+
+The exception is raised as a trap and the executor returns before it changes any state.
 */
-#define throw_if_branch_target_misaligned(address) \
-if (( address ) % 4 != 0) \
-	throw runtime_error("instruction-address-misaligned");
+#define trap_if_branch_target_misaligned(address) \
+if ((( address ) & misaligned_target_mask) != 0) \
+{ \
+	raise_trap(Rv_trap_cause::instruction_address_misaligned); \
+	return; \
+}
 
 namespace riscv_sim {
 
-Rv32_hart::Rv32_hart(Memory& memory)
-	: memory(memory), registers()
+/** Gets the high 64 bits of the 128-bit product of two unsigned 64-bit values, from the products of their 32-bit halves. */
+static uint64_t multiply_high_unsigned(uint64_t a, uint64_t b)
 {
+	const uint64_t a_low = a & 0xFFFF'FFFF;
+	const uint64_t a_high = a >> 32;
+	const uint64_t b_low = b & 0xFFFF'FFFF;
+	const uint64_t b_high = b >> 32;
+
+	const uint64_t low_low = a_low * b_low;
+	const uint64_t high_low = a_high * b_low;
+	const uint64_t low_high = a_low * b_high;
+
+	// The sum of the bits that overlap in the middle carries into the high half
+	const uint64_t middle = (low_low >> 32) + (high_low & 0xFFFF'FFFF) + (low_high & 0xFFFF'FFFF);
+	return a_high * b_high + (high_low >> 32) + (low_high >> 32) + (middle >> 32);
 }
 
-// These types are function pointers to member methods that execute different types of instructions.
+template <unsigned Xlen, typename Memory_type>
+Basic_rv_hart<Xlen, Memory_type>::Basic_rv_hart(Memory_type& memory, Rv32_engine engine)
+	: memory(memory), registers(), fp_registers(), instruction_cache(instruction_cache_size), block_lookup(instruction_cache_size), engine(engine)
+{
+	// Without a JIT, the JIT engine runs everything with the interpreter. The JIT translates RV32 code only.
+	if constexpr (Xlen == 32)
+	{
+		if (engine == Rv32_engine::jit && c_rv32_jit_supported)
+		{
+			jit = make_unique<Rv32_jit>(get_jit_memory_access(memory), &stop_requested);
+			if (!jit->is_available())
+				jit.reset();
+		}
+	}
+
+	memory.attach_code_cache(*this);
+	memory.attach_watchpoint_listener(*this);
+}
 
-typedef void (Rv32_hart::* btype_executor)(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
-typedef void (Rv32_hart::* itype_executor)(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
-typedef void (Rv32_hart::* jtype_executor)(Rv_register_id rd, Rv_jtype_imm imm);
-typedef void (Rv32_hart::* rtype_executor)(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
-typedef void (Rv32_hart::* stype_executor)(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
-typedef void (Rv32_hart::* utype_executor)(Rv_register_id rd, Rv_utype_imm imm);
+template <unsigned Xlen, typename Memory_type>
+Basic_rv_hart<Xlen, Memory_type>::~Basic_rv_hart()
+{
+	release_reservation();
+	memory.detach_watchpoint_listener(*this);
+	memory.detach_code_cache(*this);
+}
 
 /** Defines the instruction format and a pointer to the member method that executes the instruction. */
+template <unsigned Xlen, typename Memory_type>
 struct Instruction_executor
 {
+	// These types are function pointers to member methods that execute different types of instructions.
+
+	using Hart = Basic_rv_hart<Xlen, Memory_type>;
+	typedef void (Hart::* btype_executor)(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
+	typedef void (Hart::* itype_executor)(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	typedef void (Hart::* jtype_executor)(Rv_register_id rd, Rv_jtype_imm imm);
+	typedef void (Hart::* rtype_executor)(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	typedef void (Hart::* r4type_executor)(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	typedef void (Hart::* stype_executor)(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
+	typedef void (Hart::* utype_executor)(Rv_register_id rd, Rv_utype_imm imm);
+
 	Instruction_executor(btype_executor btype) : execute_btype(btype), format(Rv32_instruction_format::btype), manages_pc(true) {}
 	Instruction_executor(itype_executor itype) : execute_itype(itype), format(Rv32_instruction_format::itype), manages_pc(false) {}
 	Instruction_executor(itype_executor itype, bool manages_pc) : execute_itype(itype), format(Rv32_instruction_format::itype), manages_pc(manages_pc)  {}
 	Instruction_executor(jtype_executor jtype) : execute_jtype(jtype), format(Rv32_instruction_format::jtype), manages_pc(true) {}
 	Instruction_executor(rtype_executor rtype) : execute_rtype(rtype), format(Rv32_instruction_format::rtype), manages_pc(false) {}
+	Instruction_executor(r4type_executor r4type) : execute_r4type(r4type), format(Rv32_instruction_format::r4type), manages_pc(false) {}
 	Instruction_executor(stype_executor stype) : execute_stype(stype), format(Rv32_instruction_format::stype), manages_pc(false) {}
 	Instruction_executor(utype_executor utype) : execute_utype(utype), format(Rv32_instruction_format::utype), manages_pc(false) {}
 
@@ -56,596 +123,3384 @@ struct Instruction_executor
 		itype_executor execute_itype;
 		jtype_executor execute_jtype;
 		rtype_executor execute_rtype;
+		r4type_executor execute_r4type;
 		stype_executor execute_stype;
 		utype_executor execute_utype;
 	};
 };
 
-/** Maps an instruction to the appropriate format and executor method. */
-static const map<Rv32i_instruction_type, Instruction_executor> instruction_executor_map = {
-
-	// B-type
-
-	{ Rv32i_instruction_type::beq, &Rv32_hart::execute_beq },
-	{ Rv32i_instruction_type::bge, &Rv32_hart::execute_bge },
-	{ Rv32i_instruction_type::bgeu, &Rv32_hart::execute_bgeu },
-	{ Rv32i_instruction_type::blt, &Rv32_hart::execute_blt },
-	{ Rv32i_instruction_type::bltu, &Rv32_hart::execute_bltu },
-	{ Rv32i_instruction_type::bne, &Rv32_hart::execute_bne },
-
-	// I-type - JALR
-
-	{ Rv32i_instruction_type::jalr, Instruction_executor(&Rv32_hart::execute_jalr, true) },
+/** Gets the map of an instruction to the appropriate format and executor method. */
+template <unsigned Xlen, typename Memory_type>
+static const map<Rv32i_instruction_type, Instruction_executor<Xlen, Memory_type>>& get_instruction_executor_map()
+{
+	using Hart = Basic_rv_hart<Xlen, Memory_type>;
+	using Executor = Instruction_executor<Xlen, Memory_type>;
 
-	// I-type - LOAD
+	static const map<Rv32i_instruction_type, Executor> instruction_executor_map = {
 
-	{ Rv32i_instruction_type::lb, &Rv32_hart::execute_lb },
-	{ Rv32i_instruction_type::lbu, &Rv32_hart::execute_lbu },
-	{ Rv32i_instruction_type::lh, &Rv32_hart::execute_lh },
-	{ Rv32i_instruction_type::lhu, &Rv32_hart::execute_lhu },
-	{ Rv32i_instruction_type::lw, &Rv32_hart::execute_lw },
+		// B-type
 
-	// I-type - MISC-MEM
+		{ Rv32i_instruction_type::beq, &Hart::execute_beq },
+		{ Rv32i_instruction_type::bge, &Hart::execute_bge },
+		{ Rv32i_instruction_type::bgeu, &Hart::execute_bgeu },
+		{ Rv32i_instruction_type::blt, &Hart::execute_blt },
+		{ Rv32i_instruction_type::bltu, &Hart::execute_bltu },
+		{ Rv32i_instruction_type::bne, &Hart::execute_bne },
 
-	{ Rv32i_instruction_type::fence, &Rv32_hart::execute_fence },
+		// I-type - JALR
 
-	// I-type - OP-IMM
+		{ Rv32i_instruction_type::jalr, Executor(&Hart::execute_jalr, true) },
 
-	{ Rv32i_instruction_type::addi, &Rv32_hart::execute_addi },
-	{ Rv32i_instruction_type::andi, &Rv32_hart::execute_andi },
-	{ Rv32i_instruction_type::ori, &Rv32_hart::execute_ori },
-	{ Rv32i_instruction_type::slli, &Rv32_hart::execute_slli },
-	{ Rv32i_instruction_type::slti, &Rv32_hart::execute_slti },
-	{ Rv32i_instruction_type::sltiu, &Rv32_hart::execute_sltiu },
-	{ Rv32i_instruction_type::srli, &Rv32_hart::execute_srli },
-	{ Rv32i_instruction_type::srai, &Rv32_hart::execute_srai },
-	{ Rv32i_instruction_type::xori, &Rv32_hart::execute_xori },
+		// I-type - LOAD
 
-	// I-type - SYSTEM
+		{ Rv32i_instruction_type::lb, &Hart::execute_lb },
+		{ Rv32i_instruction_type::lbu, &Hart::execute_lbu },
+		{ Rv32i_instruction_type::lh, &Hart::execute_lh },
+		{ Rv32i_instruction_type::lhu, &Hart::execute_lhu },
+		{ Rv32i_instruction_type::lw, &Hart::execute_lw },
+		{ Rv32i_instruction_type::lwu, &Hart::execute_lwu },
+		{ Rv32i_instruction_type::ld, &Hart::execute_ld },
+
+		// I-type - LOAD-FP
 
-	{ Rv32i_instruction_type::ebreak, &Rv32_hart::execute_ebreak },
-	{ Rv32i_instruction_type::ecall, &Rv32_hart::execute_ecall },
+		{ Rv32i_instruction_type::fld, &Hart::execute_fld },
+		{ Rv32i_instruction_type::flw, &Hart::execute_flw },
+
+		// I-type - MISC-MEM
+
+		{ Rv32i_instruction_type::fence, &Hart::execute_fence },
+
+		// I-type - OP-IMM
+
+		{ Rv32i_instruction_type::addi, &Hart::execute_addi },
+		{ Rv32i_instruction_type::andi, &Hart::execute_andi },
+		{ Rv32i_instruction_type::ori, &Hart::execute_ori },
+		{ Rv32i_instruction_type::slli, &Hart::execute_slli },
+		{ Rv32i_instruction_type::slti, &Hart::execute_slti },
+		{ Rv32i_instruction_type::sltiu, &Hart::execute_sltiu },
+		{ Rv32i_instruction_type::srli, &Hart::execute_srli },
+		{ Rv32i_instruction_type::srai, &Hart::execute_srai },
+		{ Rv32i_instruction_type::xori, &Hart::execute_xori },
+
+		// I-type - OP-IMM-32
+
+		{ Rv32i_instruction_type::addiw, &Hart::execute_addiw },
+		{ Rv32i_instruction_type::slliw, &Hart::execute_slliw },
+		{ Rv32i_instruction_type::srliw, &Hart::execute_srliw },
+		{ Rv32i_instruction_type::sraiw, &Hart::execute_sraiw },
+
+		// I-type - OP-IMM - Zbb and Zbs. rs2 holds the shift amount or selects the unary operation.
+
+		{ Rv32i_instruction_type::bclri, &Hart::execute_bclri },
+		{ Rv32i_instruction_type::bexti, &Hart::execute_bexti },
+		{ Rv32i_instruction_type::binvi, &Hart::execute_binvi },
+		{ Rv32i_instruction_type::bseti, &Hart::execute_bseti },
+		{ Rv32i_instruction_type::clz, &Hart::execute_clz },
+		{ Rv32i_instruction_type::cpop, &Hart::execute_cpop },
+		{ Rv32i_instruction_type::ctz, &Hart::execute_ctz },
+		{ Rv32i_instruction_type::orc_b, &Hart::execute_orc_b },
+		{ Rv32i_instruction_type::rev8, &Hart::execute_rev8 },
+		{ Rv32i_instruction_type::rori, &Hart::execute_rori },
+		{ Rv32i_instruction_type::sext_b, &Hart::execute_sext_b },
+		{ Rv32i_instruction_type::sext_h, &Hart::execute_sext_h },
+
+		// I-type - SYSTEM
+
+		// These always trap, which leaves PC unchanged
+
+		{ Rv32i_instruction_type::ebreak, Executor(&Hart::execute_ebreak, true) },
+		{ Rv32i_instruction_type::ecall, Executor(&Hart::execute_ecall, true) },
+
+		// I-type - SYSTEM - Zicsr
+
+		{ Rv32i_instruction_type::csrrc, &Hart::execute_csrrc },
+		{ Rv32i_instruction_type::csrrci, &Hart::execute_csrrci },
+		{ Rv32i_instruction_type::csrrs, &Hart::execute_csrrs },
+		{ Rv32i_instruction_type::csrrsi, &Hart::execute_csrrsi },
+		{ Rv32i_instruction_type::csrrw, &Hart::execute_csrrw },
+		{ Rv32i_instruction_type::csrrwi, &Hart::execute_csrrwi },
+
+		// J-type
+
+		{ Rv32i_instruction_type::jal, &Hart::execute_jal },
+
+		// R-type
+
+		{ Rv32i_instruction_type::add, &Hart::execute_add },
+		{ Rv32i_instruction_type::and_, &Hart::execute_and },
+		{ Rv32i_instruction_type::or_, &Hart::execute_or },
+		{ Rv32i_instruction_type::sub, &Hart::execute_sub },
+		{ Rv32i_instruction_type::sll, &Hart::execute_sll },
+		{ Rv32i_instruction_type::slt, &Hart::execute_slt },
+		{ Rv32i_instruction_type::sltu, &Hart::execute_sltu },
+		{ Rv32i_instruction_type::sra, &Hart::execute_sra },
+		{ Rv32i_instruction_type::srl, &Hart::execute_srl },
+		{ Rv32i_instruction_type::xor_, &Hart::execute_xor },
+
+		// R-type - M extension
+
+		{ Rv32i_instruction_type::mul, &Hart::execute_mul },
+		{ Rv32i_instruction_type::mulh, &Hart::execute_mulh },
+		{ Rv32i_instruction_type::mulhsu, &Hart::execute_mulhsu },
+		{ Rv32i_instruction_type::mulhu, &Hart::execute_mulhu },
+		{ Rv32i_instruction_type::div, &Hart::execute_div },
+		{ Rv32i_instruction_type::divu, &Hart::execute_divu },
+		{ Rv32i_instruction_type::rem, &Hart::execute_rem },
+		{ Rv32i_instruction_type::remu, &Hart::execute_remu },
+
+		// R-type - OP-32
+
+		{ Rv32i_instruction_type::addw, &Hart::execute_addw },
+		{ Rv32i_instruction_type::subw, &Hart::execute_subw },
+		{ Rv32i_instruction_type::sllw, &Hart::execute_sllw },
+		{ Rv32i_instruction_type::srlw, &Hart::execute_srlw },
+		{ Rv32i_instruction_type::sraw, &Hart::execute_sraw },
+		{ Rv32i_instruction_type::mulw, &Hart::execute_mulw },
+		{ Rv32i_instruction_type::divw, &Hart::execute_divw },
+		{ Rv32i_instruction_type::divuw, &Hart::execute_divuw },
+		{ Rv32i_instruction_type::remw, &Hart::execute_remw },
+		{ Rv32i_instruction_type::remuw, &Hart::execute_remuw },
+
+		// R-type - A extension
+
+		{ Rv32i_instruction_type::lr_w, &Hart::execute_lr_w },
+		{ Rv32i_instruction_type::sc_w, &Hart::execute_sc_w },
+		{ Rv32i_instruction_type::amoswap_w, &Hart::execute_amoswap_w },
+		{ Rv32i_instruction_type::amoadd_w, &Hart::execute_amoadd_w },
+		{ Rv32i_instruction_type::amoxor_w, &Hart::execute_amoxor_w },
+		{ Rv32i_instruction_type::amoand_w, &Hart::execute_amoand_w },
+		{ Rv32i_instruction_type::amoor_w, &Hart::execute_amoor_w },
+		{ Rv32i_instruction_type::amomin_w, &Hart::execute_amomin_w },
+		{ Rv32i_instruction_type::amomax_w, &Hart::execute_amomax_w },
+		{ Rv32i_instruction_type::amominu_w, &Hart::execute_amominu_w },
+		{ Rv32i_instruction_type::amomaxu_w, &Hart::execute_amomaxu_w },
+
+		// R-type - RV64A
+
+		{ Rv32i_instruction_type::lr_d, &Hart::execute_lr_d },
+		{ Rv32i_instruction_type::sc_d, &Hart::execute_sc_d },
+		{ Rv32i_instruction_type::amoswap_d, &Hart::execute_amoswap_d },
+		{ Rv32i_instruction_type::amoadd_d, &Hart::execute_amoadd_d },
+		{ Rv32i_instruction_type::amoxor_d, &Hart::execute_amoxor_d },
+		{ Rv32i_instruction_type::amoand_d, &Hart::execute_amoand_d },
+		{ Rv32i_instruction_type::amoor_d, &Hart::execute_amoor_d },
+		{ Rv32i_instruction_type::amomin_d, &Hart::execute_amomin_d },
+		{ Rv32i_instruction_type::amomax_d, &Hart::execute_amomax_d },
+		{ Rv32i_instruction_type::amominu_d, &Hart::execute_amominu_d },
+		{ Rv32i_instruction_type::amomaxu_d, &Hart::execute_amomaxu_d },
+
+		// R-type - Zba, Zbb and Zbs
+
+		{ Rv32i_instruction_type::sh1add, &Hart::execute_sh1add },
+		{ Rv32i_instruction_type::sh2add, &Hart::execute_sh2add },
+		{ Rv32i_instruction_type::sh3add, &Hart::execute_sh3add },
+		{ Rv32i_instruction_type::andn, &Hart::execute_andn },
+		{ Rv32i_instruction_type::orn, &Hart::execute_orn },
+		{ Rv32i_instruction_type::xnor, &Hart::execute_xnor },
+		{ Rv32i_instruction_type::max, &Hart::execute_max },
+		{ Rv32i_instruction_type::maxu, &Hart::execute_maxu },
+		{ Rv32i_instruction_type::min, &Hart::execute_min },
+		{ Rv32i_instruction_type::minu, &Hart::execute_minu },
+		{ Rv32i_instruction_type::rol, &Hart::execute_rol },
+		{ Rv32i_instruction_type::ror, &Hart::execute_ror },
+		{ Rv32i_instruction_type::zext_h, &Hart::execute_zext_h },
+		{ Rv32i_instruction_type::bclr, &Hart::execute_bclr },
+		{ Rv32i_instruction_type::bext, &Hart::execute_bext },
+		{ Rv32i_instruction_type::binv, &Hart::execute_binv },
+		{ Rv32i_instruction_type::bset, &Hart::execute_bset },
+
+		// R-type - F extension
+
+		{ Rv32i_instruction_type::fadd_s, &Hart::execute_fadd_s },
+		{ Rv32i_instruction_type::fsub_s, &Hart::execute_fsub_s },
+		{ Rv32i_instruction_type::fmul_s, &Hart::execute_fmul_s },
+		{ Rv32i_instruction_type::fdiv_s, &Hart::execute_fdiv_s },
+		{ Rv32i_instruction_type::fsqrt_s, &Hart::execute_fsqrt_s },
+		{ Rv32i_instruction_type::fsgnj_s, &Hart::execute_fsgnj_s },
+		{ Rv32i_instruction_type::fsgnjn_s, &Hart::execute_fsgnjn_s },
+		{ Rv32i_instruction_type::fsgnjx_s, &Hart::execute_fsgnjx_s },
+		{ Rv32i_instruction_type::fmin_s, &Hart::execute_fmin_s },
+		{ Rv32i_instruction_type::fmax_s, &Hart::execute_fmax_s },
+		{ Rv32i_instruction_type::feq_s, &Hart::execute_feq_s },
+		{ Rv32i_instruction_type::flt_s, &Hart::execute_flt_s },
+		{ Rv32i_instruction_type::fle_s, &Hart::execute_fle_s },
+		{ Rv32i_instruction_type::fclass_s, &Hart::execute_fclass_s },
+		{ Rv32i_instruction_type::fcvt_w_s, &Hart::execute_fcvt_w_s },
+		{ Rv32i_instruction_type::fcvt_wu_s, &Hart::execute_fcvt_wu_s },
+		{ Rv32i_instruction_type::fcvt_s_w, &Hart::execute_fcvt_s_w },
+		{ Rv32i_instruction_type::fcvt_s_wu, &Hart::execute_fcvt_s_wu },
+		{ Rv32i_instruction_type::fmv_x_w, &Hart::execute_fmv_x_w },
+		{ Rv32i_instruction_type::fmv_w_x, &Hart::execute_fmv_w_x },
+
+		// R-type - D extension
+
+		{ Rv32i_instruction_type::fadd_d, &Hart::execute_fadd_d },
+		{ Rv32i_instruction_type::fsub_d, &Hart::execute_fsub_d },
+		{ Rv32i_instruction_type::fmul_d, &Hart::execute_fmul_d },
+		{ Rv32i_instruction_type::fdiv_d, &Hart::execute_fdiv_d },
+		{ Rv32i_instruction_type::fsqrt_d, &Hart::execute_fsqrt_d },
+		{ Rv32i_instruction_type::fsgnj_d, &Hart::execute_fsgnj_d },
+		{ Rv32i_instruction_type::fsgnjn_d, &Hart::execute_fsgnjn_d },
+		{ Rv32i_instruction_type::fsgnjx_d, &Hart::execute_fsgnjx_d },
+		{ Rv32i_instruction_type::fmin_d, &Hart::execute_fmin_d },
+		{ Rv32i_instruction_type::fmax_d, &Hart::execute_fmax_d },
+		{ Rv32i_instruction_type::feq_d, &Hart::execute_feq_d },
+		{ Rv32i_instruction_type::flt_d, &Hart::execute_flt_d },
+		{ Rv32i_instruction_type::fle_d, &Hart::execute_fle_d },
+		{ Rv32i_instruction_type::fclass_d, &Hart::execute_fclass_d },
+		{ Rv32i_instruction_type::fcvt_w_d, &Hart::execute_fcvt_w_d },
+		{ Rv32i_instruction_type::fcvt_wu_d, &Hart::execute_fcvt_wu_d },
+		{ Rv32i_instruction_type::fcvt_d_w, &Hart::execute_fcvt_d_w },
+		{ Rv32i_instruction_type::fcvt_d_wu, &Hart::execute_fcvt_d_wu },
+		{ Rv32i_instruction_type::fcvt_s_d, &Hart::execute_fcvt_s_d },
+		{ Rv32i_instruction_type::fcvt_d_s, &Hart::execute_fcvt_d_s },
+
+		// R4-type - fused multiply-add
+
+		{ Rv32i_instruction_type::fmadd_s, &Hart::execute_fmadd_s },
+		{ Rv32i_instruction_type::fmsub_s, &Hart::execute_fmsub_s },
+		{ Rv32i_instruction_type::fnmsub_s, &Hart::execute_fnmsub_s },
+		{ Rv32i_instruction_type::fnmadd_s, &Hart::execute_fnmadd_s },
+		{ Rv32i_instruction_type::fmadd_d, &Hart::execute_fmadd_d },
+		{ Rv32i_instruction_type::fmsub_d, &Hart::execute_fmsub_d },
+		{ Rv32i_instruction_type::fnmsub_d, &Hart::execute_fnmsub_d },
+		{ Rv32i_instruction_type::fnmadd_d, &Hart::execute_fnmadd_d },
+
+		// S-type
+
+		{ Rv32i_instruction_type::sb, &Hart::execute_sb },
+		{ Rv32i_instruction_type::sh, &Hart::execute_sh },
+		{ Rv32i_instruction_type::sw, &Hart::execute_sw },
+		{ Rv32i_instruction_type::sd, &Hart::execute_sd },
+
+		// S-type - STORE-FP
+
+		{ Rv32i_instruction_type::fsd, &Hart::execute_fsd },
+		{ Rv32i_instruction_type::fsw, &Hart::execute_fsw },
+
+		// U-type
+
+		{ Rv32i_instruction_type::auipc, &Hart::execute_auipc },
+		{ Rv32i_instruction_type::lui, &Hart::execute_lui },
+	};
 
-	// J-type
+	return instruction_executor_map;
+}
 
-	{ Rv32i_instruction_type::jal, &Rv32_hart::execute_jal },
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::decode_operands(Rv32_instruction_format format, uint32_t instruction, Decoded_operands& operands)
+{
+	switch (format)
+	{
+	case Rv32_instruction_format::btype: construct_at(&operands.btype, Decoder::decode_btype(instruction)); break;
+	case Rv32_instruction_format::itype: construct_at(&operands.itype, Decoder::decode_itype(instruction)); break;
+	case Rv32_instruction_format::jtype: construct_at(&operands.jtype, Decoder::decode_jtype(instruction)); break;
+	case Rv32_instruction_format::rtype: construct_at(&operands.rtype, Decoder::decode_rtype(instruction)); break;
+	case Rv32_instruction_format::r4type: construct_at(&operands.r4type, Decoder::decode_r4type(instruction)); break;
+	case Rv32_instruction_format::stype: construct_at(&operands.stype, Decoder::decode_stype(instruction)); break;
+	case Rv32_instruction_format::utype: construct_at(&operands.utype, Decoder::decode_utype(instruction)); break;
+	default:
+		throw runtime_error("Not implemented.");
+	}
+}
 
-	// R-type
+template <unsigned Xlen, typename Memory_type>
+uint32_t Basic_rv_hart<Xlen, Memory_type>::fetch_instruction(Register address, uint8_t& length)
+{
+	const bool was_watching = watching;
+	watching = false;
 
-	{ Rv32i_instruction_type::add, &Rv32_hart::execute_add },
-	{ Rv32i_instruction_type::and_, &Rv32_hart::execute_and },
-	{ Rv32i_instruction_type::or_, &Rv32_hart::execute_or },
-	{ Rv32i_instruction_type::sub, &Rv32_hart::execute_sub },
-	{ Rv32i_instruction_type::sll, &Rv32_hart::execute_sll },
-	{ Rv32i_instruction_type::slt, &Rv32_hart::execute_slt },
-	{ Rv32i_instruction_type::sltu, &Rv32_hart::execute_sltu },
-	{ Rv32i_instruction_type::sra, &Rv32_hart::execute_sra },
-	{ Rv32i_instruction_type::srl, &Rv32_hart::execute_srl },
-	{ Rv32i_instruction_type::xor_, &Rv32_hart::execute_xor },
+	// A compressed instruction can be the last halfword of memory, so the second halfword is only read if needed.
+	// Only RV32 harts enable compressed instructions.
+	uint32_t inst;
+	if (!compressed_enabled)
+	{
+		inst = memory.read_32(address);
+		length = 4;
+	}
+	else if (const uint16_t low = memory.read_16(address); Rv32_decoder::is_compressed(low))
+	{
+		inst = Rv32_decoder::expand_compressed(low);
+		length = 2;
+	}
+	else
+	{
+		inst = low | (static_cast<uint32_t>(memory.read_16(address + 2)) << 16);
+		length = 4;
+	}
 
-	// S-type
+	watching = was_watching;
+	return inst;
+}
 
-	{ Rv32i_instruction_type::sb, &Rv32_hart::execute_sb },
-	{ Rv32i_instruction_type::sh, &Rv32_hart::execute_sh },
-	{ Rv32i_instruction_type::sw, &Rv32_hart::execute_sw },
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::fill_instruction_cache(Register address) -> const Cached_instruction*
+{
+	uint8_t length;
+	auto inst = fetch_instruction(address, length);
+	auto inst_type = Decoder::decode_instruction_type(inst);
+
+	// Instructions that decode but aren't implemented are illegal too
+	const auto& executor_map = get_instruction_executor_map<Xlen, Memory_type>();
+	const auto found = executor_map.find(inst_type);
+	if (found == executor_map.end())
+		return nullptr;
+
+	const auto& executor = found->second;
+	auto& entry = instruction_cache[(address >> 2) & (instruction_cache_size - 1)];
+	entry.type = Rv32i_instruction_type::invalid;
+	decode_operands(executor.format, inst, entry.decoded);
+
+	entry.pc = address;
+	entry.type = inst_type;
+	entry.length = length;
+	entry.executor = &executor;
+
+	// Writes to this page must now invalidate the entry
+	memory.mark_code_page(address);
+	memory.mark_code_page(address + length - 1);
+	return &entry;
+}
 
-	// U-type
+template <unsigned Xlen, typename Memory_type>
+Rv_trap_cause Basic_rv_hart<Xlen, Memory_type>::execute_next()
+{
+	// Single steps go through translated code too
+	if (jit)
+	{
+		const auto result = run(1);
+		return result.retired == 1 ? Rv_trap_cause::none : result.trap;
+	}
 
-	{ Rv32i_instruction_type::auipc, &Rv32_hart::execute_auipc },
-	{ Rv32i_instruction_type::lui, &Rv32_hart::execute_lui },
-};
+	trap = Rv_trap_cause::none;
+	clear_host_fp_flags();
 
-void Rv32_hart::execute_next()
-{
 	auto next_inst_addr = get_register(Rv_register_id::pc);
-	auto next_inst = memory.read_32(next_inst_addr);
-	auto next_inst_type = Rv32_decoder::decode_instruction_type(next_inst);
 
-	if (next_inst_type == Rv32i_instruction_type::invalid)
-		throw runtime_error("Invalid instruction.");
+	const Cached_instruction* cached = &instruction_cache[(next_inst_addr >> 2) & (instruction_cache_size - 1)];
+	if (cached->pc != next_inst_addr || cached->type == Rv32i_instruction_type::invalid) [[unlikely]]
+	{
+		cached = fill_instruction_cache(next_inst_addr);
+		if (!cached)
+			return Rv_trap_cause::illegal_instruction;
+	}
 
-	if (!instruction_executor_map.contains(next_inst_type))
-		throw runtime_error("Not implemented.");
+	// Copy the entry out. A store executed by the instruction can invalidate it.
+	const auto& executor = *cached->executor;
+	const auto decoded = cached->decoded;
+	const auto length = cached->length;
+	instruction_length = length;
 
-	auto& executor = instruction_executor_map.at(next_inst_type);
 	switch (executor.format)
 	{
 	case Rv32_instruction_format::btype:
-	{
-		auto btype = Rv32_decoder::decode_btype(next_inst);
-		(*this.*(executor.execute_btype))(btype.rs1, btype.rs2, btype.imm);
+		(*this.*(executor.execute_btype))(decoded.btype.rs1, decoded.btype.rs2, decoded.btype.imm);
 		break;
-	}
 
 	case Rv32_instruction_format::itype:
-	{
-		auto itype = Rv32_decoder::decode_itype(next_inst);
-		(*this.*(executor.execute_itype))(itype.rd, itype.rs1, itype.imm);
+		(*this.*(executor.execute_itype))(decoded.itype.rd, decoded.itype.rs1, decoded.itype.imm);
 		break;
-	}
 	
 	case Rv32_instruction_format::jtype:
-	{
-		auto jtype = Rv32_decoder::decode_jtype(next_inst);
-		(*this.*(executor.execute_jtype))(jtype.rd, jtype.imm);
+		(*this.*(executor.execute_jtype))(decoded.jtype.rd, decoded.jtype.imm);
 		break;
-	}
 
 	case Rv32_instruction_format::rtype:
-	{
-		auto rtype = Rv32_decoder::decode_rtype(next_inst);
-		(*this.*(executor.execute_rtype))(rtype.rd, rtype.rs1, rtype.rs2);
+		rounding_mode = Rv_rounding_mode(decoded.rtype.funct3);
+		(*this.*(executor.execute_rtype))(decoded.rtype.rd, decoded.rtype.rs1, decoded.rtype.rs2);
+		break;
+
+	case Rv32_instruction_format::r4type:
+		rounding_mode = Rv_rounding_mode(decoded.r4type.funct3);
+		(*this.*(executor.execute_r4type))(decoded.r4type.rd, decoded.r4type.rs1, decoded.r4type.rs2, decoded.r4type.rs3);
 		break;
-	}
 
 	case Rv32_instruction_format::stype:
-	{
-		auto stype = Rv32_decoder::decode_stype(next_inst);
-		(*this.*(executor.execute_stype))(stype.rs1, stype.rs2, stype.imm);
+		(*this.*(executor.execute_stype))(decoded.stype.rs1, decoded.stype.rs2, decoded.stype.imm);
 		break;
-	}
 
 	case Rv32_instruction_format::utype:
-	{
-		auto utype = Rv32_decoder::decode_utype(next_inst);
-		(*this.*(executor.execute_utype))(utype.rd, utype.imm);
+		(*this.*(executor.execute_utype))(decoded.utype.rd, decoded.utype.imm);
 		break;
-	}
 
 	default:
 		throw runtime_error("Not implemented.");
 	}
 
+	fflags |= get_host_fp_flags();
+
+	if (trap != Rv_trap_cause::none) [[unlikely]]
+		return trap;
+
 	// Certain instructions (i.e., branches) handle updating the PC register manually.
 	// If the executor doesn't manage the PC, auto-increment it here
 	if (!executor.manages_pc)
-		set_register(Rv_register_id::pc, get_register(Rv_register_id::pc) + 4);
-}
+		set_register(Rv_register_id::pc, get_register(Rv_register_id::pc) + length);
 
-void Rv32_hart::execute_add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
-{
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	set_register(rd, rs1_val + rs2_val);
+	++retired;
+	return Rv_trap_cause::none;
 }
 
-void Rv32_hart::execute_addi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
-{
-	int32_t source = get_register(rs1);
-	int32_t immediate = imm.get_signed();
-	set_register(rd, source + immediate);
-}
+/*
+Basic block interpreter
 
-void Rv32_hart::execute_and(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
-{
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	set_register(rd, rs1_val & rs2_val);
-}
+Instructions are translated into basic blocks of pre-decoded operands and each block is run with threaded
+dispatch: every handler executes its instruction and then dispatches the next one itself, so every instruction
+type gets its own indirect branch and the host branch predictor can learn common sequences. Handlers call the
+execute_* methods, which are inlined here, so the semantics are shared with execute_next.
 
-void Rv32_hart::execute_andi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
-{
-	int32_t source = get_register(rs1);
-	int32_t immediate = imm.get_signed();
-	set_register(rd, source & immediate);
-}
+When a block ends, the block that execution continues with is remembered in the block's links. Loops and other
+direct control flow go from block to block without looking up the next block.
 
-void Rv32_hart::execute_auipc(Rv_register_id rd, Rv_utype_imm imm)
-{
-	uint32_t pc = get_register(Rv_register_id::pc);
-	set_register(rd, pc + imm.get_decoded());
-}
+GCC and Clang dispatch with computed goto through a table of label addresses. Other compilers fall back
+to a switch in a loop.
+*/
+
+#if defined(__GNUC__)
+#define RV_COMPUTED_GOTO 1
+#else
+#define RV_COMPUTED_GOTO 0
+#endif
 
-void Rv32_hart::execute_beq(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+Rv_run_result Basic_rv_hart<Xlen, Memory_type>::run(uint64_t max_instructions)
 {
-	uint32_t pc = get_register(Rv_register_id::pc);
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	
-	if (rs1_val == rs2_val)
-	{
-		pc = pc + imm.get_offset();
-		throw_if_branch_target_misaligned(pc);
-	}
-	else
+	free_retired_blocks();
+	trap = Rv_trap_cause::none;
+	watchpoint_hit.reset();
+
+	// Floating-point flags are accrued by the host while the run executes
+	clear_host_fp_flags();
+
 	{
-		pc += 4;
+		const auto lock = lock_guard(remote_mutex);
+		running_thread.store(this_thread::get_id(), memory_order_relaxed);
 	}
 
-	set_register(Rv_register_id::pc, pc);
-}
+	// Hits on watchpoints stop the run from here on
+	watching = true;
 
-void Rv32_hart::execute_bge(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
-{
-	uint32_t pc = get_register(Rv_register_id::pc);
-	
-	// Signed comparison
-	int32_t rs1_val = get_register(rs1);
-	int32_t rs2_val = get_register(rs2);
+	// The edge into where the run starts. Runs that follow a trap or the end of the budget take the edge that ended
+	// the last run here.
+	if (coverage_map) [[unlikely]]
+		count_coverage_edge(get_register(Rv_register_id::pc));
 
-	if (rs1_val >= rs2_val)
+	Rv_run_result result;
+	for (;;)
 	{
-		pc = pc + imm.get_offset();
-		throw_if_branch_target_misaligned(pc);
+		const auto remaining = max_instructions - result.retired;
+		Rv_run_result part;
+		if constexpr (Xlen == 32)
+			part = jit ? run_jit(remaining) : run_interpreter(remaining);
+		else
+			part = run_interpreter(remaining);
+
+		retired += part.retired;
+		retired_in_run = 0;
+		result = { result.retired + part.retired, part.reason, part.trap };
+
+		// Stops for code written by other threads continue once the code is discarded
+		if (part.reason != Rv_stop_reason::halted || watchpoint_hit || !apply_remote_invalidations()
+			|| result.retired == max_instructions)
+		{
+			break;
+		}
+
+		// A run only steps over a breakpoint it starts at
+		if (!breakpoint_pages.empty() && has_breakpoint(get_register(Rv_register_id::pc)))
+		{
+			result.reason = Rv_stop_reason::breakpoint;
+			break;
+		}
+
+		free_retired_blocks();
 	}
-	else
+	watching = false;
+
 	{
-		pc += 4;
+		const auto lock = lock_guard(remote_mutex);
+		running_thread.store({}, memory_order_relaxed);
 	}
+	apply_remote_invalidations();
+	fflags |= get_host_fp_flags();
 
-	set_register(Rv_register_id::pc, pc);
-}
-
-void Rv32_hart::execute_bgeu(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
-{
-	uint32_t pc = get_register(Rv_register_id::pc);
-
-	// Unsigned comparison
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
+	// A hit on the last instruction of the budget stops the run too
+	if (watchpoint_hit && result.reason != Rv_stop_reason::trap)
+		result.reason = Rv_stop_reason::watchpoint;
 
-	if (rs1_val >= rs2_val)
-	{
-		pc = pc + imm.get_offset();
-		throw_if_branch_target_misaligned(pc);
-	}
-	else
+	if (result.reason == Rv_stop_reason::halted || result.reason == Rv_stop_reason::watchpoint)
 	{
-		pc += 4;
+		halt_requested.store(false);
+		stop_requested.store(false);
 	}
 
-	set_register(Rv_register_id::pc, pc);
+	return result;
 }
 
-void Rv32_hart::execute_blt(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::request_halt()
 {
-	uint32_t pc = get_register(Rv_register_id::pc);
+	// Sequentially consistent with apply_remote_invalidations, so a halt is never lost when both clear the stop
+	halt_requested.store(true);
+	stop_requested.store(true);
+}
 
-	// Signed comparison
-	int32_t rs1_val = get_register(rs1);
-	int32_t rs2_val = get_register(rs2);
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::clear_halt_request()
+{
+	halt_requested.store(false);
+	stop_requested.store(false);
+}
 
-	if (rs1_val < rs2_val)
-	{
-		pc = pc + imm.get_offset();
-		throw_if_branch_target_misaligned(pc);
-	}
-	else
-	{
-		pc += 4;
-	}
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::add_breakpoint(Register address)
+{
+	constexpr uint32_t page_mask = (1 << Memory_type::code_page_bits) - 1;
+	const uint64_t page = address >> Memory_type::code_page_bits;
+	auto& breakpoints = breakpoint_pages[page];
+	if (breakpoints.test(address & page_mask))
+		return;
 
-	set_register(Rv_register_id::pc, pc);
+	// Blocks that run over the address must be split
+	breakpoints.set(address & page_mask);
+	invalidate_code_page(page);
 }
 
-void Rv32_hart::execute_bltu(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::remove_breakpoint(Register address)
 {
-	uint32_t pc = get_register(Rv_register_id::pc);
+	constexpr uint32_t page_mask = (1 << Memory_type::code_page_bits) - 1;
+	const uint64_t page = address >> Memory_type::code_page_bits;
+	const auto it = breakpoint_pages.find(page);
+	if (it == breakpoint_pages.end() || !it->second.test(address & page_mask))
+		return;
 
-	// Unsigned comparison
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
+	it->second.reset(address & page_mask);
+	if (it->second.none())
+		breakpoint_pages.erase(it);
 
-	if (rs1_val < rs2_val)
-	{
-		pc = pc + imm.get_offset();
-		throw_if_branch_target_misaligned(pc);
-	}
-	else
-	{
-		pc += 4;
-	}
+	// Blocks starting at the address are flagged
+	invalidate_code_page(page);
+}
 
-	set_register(Rv_register_id::pc, pc);
+template <unsigned Xlen, typename Memory_type>
+bool Basic_rv_hart<Xlen, Memory_type>::has_breakpoint(Register address) const
+{
+	constexpr uint32_t page_mask = (1 << Memory_type::code_page_bits) - 1;
+	const auto breakpoints = find_breakpoint_page(address >> Memory_type::code_page_bits);
+	return breakpoints && breakpoints->test(address & page_mask);
 }
 
-void Rv32_hart::execute_bne(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+optional<Watchpoint_hit> Basic_rv_hart<Xlen, Memory_type>::get_watchpoint_hit() const
 {
-	uint32_t pc = get_register(Rv_register_id::pc);
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
+	return watchpoint_hit;
+}
 
-	if (rs1_val != rs2_val)
-	{
-		pc = pc + imm.get_offset();
-		throw_if_branch_target_misaligned(pc);
-	}
-	else
-	{
-		pc += 4;
-	}
+template <unsigned Xlen, typename Memory_type>
+Rv32_engine Basic_rv_hart<Xlen, Memory_type>::get_engine() const
+{
+	return engine;
+}
 
-	set_register(Rv_register_id::pc, pc);
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_jit_threshold(uint32_t executions)
+{
+	jit_threshold = executions;
 }
 
-void Rv32_hart::execute_ebreak(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_hart_id(Register id)
 {
-	throw Rv_ebreak_exception();
+	hart_id = id;
 }
 
-void Rv32_hart::execute_ecall(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::get_hart_id() const -> Register
 {
-	throw Rv_ecall_exception();
+	return hart_id;
 }
 
-void Rv32_hart::execute_fence(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_stop_before_atomics(bool stop)
 {
-	// FENCE is a NOP in this implementation.
-	return;
+	stop_before_atomics = stop;
 }
 
-void Rv32_hart::execute_jal(Rv_register_id rd, Rv_jtype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_virtual_time(uint32_t instructions_per_microsecond)
 {
-	const auto pc = get_register(Rv_register_id::pc);
-	uint32_t new_pc = pc + imm.get_offset();
-	
-	// Target must be 4-byte aligned
-	throw_if_branch_target_misaligned(new_pc);
+	this->instructions_per_microsecond = instructions_per_microsecond;
+}
 
-	// PC is set to the jump target (PC + Offset)
-	set_register(Rv_register_id::pc, new_pc);
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_coverage_map(uint8_t* map)
+{
+	if (map == coverage_map)
+		return;
 
-	// RD is set to instruction after the jump instruction (PC + 4)
-	set_register(rd, pc + 4);
+	coverage_map = map;
+
+	// Translated loops count their edges themselves
+	invalidate_all_code();
+	if (jit)
+		jit->set_coverage_map(map);
 }
 
-void Rv32_hart::execute_jalr(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::reset_coverage_location()
 {
-	// Target address is obtained by adding the sign-extended 12-bit I-immediate to rs1,
-	// then setting the least-significant bit of the result to zero.
-	
-	const auto pc = get_register(Rv_register_id::pc);
-	const uint32_t rs1_val = get_register(rs1);
-	const int32_t offset = imm.get_signed();
-	uint32_t new_pc = rs1_val + offset;
+	coverage_location = 0;
+}
 
-	// Set least-significant bit to zero
-	new_pc &= static_cast<uint32_t>(~1);
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_compressed_enabled(bool enabled) requires (Xlen == 32)
+{
+	if (enabled == compressed_enabled)
+		return;
 
-	// Target must be 4-byte aligned
-	throw_if_branch_target_misaligned(new_pc);
+	compressed_enabled = enabled;
+	misaligned_target_mask = enabled ? 0b1 : 0b11;
 
-	set_register(Rv_register_id::pc, new_pc);
+	// The same memory decodes differently now
+	invalidate_all_code();
+	if (jit)
+		jit->set_target_alignment(enabled ? 2 : 4);
+}
 
-	// RD is set to instruction after the jump instruction (PC + 4)
-	set_register(rd, pc + 4);
+template <unsigned Xlen, typename Memory_type>
+bool Basic_rv_hart<Xlen, Memory_type>::is_compressed_enabled() const
+{
+	return compressed_enabled;
 }
 
-void Rv32_hart::execute_lb(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+Rv_run_result Basic_rv_hart<Xlen, Memory_type>::run_interpreter(uint64_t max_instructions, uint64_t retired_before)
 {
-	uint32_t rs1_val = get_register(rs1);
-	int32_t offset = imm.get_signed();
-	uint32_t address = rs1_val + offset;
-	uint32_t mem = memory.read_8(address);
+	using enum Rv32i_instruction_type;
+
+	if (max_instructions == 0)
+		return {};
+
+	uint64_t count = 0;
+	Basic_block* block = find_block(get_register(Rv_register_id::pc));
+	if (block->instruction_count == 0)
+		return { 0, Rv_stop_reason::trap, Rv_trap_cause::illegal_instruction };
+
+	const Block_instruction* inst = block->instructions.data();
+
+#if RV_COMPUTED_GOTO
+
+	// Label addresses are constant, so the table is only built on the first call
+#define RV_LABELS(X) \
+	X(auipc) X(jal) X(jalr) X(lui) \
+	X(beq) X(bne) X(blt) X(bltu) X(bge) X(bgeu) \
+	X(lb) X(lh) X(lw) X(lbu) X(lhu) X(lwu) X(ld) \
+	X(sb) X(sh) X(sw) X(sd) \
+	X(addi) X(andi) X(ori) X(xori) X(slti) X(sltiu) \
+	X(slli) X(srli) X(srai) \
+	X(add) X(sub) X(sll) X(slt) X(sltu) X(xor_) \
+	X(srl) X(sra) X(or_) X(and_) \
+	X(mul) X(mulh) X(mulhsu) X(mulhu) X(div) X(divu) X(rem) X(remu) \
+	X(addiw) X(slliw) X(srliw) X(sraiw) \
+	X(addw) X(subw) X(sllw) X(srlw) X(sraw) \
+	X(mulw) X(divw) X(divuw) X(remw) X(remuw) \
+	X(lr_w) X(sc_w) X(amoswap_w) X(amoadd_w) X(amoxor_w) X(amoand_w) \
+	X(amoor_w) X(amomin_w) X(amomax_w) X(amominu_w) X(amomaxu_w) \
+	X(lr_d) X(sc_d) X(amoswap_d) X(amoadd_d) X(amoxor_d) X(amoand_d) \
+	X(amoor_d) X(amomin_d) X(amomax_d) X(amominu_d) X(amomaxu_d) \
+	X(sh1add) X(sh2add) X(sh3add) X(andn) X(orn) X(xnor) \
+	X(clz) X(ctz) X(cpop) X(max) X(maxu) X(min) X(minu) \
+	X(sext_b) X(sext_h) X(zext_h) X(rol) X(ror) X(rori) X(orc_b) X(rev8) \
+	X(bclr) X(bclri) X(bext) X(bexti) X(binv) X(binvi) X(bset) X(bseti) \
+	X(fence) X(ecall) X(ebreak) \
+	X(csrrw) X(csrrs) X(csrrc) X(csrrwi) X(csrrsi) X(csrrci) \
+	X(flw) X(fsw) X(fld) X(fsd) \
+	X(fmadd_s) X(fmsub_s) X(fnmsub_s) X(fnmadd_s) \
+	X(fadd_s) X(fsub_s) X(fmul_s) X(fdiv_s) X(fsqrt_s) \
+	X(fsgnj_s) X(fsgnjn_s) X(fsgnjx_s) X(fmin_s) X(fmax_s) \
+	X(fcvt_w_s) X(fcvt_wu_s) X(fmv_x_w) X(feq_s) X(flt_s) X(fle_s) \
+	X(fclass_s) X(fcvt_s_w) X(fcvt_s_wu) X(fmv_w_x) \
+	X(fmadd_d) X(fmsub_d) X(fnmsub_d) X(fnmadd_d) \
+	X(fadd_d) X(fsub_d) X(fmul_d) X(fdiv_d) X(fsqrt_d) \
+	X(fsgnj_d) X(fsgnjn_d) X(fsgnjx_d) X(fmin_d) X(fmax_d) \
+	X(fcvt_s_d) X(fcvt_d_s) X(feq_d) X(flt_d) X(fle_d) \
+	X(fclass_d) X(fcvt_w_d) X(fcvt_wu_d) X(fcvt_d_w) X(fcvt_d_wu)
+
+#define RV_TYPE(type) type,
+#define RV_ADDRESS(type) &&op_##type,
+	static constexpr Rv32i_instruction_type label_types[] = { RV_LABELS(RV_TYPE) };
+	static const void* const label_addresses[] = { RV_LABELS(RV_ADDRESS) };
+	static const void* const invalid_address = &&op_invalid;
+#undef RV_ADDRESS
+#undef RV_TYPE
+#undef RV_LABELS
+
+	static const auto dispatch_table = [] {
+		auto table = array<const void*, to_underlying(_count)>();
+		table.fill(invalid_address);
+		for (size_t i = 0; i < size(label_types); ++i)
+			table[to_underlying(label_types[i])] = label_addresses[i];
+
+		return table;
+	}();
+
+#define RV_OP(type) op_##type:
+#define RV_DISPATCH() goto *dispatch_table[to_underlying(inst->type)]
+
+	RV_DISPATCH();
+	{
 
-	// Sign extend
-	if (mem & 0b1000'0000)
-		mem |= (-1 << 8);
+#else
 
-	set_register(rd, mem);
+#define RV_OP(type) case type:
+#define RV_DISPATCH() continue
+
+	for (;;)
+	{
+		switch (inst->type)
+		{
+
+#endif
+
+		// Counts an executed instruction and returns if the limit has been reached
+#define RV_RETIRE() \
+	if (++count == max_instructions) \
+		return { count };
+
+		// Continues with the next instruction in the block
+#define RV_NEXT() \
+	set_register(Rv_register_id::pc, get_register(Rv_register_id::pc) + inst->length); \
+	RV_RETIRE() \
+	++inst; \
+	RV_DISPATCH();
+
+		// Loads that hit a watchpoint stop the run right after them, at the block boundary its stop request polls
+#define RV_NEXT_AFTER_LOAD() \
+	set_register(Rv_register_id::pc, get_register(Rv_register_id::pc) + inst->length); \
+	RV_RETIRE() \
+	if (watchpoint_hit) [[unlikely]] \
+		goto next_block; \
+	++inst; \
+	RV_DISPATCH();
+
+		// Stores can overwrite the rest of the running block. Continue from a freshly translated block if they did.
+		// Stores that hit a watchpoint stop the run like loads.
+#define RV_NEXT_AFTER_STORE() \
+	set_register(Rv_register_id::pc, get_register(Rv_register_id::pc) + inst->length); \
+	RV_RETIRE() \
+	if (!block->valid || watchpoint_hit) [[unlikely]] \
+		goto next_block; \
+	++inst; \
+	RV_DISPATCH();
+
+		// Control transfer and system instructions set the PC themselves and end the block. Only they, CSR
+		// instructions, floating-point instructions that round and atomics can trap.
+#define RV_END_BLOCK() \
+	if (trap != Rv_trap_cause::none) [[unlikely]] \
+		return { count, Rv_stop_reason::trap, trap }; \
+	RV_RETIRE() \
+	goto next_block;
+
+#define RV_BTYPE(type, name) RV_OP(type) { const auto& d = inst->decoded.btype; instruction_length = inst->length; execute_##name(d.rs1, d.rs2, d.imm); } RV_END_BLOCK()
+#define RV_ITYPE(type, name) RV_OP(type) { const auto& d = inst->decoded.itype; execute_##name(d.rd, d.rs1, d.imm); } RV_NEXT()
+#define RV_RTYPE(type, name) RV_OP(type) { const auto& d = inst->decoded.rtype; execute_##name(d.rd, d.rs1, d.rs2); } RV_NEXT()
+#define RV_LOAD(type, name) RV_OP(type) { const auto& d = inst->decoded.itype; execute_##name(d.rd, d.rs1, d.imm); } RV_NEXT_AFTER_LOAD()
+#define RV_STYPE(type, name) RV_OP(type) { const auto& d = inst->decoded.stype; execute_##name(d.rs1, d.rs2, d.imm); } RV_NEXT_AFTER_STORE()
+#define RV_UTYPE(type, name) RV_OP(type) { const auto& d = inst->decoded.utype; execute_##name(d.rd, d.imm); } RV_NEXT()
+
+		// Atomics trap on misaligned addresses and can overwrite the rest of the running block like stores.
+		// Schedulers can have them stop the run first.
+#define RV_ATOMIC(type) RV_OP(type) { \
+		if (stop_before_atomics) [[unlikely]] \
+			return { count, Rv_stop_reason::atomic }; \
+		const auto& d = inst->decoded.rtype; \
+		execute_##type(d.rd, d.rs1, d.rs2); \
+		if (trap != Rv_trap_cause::none) [[unlikely]] \
+			return { count, Rv_stop_reason::trap, trap }; \
+	} RV_NEXT_AFTER_STORE()
+
+		// CSR instructions can read the counters, which include the instructions retired so far
+#define RV_CSR(type) RV_OP(type) { \
+		const auto& d = inst->decoded.itype; \
+		retired_in_run = retired_before + count; \
+		execute_##type(d.rd, d.rs1, d.imm); \
+		if (trap != Rv_trap_cause::none) [[unlikely]] \
+			return { count, Rv_stop_reason::trap, trap }; \
+	} RV_NEXT()
+
+		// Floating-point instructions that round get the rounding mode field and trap if the dynamic mode is invalid
+#define RV_FP_ROUNDED(type) RV_OP(type) { \
+		const auto& d = inst->decoded.rtype; \
+		rounding_mode = Rv_rounding_mode(d.funct3); \
+		execute_##type(d.rd, d.rs1, d.rs2); \
+		if (trap != Rv_trap_cause::none) [[unlikely]] \
+			return { count, Rv_stop_reason::trap, trap }; \
+	} RV_NEXT()
+
+#define RV_FP_FUSED(type) RV_OP(type) { \
+		const auto& d = inst->decoded.r4type; \
+		rounding_mode = Rv_rounding_mode(d.funct3); \
+		execute_##type(d.rd, d.rs1, d.rs2, d.rs3); \
+		if (trap != Rv_trap_cause::none) [[unlikely]] \
+			return { count, Rv_stop_reason::trap, trap }; \
+	} RV_NEXT()
+
+		RV_BTYPE(beq, beq)
+		RV_BTYPE(bne, bne)
+		RV_BTYPE(blt, blt)
+		RV_BTYPE(bltu, bltu)
+		RV_BTYPE(bge, bge)
+		RV_BTYPE(bgeu, bgeu)
+
+		RV_OP(jal) { const auto& d = inst->decoded.jtype; instruction_length = inst->length; execute_jal(d.rd, d.imm); } RV_END_BLOCK()
+		RV_OP(jalr) { const auto& d = inst->decoded.itype; instruction_length = inst->length; execute_jalr(d.rd, d.rs1, d.imm); } RV_END_BLOCK()
+
+		RV_LOAD(lb, lb)
+		RV_LOAD(lh, lh)
+		RV_LOAD(lw, lw)
+		RV_LOAD(lbu, lbu)
+		RV_LOAD(lhu, lhu)
+		RV_LOAD(lwu, lwu)
+		RV_LOAD(ld, ld)
+
+		RV_STYPE(sb, sb)
+		RV_STYPE(sh, sh)
+		RV_STYPE(sw, sw)
+		RV_STYPE(sd, sd)
+
+		RV_ITYPE(addi, addi)
+		RV_ITYPE(andi, andi)
+		RV_ITYPE(ori, ori)
+		RV_ITYPE(xori, xori)
+		RV_ITYPE(slti, slti)
+		RV_ITYPE(sltiu, sltiu)
+		RV_ITYPE(slli, slli)
+		RV_ITYPE(srli, srli)
+		RV_ITYPE(srai, srai)
+
+		RV_RTYPE(add, add)
+		RV_RTYPE(sub, sub)
+		RV_RTYPE(sll, sll)
+		RV_RTYPE(slt, slt)
+		RV_RTYPE(sltu, sltu)
+		RV_RTYPE(xor_, xor)
+		RV_RTYPE(srl, srl)
+		RV_RTYPE(sra, sra)
+		RV_RTYPE(or_, or)
+		RV_RTYPE(and_, and)
+
+		RV_RTYPE(mul, mul)
+		RV_RTYPE(mulh, mulh)
+		RV_RTYPE(mulhsu, mulhsu)
+		RV_RTYPE(mulhu, mulhu)
+		RV_RTYPE(div, div)
+		RV_RTYPE(divu, divu)
+		RV_RTYPE(rem, rem)
+		RV_RTYPE(remu, remu)
+
+		RV_ITYPE(addiw, addiw)
+		RV_ITYPE(slliw, slliw)
+		RV_ITYPE(srliw, srliw)
+		RV_ITYPE(sraiw, sraiw)
+		RV_RTYPE(addw, addw)
+		RV_RTYPE(subw, subw)
+		RV_RTYPE(sllw, sllw)
+		RV_RTYPE(srlw, srlw)
+		RV_RTYPE(sraw, sraw)
+		RV_RTYPE(mulw, mulw)
+		RV_RTYPE(divw, divw)
+		RV_RTYPE(divuw, divuw)
+		RV_RTYPE(remw, remw)
+		RV_RTYPE(remuw, remuw)
+
+		RV_ATOMIC(lr_w)
+		RV_ATOMIC(sc_w)
+		RV_ATOMIC(amoswap_w)
+		RV_ATOMIC(amoadd_w)
+		RV_ATOMIC(amoxor_w)
+		RV_ATOMIC(amoand_w)
+		RV_ATOMIC(amoor_w)
+		RV_ATOMIC(amomin_w)
+		RV_ATOMIC(amomax_w)
+		RV_ATOMIC(amominu_w)
+		RV_ATOMIC(amomaxu_w)
+		RV_ATOMIC(lr_d)
+		RV_ATOMIC(sc_d)
+		RV_ATOMIC(amoswap_d)
+		RV_ATOMIC(amoadd_d)
+		RV_ATOMIC(amoxor_d)
+		RV_ATOMIC(amoand_d)
+		RV_ATOMIC(amoor_d)
+		RV_ATOMIC(amomin_d)
+		RV_ATOMIC(amomax_d)
+		RV_ATOMIC(amominu_d)
+		RV_ATOMIC(amomaxu_d)
+
+		RV_RTYPE(sh1add, sh1add)
+		RV_RTYPE(sh2add, sh2add)
+		RV_RTYPE(sh3add, sh3add)
+		RV_RTYPE(andn, andn)
+		RV_RTYPE(orn, orn)
+		RV_RTYPE(xnor, xnor)
+		RV_ITYPE(clz, clz)
+		RV_ITYPE(ctz, ctz)
+		RV_ITYPE(cpop, cpop)
+		RV_RTYPE(max, max)
+		RV_RTYPE(maxu, maxu)
+		RV_RTYPE(min, min)
+		RV_RTYPE(minu, minu)
+		RV_ITYPE(sext_b, sext_b)
+		RV_ITYPE(sext_h, sext_h)
+		RV_RTYPE(zext_h, zext_h)
+		RV_RTYPE(rol, rol)
+		RV_RTYPE(ror, ror)
+		RV_ITYPE(rori, rori)
+		RV_ITYPE(orc_b, orc_b)
+		RV_ITYPE(rev8, rev8)
+		RV_RTYPE(bclr, bclr)
+		RV_ITYPE(bclri, bclri)
+		RV_RTYPE(bext, bext)
+		RV_ITYPE(bexti, bexti)
+		RV_RTYPE(binv, binv)
+		RV_ITYPE(binvi, binvi)
+		RV_RTYPE(bset, bset)
+		RV_ITYPE(bseti, bseti)
+
+		RV_UTYPE(auipc, auipc)
+		RV_UTYPE(lui, lui)
+
+		RV_ITYPE(fence, fence)
+
+		RV_OP(ecall) { const auto& d = inst->decoded.itype; execute_ecall(d.rd, d.rs1, d.imm); } RV_END_BLOCK()
+		RV_OP(ebreak) { const auto& d = inst->decoded.itype; execute_ebreak(d.rd, d.rs1, d.imm); } RV_END_BLOCK()
+
+		RV_CSR(csrrw)
+		RV_CSR(csrrs)
+		RV_CSR(csrrc)
+		RV_CSR(csrrwi)
+		RV_CSR(csrrsi)
+		RV_CSR(csrrci)
+
+		RV_LOAD(flw, flw)
+		RV_LOAD(fld, fld)
+		RV_STYPE(fsw, fsw)
+		RV_STYPE(fsd, fsd)
+
+		RV_FP_FUSED(fmadd_s)
+		RV_FP_FUSED(fmsub_s)
+		RV_FP_FUSED(fnmsub_s)
+		RV_FP_FUSED(fnmadd_s)
+
+		RV_FP_ROUNDED(fadd_s)
+		RV_FP_ROUNDED(fsub_s)
+		RV_FP_ROUNDED(fmul_s)
+		RV_FP_ROUNDED(fdiv_s)
+		RV_FP_ROUNDED(fsqrt_s)
+		RV_FP_ROUNDED(fcvt_w_s)
+		RV_FP_ROUNDED(fcvt_wu_s)
+		RV_FP_ROUNDED(fcvt_s_w)
+		RV_FP_ROUNDED(fcvt_s_wu)
+
+		RV_RTYPE(fsgnj_s, fsgnj_s)
+		RV_RTYPE(fsgnjn_s, fsgnjn_s)
+		RV_RTYPE(fsgnjx_s, fsgnjx_s)
+		RV_RTYPE(fmin_s, fmin_s)
+		RV_RTYPE(fmax_s, fmax_s)
+		RV_RTYPE(feq_s, feq_s)
+		RV_RTYPE(flt_s, flt_s)
+		RV_RTYPE(fle_s, fle_s)
+		RV_RTYPE(fclass_s, fclass_s)
+		RV_RTYPE(fmv_x_w, fmv_x_w)
+		RV_RTYPE(fmv_w_x, fmv_w_x)
+
+		RV_FP_FUSED(fmadd_d)
+		RV_FP_FUSED(fmsub_d)
+		RV_FP_FUSED(fnmsub_d)
+		RV_FP_FUSED(fnmadd_d)
+
+		RV_FP_ROUNDED(fadd_d)
+		RV_FP_ROUNDED(fsub_d)
+		RV_FP_ROUNDED(fmul_d)
+		RV_FP_ROUNDED(fdiv_d)
+		RV_FP_ROUNDED(fsqrt_d)
+		RV_FP_ROUNDED(fcvt_w_d)
+		RV_FP_ROUNDED(fcvt_wu_d)
+		RV_FP_ROUNDED(fcvt_d_w)
+		RV_FP_ROUNDED(fcvt_d_wu)
+		RV_FP_ROUNDED(fcvt_s_d)
+		RV_FP_ROUNDED(fcvt_d_s)
+
+		RV_RTYPE(fsgnj_d, fsgnj_d)
+		RV_RTYPE(fsgnjn_d, fsgnjn_d)
+		RV_RTYPE(fsgnjx_d, fsgnjx_d)
+		RV_RTYPE(fmin_d, fmin_d)
+		RV_RTYPE(fmax_d, fmax_d)
+		RV_RTYPE(feq_d, feq_d)
+		RV_RTYPE(flt_d, flt_d)
+		RV_RTYPE(fle_d, fle_d)
+		RV_RTYPE(fclass_d, fclass_d)
+
+		// End of a block that falls through to the next one
+		RV_OP(invalid)
+		next_block:
+			if (stop_requested.load(memory_order_relaxed)) [[unlikely]]
+				return { count, Rv_stop_reason::halted };
+
+			// Only blocks that ran to their end take an edge. Stores that overwrote the block stop it early.
+			if (coverage_map && (block->valid || get_register(Rv_register_id::pc) == block->end)) [[unlikely]]
+				count_coverage_edge(get_register(Rv_register_id::pc));
+
+			block = find_next_block(*block, get_register(Rv_register_id::pc));
+			if (block->breakpoint) [[unlikely]]
+				return { count, Rv_stop_reason::breakpoint };
+
+			if (block->instruction_count == 0)
+				return { count, Rv_stop_reason::trap, Rv_trap_cause::illegal_instruction };
+
+			inst = block->instructions.data();
+			RV_DISPATCH();
+
+#if !RV_COMPUTED_GOTO
+		default:
+			throw runtime_error("Not implemented.");
+		}
+#endif
+	}
+
+#undef RV_BTYPE
+#undef RV_ITYPE
+#undef RV_LOAD
+#undef RV_RTYPE
+#undef RV_STYPE
+#undef RV_UTYPE
+#undef RV_CSR
+#undef RV_FP_ROUNDED
+#undef RV_FP_FUSED
+#undef RV_END_BLOCK
+#undef RV_NEXT_AFTER_STORE
+#undef RV_NEXT_AFTER_LOAD
+#undef RV_NEXT
+#undef RV_RETIRE
+#undef RV_DISPATCH
+#undef RV_OP
 }
 
-void Rv32_hart::execute_lbu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+/*
+JIT engine
+
+Blocks are counted as they are interpreted and translated once they have run jit_threshold times. Translated code
+returns the number of instructions it executed; it returns early before anything it doesn't handle, and the
+interpreter runs the instruction it stopped at. Code is looked up through the same blocks and links as the
+interpreter, so writes to code invalidate translated blocks the same way.
+*/
+
+template <typename Memory_type>
+static uint32_t jit_read_8(void* memory, uint32_t address)
 {
-	uint32_t rs1_val = get_register(rs1);
-	int32_t offset = imm.get_signed();
-	uint32_t address = rs1_val + offset;
-	uint32_t mem = memory.read_8(address);
+	if constexpr (is_same_v<Memory_type, Buffered_memory>)
+		static_cast<Memory_type*>(memory)->map_host_page(address);
 
-	set_register(rd, mem);
+	return static_cast<Memory_type*>(memory)->read_8(address);
 }
 
-void Rv32_hart::execute_lh(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <typename Memory_type>
+static uint32_t jit_read_16(void* memory, uint32_t address)
 {
-	uint32_t rs1_val = get_register(rs1);
-	int32_t offset = imm.get_signed();
-	uint32_t address = rs1_val + offset;
-	uint32_t mem = memory.read_16(address);
-
-	// Sign extend
-	if (mem & (1 << 15))
-		mem |= (-1 << 16);
+	if constexpr (is_same_v<Memory_type, Buffered_memory>)
+		static_cast<Memory_type*>(memory)->map_host_page(address);
 
-	set_register(rd, mem);
+	return static_cast<Memory_type*>(memory)->read_16(address);
 }
 
-void Rv32_hart::execute_lhu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <typename Memory_type>
+static uint32_t jit_read_32(void* memory, uint32_t address)
 {
-	uint32_t rs1_val = get_register(rs1);
-	int32_t offset = imm.get_signed();
-	uint32_t address = rs1_val + offset;
-	uint32_t mem = memory.read_16(address);
+	if constexpr (is_same_v<Memory_type, Buffered_memory>)
+		static_cast<Memory_type*>(memory)->map_host_page(address);
 
-	set_register(rd, mem);
+	return static_cast<Memory_type*>(memory)->read_32(address);
 }
 
-void Rv32_hart::execute_lw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <typename Memory_type>
+static void jit_write_8(void* memory, uint32_t address, uint32_t value)
 {
-	uint32_t rs1_val = get_register(rs1);
-	int32_t offset = imm.get_signed();
-	uint32_t address = rs1_val + offset;
-	uint32_t mem = memory.read_32(address);
-
-	set_register(rd, mem);
+	static_cast<Memory_type*>(memory)->write_8(address, static_cast<uint8_t>(value));
 }
 
-void Rv32_hart::execute_lui(Rv_register_id rd, Rv_utype_imm imm)
+template <typename Memory_type>
+static void jit_write_16(void* memory, uint32_t address, uint32_t value)
 {
-	set_register(rd, imm.get_decoded());
+	static_cast<Memory_type*>(memory)->write_16(address, static_cast<uint16_t>(value));
 }
 
-void Rv32_hart::execute_or(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+template <typename Memory_type>
+static void jit_write_32(void* memory, uint32_t address, uint32_t value)
 {
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	set_register(rd, rs1_val | rs2_val);
+	static_cast<Memory_type*>(memory)->write_32(address, value);
 }
 
-void Rv32_hart::execute_ori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+Rv32_jit_memory_access Basic_rv_hart<Xlen, Memory_type>::get_jit_memory_access(Memory_type& memory) requires (Xlen == 32)
 {
-	int32_t source = get_register(rs1);
-	int32_t immediate = imm.get_signed();
-	set_register(rd, source | immediate);
+	auto access = Rv32_jit_memory_access();
+	access.memory = &memory;
+	access.read_8 = &jit_read_8<Memory_type>;
+	access.read_16 = &jit_read_16<Memory_type>;
+	access.read_32 = &jit_read_32<Memory_type>;
+	access.write_8 = &jit_write_8<Memory_type>;
+	access.write_16 = &jit_write_16<Memory_type>;
+	access.write_32 = &jit_write_32<Memory_type>;
+
+	// Loads from mapped memory don't need a call
+	if constexpr (is_same_v<Memory_type, Mapped_memory>)
+		access.host_base = memory.get_host_pointer(0);
+
+	// Nor do loads from most pages of a buffered view
+	if constexpr (is_same_v<Memory_type, Buffered_memory>)
+		access.host_pages = memory.get_host_pages();
+
+	return access;
 }
 
-void Rv32_hart::execute_sb(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+Rv_run_result Basic_rv_hart<Xlen, Memory_type>::run_jit(uint64_t max_instructions) requires (Xlen == 32)
 {
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
+	if (max_instructions == 0)
+		return {};
 
-	int32_t offset = imm.get_offset();
-	uint32_t address = rs1_val + offset;
-	uint8_t val_to_write = static_cast<uint8_t>(rs2_val) & 0xFF;
+	uint64_t count = 0;
+	Basic_block* block = find_block(get_register(Rv_register_id::pc));
 
-	memory.write_8(address, val_to_write);
+	// Translated code could loop back to a breakpoint the run starts at, so step over it with the interpreter
+	bool interpret_first = block->breakpoint;
+
+	for (;;)
+	{
+		if (block->instruction_count == 0)
+			return { count, Rv_stop_reason::trap, Rv_trap_cause::illegal_instruction };
+
+		// Near the instruction limit, run one instruction at a time
+		const auto remaining = max_instructions - count;
+		const bool step = remaining < block->instruction_count || interpret_first;
+
+		uint64_t executed = 0;
+		if (block->execution_count >= jit_threshold && !interpret_first)
+		{
+			if (const auto function = get_native_code(*block, step))
+				executed = function(registers.data(), static_cast<uint32_t>(min<uint64_t>(remaining, Rv32_jit::max_budget)));
+		}
+		else
+		{
+			++block->execution_count;
+		}
+
+		// Instructions that can trap are never translated
+		if (executed == 0)
+		{
+			const auto result = run_interpreter(step ? 1 : block->instruction_count, count);
+			if (result.reason != Rv_stop_reason::budget_exhausted)
+				return { count + result.retired, result.reason, result.trap };
+
+			executed = result.retired;
+		}
+
+		interpret_first = false;
+		count += executed;
+		if (count == max_instructions)
+			return { count };
+
+		if (stop_requested.load(memory_order_relaxed)) [[unlikely]]
+			return { count, Rv_stop_reason::halted };
+
+		// Translated code that stopped in the middle of the block, before an instruction it doesn't handle or after
+		// a store that overwrote the block, didn't take an edge
+		if (coverage_map && executed % block->instruction_count == 0) [[unlikely]]
+			count_coverage_edge(get_register(Rv_register_id::pc));
+
+		block = find_next_block(*block, get_register(Rv_register_id::pc));
+		if (block->breakpoint) [[unlikely]]
+			return { count, Rv_stop_reason::breakpoint };
+
+		// Blocks invalidated by the code that just ran are no longer referenced
+		if (!retired_blocks.empty())
+			free_retired_blocks();
+	}
 }
 
-void Rv32_hart::execute_sh(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+Rv32_jit::Block_function Basic_rv_hart<Xlen, Memory_type>::get_native_code(Basic_block& block, bool step) requires (Xlen == 32)
 {
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
+	auto& native = step ? block.native_step : block.native;
+	if (native.generation == jit->get_generation()) [[likely]]
+		return native.function;
+
+	// The block's memory is unchanged since it was created, or it would have been invalidated
+	array<Rv32_jit_instruction, max_block_instructions> instructions;
+	const uint32_t count = step ? 1 : block.instruction_count;
+	uint32_t pc = block.pc;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint8_t length;
+		const auto inst = fetch_instruction(pc, length);
+		instructions[i] = { pc, inst, block.instructions[i].type, length };
+		pc += length;
+	}
 
-	int32_t offset = imm.get_offset();
-	uint32_t address = rs1_val + offset;
-	uint16_t val_to_write = static_cast<uint16_t>(rs2_val) & 0xFFFF;
+	// Loads of watched pages must reach the memory. The memory's pages are the JIT's 4 KiB pages.
+	static_assert(Memory_type::code_page_bits == 12);
+	jit->set_watched_pages(memory.get_watched_page_words());
 
-	memory.write_16(address, val_to_write);
+	// Translating can flush the JIT, so the generation is read afterwards
+	native.function = jit->translate(span(instructions.data(), count), &block.valid);
+	native.generation = jit->get_generation();
+	return native.function;
 }
 
-void Rv32_hart::execute_sll(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::find_block(Register address) -> Basic_block*
 {
-	// Logical left shift on the value in rs1 by the shift amount held in the lower 5 bits of rs2.
+	auto& slot = block_lookup[(address >> 2) & (instruction_cache_size - 1)];
+	if (slot && slot->pc == address) [[likely]]
+		return slot;
 
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	uint32_t shift_amount = rs2_val & 0b11111;
-	set_register(rd, rs1_val << shift_amount);
+	const auto found = blocks.find(address);
+	slot = found != blocks.end() ? found->second.get() : create_block(address);
+	return slot;
 }
 
-void Rv32_hart::execute_slli(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::find_next_block(Basic_block& from, Register address) -> Basic_block*
 {
-	uint32_t source = get_register(rs1);
-	uint8_t shift_amount = imm.get_shift_amount();
-	set_register(rd, source << shift_amount);
-}
+	for (const auto& link : from.links)
+	{
+		if (link.block && link.pc == address && link.block->valid)
+			return link.block;
+	}
 
-void Rv32_hart::execute_slt(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
-{
-	int32_t rs1_val = get_register(rs1);
-	int32_t rs2_val = get_register(rs2);
-	set_register(rd, rs1_val < rs2_val);
+	const auto next = find_block(address);
+
+	// Blocks that were invalidated while running are about to be freed and must not be linked from
+	if (from.valid)
+	{
+		// Replace the second link, keeping the first (usually the taken branch of a loop) stable
+		auto& link = from.links[0].block ? from.links[1] : from.links[0];
+		link = { address, next };
+	}
+
+	return next;
 }
 
-void Rv32_hart::execute_slti(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::count_coverage_edge(Register address)
 {
-	// rd = (rs1 < imm) ? 1 : 0;
-	int32_t source = get_register(rs1);
-	int32_t immediate = imm.get_signed();
-	set_register(rd, (source < immediate) ? 1 : 0);
+	const auto location = get_coverage_location(address);
+	++coverage_map[location ^ coverage_location];
+	coverage_location = location >> 1;
 }
 
-void Rv32_hart::execute_sltiu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::create_block(Register address) -> Basic_block*
 {
-	// rd = (rs1 < imm) ? 1 : 0;
-	uint32_t source = get_register(rs1);
-	uint32_t immediate = imm.get_unsigned();
-	set_register(rd, (source < immediate) ? 1 : 0);
+	using enum Rv32i_instruction_type;
+	constexpr uint32_t page_mask = (1 << Memory_type::code_page_bits) - 1;
+
+	const auto& executor_map = get_instruction_executor_map<Xlen, Memory_type>();
+
+	auto block = make_unique<Basic_block>();
+	block->pc = address;
+	block->breakpoint = !breakpoint_pages.empty() && has_breakpoint(address);
+
+	Register inst_addr = address;
+	while (block->instructions.size() < max_block_instructions)
+	{
+		// Breakpoints start a block, so run() only has to check the blocks it enters
+		if (inst_addr != address && !breakpoint_pages.empty() && has_breakpoint(inst_addr))
+			break;
+
+		uint8_t length;
+		const auto inst = fetch_instruction(inst_addr, length);
+		const auto inst_type = Decoder::decode_instruction_type(inst);
+		const auto executor = executor_map.find(inst_type);
+
+		// An illegal instruction ends the block. A block that starts with one is empty and traps when it is run.
+		if (executor == executor_map.end())
+			break;
+
+		auto& block_inst = block->instructions.emplace_back(inst_type, length);
+		decode_operands(executor->second.format, inst, block_inst.decoded);
+		inst_addr += length;
+
+		// Control transfers and system instructions end the block, as does the end of the page
+		if (executor->second.manages_pc || page_mask + 1 - (inst_addr & page_mask) < 4)
+			break;
+	}
+
+	block->end = inst_addr;
+	block->instruction_count = static_cast<uint32_t>(block->instructions.size());
+	block->instructions.emplace_back(invalid, uint8_t(0));
+
+	// Writes to the block's pages must now invalidate it
+	memory.mark_code_page(address);
+	memory.mark_code_page(inst_addr - 1);
+
+	const auto result = block.get();
+	blocks_by_page[address >> Memory_type::code_page_bits].push_back(result);
+	blocks.emplace(address, std::move(block));
+	return result;
 }
 
-void Rv32_hart::execute_sltu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::retire_block(Basic_block& block)
 {
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	set_register(rd, rs1_val < rs2_val);
+	block.valid = false;
+
+	auto& slot = block_lookup[(block.pc >> 2) & (instruction_cache_size - 1)];
+	if (slot == &block)
+		slot = nullptr;
+
+	auto found = blocks.find(block.pc);
+	retired_blocks.push_back(std::move(found->second));
+	blocks.erase(found);
 }
 
-void Rv32_hart::execute_sra(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::free_retired_blocks()
 {
-	// Arithmetic right shift on the value in rs1 by the shift amount held in the lower 5 bits of rs2.
+	if (retired_blocks.empty())
+		return;
 
-	int32_t rs1_val = get_register(rs1);
-	int32_t rs2_val = get_register(rs2);
-	int32_t shift_amount = rs2_val & 0b11111;
-	set_register(rd, rs1_val >> shift_amount);
+	for (auto& [address, block] : blocks)
+	{
+		for (auto& link : block->links)
+		{
+			if (link.block && !link.block->valid)
+				link = {};
+		}
+	}
+
+	retired_blocks.clear();
 }
 
-void Rv32_hart::execute_srai(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	// Static cast to signed integer to make it more obvious what is going on.
-	// Arithemtic shift right needs signed int
-	uint32_t source = get_register(rs1);
-	uint8_t shift_amount = imm.get_shift_amount();
-	set_register(rd, static_cast<int32_t>(source) >> shift_amount);
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val + rs2_val);
 }
 
-void Rv32_hart::execute_srl(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_addi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
 {
-	// Logical right shift on the value in rs1 by the shift amount held in the lower 5 bits of rs2.
-
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	uint32_t shift_amount = rs2_val & 0b11111;
-	set_register(rd, rs1_val >> shift_amount);
+	Signed source = get_register(rs1);
+	Signed immediate = imm.get_signed();
+	set_register(rd, source + immediate);
 }
 
-void Rv32_hart::execute_srli(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_addiw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
 {
-	uint32_t source = get_register(rs1);
-	uint8_t shift_amount = imm.get_shift_amount();
-	set_register(rd, source >> shift_amount);
+	// W instructions operate on the low 32 bits and sign extend the 32-bit result
+	uint32_t source = static_cast<uint32_t>(get_register(rs1));
+	uint32_t immediate = imm.get_signed();
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(source + immediate)));
 }
 
-void Rv32_hart::execute_sub(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_addw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	set_register(rd, rs1_val - rs2_val);
+	uint32_t rs1_val = static_cast<uint32_t>(get_register(rs1));
+	uint32_t rs2_val = static_cast<uint32_t>(get_register(rs2));
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(rs1_val + rs2_val)));
 }
 
-void Rv32_hart::execute_sw(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) { return old + value; });
+}
 
-	int32_t offset = imm.get_offset();
-	uint32_t address = rs1_val + offset;
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoadd_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) { return old + value; });
+}
 
-	memory.write_32(address, rs2_val);
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoand_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) { return old & value; });
 }
 
-void Rv32_hart::execute_xor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoand_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	uint32_t rs1_val = get_register(rs1);
-	uint32_t rs2_val = get_register(rs2);
-	set_register(rd, rs1_val ^ rs2_val);
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) { return old & value; });
 }
 
-void Rv32_hart::execute_xori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amomax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	int32_t source = get_register(rs1);
-	int32_t immediate = imm.get_signed();
-	set_register(rd, source ^ immediate);
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) {
+		return static_cast<int64_t>(value) > static_cast<int64_t>(old) ? value : old;
+	});
 }
 
-uint32_t Rv32_hart::get_register(Rv_register_id register_id)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amomax_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	return registers[static_cast<uint8_t>(register_id)];
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) {
+		return static_cast<int32_t>(value) > static_cast<int32_t>(old) ? value : old;
+	});
 }
 
-void Rv32_hart::set_register(Rv_register_id register_id, uint32_t value)
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amomaxu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	// x0 is hardcoded to 0 and can't be changed. Writes to x0 are treated as a nop.
-	if (register_id == Rv_register_id::x0)
-		return;
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) { return max(old, value); });
+}
 
-	registers[static_cast<uint8_t>(register_id)] = value;
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amomaxu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) { return max(old, value); });
 }
 
-void Rv32_hart::reset()
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amomin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) {
+		return static_cast<int64_t>(value) < static_cast<int64_t>(old) ? value : old;
+	});
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amomin_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) {
+		return static_cast<int32_t>(value) < static_cast<int32_t>(old) ? value : old;
+	});
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amominu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) { return min(old, value); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amominu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) { return min(old, value); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) { return old | value; });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) { return old | value; });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoswap_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) { return value; });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoswap_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) { return value; });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoxor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint64_t>(rd, rs1, rs2, [](uint64_t old, uint64_t value) { return old ^ value; });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amoxor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_amo<uint32_t>(rd, rs1, rs2, [](uint32_t old, uint32_t value) { return old ^ value; });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_and(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val & rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_andi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Signed source = get_register(rs1);
+	Signed immediate = imm.get_signed();
+	set_register(rd, source & immediate);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_andn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val & ~rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_auipc(Rv_register_id rd, Rv_utype_imm imm)
+{
+	// The immediate is sign extended to XLEN
+	Register pc = get_register(Rv_register_id::pc);
+	set_register(rd, pc + static_cast<Signed>(static_cast<int32_t>(imm.get_decoded())));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bclr(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val & ~(Register(1) << (rs2_val & (Xlen - 1))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bclri(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, source & ~(Register(1) << shift_amount));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_beq(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+{
+	Register pc = get_register(Rv_register_id::pc);
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	
+	if (rs1_val == rs2_val)
+	{
+		pc = pc + imm.get_offset();
+		trap_if_branch_target_misaligned(pc);
+	}
+	else
+	{
+		pc += instruction_length;
+	}
+
+	set_register(Rv_register_id::pc, pc);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bext(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, (rs1_val >> (rs2_val & (Xlen - 1))) & 1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bexti(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, (source >> shift_amount) & 1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bge(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+{
+	Register pc = get_register(Rv_register_id::pc);
+	
+	// Signed comparison
+	Signed rs1_val = get_register(rs1);
+	Signed rs2_val = get_register(rs2);
+
+	if (rs1_val >= rs2_val)
+	{
+		pc = pc + imm.get_offset();
+		trap_if_branch_target_misaligned(pc);
+	}
+	else
+	{
+		pc += instruction_length;
+	}
+
+	set_register(Rv_register_id::pc, pc);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bgeu(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+{
+	Register pc = get_register(Rv_register_id::pc);
+
+	// Unsigned comparison
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+
+	if (rs1_val >= rs2_val)
+	{
+		pc = pc + imm.get_offset();
+		trap_if_branch_target_misaligned(pc);
+	}
+	else
+	{
+		pc += instruction_length;
+	}
+
+	set_register(Rv_register_id::pc, pc);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_binv(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val ^ (Register(1) << (rs2_val & (Xlen - 1))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_binvi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, source ^ (Register(1) << shift_amount));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_blt(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+{
+	Register pc = get_register(Rv_register_id::pc);
+
+	// Signed comparison
+	Signed rs1_val = get_register(rs1);
+	Signed rs2_val = get_register(rs2);
+
+	if (rs1_val < rs2_val)
+	{
+		pc = pc + imm.get_offset();
+		trap_if_branch_target_misaligned(pc);
+	}
+	else
+	{
+		pc += instruction_length;
+	}
+
+	set_register(Rv_register_id::pc, pc);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bltu(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+{
+	Register pc = get_register(Rv_register_id::pc);
+
+	// Unsigned comparison
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+
+	if (rs1_val < rs2_val)
+	{
+		pc = pc + imm.get_offset();
+		trap_if_branch_target_misaligned(pc);
+	}
+	else
+	{
+		pc += instruction_length;
+	}
+
+	set_register(Rv_register_id::pc, pc);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bne(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+{
+	Register pc = get_register(Rv_register_id::pc);
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+
+	if (rs1_val != rs2_val)
+	{
+		pc = pc + imm.get_offset();
+		trap_if_branch_target_misaligned(pc);
+	}
+	else
+	{
+		pc += instruction_length;
+	}
+
+	set_register(Rv_register_id::pc, pc);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bset(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val | (Register(1) << (rs2_val & (Xlen - 1))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_bseti(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, source | (Register(1) << shift_amount));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_clz(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	set_register(rd, countl_zero(source));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_cpop(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	set_register(rd, popcount(source));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_csrrc(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// With rs1 = x0 the CSR is only read
+	access_csr(rd, imm, rs1 != Rv_register_id::x0, 0, get_register(rs1));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_csrrci(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// The rs1 field holds the immediate. A zero immediate only reads the CSR.
+	const auto zimm = to_underlying(rs1);
+	access_csr(rd, imm, zimm != 0, 0, zimm);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_csrrs(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	access_csr(rd, imm, rs1 != Rv_register_id::x0, get_register(rs1), 0);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_csrrsi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	const auto zimm = to_underlying(rs1);
+	access_csr(rd, imm, zimm != 0, zimm, 0);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_csrrw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	access_csr(rd, imm, true, get_register(rs1), numeric_limits<Register>::max());
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_csrrwi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	access_csr(rd, imm, true, to_underlying(rs1), numeric_limits<Register>::max());
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_ctz(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	set_register(rd, countr_zero(source));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_div(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Signed rs1_val = get_register(rs1);
+	Signed rs2_val = get_register(rs2);
+
+	// Division by zero gives all ones and overflow gives the dividend. Neither traps.
+	if (rs2_val == 0)
+		set_register(rd, numeric_limits<Register>::max());
+	else if (rs1_val == numeric_limits<Signed>::min() && rs2_val == -1)
+		set_register(rd, rs1_val);
+	else
+		set_register(rd, rs1_val / rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_divu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs2_val == 0 ? numeric_limits<Register>::max() : rs1_val / rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_divuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	uint32_t rs1_val = static_cast<uint32_t>(get_register(rs1));
+	uint32_t rs2_val = static_cast<uint32_t>(get_register(rs2));
+	uint32_t quotient = rs2_val == 0 ? numeric_limits<uint32_t>::max() : rs1_val / rs2_val;
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(quotient)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_divw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	int32_t rs1_val = static_cast<int32_t>(get_register(rs1));
+	int32_t rs2_val = static_cast<int32_t>(get_register(rs2));
+
+	// As DIV on the low 32 bits
+	if (rs2_val == 0)
+		set_register(rd, numeric_limits<Register>::max());
+	else if (rs1_val == numeric_limits<int32_t>::min() && rs2_val == -1)
+		set_register(rd, static_cast<Signed>(rs1_val));
+	else
+		set_register(rd, static_cast<Signed>(rs1_val / rs2_val));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_ebreak(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	raise_trap(Rv_trap_cause::breakpoint);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_ecall(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	raise_trap(Rv_trap_cause::ecall);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_add(read_fp<double>(rs1), read_fp<double>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_add(read_fp<float>(rs1), read_fp<float>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fclass_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, classify(read_fp<double>(rs1)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fclass_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, classify(read_fp<float>(rs1)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_d_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool) { return static_cast<double>(read_fp<float>(rs1)); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_d_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	// Exact, but an invalid dynamic rounding mode still traps
+	execute_rounded(rd, [&](bool) { return static_cast<double>(static_cast<int32_t>(get_register(rs1))); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_d_wu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool) { return static_cast<double>(static_cast<uint32_t>(get_register(rs1))); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_s_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_narrow<float>(read_fp<double>(rs1), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_s_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	// Integers are exact as doubles, so this rounds once
+	execute_rounded(rd, [&](bool ties_away) { return fp_narrow<float>(static_cast<double>(static_cast<int32_t>(get_register(rs1))), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_s_wu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_narrow<float>(static_cast<double>(static_cast<uint32_t>(get_register(rs1))), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_w_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_convert_to_integer<int32_t, double>(rd, rs1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_w_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_convert_to_integer<int32_t, float>(rd, rs1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_wu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_convert_to_integer<uint32_t, double>(rd, rs1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fcvt_wu_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_convert_to_integer<uint32_t, float>(rd, rs1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fdiv_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_divide(read_fp<double>(rs1), read_fp<double>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fdiv_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_divide(read_fp<float>(rs1), read_fp<float>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fence(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// Harts on other threads share the memory. The predecessor and successor sets aren't tracked: every FENCE
+	// orders all of this hart's accesses on the host.
+	atomic_thread_fence(memory_order_seq_cst);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_feq_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, fp_equal(read_fp<double>(rs1), read_fp<double>(rs2), fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_feq_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, fp_equal(read_fp<float>(rs1), read_fp<float>(rs2), fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fld(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+
+	set_fp_register(rd, memory.read_64(address));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fle_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, fp_less_equal(read_fp<double>(rs1), read_fp<double>(rs2), fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fle_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, fp_less_equal(read_fp<float>(rs1), read_fp<float>(rs2), fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_flt_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, fp_less(read_fp<double>(rs1), read_fp<double>(rs2), fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_flt_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_register(rd, fp_less(read_fp<float>(rs1), read_fp<float>(rs2), fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_flw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+	Register mem = memory.read_32(address);
+
+	set_fp_register(rd, nan_box(mem));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(read_fp<double>(rs1), read_fp<double>(rs2), read_fp<double>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(read_fp<float>(rs1), read_fp<float>(rs2), read_fp<float>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_min_max(read_fp<double>(rs1), read_fp<double>(rs2), true, fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmax_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_min_max(read_fp<float>(rs1), read_fp<float>(rs2), true, fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_min_max(read_fp<double>(rs1), read_fp<double>(rs2), false, fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmin_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_min_max(read_fp<float>(rs1), read_fp<float>(rs2), false, fflags));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(read_fp<double>(rs1), read_fp<double>(rs2), -read_fp<double>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(read_fp<float>(rs1), read_fp<float>(rs2), -read_fp<float>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmul_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_multiply(read_fp<double>(rs1), read_fp<double>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmul_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_multiply(read_fp<float>(rs1), read_fp<float>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmv_w_x(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	set_fp_register(rd, nan_box(get_register(rs1)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fmv_x_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	// Moves the low bits as they are, boxed or not, sign extended on RV64
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(get_fp_register(rs1))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fnmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(-read_fp<double>(rs1), read_fp<double>(rs2), -read_fp<double>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fnmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(-read_fp<float>(rs1), read_fp<float>(rs2), -read_fp<float>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fnmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(-read_fp<double>(rs1), read_fp<double>(rs2), read_fp<double>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fnmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_fused_multiply_add(-read_fp<float>(rs1), read_fp<float>(rs2), read_fp<float>(rs3), ties_away, fflags); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsd(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_offset();
+	Register address = rs1_val + offset;
+
+	memory.write_64(address, get_fp_register(rs2));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsgnj_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_with_sign(read_fp<double>(rs1), signbit(read_fp<double>(rs2))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsgnj_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_with_sign(read_fp<float>(rs1), signbit(read_fp<float>(rs2))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsgnjn_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_with_sign(read_fp<double>(rs1), !signbit(read_fp<double>(rs2))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsgnjn_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	write_fp(rd, fp_with_sign(read_fp<float>(rs1), !signbit(read_fp<float>(rs2))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsgnjx_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	const auto value = read_fp<double>(rs1);
+	write_fp(rd, fp_with_sign(value, signbit(value) != signbit(read_fp<double>(rs2))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsgnjx_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	const auto value = read_fp<float>(rs1);
+	write_fp(rd, fp_with_sign(value, signbit(value) != signbit(read_fp<float>(rs2))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsqrt_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	// Square roots are never subnormal, and normal ones are never halfway between two values, so ties don't arise
+	execute_rounded(rd, [&](bool) { return sqrt(read_fp<double>(rs1)); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsqrt_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool) { return sqrt(read_fp<float>(rs1)); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_add(read_fp<double>(rs1), -read_fp<double>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_rounded(rd, [&](bool ties_away) { return fp_add(read_fp<float>(rs1), -read_fp<float>(rs2), ties_away); });
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_fsw(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_offset();
+	Register address = rs1_val + offset;
+
+	// Stores the low bits as they are, boxed or not
+	memory.write_32(address, static_cast<uint32_t>(get_fp_register(rs2)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_jal(Rv_register_id rd, Rv_jtype_imm imm)
+{
+	const auto pc = get_register(Rv_register_id::pc);
+	Register new_pc = pc + imm.get_offset();
+	
+	// Target must be 4-byte aligned, or 2-byte aligned with the C extension
+	trap_if_branch_target_misaligned(new_pc);
+
+	// PC is set to the jump target (PC + Offset)
+	set_register(Rv_register_id::pc, new_pc);
+
+	// RD is set to instruction after the jump instruction (PC + 4, or PC + 2 for C.JAL)
+	set_register(rd, pc + instruction_length);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_jalr(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// Target address is obtained by adding the sign-extended 12-bit I-immediate to rs1,
+	// then setting the least-significant bit of the result to zero.
+	
+	const auto pc = get_register(Rv_register_id::pc);
+	const Register rs1_val = get_register(rs1);
+	const int32_t offset = imm.get_signed();
+	Register new_pc = rs1_val + offset;
+
+	// Set least-significant bit to zero
+	new_pc &= ~Register(1);
+
+	// Target must be 4-byte aligned, or 2-byte aligned with the C extension
+	trap_if_branch_target_misaligned(new_pc);
+
+	set_register(Rv_register_id::pc, new_pc);
+
+	// RD is set to instruction after the jump instruction (PC + 4, or PC + 2 for C.JALR)
+	set_register(rd, pc + instruction_length);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lb(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+	Register mem = memory.read_8(address);
+
+	// Sign extend
+	if (mem & 0b1000'0000)
+		mem |= (-1 << 8);
+
+	set_register(rd, mem);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lbu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+	Register mem = memory.read_8(address);
+
+	set_register(rd, mem);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_ld(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+
+	set_register(rd, static_cast<Register>(memory.read_64(address)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lh(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+	Register mem = memory.read_16(address);
+
+	// Sign extend
+	if (mem & (1 << 15))
+		mem |= (-1 << 16);
+
+	set_register(rd, mem);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lhu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+	Register mem = memory.read_16(address);
+
+	set_register(rd, mem);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lr_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_lr<uint64_t>(rd, rs1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lr_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_lr<uint32_t>(rd, rs1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+	Register mem = memory.read_32(address);
+
+	// Sign extended on RV64
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(mem)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lwu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	int32_t offset = imm.get_signed();
+	Register address = rs1_val + offset;
+	Register mem = memory.read_32(address);
+
+	set_register(rd, mem);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lui(Rv_register_id rd, Rv_utype_imm imm)
+{
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(imm.get_decoded())));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_max(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, max(static_cast<Signed>(rs1_val), static_cast<Signed>(rs2_val)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_maxu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, max(rs1_val, rs2_val));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_min(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, min(static_cast<Signed>(rs1_val), static_cast<Signed>(rs2_val)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_minu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, min(rs1_val, rs2_val));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_mul(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val * rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_mulh(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	if constexpr (Xlen == 32)
+	{
+		int64_t rs1_val = static_cast<int32_t>(get_register(rs1));
+		int64_t rs2_val = static_cast<int32_t>(get_register(rs2));
+		set_register(rd, static_cast<uint32_t>((rs1_val * rs2_val) >> 32));
+	}
+	else
+	{
+		// Each negative operand adds 2^64 times the other operand to the unsigned product, which is taken back off
+		Register rs1_val = get_register(rs1);
+		Register rs2_val = get_register(rs2);
+		Register high = multiply_high_unsigned(rs1_val, rs2_val);
+		high -= static_cast<Signed>(rs1_val) < 0 ? rs2_val : 0;
+		high -= static_cast<Signed>(rs2_val) < 0 ? rs1_val : 0;
+		set_register(rd, high);
+	}
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_mulhsu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	if constexpr (Xlen == 32)
+	{
+		// The unsigned operand fits in an int64_t, and so does the product
+		int64_t rs1_val = static_cast<int32_t>(get_register(rs1));
+		int64_t rs2_val = get_register(rs2);
+		set_register(rd, static_cast<uint32_t>((rs1_val * rs2_val) >> 32));
+	}
+	else
+	{
+		Register rs1_val = get_register(rs1);
+		Register rs2_val = get_register(rs2);
+		Register high = multiply_high_unsigned(rs1_val, rs2_val);
+		high -= static_cast<Signed>(rs1_val) < 0 ? rs2_val : 0;
+		set_register(rd, high);
+	}
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_mulhu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	if constexpr (Xlen == 32)
+	{
+		uint64_t rs1_val = get_register(rs1);
+		uint64_t rs2_val = get_register(rs2);
+		set_register(rd, static_cast<uint32_t>((rs1_val * rs2_val) >> 32));
+	}
+	else
+	{
+		set_register(rd, multiply_high_unsigned(get_register(rs1), get_register(rs2)));
+	}
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_mulw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	uint32_t rs1_val = static_cast<uint32_t>(get_register(rs1));
+	uint32_t rs2_val = static_cast<uint32_t>(get_register(rs2));
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(rs1_val * rs2_val)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_or(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val | rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_orc_b(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// Adding 0x7F to the low 7 bits of a byte carries into its high bit if any of them is set. Multiplying the high
+	// bits, moved down to bit 0, by 0xFF fills each byte without carrying into the next.
+	Register source = get_register(rs1);
+	constexpr Register low_bits = numeric_limits<Register>::max() / 0xFF * 0x7F; // 0x7F in each byte
+	Register nonzero = (((source & low_bits) + low_bits) | source) & ~low_bits;
+	set_register(rd, (nonzero >> 7) * 0xFF);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_ori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Signed source = get_register(rs1);
+	Signed immediate = imm.get_signed();
+	set_register(rd, source | immediate);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_orn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val | ~rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_rem(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Signed rs1_val = get_register(rs1);
+	Signed rs2_val = get_register(rs2);
+
+	// Division by zero gives the dividend and overflow gives 0. Neither traps.
+	if (rs2_val == 0)
+		set_register(rd, rs1_val);
+	else if (rs1_val == numeric_limits<Signed>::min() && rs2_val == -1)
+		set_register(rd, 0);
+	else
+		set_register(rd, rs1_val % rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_remu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs2_val == 0 ? rs1_val : rs1_val % rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_remuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	uint32_t rs1_val = static_cast<uint32_t>(get_register(rs1));
+	uint32_t rs2_val = static_cast<uint32_t>(get_register(rs2));
+	uint32_t remainder = rs2_val == 0 ? rs1_val : rs1_val % rs2_val;
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(remainder)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_remw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	int32_t rs1_val = static_cast<int32_t>(get_register(rs1));
+	int32_t rs2_val = static_cast<int32_t>(get_register(rs2));
+
+	// As REM on the low 32 bits
+	if (rs2_val == 0)
+		set_register(rd, static_cast<Signed>(rs1_val));
+	else if (rs1_val == numeric_limits<int32_t>::min() && rs2_val == -1)
+		set_register(rd, 0);
+	else
+		set_register(rd, static_cast<Signed>(rs1_val % rs2_val));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_rev8(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	set_register(rd, byteswap(source));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_rol(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rotl(rs1_val, static_cast<int>(rs2_val & (Xlen - 1))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_ror(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rotr(rs1_val, static_cast<int>(rs2_val & (Xlen - 1))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_rori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, rotr(source, shift_amount));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sb(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+
+	int32_t offset = imm.get_offset();
+	Register address = rs1_val + offset;
+	uint8_t val_to_write = static_cast<uint8_t>(rs2_val) & 0xFF;
+
+	memory.write_8(address, val_to_write);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sc_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_sc<uint64_t>(rd, rs1, rs2);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sc_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	execute_sc<uint32_t>(rd, rs1, rs2);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sd(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	uint64_t rs2_val = get_register(rs2);
+
+	int32_t offset = imm.get_offset();
+	Register address = rs1_val + offset;
+
+	memory.write_64(address, rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sext_b(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	set_register(rd, static_cast<int8_t>(source));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sext_h(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	set_register(rd, static_cast<int16_t>(source));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sh(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+
+	int32_t offset = imm.get_offset();
+	Register address = rs1_val + offset;
+	uint16_t val_to_write = static_cast<uint16_t>(rs2_val) & 0xFFFF;
+
+	memory.write_16(address, val_to_write);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sh1add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, (rs1_val << 1) + rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sh2add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, (rs1_val << 2) + rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sh3add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, (rs1_val << 3) + rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sll(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	// Logical left shift on the value in rs1 by the shift amount held in the lower 5 bits of rs2 (6 bits on RV64).
+
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	Register shift_amount = rs2_val & (Xlen - 1);
+	set_register(rd, rs1_val << shift_amount);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_slli(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, source << shift_amount);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_slliw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	uint32_t source = static_cast<uint32_t>(get_register(rs1));
+	uint8_t shift_amount = imm.get_shift_amount<32>();
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(source << shift_amount)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sllw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	uint32_t rs1_val = static_cast<uint32_t>(get_register(rs1));
+	uint32_t shift_amount = get_register(rs2) & 0b11111;
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(rs1_val << shift_amount)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_slt(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Signed rs1_val = get_register(rs1);
+	Signed rs2_val = get_register(rs2);
+	set_register(rd, rs1_val < rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_slti(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// rd = (rs1 < imm) ? 1 : 0;
+	Signed source = get_register(rs1);
+	Signed immediate = imm.get_signed();
+	set_register(rd, (source < immediate) ? 1 : 0);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sltiu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// rd = (rs1 < imm) ? 1 : 0;
+	Register source = get_register(rs1);
+	Register immediate = imm.get_unsigned();
+	set_register(rd, (source < immediate) ? 1 : 0);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sltu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val < rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sra(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	// Arithmetic right shift on the value in rs1 by the shift amount held in the lower 5 bits of rs2 (6 bits on RV64).
+
+	Signed rs1_val = get_register(rs1);
+	Signed rs2_val = get_register(rs2);
+	Signed shift_amount = rs2_val & (Xlen - 1);
+	set_register(rd, rs1_val >> shift_amount);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_srai(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	// Static cast to signed integer to make it more obvious what is going on.
+	// Arithemtic shift right needs signed int
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, static_cast<Signed>(source) >> shift_amount);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sraiw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	int32_t source = static_cast<int32_t>(get_register(rs1));
+	uint8_t shift_amount = imm.get_shift_amount<32>();
+	set_register(rd, static_cast<Signed>(source >> shift_amount));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sraw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	int32_t rs1_val = static_cast<int32_t>(get_register(rs1));
+	uint32_t shift_amount = get_register(rs2) & 0b11111;
+	set_register(rd, static_cast<Signed>(rs1_val >> shift_amount));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_srl(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	// Logical right shift on the value in rs1 by the shift amount held in the lower 5 bits of rs2 (6 bits on RV64).
+
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	Register shift_amount = rs2_val & (Xlen - 1);
+	set_register(rd, rs1_val >> shift_amount);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_srli(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Register source = get_register(rs1);
+	uint8_t shift_amount = imm.get_shift_amount<Xlen>();
+	set_register(rd, source >> shift_amount);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_srliw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	uint32_t source = static_cast<uint32_t>(get_register(rs1));
+	uint8_t shift_amount = imm.get_shift_amount<32>();
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(source >> shift_amount)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_srlw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	uint32_t rs1_val = static_cast<uint32_t>(get_register(rs1));
+	uint32_t shift_amount = get_register(rs2) & 0b11111;
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(rs1_val >> shift_amount)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sub(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val - rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_subw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	uint32_t rs1_val = static_cast<uint32_t>(get_register(rs1));
+	uint32_t rs2_val = static_cast<uint32_t>(get_register(rs2));
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(rs1_val - rs2_val)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sw(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+
+	int32_t offset = imm.get_offset();
+	Register address = rs1_val + offset;
+
+	memory.write_32(address, rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_xnor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, ~(rs1_val ^ rs2_val));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_xor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register rs1_val = get_register(rs1);
+	Register rs2_val = get_register(rs2);
+	set_register(rd, rs1_val ^ rs2_val);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_xori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	Signed source = get_register(rs1);
+	Signed immediate = imm.get_signed();
+	set_register(rd, source ^ immediate);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::execute_zext_h(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register source = get_register(rs1);
+	set_register(rd, source & 0xFFFF);
+}
+
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::get_register(Rv_register_id register_id) -> Register
+{
+	return registers[static_cast<uint8_t>(register_id)];
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_register(Rv_register_id register_id, Register value)
+{
+	// x0 is hardcoded to 0 and can't be changed. Writes to x0 are treated as a nop.
+	if (register_id == Rv_register_id::x0)
+		return;
+
+	registers[static_cast<uint8_t>(register_id)] = value;
+}
+
+template <unsigned Xlen, typename Memory_type>
+uint64_t Basic_rv_hart<Xlen, Memory_type>::get_fp_register(Rv_register_id register_id) const
+{
+	return fp_registers[static_cast<uint8_t>(register_id)];
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_fp_register(Rv_register_id register_id, uint64_t value)
+{
+	fp_registers[static_cast<uint8_t>(register_id)] = value;
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename T>
+T Basic_rv_hart<Xlen, Memory_type>::read_fp(Rv_register_id register_id) const
+{
+	const auto bits = get_fp_register(register_id);
+	if constexpr (is_same_v<T, float>)
+		return nan_unbox(bits);
+	else
+		return bit_cast<double>(bits);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::write_fp(Rv_register_id register_id, float value)
+{
+	set_fp_register(register_id, nan_box(bit_cast<uint32_t>(value)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::write_fp(Rv_register_id register_id, double value)
+{
+	set_fp_register(register_id, bit_cast<uint64_t>(value));
+}
+
+template <unsigned Xlen, typename Memory_type>
+bool Basic_rv_hart<Xlen, Memory_type>::get_rounding_mode(Rv_rounding_mode& mode) const
+{
+	mode = rounding_mode == Rv_rounding_mode::dyn ? Rv_rounding_mode(frm) : rounding_mode;
+	return to_underlying(mode) <= to_underlying(Rv_rounding_mode::rmm);
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Operation>
+void Basic_rv_hart<Xlen, Memory_type>::execute_rounded(Rv_register_id rd, Operation operation)
+{
+	Rv_rounding_mode mode;
+	if (!get_rounding_mode(mode)) [[unlikely]]
+	{
+		raise_trap(Rv_trap_cause::illegal_instruction);
+		return;
+	}
+
+	if (mode == Rv_rounding_mode::rne || mode == Rv_rounding_mode::rmm) [[likely]]
+	{
+		write_fp(rd, canonicalize(operation(mode == Rv_rounding_mode::rmm)));
+		return;
+	}
+
+	// The operands are read and the result written while the host mode is set. Switching modes is a call the
+	// compiler can't move those memory accesses across, so the operation can't move either.
+	const Host_rounding_mode host_mode(mode);
+	write_fp(rd, canonicalize(operation(false)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Integer, typename T>
+void Basic_rv_hart<Xlen, Memory_type>::execute_convert_to_integer(Rv_register_id rd, Rv_register_id rs1)
+{
+	Rv_rounding_mode mode;
+	if (!get_rounding_mode(mode)) [[unlikely]]
+	{
+		raise_trap(Rv_trap_cause::illegal_instruction);
+		return;
+	}
+
+	// Rounds in software, so the host mode is left alone
+	// 32-bit results are sign extended on RV64, unsigned ones too
+	set_register(rd, static_cast<Signed>(static_cast<int32_t>(convert_to_integer<Integer>(read_fp<T>(rs1), mode, fflags))));
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Word>
+Word* Basic_rv_hart<Xlen, Memory_type>::get_atomic_word(Register address)
+{
+	return reinterpret_cast<Word*>(memory.get_atomic_pointer(address, sizeof(Word)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Word>
+Word Basic_rv_hart<Xlen, Memory_type>::read_word(Register address) const
+{
+	if constexpr (sizeof(Word) == 8)
+		return memory.read_64(address);
+	else
+		return memory.read_32(address);
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Word>
+void Basic_rv_hart<Xlen, Memory_type>::write_word(Register address, Word value)
+{
+	if constexpr (sizeof(Word) == 8)
+		memory.write_64(address, value);
+	else
+		memory.write_32(address, value);
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Word>
+void Basic_rv_hart<Xlen, Memory_type>::execute_lr(Rv_register_id rd, Rv_register_id rs1)
+{
+	Register address = get_register(rs1);
+	if ((address & (sizeof(Word) - 1)) != 0)
+	{
+		raise_trap(Rv_trap_cause::load_address_misaligned);
+		return;
+	}
+
+	// The word is read after the version, so an atomic write that the version misses changes the word SC compares
+	release_reservation();
+	const uint32_t version = memory.get_reservations().reserve(address);
+	const Word mem = read_word<Word>(address);
+	reservation = Reservation{ address, mem, version, sizeof(Word) };
+
+	// Words are sign extended on RV64
+	set_register(rd, static_cast<Signed>(static_cast<make_signed_t<Word>>(mem)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Word>
+void Basic_rv_hart<Xlen, Memory_type>::execute_sc(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	Register address = get_register(rs1);
+	if ((address & (sizeof(Word) - 1)) != 0)
+	{
+		raise_trap(Rv_trap_cause::store_address_misaligned);
+		return;
+	}
+
+	// The reservation must be for the same address and size: an SC.D never completes an LR.W
+	auto& reservations = memory.get_reservations();
+	bool stored = false;
+	if (reservation && reservation->address == address && reservation->size == sizeof(Word)
+		&& reservations.is_current(address, reservation->version))
+	{
+		auto expected = static_cast<Word>(reservation->value);
+		const auto value = static_cast<Word>(get_register(rs2));
+		if (const auto word = get_atomic_word<Word>(address))
+		{
+			// Only an SC that is going to store notifies a write, before it stores like other writes. Another hart
+			// can still change the word in between, which makes the notification spurious but harmless.
+			const auto host_word = atomic_ref(*word);
+			if (host_word.load() == expected)
+			{
+				memory.notify_atomic_store(address, sizeof(Word));
+				stored = host_word.compare_exchange_strong(expected, value);
+			}
+		}
+		else if (read_word<Word>(address) == expected)
+		{
+			write_word(address, value);
+			stored = true;
+		}
+
+		if (stored)
+			reservations.notify_atomic_write(address);
+	}
+
+	// SC always gives up the reservation, whether it stored or not
+	release_reservation();
+	set_register(rd, stored ? 0 : 1);
+}
+
+template <unsigned Xlen, typename Memory_type>
+template <typename Word, typename Operation>
+void Basic_rv_hart<Xlen, Memory_type>::execute_amo(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Operation operation)
+{
+	Register address = get_register(rs1);
+	if ((address & (sizeof(Word) - 1)) != 0)
+	{
+		raise_trap(Rv_trap_cause::store_address_misaligned);
+		return;
+	}
+
+	const auto value = static_cast<Word>(get_register(rs2));
+	Word old;
+	bool notified = false;
+	if (const auto word = get_atomic_word<Word>(address))
+	{
+		// The write is notified once the operation changes the word, before it is stored like other writes
+		const auto host_word = atomic_ref(*word);
+		old = host_word.load();
+		for (;;)
+		{
+			const Word result = operation(old, value);
+			if (result == old)
+				break;
+
+			if (!notified)
+			{
+				memory.notify_atomic_store(address, sizeof(Word));
+				notified = true;
+			}
+
+			if (host_word.compare_exchange_weak(old, result))
+				break;
+		}
+
+		if (!notified)
+			memory.notify_atomic_load(address, sizeof(Word));
+	}
+	else
+	{
+		// Without host storage, the operation runs on a copy of the word
+		old = read_word<Word>(address);
+		const Word result = operation(old, value);
+		if (result != old)
+			write_word(address, result);
+	}
+
+	// Reservations are lost to every AMO, as they are to other harts' stores, whether it changed the word or not
+	memory.get_reservations().notify_atomic_write(address);
+
+	// Words are sign extended on RV64
+	set_register(rd, static_cast<Signed>(static_cast<make_signed_t<Word>>(old)));
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::release_reservation()
+{
+	if (reservation)
+	{
+		memory.get_reservations().release();
+		reservation.reset();
+	}
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::reset()
 {
 	// Reset all registers to 0
 	for (auto i = 0; i < to_underlying(Rv_register_id::_count); ++i)
 		registers[i] = 0;
+
+	trap = Rv_trap_cause::none;
+	invalidate_all_code();
+
+	if (jit)
+		jit->flush();
+
+	fp_registers.fill(0);
+	fflags = 0;
+	frm = 0;
+	clear_host_fp_flags();
+
+	retired = 0;
+	time_base = chrono::steady_clock::now();
+	release_reservation();
+}
+
+template <unsigned Xlen, typename Memory_type>
+Rv_trap_cause Basic_rv_hart<Xlen, Memory_type>::get_trap() const
+{
+	return trap;
+}
+
+template <unsigned Xlen, typename Memory_type>
+uint64_t Basic_rv_hart<Xlen, Memory_type>::get_instret() const
+{
+	return retired;
+}
+
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::get_state() const -> State
+{
+	return { registers, fp_registers, fflags | get_host_fp_flags(), frm, retired };
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::set_state(const State& state)
+{
+	registers = state.registers;
+	fp_registers = state.fp_registers;
+	fflags = state.fflags;
+	frm = state.frm;
+	clear_host_fp_flags();
+
+	retired = state.retired;
+	trap = Rv_trap_cause::none;
+	release_reservation();
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::raise_trap(Rv_trap_cause cause)
+{
+	trap = cause;
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::access_csr(Rv_register_id rd, Rv_itype_imm csr, bool write, Register set_bits, Register clear_bits)
+{
+	const auto address = static_cast<uint16_t>(csr.get_unsigned());
+
+	Register value;
+	if (!read_csr(address, value) || (write && !write_csr(address, (value & ~clear_bits) | set_bits)))
+	{
+		raise_trap(Rv_trap_cause::illegal_instruction);
+		return;
+	}
+
+	set_register(rd, value);
+}
+
+template <unsigned Xlen, typename Memory_type>
+bool Basic_rv_hart<Xlen, Memory_type>::read_csr(uint16_t csr, Register& value) const
+{
+	const auto instret = retired + retired_in_run;
+	const auto time = instructions_per_microsecond != 0 ? instret / instructions_per_microsecond : static_cast<uint64_t>(
+		chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - time_base).count());
+
+	switch (Rv_csr(csr))
+	{
+	// On RV64 the counters are read whole and their high halves don't exist
+	case Rv_csr::cycle: case Rv_csr::instret: value = static_cast<Register>(instret); return true;
+	case Rv_csr::cycleh: case Rv_csr::instreth: value = static_cast<Register>(instret >> 32); return Xlen == 32;
+	case Rv_csr::time: value = static_cast<Register>(time); return true;
+	case Rv_csr::timeh: value = static_cast<Register>(time >> 32); return Xlen == 32;
+
+	// Flags raised since run() or execute_next started are still held by the host
+	case Rv_csr::fflags: value = fflags | get_host_fp_flags(); return true;
+	case Rv_csr::frm: value = frm; return true;
+	case Rv_csr::fcsr: value = (frm << 5) | fflags | get_host_fp_flags(); return true;
+
+	case Rv_csr::mhartid: value = hart_id; return true;
+	}
+
+	return false;
+}
+
+template <unsigned Xlen, typename Memory_type>
+bool Basic_rv_hart<Xlen, Memory_type>::write_csr(uint16_t csr, Register value)
+{
+	// The counters are read-only. Writes to fflags replace the flags the host holds too.
+	switch (Rv_csr(csr))
+	{
+	case Rv_csr::fflags:
+		fflags = value & Rv_fp_flags::all;
+		clear_host_fp_flags();
+		return true;
+
+	case Rv_csr::frm:
+		frm = value & 0b111;
+		return true;
+
+	case Rv_csr::fcsr:
+		fflags = value & Rv_fp_flags::all;
+		frm = (value >> 5) & 0b111;
+		clear_host_fp_flags();
+		return true;
+
+	case Rv_csr::cycle: case Rv_csr::cycleh:
+	case Rv_csr::time: case Rv_csr::timeh:
+	case Rv_csr::instret: case Rv_csr::instreth:
+	case Rv_csr::mhartid:
+		return false;
+	}
+
+	return false;
+}
+
+template <unsigned Xlen, typename Memory_type>
+auto Basic_rv_hart<Xlen, Memory_type>::find_breakpoint_page(uint64_t page) const -> const Breakpoint_page*
+{
+	const auto it = breakpoint_pages.find(page);
+	return it != breakpoint_pages.end() ? &it->second : nullptr;
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::invalidate_code_page(uint64_t page)
+{
+	const auto lock = lock_guard(remote_mutex);
+	if (!is_running_elsewhere())
+	{
+		discard_code_page(page);
+		return;
+	}
+
+	remote_pages.push_back(page);
+	stop_requested.store(true, memory_order_relaxed);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::invalidate_all_code()
+{
+	const auto lock = lock_guard(remote_mutex);
+	if (!is_running_elsewhere())
+	{
+		discard_all_code();
+		return;
+	}
+
+	remote_invalidate_all = true;
+	stop_requested.store(true, memory_order_relaxed);
+}
+
+template <unsigned Xlen, typename Memory_type>
+bool Basic_rv_hart<Xlen, Memory_type>::is_running_elsewhere() const
+{
+	const auto thread = running_thread.load(memory_order_relaxed);
+	return thread != thread::id() && thread != this_thread::get_id();
+}
+
+template <unsigned Xlen, typename Memory_type>
+bool Basic_rv_hart<Xlen, Memory_type>::apply_remote_invalidations()
+{
+	{
+		const auto lock = lock_guard(remote_mutex);
+		stop_requested.store(false);
+		if (remote_invalidate_all)
+			discard_all_code();
+		else
+			for (const auto page : remote_pages)
+				discard_code_page(page);
+
+		remote_pages.clear();
+		remote_invalidate_all = false;
+	}
+
+	// A halt requested since the stop was raised still stops the run. Checked after clearing the stop, so a
+	// request that comes after the check raises it again.
+	if (!halt_requested.load())
+		return true;
+
+	stop_requested.store(true);
+	return false;
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::discard_code_page(uint64_t page)
+{
+	constexpr auto page_bits = Memory_type::code_page_bits;
+	const auto in_page = [page](Register first, Register last) {
+		return (first >> page_bits) == page || (last >> page_bits) == page;
+	};
+
+	// A page maps onto a contiguous run of cache slots. The slot before them can hold an instruction that crosses
+	// into the page. Only entries for instructions that overlap the page are dropped.
+	constexpr uint32_t slots_per_page = (1 << page_bits) / 4;
+	static_assert(slots_per_page < instruction_cache_size);
+
+	const uint32_t first_slot = static_cast<uint32_t>((page << page_bits) >> 2) - 1;
+	for (uint32_t i = 0; i <= slots_per_page; ++i)
+	{
+		auto& entry = instruction_cache[(first_slot + i) & (instruction_cache_size - 1)];
+		if (in_page(entry.pc, entry.pc + 3))
+			entry.type = Rv32i_instruction_type::invalid;
+	}
+
+	const auto page_blocks = blocks_by_page.find(page);
+	if (page_blocks != blocks_by_page.end())
+	{
+		for (auto block : page_blocks->second)
+			retire_block(*block);
+
+		blocks_by_page.erase(page_blocks);
+	}
+
+	// Blocks from the previous page that cross into this one
+	const auto previous_page_blocks = blocks_by_page.find((page - 1) & (numeric_limits<Register>::max() >> page_bits));
+	if (previous_page_blocks != blocks_by_page.end())
+	{
+		erase_if(previous_page_blocks->second, [&](Basic_block* block) {
+			if (!in_page(block->pc, block->end - 1))
+				return false;
+
+			retire_block(*block);
+			return true;
+		});
+	}
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::discard_all_code()
+{
+	for (auto& entry : instruction_cache)
+		entry.type = Rv32i_instruction_type::invalid;
+
+	for (auto& [address, block] : blocks)
+	{
+		block->valid = false;
+		retired_blocks.push_back(std::move(block));
+	}
+
+	blocks.clear();
+	blocks_by_page.clear();
+	ranges::fill(block_lookup, nullptr);
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Basic_rv_hart<Xlen, Memory_type>::on_watchpoint_hit(const Watchpoint_hit& hit)
+{
+	// Keep the first hit. The interpreter and translated code check for it after the access and stop there.
+	// Accesses by harts on other threads that share the memory are theirs.
+	if (running_thread.load(memory_order_relaxed) != this_thread::get_id() || !watching || watchpoint_hit)
+		return;
+
+	watchpoint_hit = hit;
+	stop_requested.store(true, memory_order_relaxed);
 }
 
+// Explicit instantiations for the memory backends. Basic_rv32_hart<Memory> is the type-erased Rv32_hart and
+// Basic_rv64_hart<Memory_64> the type-erased Rv64_hart.
+
+template class Basic_rv_hart<32, Memory>;
+template class Basic_rv_hart<32, Mapped_memory>;
+template class Basic_rv_hart<32, Paged_memory>;
+template class Basic_rv_hart<32, Buffered_memory>;
+template class Basic_rv_hart<64, Memory_64>;
+template class Basic_rv_hart<64, Radix_memory>;
+
 }
@@ -1,67 +1,696 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "buffered-memory.h"
+#include "mapped-memory.h"
 #include "memory.h"
+#include "paged-memory.h"
+#include "radix-memory.h"
 #include "rv32.h"
+#include "rv32-jit.h"
 
 namespace riscv_sim {
 
-class Rv32_hart
+template <unsigned Xlen, typename Memory_type>
+struct Instruction_executor;
+
+/** Why Basic_rv_hart::run returned. */
+enum class Rv_stop_reason : uint8_t
+{
+	budget_exhausted, // max_instructions were executed
+	trap,             // An instruction trapped. PC points at it.
+	breakpoint,       // PC reached a breakpoint. The instruction there has not been executed.
+	halted,           // request_halt was called
+	watchpoint,       // The last instruction executed accessed a watched memory range
+	atomic,           // PC reached an atomic instruction while set_stop_before_atomics was on. It has not been executed.
+};
+
+/** Result of Basic_rv_hart::run. */
+struct Rv_run_result
+{
+	uint64_t retired = 0; // Instructions executed, not counting a trapping instruction
+	Rv_stop_reason reason = Rv_stop_reason::budget_exhausted;
+	Rv_trap_cause trap = Rv_trap_cause::none;
+};
+
+/** How a hart runs instructions in run(). */
+enum class Rv32_engine
+{
+	interpreter, // Basic block interpreter
+	jit,         // Hot blocks are translated to host machine code. Falls back to the interpreter where it isn't available.
+};
+
+/**
+RISC-V hart of width Xlen, bound to a memory type at compile time. RV32 harts implement RV32IMAFD with the Zicsr,
+Zicntr, Zba, Zbb and Zbs extensions, and compressed instructions (C) can be enabled. RV64 harts implement RV64IMA
+with Zicsr and Zicntr. The width is fixed at compile time, so neither has runtime
+width checks: registers and addresses are Register, and each width decodes with its own Rv_decoder.
+
+When Memory_type is a concrete (final) memory backend, memory accesses are resolved statically and can be
+inlined into the instruction executors. Use Rv32_hart to access memory through the virtual Memory interface.
+
+Decoded instructions are kept in a direct-mapped cache keyed by PC for execute_next, and grouped into basic blocks
+for run, so each instruction in a loop is only fetched and decoded once. The hart registers itself with the memory
+as a code cache; writes to memory that hold cached instructions (from the guest or the host) invalidate the
+affected entries and blocks.
+
+With the JIT engine, blocks that have run jit_threshold times are translated to host machine code by Rv32_jit.
+RV64 harts always interpret. Translated code stops before anything it can't handle and the interpreter takes over, so both engines give
+identical results.
+
+Instructions don't throw when they trap (ECALL, EBREAK, misaligned jumps and atomics, illegal instructions). The trap is
+returned by execute_next and run, and the trapping instruction has no effect.
+
+The hart retires one instruction per cycle, so the cycle and instret counters read the same. Neither is incremented
+per instruction: they are computed from the instructions run() and execute_next have retired when a CSR instruction
+reads them. The time counter counts microseconds of host time since reset, or instructions scaled by
+set_virtual_time.
+
+Floating-point instructions run on the host FPU. Round to nearest, ties to even runs without switching the host
+rounding mode; the directed modes switch it around the instruction and ties to max magnitude corrects the host's
+result. Exception flags are accrued by the host too: run() and execute_next clear the host's flags when they start
+and add them to fflags when they return, and reads of fflags include the flags raised so far. The host's flags
+are clobbered and the host must be in round to nearest. Instructions called directly raise their flags on the
+host, where CSR reads see them.
+
+Harts that share a memory can run on different host threads (see Smp_system). Each hart still belongs to the thread
+that runs it: only request_halt may be called from elsewhere. Code that another thread overwrites while the hart runs
+is discarded by the hart itself at its next block boundary, so stale instructions can run until then, as they can
+on hardware until FENCE.I. FENCE is a full host memory fence.
+
+AMOs are sequentially consistent host atomics on the word that backs the address, whatever their aq and rl bits.
+LR reserves the word in the memory's Reservation_table and SC stores with a host compare-and-swap if the reservation
+still holds, so LR/SC pairs have CAS semantics (see Reservation_table). Atomics on memory without host storage behind
+get_span fall back to a read and a write, which are only atomic if no other thread runs a hart on the memory.
+*/
+template <unsigned Xlen, typename Memory_type>
+class Basic_rv_hart : private Code_cache, private Watchpoint_listener
 {
 public:
-	Rv32_hart(Memory& memory);
+	using Register = typename Rv_xlen<Xlen>::Unsigned;
+	using Signed = typename Rv_xlen<Xlen>::Signed;
+
+	Basic_rv_hart(Memory_type& memory, Rv32_engine engine = Rv32_engine::interpreter);
+	~Basic_rv_hart();
+
+	// The hart is registered with its memory by address
+	Basic_rv_hart(const Basic_rv_hart&) = delete;
+	Basic_rv_hart& operator=(const Basic_rv_hart&) = delete;
 
 	void execute_add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_addi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_addiw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_addw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoadd_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoand_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoand_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amomax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amomax_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amomaxu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amomaxu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amomin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amomin_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amominu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amominu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoswap_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoswap_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoxor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_amoxor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_and(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_andi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_andn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_auipc(Rv_register_id rd, Rv_utype_imm imm);
+	void execute_bclr(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_bclri(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_beq(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
+	void execute_bext(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_bexti(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_bge(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
 	void execute_bgeu(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
+	void execute_binv(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_binvi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_blt(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
 	void execute_bltu(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
 	void execute_bne(Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm);
+	void execute_bset(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_bseti(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_clz(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_cpop(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_csrrc(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_csrrci(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_csrrs(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_csrrsi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_csrrw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_csrrwi(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_ctz(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_div(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_divu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_divuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_divw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_ebreak(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_ecall(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_fadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fclass_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fclass_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_d_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_d_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_d_wu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_s_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_s_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_s_wu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_w_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_w_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_wu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fcvt_wu_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fdiv_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fdiv_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_fence(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_feq_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_feq_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fld(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_fle_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fle_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_flt_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_flt_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_flw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_fmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fmax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fmax_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fmin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fmin_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fmul_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fmul_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fmv_w_x(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fmv_x_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fnmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fnmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fnmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fnmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	void execute_fsd(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
+	void execute_fsgnj_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsgnj_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsgnjn_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsgnjn_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsgnjx_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsgnjx_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsqrt_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsqrt_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_fsw(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
 	void execute_jal(Rv_register_id rd, Rv_jtype_imm imm);
 	void execute_jalr(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_lb(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_lbu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_ld(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_lh(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_lhu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_lr_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_lr_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_lw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_lwu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_lui(Rv_register_id rd, Rv_utype_imm imm);
-	void execute_next();
+	void execute_max(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_maxu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_min(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_minu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_mul(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_mulh(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_mulhsu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_mulhu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_mulw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+
+	/**
+	Executes the instruction at PC. Returns Rv_trap_cause::none if it was executed, otherwise why it trapped.
+	Must not be used while other threads run harts on the same memory: only run() picks up their code writes.
+	*/
+	Rv_trap_cause execute_next();
+
+	/**
+	Executes up to max_instructions with the hart's engine. Stops early at an instruction that traps, without
+	executing it, so the caller can handle it (e.g. service an ECALL and move PC past it). Also stops before the
+	instruction at a breakpoint, unless it is the first instruction run, so a run started at a breakpoint
+	continues past it.
+	*/
+	Rv_run_result run(uint64_t max_instructions);
+
+	/**
+	Makes the current or next run() return Rv_stop_reason::halted at the next block boundary. Can be called
+	from any thread. The request is cleared when run() returns because of it.
+	*/
+	void request_halt();
+
+	/** Drops a halt that no run() has returned for. Must not be called while the hart runs. */
+	void clear_halt_request();
+
+	/** Breakpoints stop run() before the instruction at the address is executed. */
+	void add_breakpoint(Register address);
+	void remove_breakpoint(Register address);
+	bool has_breakpoint(Register address) const;
+
+	/**
+	Gets the access that made the last run() return Rv_stop_reason::watchpoint. Watchpoints are set on the memory.
+	run() stops right after the access, in the interpreter and in translated code, which sends loads of watched
+	pages through the memory.
+	*/
+	std::optional<Watchpoint_hit> get_watchpoint_hit() const;
+
+	Rv32_engine get_engine() const;
+
+	/**
+	Enables the C extension. Compressed instructions are then expanded to their 32-bit equivalents when they are
+	decoded, and jump and branch targets only need 2-byte alignment. Without it, compressed encodings are illegal and
+	targets need 4-byte alignment. Disabled by default. RV32 only.
+	*/
+	void set_compressed_enabled(bool enabled) requires (Xlen == 32);
+	bool is_compressed_enabled() const;
+
+	/** Sets how many times a block is interpreted before the JIT translates it. */
+	void set_jit_threshold(uint32_t executions);
+
+	/** Sets the ID the mhartid CSR reads. Harts that share a memory need distinct IDs. 0 by default. */
+	void set_hart_id(Register id);
+	Register get_hart_id() const;
+
+	/**
+	Makes run() stop before atomic instructions with Rv_stop_reason::atomic, including one it starts at, so a
+	scheduler can run them while no other hart runs (see Deterministic_system). Off by default.
+	*/
+	void set_stop_before_atomics(bool stop);
+
+	/**
+	Makes the time counter advance a microsecond per instructions_per_microsecond instructions retired instead of
+	with host time, so it reads the same in every run. 0, the default, goes back to host time.
+	*/
+	void set_virtual_time(uint32_t instructions_per_microsecond);
+
+	/**
+	Counts the edges run() takes between blocks in an AFL-style map of rv_coverage_map_size 8-bit counters, or stops
+	counting if map is null. Each block that runs to its end adds one to the counter at the get_coverage_location of
+	the address it continues at, XORed with half the location of the block before. Blocks that stop early, where
+	translated code hands an instruction to the interpreter or a store overwrites the block, take no edge, so both
+	engines count the same. run() also counts the edge into the address each run starts at. The map must stay valid
+	while it is set.
+	*/
+	void set_coverage_map(uint8_t* map);
+
+	/** Forgets the block run() left last, so the next edge counted starts from location 0, as in a new process. */
+	void reset_coverage_location();
+
 	void execute_or(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_orc_b(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_ori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_orn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_rem(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_remu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_remuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_remw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_rev8(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_rol(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_ror(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_rori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_sb(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
+	void execute_sc_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_sc_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_sd(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
+	void execute_sext_b(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_sext_h(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_sh(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
+	void execute_sh1add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_sh2add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_sh3add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_sll(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_sllw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_slt(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_sltu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_slli(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_slliw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_slti(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_sltiu(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
 	void execute_sra(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_srai(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_sraiw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_sraw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_srl(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_srli(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_srliw(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_srlw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_sub(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	void execute_subw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_sw(Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
+	void execute_xnor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_xor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	void execute_xori(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	void execute_zext_h(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+
+	Register get_register(Rv_register_id register_id);
+	void set_register(Rv_register_id register_id, Register value);
 
-	uint32_t get_register(Rv_register_id register_id);
-	void set_register(Rv_register_id register_id, uint32_t value);
+	/** Floating-point registers hold doubles, or singles NaN-boxed with the upper 32 bits set. */
+	uint64_t get_fp_register(Rv_register_id register_id) const;
+	void set_fp_register(Rv_register_id register_id, uint64_t value);
+
+	/** Gets the trap raised by the last execute_* method called directly. execute_next and run return traps instead. */
+	Rv_trap_cause get_trap() const;
+
+	/** Gets the number of instructions retired since reset, as the instret counter reads it outside of run(). */
+	uint64_t get_instret() const;
 
 	void reset();
 
+	/**
+	The architectural state of a hart, as saved with a memory snapshot: the registers, the floating-point state and
+	the instructions retired. Cached code, breakpoints and settings aren't part of it.
+	*/
+	struct State
+	{
+		std::array<Register, (size_t)Rv_register_id::_count> registers;
+		std::array<uint64_t, 32> fp_registers;
+		uint32_t fflags;
+		uint32_t frm;
+		uint64_t retired;
+	};
+
+	State get_state() const;
+
+	/** Sets the architectural state. Drops the hart's LR reservation, which a snapshot doesn't hold. */
+	void set_state(const State& state);
+
 private:
-	Memory& memory;
-	std::array<uint32_t, (size_t)Rv_register_id::_count> registers;
+	using Decoder = Rv_decoder<Xlen>;
+
+	/** Operands of a decoded instruction, stored in the format of the instruction. */
+	union Decoded_operands
+	{
+		Decoded_operands() : raw(0) {}
+
+		uint32_t raw;
+		Rv_btype_instruction btype;
+		Rv_itype_instruction itype;
+		Rv_jtype_instruction jtype;
+		Rv_rtype_instruction rtype;
+		Rv_r4type_instruction r4type;
+		Rv_stype_instruction stype;
+		Rv_utype_instruction utype;
+	};
+
+	/** An instruction that has been fetched and decoded, along with the executor that runs it. */
+	struct Cached_instruction
+	{
+		Register pc = 0;
+		Rv32i_instruction_type type = Rv32i_instruction_type::invalid; // Invalid if the entry is empty
+		uint8_t length = 4; // 2 for compressed instructions
+		const Instruction_executor<Xlen, Memory_type>* executor = nullptr;
+		Decoded_operands decoded;
+	};
+
+	struct Basic_block;
+
+	/** Translated code for a block. Only valid while generation matches the JIT's generation. */
+	struct Native_code
+	{
+		Rv32_jit::Block_function function = nullptr; // Null if the code couldn't be translated
+		uint64_t generation = 0;
+	};
+
+	struct Block_instruction
+	{
+		Rv32i_instruction_type type;
+		uint8_t length; // 2 for compressed instructions
+		Decoded_operands decoded;
+	};
+
+	/** The block that execution continued with the last time a block ended at pc. */
+	struct Block_link
+	{
+		Register pc = 0;
+		Basic_block* block = nullptr;
+	};
+
+	/**
+	Straight-line instructions that end at a branch, jump, ECALL/EBREAK, illegal instruction or the end of a code
+	page. Only a first instruction at a misaligned PC can cross into the next page.
+	*/
+	struct Basic_block
+	{
+		Register pc = 0;
+		Register end = 0;               // Address after the last instruction
+		uint32_t instruction_count = 0; // 0 if the block starts at an illegal instruction
+		bool valid = true;              // Cleared when the block's page is written
+		bool breakpoint = false;        // A breakpoint is set at pc. Breakpoints never fall inside a block.
+		uint32_t execution_count = 0;   // Counts up to the JIT threshold
+		std::array<Block_link, 2> links;
+		Native_code native;             // Whole block
+		Native_code native_step;        // First instruction only, for when fewer instructions remain than the block has
+		std::vector<Block_instruction> instructions; // Terminated by an entry of type invalid
+	};
+
+	/** One bit per byte of a code page that has breakpoints. */
+	using Breakpoint_page = std::bitset<1 << Memory_type::code_page_bits>;
+
+	// 4096 entries cover 16 KiB of straight-line code. Compressed instructions in the same word share a slot.
+	static constexpr uint32_t instruction_cache_bits = 12;
+	static constexpr uint32_t instruction_cache_size = 1 << instruction_cache_bits;
+
+	static constexpr uint32_t max_block_instructions = 64;
+
+	static constexpr uint32_t default_jit_threshold = 16;
+
+	static void decode_operands(Rv32_instruction_format format, uint32_t instruction, Decoded_operands& operands);
+
+	/**
+	Reads the instruction at the address and sets length to its size in bytes. Compressed instructions are returned
+	expanded. Fetches don't hit watchpoints.
+	*/
+	uint32_t fetch_instruction(Register address, uint8_t& length);
+
+	/** Fetches and decodes the instruction at the address and stores it in the instruction cache. Returns null if it is illegal. */
+	const Cached_instruction* fill_instruction_cache(Register address);
+
+	/** Gets the block starting at the address, translating it if needed. */
+	Basic_block* find_block(Register address);
+
+	/** Gets the block to continue with after a block ends with pc at the address, and links the two blocks. */
+	Basic_block* find_next_block(Basic_block& from, Register address);
+
+	/** Counts the edge from the last block into the block at the address in the coverage map. */
+	void count_coverage_edge(Register address);
+
+	Basic_block* create_block(Register address);
+
+	/** Gets the breakpoints in the code page (address >> Memory_type::code_page_bits), or null if it has none. */
+	const Breakpoint_page* find_breakpoint_page(uint64_t page) const;
+
+	/**
+	Runs blocks with the interpreter. The caller must free retired blocks and clear the trap. retired_before is the
+	number of instructions the run has already retired, which counter reads include.
+	*/
+	Rv_run_result run_interpreter(uint64_t max_instructions, uint64_t retired_before = 0);
+
+	/** Runs blocks with translated code where possible. The caller must free retired blocks and clear the trap. */
+	Rv_run_result run_jit(uint64_t max_instructions) requires (Xlen == 32);
+
+	/** Records a trap. The executor must return without changing any state. */
+	void raise_trap(Rv_trap_cause cause);
+
+	/**
+	Reads the CSR, sets its new value to (value & ~clear_bits) | set_bits if write is true and writes the old value
+	to rd. Traps as an illegal instruction if the CSR isn't implemented or a write goes to a read-only CSR.
+	*/
+	void access_csr(Rv_register_id rd, Rv_itype_imm csr, bool write, Register set_bits, Register clear_bits);
+
+	/** Reads a CSR. Returns false if it isn't implemented. */
+	bool read_csr(uint16_t csr, Register& value) const;
+
+	/** Writes a CSR. Returns false without changing anything if it is read-only or isn't implemented. */
+	bool write_csr(uint16_t csr, Register value);
+
+	/** Gets the rounding mode of the instruction being executed, resolving DYN with frm. Returns false if it is invalid. */
+	bool get_rounding_mode(Rv_rounding_mode& mode) const;
+
+	/**
+	Runs a floating-point operation in the instruction's rounding mode and writes its float or double result to rd,
+	with NaNs made canonical. The operation gets whether ties round away from zero, and runs with the host in the
+	mode otherwise. Traps as an illegal instruction if the rounding mode is invalid.
+	*/
+	template <typename Operation>
+	void execute_rounded(Rv_register_id rd, Operation operation);
+
+	/** Converts a floating-point register to an integer register in the instruction's rounding mode. */
+	template <typename Integer, typename T>
+	void execute_convert_to_integer(Rv_register_id rd, Rv_register_id rs1);
+
+	/** Reads a floating-point register as a float, unboxing it, or as a double. */
+	template <typename T>
+	T read_fp(Rv_register_id register_id) const;
+
+	/** Writes a float, NaN-boxed, or a double to a floating-point register. */
+	void write_fp(Rv_register_id register_id, float value);
+	void write_fp(Rv_register_id register_id, double value);
+
+	/**
+	Gets the host word that backs the word at the address, for atomic access, or null if the memory has no host
+	storage behind it. Word is uint32_t or uint64_t. Nothing is notified: stores through it must call
+	Basic_memory::notify_atomic_store first.
+	*/
+	template <typename Word>
+	Word* get_atomic_word(Register address);
+
+	/** Reads or writes a word of type Word through the memory's accessors, for atomics without host storage. */
+	template <typename Word>
+	Word read_word(Register address) const;
+	template <typename Word>
+	void write_word(Register address, Word value);
+
+	/** Runs LR or SC on a word of type Word. Both trap if the address is misaligned. */
+	template <typename Word>
+	void execute_lr(Rv_register_id rd, Rv_register_id rs1);
+	template <typename Word>
+	void execute_sc(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+
+	/**
+	Runs an AMO: atomically replaces the word of type Word at rs1 with operation(word, rs2) and writes the old word
+	to rd, sign extended. The operation returns the new word. AMOs that leave the word as it was don't store, so
+	they notify a read. Traps if the address is misaligned.
+	*/
+	template <typename Word, typename Operation>
+	void execute_amo(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Operation operation);
+
+	/** Drops the LR reservation, if the hart holds one. */
+	void release_reservation();
+
+	/** Gets the translated code for the block, or for its first instruction only, translating it if needed. */
+	Rv32_jit::Block_function get_native_code(Basic_block& block, bool step) requires (Xlen == 32);
+
+	static Rv32_jit_memory_access get_jit_memory_access(Memory_type& memory) requires (Xlen == 32);
+
+	/** Removes a block from the lookup structures. It is freed at the next call to free_retired_blocks. */
+	void retire_block(Basic_block& block);
+
+	/** Frees retired blocks after unlinking them. Must not be called while a block is executing. */
+	void free_retired_blocks();
+
+	void invalidate_code_page(uint64_t page) override;
+	void invalidate_all_code() override;
+
+	// Discard cached code. invalidate_code_page and invalidate_all_code call them directly unless another thread
+	// is running the hart, in which case the hart calls them from apply_remote_invalidations.
+	void discard_code_page(uint64_t page);
+	void discard_all_code();
+
+	/** Whether the hart is in run() on a thread other than the calling one. remote_mutex must be held. */
+	bool is_running_elsewhere() const;
+
+	/**
+	Discards the code queued by other threads and clears stop_requested. Must not be called while a block is
+	executing. Returns false if run() must stop because a halt was requested.
+	*/
+	bool apply_remote_invalidations();
+
+	void on_watchpoint_hit(const Watchpoint_hit& hit) override;
+
+	Memory_type& memory;
+	std::array<Register, (size_t)Rv_register_id::_count> registers;
+	Rv_trap_cause trap = Rv_trap_cause::none; // Set by executors, only checked after instructions that can trap
+
+	// Length of the branch or jump being executed, for the return address and the not-taken PC. Set before they
+	// run rather than passed in, so the executors keep the signatures of the other instructions.
+	uint8_t instruction_length = 4;
+
+	// Rounding mode field of the floating-point instruction being executed, set before it runs like
+	// instruction_length
+	Rv_rounding_mode rounding_mode = Rv_rounding_mode::rne;
+
+	std::array<uint64_t, 32> fp_registers;
+	uint32_t fflags = 0; // Accrued exception flags, without those still held by the host
+	uint32_t frm = 0;    // Dynamic rounding mode
+
+	bool compressed_enabled = false;
+	uint32_t misaligned_target_mask = 0b11; // Bits that must be clear in jump and branch targets
+
+	// Counters are derived from these when they are read
+	uint64_t retired = 0;        // Instructions retired before the current run() or execute_next call
+	uint64_t retired_in_run = 0; // Set by the interpreter before CSR instructions. 0 outside of run().
+	std::chrono::steady_clock::time_point time_base = std::chrono::steady_clock::now();
+	std::vector<Cached_instruction> instruction_cache;
+
+	std::unordered_map<Register, std::unique_ptr<Basic_block>> blocks; // Keyed by start address
+	std::unordered_map<uint64_t, std::vector<Basic_block*>> blocks_by_page;
+	std::vector<Basic_block*> block_lookup; // Direct-mapped by start address, in front of blocks
+	std::vector<std::unique_ptr<Basic_block>> retired_blocks;
+
+	// Only code pages with breakpoints have an entry. Blocks are split at breakpoints and flag them when created,
+	// so run() doesn't look breakpoints up while it executes.
+	std::unordered_map<uint64_t, Breakpoint_page> breakpoint_pages;
+
+	// Polled by run() at block boundaries, including by translated code. Set for halt requests, watchpoint hits
+	// and code invalidated by other threads. Only halt_requested makes run() return for the first and last.
+	std::atomic<bool> stop_requested = false;
+	std::atomic<bool> halt_requested = false;
+
+	// Code pages written by other threads while the hart runs, discarded by the hart at its next block boundary
+	std::mutex remote_mutex;
+	std::atomic<std::thread::id> running_thread; // Set while run() executes. Written under remote_mutex.
+	std::vector<uint64_t> remote_pages;
+	bool remote_invalidate_all = false;
+
+	// A watchpoint hit stops run() like a halt request. Hits outside run() and from instruction fetches are ignored.
+	std::optional<Watchpoint_hit> watchpoint_hit;
+	bool watching = false; // Set while run() executes instructions
+
+	Rv32_engine engine;
+	std::unique_ptr<Rv32_jit> jit; // Null unless the engine is the JIT, it is available and the hart is RV32
+	uint32_t jit_threshold = default_jit_threshold;
+	Register hart_id = 0;
+	bool stop_before_atomics = false;
+	uint32_t instructions_per_microsecond = 0; // 0 for host time
+	uint8_t* coverage_map = nullptr;
+	uint32_t coverage_location = 0; // Location of the last block entered, halved as AFL does
+
+	/** An LR reservation: the word LR read, its size and the version of its granule in the memory's Reservation_table. */
+	struct Reservation
+	{
+		Register address;
+		uint64_t value;
+		uint32_t version;
+		uint32_t size;
+	};
+
+	std::optional<Reservation> reservation;
 };
 
+template <typename Memory_type>
+using Basic_rv32_hart = Basic_rv_hart<32, Memory_type>;
+
+template <typename Memory_type>
+using Basic_rv64_hart = Basic_rv_hart<64, Memory_type>;
+
+/** Harts that access memory through the virtual Memory and Memory_64 interfaces. Work with any memory backend. */
+using Rv32_hart = Basic_rv32_hart<Memory>;
+using Rv64_hart = Basic_rv64_hart<Memory_64>;
+
+extern template class Basic_rv_hart<32, Memory>;
+extern template class Basic_rv_hart<32, Mapped_memory>;
+extern template class Basic_rv_hart<32, Paged_memory>;
+extern template class Basic_rv_hart<32, Buffered_memory>;
+extern template class Basic_rv_hart<64, Memory_64>;
+extern template class Basic_rv_hart<64, Radix_memory>;
+
 }
@@ -0,0 +1,895 @@
+#include "rv32-jit.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "x86-64-emitter.h"
+
+using namespace std;
+
+namespace riscv_sim {
+
+using enum X86_64_register;
+using Condition = X86_64_condition;
+using Alu_op = X86_64_alu_op;
+using Shift_op = X86_64_shift_op;
+using Bit_count_op = X86_64_bit_count_op;
+using Bit_op = X86_64_bit_op;
+using Label = X86_64_emitter::Label;
+
+// Integer argument registers of the host calling convention
+#ifdef _WIN32
+static constexpr auto c_arg0 = rcx;
+static constexpr auto c_arg1 = rdx;
+static constexpr auto c_arg2 = r8;
+#else
+static constexpr auto c_arg0 = rdi;
+static constexpr auto c_arg1 = rsi;
+static constexpr auto c_arg2 = rdx;
+#endif
+
+// Registers that live for the whole block. All are callee-saved in both calling conventions.
+static constexpr auto c_registers = rbx; // Guest register array
+static constexpr auto c_memory = r12;    // Rv32_jit_memory_access::memory
+static constexpr auto c_executed = r13;  // Instructions executed by earlier iterations of the block
+static constexpr auto c_budget = r14;    // Most instructions the function may execute
+
+static constexpr int32_t c_pc_offset = 4 * static_cast<int32_t>(Rv_register_id::pc);
+
+// Pages of Rv32_jit_memory_access::host_pages
+static constexpr uint8_t c_page_bits = 12;
+static constexpr int32_t c_page_size = 1 << c_page_bits;
+
+// Division has several special cases and is slow anyway, so translated code calls these instead of inlining it.
+// Division by zero and overflow give the results the spec defines and don't trap.
+
+static uint32_t jit_div(uint32_t dividend, uint32_t divisor)
+{
+	if (divisor == 0)
+		return 0xFFFF'FFFF;
+
+	if (dividend == 0x8000'0000 && divisor == 0xFFFF'FFFF)
+		return dividend;
+
+	return static_cast<uint32_t>(static_cast<int32_t>(dividend) / static_cast<int32_t>(divisor));
+}
+
+static uint32_t jit_divu(uint32_t dividend, uint32_t divisor)
+{
+	return divisor == 0 ? 0xFFFF'FFFF : dividend / divisor;
+}
+
+static uint32_t jit_rem(uint32_t dividend, uint32_t divisor)
+{
+	if (divisor == 0)
+		return dividend;
+
+	if (dividend == 0x8000'0000 && divisor == 0xFFFF'FFFF)
+		return 0;
+
+	return static_cast<uint32_t>(static_cast<int32_t>(dividend) % static_cast<int32_t>(divisor));
+}
+
+static uint32_t jit_remu(uint32_t dividend, uint32_t divisor)
+{
+	return divisor == 0 ? dividend : dividend % divisor;
+}
+
+/**
+True if the host has LZCNT, TZCNT and POPCNT. Without them, clz, ctz and cpop are left to the interpreter: older
+hosts run the LZCNT and TZCNT encodings as BSR and BSF, which give different results.
+*/
+static bool host_has_bit_count()
+{
+	static const bool supported = [] {
+		uint32_t leaf_1_ecx = 0, leaf_7_ebx = 0, extended_ecx = 0;
+#if defined(_MSC_VER) && defined(_M_X64)
+		int info[4];
+		__cpuid(info, 1);
+		leaf_1_ecx = info[2];
+		__cpuidex(info, 7, 0);
+		leaf_7_ebx = info[1];
+		__cpuid(info, 0x8000'0001);
+		extended_ecx = info[2];
+#elif defined(__x86_64__)
+		unsigned int a, b, c, d;
+		if (__get_cpuid(1, &a, &b, &c, &d))
+			leaf_1_ecx = c;
+		if (__get_cpuid_count(7, 0, &a, &b, &c, &d))
+			leaf_7_ebx = b;
+		if (__get_cpuid(0x8000'0001, &a, &b, &c, &d))
+			extended_ecx = c;
+#endif
+		const bool popcnt = leaf_1_ecx & (1 << 23);
+		const bool tzcnt = leaf_7_ebx & (1 << 3); // BMI1
+		const bool lzcnt = extended_ecx & (1 << 5); // ABM
+		return popcnt && tzcnt && lzcnt;
+	}();
+
+	return supported;
+}
+
+/** Offset of a guest register in the register array. */
+static int32_t get_offset(Rv_register_id reg)
+{
+	return 4 * static_cast<int32_t>(reg);
+}
+
+/** Emits the code for one block. Holds the exits that are placed after the block body. */
+class Block_translator
+{
+public:
+	Block_translator(X86_64_emitter& emitter, const Rv32_jit_memory_access& memory_access,
+		const std::atomic<bool>* halt_requested, uint32_t pc, const bool* valid, uint32_t target_alignment,
+		uint8_t* coverage_map, const uint64_t* watched_pages)
+		: emitter(emitter), memory_access(memory_access), halt_requested(halt_requested), pc(pc), valid(valid),
+		target_alignment(target_alignment), coverage_map(coverage_map), watched_pages(watched_pages)
+	{
+	}
+
+	void emit_prologue();
+
+	/** Emits the exits and the epilogue. length is the number of instructions translated. */
+	void emit_epilogue(uint32_t length);
+
+	/** Emits the instruction. Returns false if it can't be translated, without emitting anything. */
+	bool emit_instruction(const Rv32_jit_instruction& inst, uint32_t executed_before);
+
+	/** Returns true if the last instruction emitted ended the block. */
+	bool has_ended() const { return ended; }
+
+	/** Sets PC and returns the number of instructions executed, counting executed from this iteration. */
+	void emit_exit(uint32_t pc, uint32_t executed);
+
+private:
+	struct Pending_exit
+	{
+		std::unique_ptr<Label> label;
+		uint32_t pc;
+		uint32_t executed;
+		bool loop; // Jumps back to the start of the block if the budget allows
+	};
+
+	/** Gets a label that exits with the PC and count when jumped to. The exit is emitted after the block body. */
+	Label& add_exit(uint32_t pc, uint32_t executed);
+
+	/** Gets a label for a jump to the address. Jumps to the start of the block loop, others exit. */
+	Label& add_jump(uint32_t target, uint32_t executed);
+
+	void emit_call(const void* function);
+
+	/** Emits a return after a call to a memory access function if watchpoints are set and a halt was requested. */
+	void emit_watchpoint_exit(const Rv32_jit_instruction& inst, uint32_t executed);
+
+	void emit_load(const Rv32_jit_instruction& inst, uint8_t size, bool sign_extend, uint32_t (*read)(void*, uint32_t),
+		uint32_t executed);
+	void emit_store(const Rv32_jit_instruction& inst, void (*write)(void*, uint32_t, uint32_t), uint32_t executed);
+	void emit_branch(const Rv32_jit_instruction& inst, Condition condition, uint32_t executed);
+
+	X86_64_emitter& emitter;
+	const Rv32_jit_memory_access& memory_access;
+	const std::atomic<bool>* halt_requested;
+	uint32_t pc;
+	const bool* valid;
+	uint32_t target_alignment;
+	uint8_t* coverage_map;
+	const uint64_t* watched_pages;
+	Label loop_start;
+	Label epilogue;
+	std::vector<Pending_exit> exits;
+	bool ended = false;
+};
+
+void Block_translator::emit_prologue()
+{
+	// After four pushes and 40 bytes, which include the 32 bytes of shadow space Windows requires, the stack is
+	// 16-byte aligned for calls
+	emitter.push(rbx);
+	emitter.push(r12);
+	emitter.push(r13);
+	emitter.push(r14);
+	emitter.alu_imm_64(Alu_op::sub, rsp, 40);
+
+	emitter.mov_64(c_registers, c_arg0);
+	emitter.mov(c_budget, c_arg1);
+	emitter.mov_imm(c_executed, 0);
+	emitter.mov_imm_64(c_memory, reinterpret_cast<uint64_t>(memory_access.memory));
+
+	emitter.bind(loop_start);
+}
+
+void Block_translator::emit_epilogue(uint32_t length)
+{
+	for (auto& exit : exits)
+	{
+		emitter.bind(*exit.label);
+		if (!exit.loop)
+		{
+			emit_exit(exit.pc, exit.executed);
+			continue;
+		}
+
+		// Run the block again if no halt was requested and all of it fits in the budget
+		Label stop;
+		emitter.alu_imm(Alu_op::add, c_executed, exit.executed);
+		if (halt_requested)
+		{
+			emitter.mov_imm_64(rax, reinterpret_cast<uint64_t>(halt_requested));
+			emitter.cmp_byte_imm(rax, 0, 0);
+			emitter.jcc(Condition::ne, stop);
+		}
+
+		emitter.mov(rax, c_executed);
+		emitter.alu_imm(Alu_op::add, rax, length);
+		emitter.alu(Alu_op::cmp, rax, c_budget);
+		if (coverage_map)
+		{
+			// The edge from the block to itself. The hart's previous location is already this block's.
+			const auto location = get_coverage_location(pc);
+			emitter.jcc(Condition::a, stop);
+			emitter.mov_imm_64(rax, reinterpret_cast<uint64_t>(coverage_map + (location ^ (location >> 1))));
+			emitter.add_byte_imm(rax, 0, 1);
+			emitter.jmp(loop_start);
+		}
+		else
+		{
+			emitter.jcc(Condition::be, loop_start);
+		}
+
+		emitter.bind(stop);
+		emit_exit(exit.pc, 0);
+	}
+
+	emitter.bind(epilogue);
+	emitter.alu_imm_64(Alu_op::add, rsp, 40);
+	emitter.pop(r14);
+	emitter.pop(r13);
+	emitter.pop(r12);
+	emitter.pop(rbx);
+	emitter.ret();
+}
+
+void Block_translator::emit_exit(uint32_t pc, uint32_t executed)
+{
+	emitter.store_imm(c_registers, c_pc_offset, pc);
+	emitter.mov(rax, c_executed);
+	if (executed != 0)
+		emitter.alu_imm(Alu_op::add, rax, executed);
+	emitter.jmp(epilogue);
+}
+
+Label& Block_translator::add_exit(uint32_t pc, uint32_t executed)
+{
+	exits.push_back({ make_unique<Label>(), pc, executed, false });
+	return *exits.back().label;
+}
+
+Label& Block_translator::add_jump(uint32_t target, uint32_t executed)
+{
+	exits.push_back({ make_unique<Label>(), target, executed, target == pc });
+	return *exits.back().label;
+}
+
+void Block_translator::emit_call(const void* function)
+{
+	emitter.mov_imm_64(rax, reinterpret_cast<uint64_t>(function));
+	emitter.call(rax);
+}
+
+bool Block_translator::emit_instruction(const Rv32_jit_instruction& inst, uint32_t executed_before)
+{
+	using enum Rv32i_instruction_type;
+
+	const uint32_t executed = executed_before + 1;
+
+	// Register-register operations. Writes to x0 are dropped, so those instructions have no effect.
+	const auto emit_rtype = [&](Alu_op op) {
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emitter.alu_load(op, rax, c_registers, get_offset(d.rs2));
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	const auto emit_shift = [&](Shift_op op) {
+		// x86 masks the shift count to 5 bits, the same as RV32
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rcx, c_registers, get_offset(d.rs2));
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emitter.shift_cl(op, rax);
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	const auto emit_set_less_than = [&](Condition condition) {
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rcx, c_registers, get_offset(d.rs1));
+		emitter.alu_load(Alu_op::cmp, rcx, c_registers, get_offset(d.rs2));
+		emitter.setcc_zero_extend(condition, rax);
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	// High half of the 64-bit product. Operands are sign or zero extended to 64 bits first.
+	const auto emit_multiply_high = [&](bool rs1_signed, bool rs2_signed) {
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		// 32-bit loads zero extend
+		if (rs1_signed)
+			emitter.load_sign_extend_64(rax, c_registers, get_offset(d.rs1));
+		else
+			emitter.load(rax, c_registers, get_offset(d.rs1));
+
+		if (rs2_signed)
+			emitter.load_sign_extend_64(rcx, c_registers, get_offset(d.rs2));
+		else
+			emitter.load(rcx, c_registers, get_offset(d.rs2));
+
+		// The low 64 bits of the product are the same for signed and unsigned multiplication
+		emitter.imul_64(rax, rcx);
+		emitter.shift_imm_64(Shift_op::shr, rax, 32);
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	const auto emit_divide = [&](uint32_t (*divide)(uint32_t, uint32_t)) {
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(c_arg0, c_registers, get_offset(d.rs1));
+		emitter.load(c_arg1, c_registers, get_offset(d.rs2));
+		emit_call(reinterpret_cast<const void*>(divide));
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	// rs1 and rs2 in rax and rcx for operations the two-operand helpers don't cover
+	const auto emit_rtype_registers = [&](auto&& emit) {
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emitter.load(rcx, c_registers, get_offset(d.rs2));
+		emit();
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	// Zbb and Zbs operations with one register source, in rax
+	const auto emit_unary = [&](auto&& emit) {
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emit();
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	// Register-immediate operations. The immediates are read the same way as the interpreter's executors read them.
+	const auto emit_itype = [&](Alu_op op, int32_t imm) {
+		const auto d = Rv32_decoder::decode_itype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emitter.alu_imm(op, rax, imm);
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	const auto emit_set_less_than_imm = [&](Condition condition, int32_t imm) {
+		const auto d = Rv32_decoder::decode_itype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rcx, c_registers, get_offset(d.rs1));
+		emitter.alu_imm(Alu_op::cmp, rcx, imm);
+		emitter.setcc_zero_extend(condition, rax);
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	const auto emit_shift_imm = [&](Shift_op op) {
+		const auto d = Rv32_decoder::decode_itype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			return;
+
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emitter.shift_imm(op, rax, d.imm.get_shift_amount());
+		emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	const auto itype_imm = Rv32_decoder::decode_itype(inst.instruction).imm;
+
+	switch (inst.type)
+	{
+	case add: emit_rtype(Alu_op::add); break;
+	case sub: emit_rtype(Alu_op::sub); break;
+	case and_: emit_rtype(Alu_op::and_); break;
+	case or_: emit_rtype(Alu_op::or_); break;
+	case xor_: emit_rtype(Alu_op::xor_); break;
+	case sll: emit_shift(Shift_op::shl); break;
+	case srl: emit_shift(Shift_op::shr); break;
+	case sra: emit_shift(Shift_op::sar); break;
+	case slt: emit_set_less_than(Condition::l); break;
+	case sltu: emit_set_less_than(Condition::b); break;
+
+	case mul:
+	{
+		const auto d = Rv32_decoder::decode_rtype(inst.instruction);
+		if (d.rd == Rv_register_id::x0)
+			break;
+
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emitter.imul_load(rax, c_registers, get_offset(d.rs2));
+		emitter.store(c_registers, get_offset(d.rd), rax);
+		break;
+	}
+
+	case mulh: emit_multiply_high(true, true); break;
+	case mulhsu: emit_multiply_high(true, false); break;
+	case mulhu: emit_multiply_high(false, false); break;
+	case div: emit_divide(&jit_div); break;
+	case divu: emit_divide(&jit_divu); break;
+	case rem: emit_divide(&jit_rem); break;
+	case remu: emit_divide(&jit_remu); break;
+
+	case sh1add: emit_rtype_registers([&] { emitter.lea_scaled(rax, rcx, rax, 2); }); break;
+	case sh2add: emit_rtype_registers([&] { emitter.lea_scaled(rax, rcx, rax, 4); }); break;
+	case sh3add: emit_rtype_registers([&] { emitter.lea_scaled(rax, rcx, rax, 8); }); break;
+
+	// BMI1 has ANDN, but the emitter has no VEX encodings
+	case andn: emit_rtype_registers([&] { emitter.not_(rcx); emitter.alu(Alu_op::and_, rax, rcx); }); break;
+	case orn: emit_rtype_registers([&] { emitter.not_(rcx); emitter.alu(Alu_op::or_, rax, rcx); }); break;
+	case xnor: emit_rtype_registers([&] { emitter.alu(Alu_op::xor_, rax, rcx); emitter.not_(rax); }); break;
+
+	// Take rs2 when rs1 is on the wrong side of it
+	case max: emit_rtype_registers([&] { emitter.alu(Alu_op::cmp, rax, rcx); emitter.cmov(Condition::l, rax, rcx); }); break;
+	case maxu: emit_rtype_registers([&] { emitter.alu(Alu_op::cmp, rax, rcx); emitter.cmov(Condition::b, rax, rcx); }); break;
+	case min: emit_rtype_registers([&] { emitter.alu(Alu_op::cmp, rax, rcx); emitter.cmov(Condition::g, rax, rcx); }); break;
+	case minu: emit_rtype_registers([&] { emitter.alu(Alu_op::cmp, rax, rcx); emitter.cmov(Condition::a, rax, rcx); }); break;
+
+	// x86 masks the rotate count to 5 bits too
+	case rol: emit_shift(Shift_op::rol); break;
+	case ror: emit_shift(Shift_op::ror); break;
+	case rori: emit_shift_imm(Shift_op::ror); break;
+
+	case clz:
+	case ctz:
+	case cpop:
+	{
+		// LZCNT and TZCNT give 32 for zero, the same as clz and ctz
+		if (!host_has_bit_count())
+			return false;
+
+		const auto op = inst.type == clz ? Bit_count_op::lzcnt : inst.type == ctz ? Bit_count_op::tzcnt : Bit_count_op::popcnt;
+		emit_unary([&] { emitter.bit_count(op, rax, rax); });
+		break;
+	}
+
+	case sext_b: emit_unary([&] { emitter.extend(rax, rax, 1, true); }); break;
+	case sext_h: emit_unary([&] { emitter.extend(rax, rax, 2, true); }); break;
+	case zext_h: emit_unary([&] { emitter.extend(rax, rax, 2, false); }); break;
+	case rev8: emit_unary([&] { emitter.bswap(rax); }); break;
+
+	case orc_b:
+		// No x86 instruction does this. Set the top bit of each nonzero byte, then spread it with (x << 8) - x.
+		emit_unary([&] {
+			emitter.mov(rcx, rax);
+			emitter.alu_imm(Alu_op::and_, rax, 0x7F7F'7F7F);
+			emitter.alu_imm(Alu_op::add, rax, 0x7F7F'7F7F);
+			emitter.alu(Alu_op::or_, rax, rcx);
+			emitter.alu_imm(Alu_op::and_, rax, static_cast<int32_t>(0x8080'8080));
+			emitter.shift_imm(Shift_op::shr, rax, 7);
+			emitter.mov(rcx, rax);
+			emitter.shift_imm(Shift_op::shl, rax, 8);
+			emitter.alu(Alu_op::sub, rax, rcx);
+		});
+		break;
+
+	// The bit operations take the index modulo 32, the same as RV32
+	case bclr: emit_rtype_registers([&] { emitter.bit_op(Bit_op::btr, rax, rcx); }); break;
+	case binv: emit_rtype_registers([&] { emitter.bit_op(Bit_op::btc, rax, rcx); }); break;
+	case bset: emit_rtype_registers([&] { emitter.bit_op(Bit_op::bts, rax, rcx); }); break;
+	case bext:
+		emit_rtype_registers([&] {
+			emitter.bit_op(Bit_op::bt, rax, rcx);
+			emitter.setcc_zero_extend(Condition::b, rax);
+		});
+		break;
+
+	case bclri: emit_unary([&] { emitter.bit_op_imm(Bit_op::btr, rax, itype_imm.get_shift_amount()); }); break;
+	case binvi: emit_unary([&] { emitter.bit_op_imm(Bit_op::btc, rax, itype_imm.get_shift_amount()); }); break;
+	case bseti: emit_unary([&] { emitter.bit_op_imm(Bit_op::bts, rax, itype_imm.get_shift_amount()); }); break;
+	case bexti:
+		emit_unary([&] {
+			emitter.bit_op_imm(Bit_op::bt, rax, itype_imm.get_shift_amount());
+			emitter.setcc_zero_extend(Condition::b, rax);
+		});
+		break;
+
+	case addi: emit_itype(Alu_op::add, itype_imm.get_signed()); break;
+	case andi: emit_itype(Alu_op::and_, itype_imm.get_signed()); break;
+	case ori: emit_itype(Alu_op::or_, itype_imm.get_signed()); break;
+	case xori: emit_itype(Alu_op::xor_, itype_imm.get_signed()); break;
+	case slti: emit_set_less_than_imm(Condition::l, itype_imm.get_signed()); break;
+	case sltiu: emit_set_less_than_imm(Condition::b, static_cast<int32_t>(itype_imm.get_unsigned())); break;
+	case slli: emit_shift_imm(Shift_op::shl); break;
+	case srli: emit_shift_imm(Shift_op::shr); break;
+	case srai: emit_shift_imm(Shift_op::sar); break;
+
+	case lui:
+	{
+		const auto d = Rv32_decoder::decode_utype(inst.instruction);
+		if (d.rd != Rv_register_id::x0)
+			emitter.store_imm(c_registers, get_offset(d.rd), d.imm.get_decoded());
+		break;
+	}
+
+	case auipc:
+	{
+		const auto d = Rv32_decoder::decode_utype(inst.instruction);
+		if (d.rd != Rv_register_id::x0)
+			emitter.store_imm(c_registers, get_offset(d.rd), inst.pc + d.imm.get_decoded());
+		break;
+	}
+
+	case lb: emit_load(inst, 1, true, memory_access.read_8, executed); break;
+	case lbu: emit_load(inst, 1, false, memory_access.read_8, executed); break;
+	case lh: emit_load(inst, 2, true, memory_access.read_16, executed); break;
+	case lhu: emit_load(inst, 2, false, memory_access.read_16, executed); break;
+	case lw: emit_load(inst, 4, false, memory_access.read_32, executed); break;
+
+	case sb: emit_store(inst, memory_access.write_8, executed); break;
+	case sh: emit_store(inst, memory_access.write_16, executed); break;
+	case sw: emit_store(inst, memory_access.write_32, executed); break;
+
+	case fence:
+	{
+		// The host is TSO, so only a fence that orders earlier writes before later reads needs an instruction.
+		// Predecessor bits are 7:4 and successor bits 3:0, each I, O, R, W from the top.
+		const auto ordering = itype_imm.get_unsigned();
+		if ((ordering & 0b0101'0000) && (ordering & 0b0000'1010))
+			emitter.mfence();
+		break;
+	}
+
+	case beq:
+	case bne:
+	case blt:
+	case bltu:
+	case bge:
+	case bgeu:
+	{
+		// Misaligned targets trap, which only the interpreter can do
+		const auto target = inst.pc + Rv32_decoder::decode_btype(inst.instruction).imm.get_offset();
+		if (target % target_alignment != 0)
+			return false;
+
+		constexpr Condition conditions[] = { Condition::e, Condition::ne, Condition::l, Condition::b, Condition::ge, Condition::ae };
+		emit_branch(inst, conditions[to_underlying(inst.type) - to_underlying(beq)], executed);
+		break;
+	}
+
+	case jal:
+	{
+		const auto d = Rv32_decoder::decode_jtype(inst.instruction);
+		const auto target = inst.pc + d.imm.get_offset();
+		if (target % target_alignment != 0)
+			return false;
+
+		if (d.rd != Rv_register_id::x0)
+			emitter.store_imm(c_registers, get_offset(d.rd), inst.pc + inst.length);
+
+		emitter.jmp(add_jump(target, executed));
+		ended = true;
+		break;
+	}
+
+	case jalr:
+	{
+		// The target is computed before rd is written, in case rd is rs1
+		const auto d = Rv32_decoder::decode_itype(inst.instruction);
+		emitter.load(rax, c_registers, get_offset(d.rs1));
+		emitter.alu_imm(Alu_op::add, rax, d.imm.get_signed());
+		emitter.alu_imm(Alu_op::and_, rax, ~1);
+
+		// Leave misaligned targets to the interpreter, which raises the trap. With 2-byte alignment none are.
+		if (target_alignment == 4)
+		{
+			emitter.test_imm(rax, 0b10);
+			emitter.jcc(Condition::ne, add_exit(inst.pc, executed_before));
+		}
+
+		emitter.store(c_registers, c_pc_offset, rax);
+		if (d.rd != Rv_register_id::x0)
+			emitter.store_imm(c_registers, get_offset(d.rd), inst.pc + inst.length);
+
+		emitter.mov(rax, c_executed);
+		emitter.alu_imm(Alu_op::add, rax, executed);
+		emitter.jmp(epilogue);
+		ended = true;
+		break;
+	}
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+void Block_translator::emit_watchpoint_exit(const Rv32_jit_instruction& inst, uint32_t executed)
+{
+	if (!watched_pages || !halt_requested)
+		return;
+
+	emitter.mov_imm_64(rax, reinterpret_cast<uint64_t>(halt_requested));
+	emitter.cmp_byte_imm(rax, 0, 0);
+	emitter.jcc(Condition::ne, add_exit(inst.pc + inst.length, executed));
+}
+
+void Block_translator::emit_load(const Rv32_jit_instruction& inst, uint8_t size, bool sign_extend, uint32_t (*read)(void*, uint32_t),
+	uint32_t executed)
+{
+	const auto d = Rv32_decoder::decode_itype(inst.instruction);
+	const auto store_result = [&] {
+		if (d.rd != Rv_register_id::x0)
+			emitter.store(c_registers, get_offset(d.rd), rax);
+	};
+
+	emitter.load(rax, c_registers, get_offset(d.rs1));
+	emitter.alu_imm(Alu_op::add, rax, d.imm.get_signed());
+
+	auto call = Label();
+	auto done = Label();
+	const bool direct = memory_access.host_base || memory_access.host_pages;
+	if (direct && watched_pages)
+	{
+		// Loads of watched pages call read, which checks the watchpoints. So do loads that straddle pages, which
+		// the table lookup below already sends to read.
+		emitter.mov(rcx, rax);
+		emitter.shift_imm(Shift_op::shr, rcx, c_page_bits + 6);
+		emitter.mov_imm_64(rdx, reinterpret_cast<uint64_t>(watched_pages));
+		emitter.load_scaled_64(rdx, rdx, rcx);
+		emitter.mov(rcx, rax);
+		emitter.shift_imm(Shift_op::shr, rcx, c_page_bits);
+		emitter.bit_op_64(Bit_op::bt, rdx, rcx);
+		emitter.jcc(Condition::b, call);
+
+		if (size > 1 && memory_access.host_base)
+		{
+			emitter.mov(rcx, rax);
+			emitter.alu_imm(Alu_op::and_, rcx, c_page_size - 1);
+			emitter.alu_imm(Alu_op::cmp, rcx, c_page_size - size);
+			emitter.jcc(Condition::a, call);
+		}
+	}
+
+	if (memory_access.host_base)
+	{
+		// Writing a 32-bit register clears the upper half, so rcx holds the zero extended guest address
+		emitter.mov(rcx, rax);
+		emitter.mov_imm_64(rdx, reinterpret_cast<uint64_t>(memory_access.host_base));
+		emitter.load_indexed(rax, rdx, rcx, size, sign_extend);
+		store_result();
+		if (!watched_pages)
+			return;
+
+		emitter.jmp(done);
+	}
+	else if (memory_access.host_pages)
+	{
+		// Look the page up in the table and load from it unless the entry is null or the load straddles pages
+		emitter.mov(rcx, rax);
+		emitter.shift_imm(Shift_op::shr, rcx, c_page_bits);
+		emitter.mov_imm_64(rdx, reinterpret_cast<uint64_t>(memory_access.host_pages));
+		emitter.load_scaled_64(rdx, rdx, rcx);
+		emitter.test_64(rdx, rdx);
+		emitter.jcc(Condition::e, call);
+
+		emitter.mov(rcx, rax);
+		emitter.alu_imm(Alu_op::and_, rcx, c_page_size - 1);
+		if (size > 1)
+		{
+			emitter.alu_imm(Alu_op::cmp, rcx, c_page_size - size);
+			emitter.jcc(Condition::a, call);
+		}
+
+		emitter.load_indexed(rax, rdx, rcx, size, sign_extend);
+		store_result();
+		emitter.jmp(done);
+	}
+
+	emitter.bind(call);
+	emitter.mov(c_arg1, rax);
+	emitter.mov_64(c_arg0, c_memory);
+	emit_call(reinterpret_cast<const void*>(read));
+
+	if (sign_extend)
+	{
+		const uint8_t shift = 32 - size * 8;
+		emitter.shift_imm(Shift_op::shl, rax, shift);
+		emitter.shift_imm(Shift_op::sar, rax, shift);
+	}
+
+	store_result();
+	emit_watchpoint_exit(inst, executed);
+	emitter.bind(done);
+}
+
+void Block_translator::emit_store(const Rv32_jit_instruction& inst, void (*write)(void*, uint32_t, uint32_t), uint32_t executed)
+{
+	const auto d = Rv32_decoder::decode_stype(inst.instruction);
+
+	emitter.load(rax, c_registers, get_offset(d.rs1));
+	emitter.alu_imm(Alu_op::add, rax, d.imm.get_offset());
+	emitter.load(c_arg2, c_registers, get_offset(d.rs2));
+	emitter.mov(c_arg1, rax);
+	emitter.mov_64(c_arg0, c_memory);
+	emit_call(reinterpret_cast<const void*>(write));
+
+	// The store may have overwritten this block. Return to the interpreter, which picks up the new code.
+	emitter.mov_imm_64(rax, reinterpret_cast<uint64_t>(valid));
+	emitter.cmp_byte_imm(rax, 0, 0);
+	emitter.jcc(Condition::e, add_exit(inst.pc + inst.length, executed));
+	emit_watchpoint_exit(inst, executed);
+}
+
+void Block_translator::emit_branch(const Rv32_jit_instruction& inst, Condition condition, uint32_t executed)
+{
+	const auto d = Rv32_decoder::decode_btype(inst.instruction);
+
+	emitter.load(rax, c_registers, get_offset(d.rs1));
+	emitter.alu_load(Alu_op::cmp, rax, c_registers, get_offset(d.rs2));
+	emitter.jcc(condition, add_jump(inst.pc + d.imm.get_offset(), executed));
+	emit_exit(inst.pc + inst.length, executed);
+	ended = true;
+}
+
+/* ========================================================
+Rv32_jit
+======================================================== */
+
+// Translated code reads the flag as a byte
+static_assert(sizeof(std::atomic<bool>) == 1 && std::atomic<bool>::is_always_lock_free);
+
+Rv32_jit::Rv32_jit(const Rv32_jit_memory_access& memory_access, const std::atomic<bool>* halt_requested, size_t buffer_size)
+	: memory_access(memory_access), halt_requested(halt_requested)
+{
+	if constexpr (!c_rv32_jit_supported)
+		return;
+
+#ifdef _WIN32
+	void* allocation = VirtualAlloc(nullptr, buffer_size, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+	if (!allocation)
+		return;
+#else
+	void* allocation = mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (allocation == MAP_FAILED)
+		return;
+#endif
+
+	buffer = static_cast<uint8_t*>(allocation);
+	this->buffer_size = buffer_size;
+}
+
+Rv32_jit::~Rv32_jit()
+{
+	if (!buffer)
+		return;
+
+#ifdef _WIN32
+	VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+	munmap(buffer, buffer_size);
+#endif
+}
+
+bool Rv32_jit::is_available() const
+{
+	return buffer != nullptr;
+}
+
+auto Rv32_jit::translate(span<const Rv32_jit_instruction> instructions, const bool* valid) -> Block_function
+{
+	if (!buffer || instructions.empty())
+		return nullptr;
+
+	if (auto function = try_translate(instructions, valid))
+		return function;
+
+	// Out of room. Start over with an empty buffer.
+	flush();
+	return try_translate(instructions, valid);
+}
+
+auto Rv32_jit::try_translate(span<const Rv32_jit_instruction> instructions, const bool* valid) -> Block_function
+{
+	auto emitter = X86_64_emitter({ buffer + buffer_used, buffer_size - buffer_used });
+	auto translator = Block_translator(emitter, memory_access, halt_requested, instructions[0].pc, valid, target_alignment,
+		coverage_map, watched_pages);
+
+	translator.emit_prologue();
+
+	uint32_t translated = 0;
+	for (const auto& inst : instructions)
+	{
+		if (!translator.emit_instruction(inst, translated))
+			break;
+
+		++translated;
+		if (translator.has_ended())
+			break;
+	}
+
+	if (translated == 0)
+		return nullptr;
+
+	// Blocks that don't end with a jump continue at the next instruction
+	if (!translator.has_ended())
+	{
+		const auto& last = instructions[translated - 1];
+		translator.emit_exit(last.pc + last.length, translated);
+	}
+
+	translator.emit_epilogue(translated);
+
+	if (emitter.has_overflowed())
+		return nullptr;
+
+	const auto function = reinterpret_cast<Block_function>(buffer + buffer_used);
+
+	// Keep functions 16-byte aligned
+	buffer_used += (emitter.get_size() + 15) & ~size_t(15);
+	return function;
+}
+
+void Rv32_jit::set_coverage_map(uint8_t* map)
+{
+	coverage_map = map;
+}
+
+void Rv32_jit::set_watched_pages(const uint64_t* pages)
+{
+	watched_pages = pages;
+}
+
+void Rv32_jit::set_target_alignment(uint32_t alignment)
+{
+	target_alignment = alignment;
+}
+
+void Rv32_jit::flush()
+{
+	buffer_used = 0;
+	++generation;
+}
+
+uint64_t Rv32_jit::get_generation() const
+{
+	return generation;
+}
+
+}
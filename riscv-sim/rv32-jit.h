@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "rv32.h"
+
+namespace riscv_sim {
+
+/** True if the host can run code translated by Rv32_jit. */
+#if defined(__x86_64__) || defined(_M_X64)
+inline constexpr bool c_rv32_jit_supported = true;
+#else
+inline constexpr bool c_rv32_jit_supported = false;
+#endif
+
+/**
+Functions that translated code calls to access guest memory. Each function gets the memory pointer as its first argument.
+The functions must not throw: exceptions can't unwind through translated code.
+*/
+struct Rv32_jit_memory_access
+{
+	void* memory = nullptr;
+	uint32_t (*read_8)(void* memory, uint32_t address) = nullptr;
+	uint32_t (*read_16)(void* memory, uint32_t address) = nullptr;
+	uint32_t (*read_32)(void* memory, uint32_t address) = nullptr;
+	void (*write_8)(void* memory, uint32_t address, uint32_t value) = nullptr;
+	void (*write_16)(void* memory, uint32_t address, uint32_t value) = nullptr;
+	void (*write_32)(void* memory, uint32_t address, uint32_t value) = nullptr;
+
+	/** Host address of guest address 0 if guest memory is one contiguous host mapping. Loads then read it directly. */
+	const uint8_t* host_base = nullptr;
+
+	/**
+	Otherwise, a table of the host address of each 4 KiB guest page (indexed by guest address >> 12) that loads can
+	read directly, or null. Loads of pages with null entries and loads that straddle pages call read_8/16/32. The
+	entries may change between runs of translated code, but the table must not move.
+	*/
+	const uint8_t* const* host_pages = nullptr;
+};
+
+/** A guest instruction to translate. */
+struct Rv32_jit_instruction
+{
+	uint32_t pc;
+	uint32_t instruction; // Compressed instructions are expanded
+	Rv32i_instruction_type type;
+	uint8_t length;       // 2 for compressed instructions, otherwise 4
+};
+
+/**
+Translates RV32IM basic blocks with Zba, Zbb and Zbs, and compressed instructions expanded, into x86-64 machine code
+with a hand-written emitter.
+
+Translated code keeps guest registers in the hart's register array, sets PC before it returns and returns the number
+of instructions it executed. It stops before any instruction it can't run: instructions it doesn't translate, jumps
+to misaligned targets and stores that invalidate the block being run. The interpreter takes over from there, so
+results always match the interpreter.
+
+Translated code lives in a fixed-size executable buffer. When the buffer is full it is flushed and the generation
+is incremented, which invalidates every function translated before.
+*/
+class Rv32_jit
+{
+public:
+	/**
+	Translated block. Takes the hart's register array and the most instructions it may execute, which must be at least
+	the block's length. Branches back to the start of the block loop inside the function while the budget allows.
+	Returns the number of instructions executed.
+	*/
+	using Block_function = uint32_t (*)(uint32_t* registers, uint32_t budget);
+
+	/** Largest budget a block function accepts. */
+	static constexpr uint32_t max_budget = 0x7FFF'FFFF;
+
+	/** Translated loops stop before another iteration when halt_requested (if not null) is true. */
+	Rv32_jit(const Rv32_jit_memory_access& memory_access, const std::atomic<bool>* halt_requested = nullptr,
+		size_t buffer_size = 16 * 1024 * 1024);
+	~Rv32_jit();
+
+	Rv32_jit(const Rv32_jit&) = delete;
+	Rv32_jit& operator=(const Rv32_jit&) = delete;
+
+	/** Returns false if the host is not supported or the code buffer could not be allocated. */
+	bool is_available() const;
+
+	/**
+	Translates a block of instructions that run in sequence. Translation stops at the first instruction that can't be
+	translated. Returns null if no instruction could be translated. valid must stay readable while the code can run;
+	the code returns after a store if it reads false.
+	*/
+	Block_function translate(std::span<const Rv32_jit_instruction> instructions, const bool* valid);
+
+	/**
+	Sets the alignment in bytes that jump and branch targets need: 4, or 2 with the C extension. Translated code
+	returns before a jump to a misaligned target. Only affects code translated afterwards.
+	*/
+	void set_target_alignment(uint32_t alignment);
+
+	/**
+	Sets the edge coverage map of the hart, or null. Blocks that jump back to their own start count the edge in the
+	map themselves, like the hart counts the edges it takes between blocks. Only affects code translated afterwards.
+	*/
+	void set_coverage_map(uint8_t* map);
+
+	/**
+	Sets the bitmap of watched 4 KiB guest pages, with the bit of page p in bit p % 64 of word p / 64, or null.
+	Translated loads of watched pages, and loads that straddle pages, call read_8/16/32 instead of reading host
+	memory directly, so the memory sees them. After each call to a memory access function, translated code returns
+	if halt_requested is set, so a watchpoint hit that requests a halt stops it right after the access. Only
+	affects code translated afterwards.
+	*/
+	void set_watched_pages(const uint64_t* pages);
+
+	/** Discards all translated code. */
+	void flush();
+
+	/** Gets the generation of translated code. Functions from older generations must not be called. */
+	uint64_t get_generation() const;
+
+private:
+	/** Emits the block into the free part of the buffer. Returns null if there is not enough room. */
+	Block_function try_translate(std::span<const Rv32_jit_instruction> instructions, const bool* valid);
+
+	Rv32_jit_memory_access memory_access;
+	const std::atomic<bool>* halt_requested;
+	uint8_t* buffer = nullptr;
+	size_t buffer_size = 0;
+	size_t buffer_used = 0;
+	uint64_t generation = 1;
+	uint32_t target_alignment = 4;
+	uint8_t* coverage_map = nullptr;
+	const uint64_t* watched_pages = nullptr;
+};
+
+}
@@ -1,263 +1,809 @@
 #include "rv32.h"
 
 #include <array>
-#include <map>
 #include <stdexcept>
-#include <vector>
 #include <utility>
 
 using namespace std;
 
 namespace riscv_sim {
 
-constexpr uint32_t rv32i_rtype_mask = 0b1111111'00000'00000'111'00000'1111111;
-constexpr uint32_t rv32i_itype_mask = 0b000000000000'00000'111'00000'1111111;
-constexpr uint32_t rv32i_stype_mask = rv32i_itype_mask;
-constexpr uint32_t rv32i_btype_mask = rv32i_itype_mask;
-constexpr uint32_t rv32i_utype_mask = 0b00000000000000000000'00000'1111111;
-constexpr uint32_t rv32i_jtype_mask = rv32i_utype_mask;
-
-static uint32_t create_rtype_signature(Rv_opcode opcode, uint8_t funct3, uint8_t funct7)
+const char* get_trap_cause_name(Rv_trap_cause cause)
 {
-	return to_underlying(opcode) | (funct3 << 12) | (funct7 << 25);
-}
+	switch (cause)
+	{
+	case Rv_trap_cause::instruction_address_misaligned: return "instruction-address-misaligned";
+	case Rv_trap_cause::illegal_instruction: return "illegal-instruction";
+	case Rv_trap_cause::breakpoint: return "breakpoint";
+	case Rv_trap_cause::load_address_misaligned: return "load-address-misaligned";
+	case Rv_trap_cause::store_address_misaligned: return "store-address-misaligned";
+	case Rv_trap_cause::ecall: return "ecall";
+	case Rv_trap_cause::none: return "none";
+	}
 
-static uint32_t create_itype_signature(Rv_opcode opcode, uint8_t funct3)
-{
-	return to_underlying(opcode) | (funct3 << 12);
+	return "unknown";
 }
 
-static uint32_t create_stype_signature(Rv_opcode opcode, uint8_t funct3)
-{
-	return create_itype_signature(opcode, funct3);
-}
+/**
+Instruction decoding uses two compile-time generated lookup tables.
 
-static uint32_t create_btype_signature(Rv_opcode opcode, uint8_t funct3)
+The primary table is indexed by the opcode and funct3 bits of an instruction. Each entry selects a
+range of the secondary table and the instruction bits (if any) that index into that range. The
+secondary table holds the instruction types.
+
+Instructions identified by opcode and funct3 alone select a single-entry range with no index bits.
+Instructions that share an opcode and funct3 select a larger range indexed by the bits that tell them
+apart (funct7 for OP, funct12 for SYSTEM, fmt for the fused multiply-adds and funct7 and rs2 for OP-FP, the
+OP-IMM shifts and OP funct3 100, where rs2 is a shift amount or selects the operation of unary instructions). funct3 is the rounding mode of floating-point instructions that round, so the funct3 values of
+the valid modes share a range.
+
+instruction type = secondary[entry.base + ((instruction >> entry.shift) & entry.mask)]
+*/
+struct Rv32_decode_entry
 {
-	return create_itype_signature(opcode, funct3);
+	uint16_t base;   // Start of the range in the secondary table
+	uint8_t shift;   // Position of the bits that index into the range
+	uint16_t mask;   // Mask of the bits that index into the range (0 for a single-entry range)
+};
+
+constexpr size_t rv32_opcode_count = 1 << 7;
+constexpr size_t rv32_funct3_count = 1 << 3;
+constexpr size_t rv32_funct7_count = 1 << 7;
+constexpr size_t rv32_funct12_count = 1 << 12;
+constexpr size_t rv32_fmt_count = 1 << 2;
+constexpr size_t rv32_funct7_rs2_count = 1 << 12;
+
+// rs2 value for instructions where rs2 is an operand rather than part of the encoding
+constexpr int any_rs2 = -1;
+
+/**
+The secondary table starts with one single-entry range per instruction type, so a type's range is at its own index.
+RV64 adds the ranges of OP-IMM-32, OP-32 and the doubleword AMOs.
+*/
+template <unsigned Xlen>
+constexpr size_t rv_decode_secondary_size =
+	to_underlying(Rv32i_instruction_type::_count)
+	+ (rv32_funct3_count - 1) * rv32_funct7_count // OP: one funct7 range per funct3 but 100
+	+ rv32_funct7_rs2_count                       // OP funct3 100: ZEXT.H needs rs2 0
+	+ 2 * rv32_funct7_rs2_count                   // OP-IMM: the shift funct3 values
+	+ rv32_funct12_count                          // SYSTEM: ECALL/EBREAK
+	+ 4 * rv32_funct7_rs2_count                   // OP-FP: funct3 0-3. The other rounding modes share the range of 3.
+	+ 4 * rv32_fmt_count                          // Fused multiply-adds: one fmt range per opcode
+	+ rv32_funct7_rs2_count                       // AMO funct3 010
+	+ (Xlen == 64 ? 2 * rv32_funct7_rs2_count     // OP-IMM-32: the shift funct3 values
+		+ 6 * rv32_funct7_count                   // OP-32: one funct7 range per funct3 but 010 and 011
+		+ rv32_funct7_rs2_count : 0);             // AMO funct3 011
+
+template <unsigned Xlen>
+struct Rv_decode_tables
+{
+	array<Rv32_decode_entry, rv32_opcode_count * rv32_funct3_count> primary;
+	array<Rv32i_instruction_type, rv_decode_secondary_size<Xlen>> secondary;
+	array<Rv_opcode, rv32_opcode_count> opcodes;
+};
+
+static constexpr size_t get_primary_index(Rv_opcode opcode, uint8_t funct3)
+{
+	return (funct3 << 7) | to_underlying(opcode);
+}
+
+template <unsigned Xlen>
+static consteval Rv_decode_tables<Xlen> create_decode_tables()
+{
+	auto tables = Rv_decode_tables<Xlen>();
+	size_t next_range = to_underlying(Rv32i_instruction_type::_count);
+
+	// Single-entry ranges. Anything not set below decodes to invalid (secondary[0]).
+	for (size_t i = 0; i < to_underlying(Rv32i_instruction_type::_count); ++i)
+		tables.secondary[i] = static_cast<Rv32i_instruction_type>(i);
+
+	for (auto& entry : tables.primary)
+		entry = { to_underlying(Rv32i_instruction_type::invalid), 0, 0 };
+
+	for (auto& opcode : tables.opcodes)
+		opcode = Rv_opcode::invalid;
+
+	const auto add_opcode = [&](Rv_opcode opcode) {
+		tables.opcodes[to_underlying(opcode)] = opcode;
+	};
+
+	// Opcode and funct3 identify the instruction
+	const auto add_funct3 = [&](Rv_opcode opcode, uint8_t funct3, Rv32i_instruction_type type) {
+		add_opcode(opcode);
+		tables.primary[get_primary_index(opcode, funct3)] = { static_cast<uint16_t>(to_underlying(type)), 0, 0 };
+	};
+
+	// Opcode alone identifies the instruction (U-type and J-type)
+	const auto add_opcode_only = [&](Rv_opcode opcode, Rv32i_instruction_type type) {
+		for (uint8_t funct3 = 0; funct3 < rv32_funct3_count; ++funct3)
+			add_funct3(opcode, funct3, type);
+	};
+
+	// Opcode and funct3 select a range indexed by other instruction bits
+	const auto add_range = [&](Rv_opcode opcode, uint8_t funct3, uint8_t shift, uint16_t mask) {
+		add_opcode(opcode);
+		tables.primary[get_primary_index(opcode, funct3)] = { static_cast<uint16_t>(next_range), shift, mask };
+
+		const auto base = next_range;
+		next_range += mask + 1;
+		return base;
+	};
+
+	// Ranges indexed by funct7 and rs2. Anything not set decodes to invalid.
+	const auto add_funct7_rs2_range = [&](Rv_opcode opcode, uint8_t funct3) {
+		const auto base = add_range(opcode, funct3, 20, rv32_funct7_rs2_count - 1);
+		for (size_t i = 0; i < rv32_funct7_rs2_count; ++i)
+			tables.secondary[base + i] = Rv32i_instruction_type::invalid;
+	};
+
+	// Instructions with a register or a shift amount in rs2 (any_rs2) fill every rs2 value
+	const auto add_funct7_rs2 = [&](Rv_opcode opcode, uint8_t funct3, uint8_t funct7, int rs2, Rv32i_instruction_type type) {
+		const auto base = tables.primary[get_primary_index(opcode, funct3)].base + (funct7 << 5);
+		for (int i = 0; i < 32; ++i)
+		{
+			if (rs2 == any_rs2 || rs2 == i)
+				tables.secondary[base + i] = type;
+		}
+	};
+
+	add_opcode_only(Rv_opcode::auipc, Rv32i_instruction_type::auipc);
+	add_opcode_only(Rv_opcode::lui, Rv32i_instruction_type::lui);
+	add_opcode_only(Rv_opcode::jal, Rv32i_instruction_type::jal);
+
+	add_funct3(Rv_opcode::jalr, to_underlying(Rv32_jalr_funct3::jalr), Rv32i_instruction_type::jalr);
+
+	add_funct3(Rv_opcode::branch, to_underlying(Rv32_branch_funct3::beq), Rv32i_instruction_type::beq);
+	add_funct3(Rv_opcode::branch, to_underlying(Rv32_branch_funct3::bge), Rv32i_instruction_type::bge);
+	add_funct3(Rv_opcode::branch, to_underlying(Rv32_branch_funct3::bgeu), Rv32i_instruction_type::bgeu);
+	add_funct3(Rv_opcode::branch, to_underlying(Rv32_branch_funct3::blt), Rv32i_instruction_type::blt);
+	add_funct3(Rv_opcode::branch, to_underlying(Rv32_branch_funct3::bltu), Rv32i_instruction_type::bltu);
+	add_funct3(Rv_opcode::branch, to_underlying(Rv32_branch_funct3::bne), Rv32i_instruction_type::bne);
+
+	add_funct3(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::addi), Rv32i_instruction_type::addi);
+	add_funct3(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::andi), Rv32i_instruction_type::andi);
+	add_funct3(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::ori), Rv32i_instruction_type::ori);
+	add_funct3(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::slti), Rv32i_instruction_type::slti);
+	add_funct3(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::sltiu), Rv32i_instruction_type::sltiu);
+	add_funct3(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::xori), Rv32i_instruction_type::xori);
+
+	// Immediate shifts share their funct3 values with the Zbb and Zbs instructions that have a shift amount or a
+	// unary operation in rs2. funct7 tells them apart. RV32 shift amounts are 5 bits, so other funct7 values are
+	// reserved. RV64 shift amounts are 6 bits, with the high bit in the low bit of funct7.
+	const auto add_op_imm = [&](Rv32_op_imm_funct funct3, Rv32_op_imm_funct7 funct7, int rs2, Rv32i_instruction_type type) {
+		add_funct7_rs2(Rv_opcode::op_imm, to_underlying(funct3), to_underlying(funct7), rs2, type);
+	};
+
+	const auto add_op_imm_shift = [&](Rv32_op_imm_funct funct3, Rv32_op_imm_funct7 funct7, Rv32i_instruction_type type) {
+		add_op_imm(funct3, funct7, any_rs2, type);
+		if constexpr (Xlen == 64)
+			add_op_imm(funct3, Rv32_op_imm_funct7(to_underlying(funct7) | 1), any_rs2, type);
+	};
+
+	const auto add_op_imm_unary = [&](Rv32_op_imm_funct funct3, Rv32_op_imm_funct7 funct7, Rv32_op_imm_unary operation, Rv32i_instruction_type type) {
+		add_op_imm(funct3, funct7, to_underlying(operation), type);
+	};
+
+	add_funct7_rs2_range(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::slli));
+	add_funct7_rs2_range(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::srxi));
+
+	add_op_imm_shift(Rv32_op_imm_funct::slli, Rv32_op_imm_funct7::slli, Rv32i_instruction_type::slli);
+	add_op_imm_shift(Rv32_op_imm_funct::srxi, Rv32_op_imm_funct7::srli, Rv32i_instruction_type::srli);
+	add_op_imm_shift(Rv32_op_imm_funct::srxi, Rv32_op_imm_funct7::srai, Rv32i_instruction_type::srai);
+
+	// The bit-manipulation extensions have W forms and other encodings on RV64 that aren't implemented
+	if constexpr (Xlen == 32)
+	{
+		add_op_imm_unary(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, Rv32_op_imm_unary::clz, Rv32i_instruction_type::clz);
+		add_op_imm_unary(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, Rv32_op_imm_unary::ctz, Rv32i_instruction_type::ctz);
+		add_op_imm_unary(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, Rv32_op_imm_unary::cpop, Rv32i_instruction_type::cpop);
+		add_op_imm_unary(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, Rv32_op_imm_unary::sext_b, Rv32i_instruction_type::sext_b);
+		add_op_imm_unary(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, Rv32_op_imm_unary::sext_h, Rv32i_instruction_type::sext_h);
+		add_op_imm_unary(Rv32_op_imm_funct::orc_b, Rv32_op_imm_funct7::orc_b, Rv32_op_imm_unary::orc_b, Rv32i_instruction_type::orc_b);
+		add_op_imm_unary(Rv32_op_imm_funct::rev8, Rv32_op_imm_funct7::rev8, Rv32_op_imm_unary::rev8, Rv32i_instruction_type::rev8);
+		add_op_imm(Rv32_op_imm_funct::rori, Rv32_op_imm_funct7::rori, any_rs2, Rv32i_instruction_type::rori);
+
+		add_op_imm(Rv32_op_imm_funct::bclri, Rv32_op_imm_funct7::bclri, any_rs2, Rv32i_instruction_type::bclri);
+		add_op_imm(Rv32_op_imm_funct::bexti, Rv32_op_imm_funct7::bexti, any_rs2, Rv32i_instruction_type::bexti);
+		add_op_imm(Rv32_op_imm_funct::binvi, Rv32_op_imm_funct7::binvi, any_rs2, Rv32i_instruction_type::binvi);
+		add_op_imm(Rv32_op_imm_funct::bseti, Rv32_op_imm_funct7::bseti, any_rs2, Rv32i_instruction_type::bseti);
+	}
+
+	add_funct3(Rv_opcode::load, to_underlying(Rv32_load_funct3::lb), Rv32i_instruction_type::lb);
+	add_funct3(Rv_opcode::load, to_underlying(Rv32_load_funct3::lbu), Rv32i_instruction_type::lbu);
+	add_funct3(Rv_opcode::load, to_underlying(Rv32_load_funct3::lh), Rv32i_instruction_type::lh);
+	add_funct3(Rv_opcode::load, to_underlying(Rv32_load_funct3::lhu), Rv32i_instruction_type::lhu);
+	add_funct3(Rv_opcode::load, to_underlying(Rv32_load_funct3::lw), Rv32i_instruction_type::lw);
+
+	if constexpr (Xlen == 64)
+	{
+		add_funct3(Rv_opcode::load, to_underlying(Rv32_load_funct3::lwu), Rv32i_instruction_type::lwu);
+		add_funct3(Rv_opcode::load, to_underlying(Rv32_load_funct3::ld), Rv32i_instruction_type::ld);
+	}
+
+	// OP instructions are told apart by funct7. Unused funct7 values decode to invalid. funct3 100 is also indexed
+	// by rs2, which is 0 for ZEXT.H.
+	if constexpr (Xlen == 32)
+		add_funct7_rs2_range(Rv_opcode::op, to_underlying(Rv32_op_funct3::zext_h));
+
+	// OP-32 is laid out like OP
+	const auto add_funct7 = [&](Rv_opcode opcode, Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv32i_instruction_type type, int rs2) {
+		const auto index = get_primary_index(opcode, to_underlying(funct3));
+		if (tables.primary[index].mask == rv32_funct7_rs2_count - 1)
+		{
+			add_funct7_rs2(opcode, to_underlying(funct3), to_underlying(funct7), rs2, type);
+			return;
+		}
+
+		if (tables.primary[index].mask == 0)
+		{
+			const auto base = add_range(opcode, to_underlying(funct3), 25, rv32_funct7_count - 1);
+			for (size_t i = 0; i < rv32_funct7_count; ++i)
+				tables.secondary[base + i] = Rv32i_instruction_type::invalid;
+		}
+
+		tables.secondary[tables.primary[index].base + to_underlying(funct7)] = type;
+	};
+
+	const auto add_op = [&](Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv32i_instruction_type type, int rs2 = any_rs2) {
+		add_funct7(Rv_opcode::op, funct3, funct7, type, rs2);
+	};
+
+	add_op(Rv32_op_funct3::add, Rv32_op_funct7::add, Rv32i_instruction_type::add);
+	add_op(Rv32_op_funct3::and_, Rv32_op_funct7::and_, Rv32i_instruction_type::and_);
+	add_op(Rv32_op_funct3::or_, Rv32_op_funct7::or_, Rv32i_instruction_type::or_);
+	add_op(Rv32_op_funct3::sll, Rv32_op_funct7::sll, Rv32i_instruction_type::sll);
+	add_op(Rv32_op_funct3::slt, Rv32_op_funct7::slt, Rv32i_instruction_type::slt);
+	add_op(Rv32_op_funct3::sltu, Rv32_op_funct7::sltu, Rv32i_instruction_type::sltu);
+	add_op(Rv32_op_funct3::sra, Rv32_op_funct7::sra, Rv32i_instruction_type::sra);
+	add_op(Rv32_op_funct3::srl, Rv32_op_funct7::srl, Rv32i_instruction_type::srl);
+	add_op(Rv32_op_funct3::sub, Rv32_op_funct7::sub, Rv32i_instruction_type::sub);
+	add_op(Rv32_op_funct3::xor_, Rv32_op_funct7::xor_, Rv32i_instruction_type::xor_);
+
+	add_op(Rv32_op_funct3::mul, Rv32_op_funct7::muldiv, Rv32i_instruction_type::mul);
+	add_op(Rv32_op_funct3::mulh, Rv32_op_funct7::muldiv, Rv32i_instruction_type::mulh);
+	add_op(Rv32_op_funct3::mulhsu, Rv32_op_funct7::muldiv, Rv32i_instruction_type::mulhsu);
+	add_op(Rv32_op_funct3::mulhu, Rv32_op_funct7::muldiv, Rv32i_instruction_type::mulhu);
+	add_op(Rv32_op_funct3::div, Rv32_op_funct7::muldiv, Rv32i_instruction_type::div);
+	add_op(Rv32_op_funct3::divu, Rv32_op_funct7::muldiv, Rv32i_instruction_type::divu);
+	add_op(Rv32_op_funct3::rem, Rv32_op_funct7::muldiv, Rv32i_instruction_type::rem);
+	add_op(Rv32_op_funct3::remu, Rv32_op_funct7::muldiv, Rv32i_instruction_type::remu);
+
+	if constexpr (Xlen == 32)
+	{
+		add_op(Rv32_op_funct3::sh1add, Rv32_op_funct7::shadd, Rv32i_instruction_type::sh1add);
+		add_op(Rv32_op_funct3::sh2add, Rv32_op_funct7::shadd, Rv32i_instruction_type::sh2add);
+		add_op(Rv32_op_funct3::sh3add, Rv32_op_funct7::shadd, Rv32i_instruction_type::sh3add);
+
+		add_op(Rv32_op_funct3::andn, Rv32_op_funct7::andn, Rv32i_instruction_type::andn);
+		add_op(Rv32_op_funct3::orn, Rv32_op_funct7::orn, Rv32i_instruction_type::orn);
+		add_op(Rv32_op_funct3::xnor, Rv32_op_funct7::xnor, Rv32i_instruction_type::xnor);
+		add_op(Rv32_op_funct3::max, Rv32_op_funct7::minmax, Rv32i_instruction_type::max);
+		add_op(Rv32_op_funct3::maxu, Rv32_op_funct7::minmax, Rv32i_instruction_type::maxu);
+		add_op(Rv32_op_funct3::min, Rv32_op_funct7::minmax, Rv32i_instruction_type::min);
+		add_op(Rv32_op_funct3::minu, Rv32_op_funct7::minmax, Rv32i_instruction_type::minu);
+		add_op(Rv32_op_funct3::rol, Rv32_op_funct7::rotate, Rv32i_instruction_type::rol);
+		add_op(Rv32_op_funct3::ror, Rv32_op_funct7::rotate, Rv32i_instruction_type::ror);
+		add_op(Rv32_op_funct3::zext_h, Rv32_op_funct7::zext_h, Rv32i_instruction_type::zext_h, 0);
+
+		add_op(Rv32_op_funct3::bclr, Rv32_op_funct7::bclr, Rv32i_instruction_type::bclr);
+		add_op(Rv32_op_funct3::bext, Rv32_op_funct7::bext, Rv32i_instruction_type::bext);
+		add_op(Rv32_op_funct3::binv, Rv32_op_funct7::binv, Rv32i_instruction_type::binv);
+		add_op(Rv32_op_funct3::bset, Rv32_op_funct7::bset, Rv32i_instruction_type::bset);
+	}
+
+	add_funct3(Rv_opcode::store, to_underlying(Rv32_store_funct3::sb), Rv32i_instruction_type::sb);
+	add_funct3(Rv_opcode::store, to_underlying(Rv32_store_funct3::sh), Rv32i_instruction_type::sh);
+	add_funct3(Rv_opcode::store, to_underlying(Rv32_store_funct3::sw), Rv32i_instruction_type::sw);
+
+	if constexpr (Xlen == 64)
+	{
+		add_funct3(Rv_opcode::store, to_underlying(Rv32_store_funct3::sd), Rv32i_instruction_type::sd);
+
+		// OP-IMM-32 shift amounts are 5 bits, as on RV32
+		add_funct3(Rv_opcode::op_imm_32, to_underlying(Rv64_op_imm_32_funct::addiw), Rv32i_instruction_type::addiw);
+		add_funct7_rs2_range(Rv_opcode::op_imm_32, to_underlying(Rv64_op_imm_32_funct::slliw));
+		add_funct7_rs2_range(Rv_opcode::op_imm_32, to_underlying(Rv64_op_imm_32_funct::srxiw));
+		add_funct7_rs2(Rv_opcode::op_imm_32, to_underlying(Rv64_op_imm_32_funct::slliw), to_underlying(Rv32_op_imm_funct7::slli), any_rs2, Rv32i_instruction_type::slliw);
+		add_funct7_rs2(Rv_opcode::op_imm_32, to_underlying(Rv64_op_imm_32_funct::srxiw), to_underlying(Rv32_op_imm_funct7::srli), any_rs2, Rv32i_instruction_type::srliw);
+		add_funct7_rs2(Rv_opcode::op_imm_32, to_underlying(Rv64_op_imm_32_funct::srxiw), to_underlying(Rv32_op_imm_funct7::srai), any_rs2, Rv32i_instruction_type::sraiw);
+
+		const auto add_op_32 = [&](Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv32i_instruction_type type) {
+			add_funct7(Rv_opcode::op_32, funct3, funct7, type, any_rs2);
+		};
+
+		add_op_32(Rv32_op_funct3::add, Rv32_op_funct7::add, Rv32i_instruction_type::addw);
+		add_op_32(Rv32_op_funct3::sub, Rv32_op_funct7::sub, Rv32i_instruction_type::subw);
+		add_op_32(Rv32_op_funct3::sll, Rv32_op_funct7::sll, Rv32i_instruction_type::sllw);
+		add_op_32(Rv32_op_funct3::srl, Rv32_op_funct7::srl, Rv32i_instruction_type::srlw);
+		add_op_32(Rv32_op_funct3::sra, Rv32_op_funct7::sra, Rv32i_instruction_type::sraw);
+
+		add_op_32(Rv32_op_funct3::mul, Rv32_op_funct7::muldiv, Rv32i_instruction_type::mulw);
+		add_op_32(Rv32_op_funct3::div, Rv32_op_funct7::muldiv, Rv32i_instruction_type::divw);
+		add_op_32(Rv32_op_funct3::divu, Rv32_op_funct7::muldiv, Rv32i_instruction_type::divuw);
+		add_op_32(Rv32_op_funct3::rem, Rv32_op_funct7::muldiv, Rv32i_instruction_type::remw);
+		add_op_32(Rv32_op_funct3::remu, Rv32_op_funct7::muldiv, Rv32i_instruction_type::remuw);
+	}
+
+	add_funct3(Rv_opcode::misc_mem, to_underlying(Rv32_miscmem_funct3::fence), Rv32i_instruction_type::fence);
+
+	// AMO instructions are told apart by funct5. Every combination of the aq and rl bits below it decodes the same.
+	const auto add_amo = [&](Rv32_amo_funct3 funct3, Rv32_amo_funct5 funct5, int rs2, Rv32i_instruction_type type) {
+		for (uint8_t ordering = 0; ordering < 4; ++ordering)
+		{
+			const auto funct7 = static_cast<uint8_t>((to_underlying(funct5) << 2) | ordering);
+			add_funct7_rs2(Rv_opcode::amo, to_underlying(funct3), funct7, rs2, type);
+		}
+	};
+
+	add_funct7_rs2_range(Rv_opcode::amo, to_underlying(Rv32_amo_funct3::w));
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::lr, 0, Rv32i_instruction_type::lr_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::sc, any_rs2, Rv32i_instruction_type::sc_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoswap, any_rs2, Rv32i_instruction_type::amoswap_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoadd, any_rs2, Rv32i_instruction_type::amoadd_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoxor, any_rs2, Rv32i_instruction_type::amoxor_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoand, any_rs2, Rv32i_instruction_type::amoand_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoor, any_rs2, Rv32i_instruction_type::amoor_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amomin, any_rs2, Rv32i_instruction_type::amomin_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amomax, any_rs2, Rv32i_instruction_type::amomax_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amominu, any_rs2, Rv32i_instruction_type::amominu_w);
+	add_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amomaxu, any_rs2, Rv32i_instruction_type::amomaxu_w);
+
+	if constexpr (Xlen == 64)
+	{
+		add_funct7_rs2_range(Rv_opcode::amo, to_underlying(Rv32_amo_funct3::d));
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::lr, 0, Rv32i_instruction_type::lr_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::sc, any_rs2, Rv32i_instruction_type::sc_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoswap, any_rs2, Rv32i_instruction_type::amoswap_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoadd, any_rs2, Rv32i_instruction_type::amoadd_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoxor, any_rs2, Rv32i_instruction_type::amoxor_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoand, any_rs2, Rv32i_instruction_type::amoand_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoor, any_rs2, Rv32i_instruction_type::amoor_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amomin, any_rs2, Rv32i_instruction_type::amomin_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amomax, any_rs2, Rv32i_instruction_type::amomax_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amominu, any_rs2, Rv32i_instruction_type::amominu_d);
+		add_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amomaxu, any_rs2, Rv32i_instruction_type::amomaxu_d);
+	}
+
+	// Type of SYSTEM instruction is the I-type immediate value
+	const auto system_priv = add_range(Rv_opcode::system, to_underlying(Rv32_system_funct3::priv), 20, rv32_funct12_count - 1);
+	for (size_t i = 0; i < rv32_funct12_count; ++i)
+		tables.secondary[system_priv + i] = Rv32i_instruction_type::invalid;
+	tables.secondary[system_priv + to_underlying(Rv32_system_funct12::ecall)] = Rv32i_instruction_type::ecall;
+	tables.secondary[system_priv + to_underlying(Rv32_system_funct12::ebreak)] = Rv32i_instruction_type::ebreak;
+
+	add_funct3(Rv_opcode::system, to_underlying(Rv32_system_funct3::csrrw), Rv32i_instruction_type::csrrw);
+	add_funct3(Rv_opcode::system, to_underlying(Rv32_system_funct3::csrrs), Rv32i_instruction_type::csrrs);
+	add_funct3(Rv_opcode::system, to_underlying(Rv32_system_funct3::csrrc), Rv32i_instruction_type::csrrc);
+	add_funct3(Rv_opcode::system, to_underlying(Rv32_system_funct3::csrrwi), Rv32i_instruction_type::csrrwi);
+	add_funct3(Rv_opcode::system, to_underlying(Rv32_system_funct3::csrrsi), Rv32i_instruction_type::csrrsi);
+	add_funct3(Rv_opcode::system, to_underlying(Rv32_system_funct3::csrrci), Rv32i_instruction_type::csrrci);
+
+	// F and D. Their RV64 instructions (FCVT to and from 64-bit integers, FMV.X.D and FMV.D.X) aren't implemented.
+	if constexpr (Xlen == 32)
+	{
+		add_funct3(Rv_opcode::load_fp, to_underlying(Rv32_load_fp_funct3::flw), Rv32i_instruction_type::flw);
+		add_funct3(Rv_opcode::load_fp, to_underlying(Rv32_load_fp_funct3::fld), Rv32i_instruction_type::fld);
+		add_funct3(Rv_opcode::store_fp, to_underlying(Rv32_store_fp_funct3::fsw), Rv32i_instruction_type::fsw);
+		add_funct3(Rv_opcode::store_fp, to_underlying(Rv32_store_fp_funct3::fsd), Rv32i_instruction_type::fsd);
+
+		// Rounding modes that are valid in instructions. The other two funct3 values of instructions that round
+		// are reserved and decode to invalid.
+		constexpr Rv_rounding_mode rounding_modes[] = {
+			Rv_rounding_mode::rne, Rv_rounding_mode::rtz, Rv_rounding_mode::rdn, Rv_rounding_mode::rup,
+			Rv_rounding_mode::rmm, Rv_rounding_mode::dyn,
+		};
+
+		// Fused multiply-adds are told apart by opcode and fmt. Every rounding mode shares one range.
+		const auto add_fused = [&](Rv_opcode opcode, Rv32i_instruction_type single, Rv32i_instruction_type double_) {
+			const auto base = add_range(opcode, 0, 25, rv32_fmt_count - 1);
+			for (size_t i = 0; i < rv32_fmt_count; ++i)
+				tables.secondary[base + i] = Rv32i_instruction_type::invalid;
+			tables.secondary[base + to_underlying(Rv_fp_format::s)] = single;
+			tables.secondary[base + to_underlying(Rv_fp_format::d)] = double_;
+
+			for (const auto rm : rounding_modes)
+				tables.primary[get_primary_index(opcode, to_underlying(rm))] = tables.primary[get_primary_index(opcode, 0)];
+		};
+
+		add_fused(Rv_opcode::madd, Rv32i_instruction_type::fmadd_s, Rv32i_instruction_type::fmadd_d);
+		add_fused(Rv_opcode::msub, Rv32i_instruction_type::fmsub_s, Rv32i_instruction_type::fmsub_d);
+		add_fused(Rv_opcode::nmsub, Rv32i_instruction_type::fnmsub_s, Rv32i_instruction_type::fnmsub_d);
+		add_fused(Rv_opcode::nmadd, Rv32i_instruction_type::fnmadd_s, Rv32i_instruction_type::fnmadd_d);
+
+		// OP-FP instructions are told apart by funct7 (operation and format) and rs2, which is an operand of binary
+		// operations and selects the variant of unary ones
+		const auto add_op_fp = [&](uint8_t funct3, Rv32_op_fp_funct5 funct5, Rv_fp_format fmt, int rs2, Rv32i_instruction_type type) {
+			if (tables.primary[get_primary_index(Rv_opcode::op_fp, funct3)].mask == 0)
+				add_funct7_rs2_range(Rv_opcode::op_fp, funct3);
+
+			const auto funct7 = static_cast<uint8_t>((to_underlying(funct5) << 2) | to_underlying(fmt));
+			add_funct7_rs2(Rv_opcode::op_fp, funct3, funct7, rs2, type);
+		};
+
+		// Instructions that round are added for RNE, RTZ, RDN and RUP. RMM and DYN share the range of RUP, which
+		// only holds instructions that round.
+		const auto add_op_fp_rounding = [&](Rv32_op_fp_funct5 funct5, Rv_fp_format fmt, int rs2, Rv32i_instruction_type type) {
+			for (const auto rm : { Rv_rounding_mode::rne, Rv_rounding_mode::rtz, Rv_rounding_mode::rdn, Rv_rounding_mode::rup })
+				add_op_fp(to_underlying(rm), funct5, fmt, rs2, type);
+		};
+
+		using enum Rv32_op_fp_funct5;
+		constexpr auto s = Rv_fp_format::s;
+		constexpr auto d = Rv_fp_format::d;
+		constexpr auto w = to_underlying(Rv32_fcvt_int_type::w);
+		constexpr auto wu = to_underlying(Rv32_fcvt_int_type::wu);
+
+		add_op_fp_rounding(fadd, s, any_rs2, Rv32i_instruction_type::fadd_s);
+		add_op_fp_rounding(fsub, s, any_rs2, Rv32i_instruction_type::fsub_s);
+		add_op_fp_rounding(fmul, s, any_rs2, Rv32i_instruction_type::fmul_s);
+		add_op_fp_rounding(fdiv, s, any_rs2, Rv32i_instruction_type::fdiv_s);
+		add_op_fp_rounding(fsqrt, s, 0, Rv32i_instruction_type::fsqrt_s);
+		add_op_fp_rounding(fcvt_to_int, s, w, Rv32i_instruction_type::fcvt_w_s);
+		add_op_fp_rounding(fcvt_to_int, s, wu, Rv32i_instruction_type::fcvt_wu_s);
+		add_op_fp_rounding(fcvt_from_int, s, w, Rv32i_instruction_type::fcvt_s_w);
+		add_op_fp_rounding(fcvt_from_int, s, wu, Rv32i_instruction_type::fcvt_s_wu);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fsgnj), fsgnj, s, any_rs2, Rv32i_instruction_type::fsgnj_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fsgnjn), fsgnj, s, any_rs2, Rv32i_instruction_type::fsgnjn_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fsgnjx), fsgnj, s, any_rs2, Rv32i_instruction_type::fsgnjx_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fmin), fminmax, s, any_rs2, Rv32i_instruction_type::fmin_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fmax), fminmax, s, any_rs2, Rv32i_instruction_type::fmax_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::feq), fcmp, s, any_rs2, Rv32i_instruction_type::feq_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::flt), fcmp, s, any_rs2, Rv32i_instruction_type::flt_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fle), fcmp, s, any_rs2, Rv32i_instruction_type::fle_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fmv), fmv_to_int, s, 0, Rv32i_instruction_type::fmv_x_w);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fclass), fmv_to_int, s, 0, Rv32i_instruction_type::fclass_s);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fmv), fmv_from_int, s, 0, Rv32i_instruction_type::fmv_w_x);
+
+		add_op_fp_rounding(fadd, d, any_rs2, Rv32i_instruction_type::fadd_d);
+		add_op_fp_rounding(fsub, d, any_rs2, Rv32i_instruction_type::fsub_d);
+		add_op_fp_rounding(fmul, d, any_rs2, Rv32i_instruction_type::fmul_d);
+		add_op_fp_rounding(fdiv, d, any_rs2, Rv32i_instruction_type::fdiv_d);
+		add_op_fp_rounding(fsqrt, d, 0, Rv32i_instruction_type::fsqrt_d);
+		add_op_fp_rounding(fcvt_fp, s, to_underlying(d), Rv32i_instruction_type::fcvt_s_d);
+		add_op_fp_rounding(fcvt_fp, d, to_underlying(s), Rv32i_instruction_type::fcvt_d_s);
+		add_op_fp_rounding(fcvt_to_int, d, w, Rv32i_instruction_type::fcvt_w_d);
+		add_op_fp_rounding(fcvt_to_int, d, wu, Rv32i_instruction_type::fcvt_wu_d);
+		add_op_fp_rounding(fcvt_from_int, d, w, Rv32i_instruction_type::fcvt_d_w);
+		add_op_fp_rounding(fcvt_from_int, d, wu, Rv32i_instruction_type::fcvt_d_wu);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fsgnj), fsgnj, d, any_rs2, Rv32i_instruction_type::fsgnj_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fsgnjn), fsgnj, d, any_rs2, Rv32i_instruction_type::fsgnjn_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fsgnjx), fsgnj, d, any_rs2, Rv32i_instruction_type::fsgnjx_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fmin), fminmax, d, any_rs2, Rv32i_instruction_type::fmin_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fmax), fminmax, d, any_rs2, Rv32i_instruction_type::fmax_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::feq), fcmp, d, any_rs2, Rv32i_instruction_type::feq_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::flt), fcmp, d, any_rs2, Rv32i_instruction_type::flt_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fle), fcmp, d, any_rs2, Rv32i_instruction_type::fle_d);
+		add_op_fp(to_underlying(Rv32_op_fp_funct3::fclass), fmv_to_int, d, 0, Rv32i_instruction_type::fclass_d);
+
+		const auto op_fp_rup = tables.primary[get_primary_index(Rv_opcode::op_fp, to_underlying(Rv_rounding_mode::rup))];
+		tables.primary[get_primary_index(Rv_opcode::op_fp, to_underlying(Rv_rounding_mode::rmm))] = op_fp_rup;
+		tables.primary[get_primary_index(Rv_opcode::op_fp, to_underlying(Rv_rounding_mode::dyn))] = op_fp_rup;
+	}
+
+	// Fails compilation if the secondary table size doesn't account for every range
+	if (next_range > rv_decode_secondary_size<Xlen>)
+		throw "Secondary decode table is too small.";
+
+	return tables;
 }
 
-static uint32_t create_utype_signature(Rv_opcode opcode)
+template <unsigned Xlen>
+static constexpr auto rv_decode_tables = create_decode_tables<Xlen>();
+
+/**
+Compressed (RVC) instructions are expanded with a compile-time generated table indexed by the whole 16-bit parcel.
+Each entry is the equivalent 32-bit instruction, or 0 for reserved encodings and encodings of other XLENs. 0 is an
+illegal instruction, so the decoder rejects them without a separate check.
+Entries for parcels that aren't compressed (low bits 11) are 0 too.
+*/
+constexpr size_t rvc_expansion_table_size = 1 << 16;
+
+/** Gets bits high..low of a parcel, shifted down to bit 0. */
+static constexpr uint32_t get_bits(uint32_t parcel, int high, int low)
 {
-	return to_underlying(opcode);
+	return (parcel >> low) & ((1u << (high - low + 1)) - 1);
 }
 
-static uint32_t create_jtype_signature(Rv_opcode opcode)
+/** Sign extends the low bits of a value. */
+static constexpr int32_t sign_extend(uint32_t value, int bits)
 {
-	return create_utype_signature(opcode);
+	const uint32_t sign = 1u << (bits - 1);
+	return static_cast<int32_t>((value ^ sign) - sign);
 }
 
-static uint32_t create_branch_signature(Rv32_branch_funct3 funct3)
+/** rd', rs1' and rs2' are 3-bit fields that select x8-x15. */
+static constexpr uint32_t get_compressed_register(uint32_t parcel, int low)
 {
-	return create_btype_signature(Rv_opcode::branch, to_underlying(funct3));
+	return 8 + get_bits(parcel, low + 2, low);
 }
 
-static uint32_t create_load_signature(Rv32_load_funct3 funct3)
+static constexpr uint32_t make_itype(Rv_opcode opcode, uint32_t funct3, uint32_t rd, uint32_t rs1, int32_t imm)
 {
-	return create_itype_signature(Rv_opcode::load, to_underlying(funct3));
+	return (static_cast<uint32_t>(imm) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | to_underlying(opcode);
 }
 
-static uint32_t create_miscmem_signature(Rv32_miscmem_funct3 funct3)
+static constexpr uint32_t make_rtype(Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, uint32_t rd, uint32_t rs1, uint32_t rs2)
 {
-	return create_itype_signature(Rv_opcode::misc_mem, to_underlying(funct3));
+	return (to_underlying(funct7) << 25) | (rs2 << 20) | (rs1 << 15) | (to_underlying(funct3) << 12) | (rd << 7) | to_underlying(Rv_opcode::op);
 }
 
-static uint32_t create_op_signature(Rv32_op_funct3 funct3, Rv32_op_funct7 funct7)
+static constexpr uint32_t make_stype(Rv_opcode opcode, uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t offset)
 {
-	return create_rtype_signature(Rv_opcode::op, to_underlying(funct3), to_underlying(funct7));
+	const auto imm = static_cast<uint32_t>(offset);
+	return (get_bits(imm, 11, 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12)
+		| (get_bits(imm, 4, 0) << 7) | to_underlying(opcode);
 }
 
-static uint32_t create_op_imm_signature(Rv32_op_imm_funct funct)
+static constexpr uint32_t make_btype(Rv32_branch_funct3 funct3, uint32_t rs1, uint32_t rs2, int32_t offset)
 {
-	return create_itype_signature(Rv_opcode::op_imm, to_underlying(funct));
+	const auto imm = static_cast<uint32_t>(offset);
+	return (get_bits(imm, 12, 12) << 31) | (get_bits(imm, 10, 5) << 25) | (rs2 << 20) | (rs1 << 15)
+		| (to_underlying(funct3) << 12) | (get_bits(imm, 4, 1) << 8) | (get_bits(imm, 11, 11) << 7)
+		| to_underlying(Rv_opcode::branch);
 }
 
-static uint32_t create_store_signature(Rv32_store_funct3 funct3)
+static constexpr uint32_t make_jal(uint32_t rd, int32_t offset)
 {
-	return create_stype_signature(Rv_opcode::store, to_underlying(funct3));
+	const auto imm = static_cast<uint32_t>(offset);
+	return (get_bits(imm, 20, 20) << 31) | (get_bits(imm, 10, 1) << 21) | (get_bits(imm, 11, 11) << 20)
+		| (get_bits(imm, 19, 12) << 12) | (rd << 7) | to_underlying(Rv_opcode::jal);
 }
 
-static uint32_t create_system_signature(Rv32_system_funct3 funct3)
+/** Expands a compressed instruction. Returns 0 if it has no RV32 expansion. */
+static constexpr uint32_t expand_rvc(uint32_t parcel)
 {
-	return create_itype_signature(Rv_opcode::system, to_underlying(funct3));
-}
+	constexpr uint32_t ra = 1;
+	constexpr uint32_t sp = 2;
 
-/** Function type used for functions that resolve instruction type lookups. */
-using Rv_instruction_type_resolver = std::add_pointer_t<Rv32i_instruction_type(uint32_t instruction)>;
+	const auto funct3 = get_bits(parcel, 15, 13);
+	const auto rd = get_bits(parcel, 11, 7);   // Also rs1 in the CR and CI formats
+	const auto rs2 = get_bits(parcel, 6, 2);
+	const auto rd_prime = get_compressed_register(parcel, 2);  // CIW, CL: rd'. CS: rs2'.
+	const auto rs1_prime = get_compressed_register(parcel, 7); // Also rd' in the CA and CB formats
 
-static Rv32i_instruction_type resolve_op_imm_shift_right(uint32_t instruction)
-{
-	// SRAI (arithmetic) has bit 30 set. SRLI (logical) does not.
-	const auto arithmetic_mask = (1 << 30);
+	// Immediates of the CI format: imm[5] in bit 12, imm[4:0] in bits 6:2
+	const auto ci_imm = sign_extend((get_bits(parcel, 12, 12) << 5) | get_bits(parcel, 6, 2), 6);
 
-	if (instruction & arithmetic_mask)
-		return Rv32i_instruction_type::srai;
+	// CL/CS word offset: offset[5:3] in bits 12:10, offset[2] in bit 6, offset[6] in bit 5
+	const auto word_offset = static_cast<int32_t>(
+		(get_bits(parcel, 12, 10) << 3) | (get_bits(parcel, 6, 6) << 2) | (get_bits(parcel, 5, 5) << 6));
 
-	return Rv32i_instruction_type::srli;
-}
+	// CL/CS doubleword offset: offset[5:3] in bits 12:10, offset[7:6] in bits 6:5
+	const auto doubleword_offset = static_cast<int32_t>((get_bits(parcel, 12, 10) << 3) | (get_bits(parcel, 6, 5) << 6));
 
-static Rv32i_instruction_type resolve_system_priv(uint32_t instruction)
-{
-	// Type of instruction is immediate in the I-type immediate value
+	// CJ offset[11|4|9:8|10|6|7|3:1|5]
+	const auto jump_offset = sign_extend(
+		(get_bits(parcel, 12, 12) << 11) | (get_bits(parcel, 11, 11) << 4) | (get_bits(parcel, 10, 9) << 8)
+		| (get_bits(parcel, 8, 8) << 10) | (get_bits(parcel, 7, 7) << 6) | (get_bits(parcel, 6, 6) << 7)
+		| (get_bits(parcel, 5, 3) << 1) | (get_bits(parcel, 2, 2) << 5), 12);
 
-	const auto imm = instruction >> 20;
-	if (imm == to_underlying(Rv32_system_funct12::ebreak))
-		return Rv32i_instruction_type::ebreak;
-	if (imm == to_underlying(Rv32_system_funct12::ecall))
-		return Rv32i_instruction_type::ecall;
+	// CB offset[8|4:3] in bits 12:10, offset[7:6|2:1|5] in bits 6:2
+	const auto branch_offset = sign_extend(
+		(get_bits(parcel, 12, 12) << 8) | (get_bits(parcel, 11, 10) << 3) | (get_bits(parcel, 6, 5) << 6)
+		| (get_bits(parcel, 4, 3) << 1) | (get_bits(parcel, 2, 2) << 5), 9);
 
-	return Rv32i_instruction_type::invalid;
-}
+	switch ((get_bits(parcel, 1, 0) << 3) | funct3)
+	{
+	// Quadrant 0
 
-struct Signature_match
-{
-	Signature_match(Rv32i_instruction_type type) : instruction(type), resolver(nullptr)
+	case 0b00'000: // C.ADDI4SPN: nzuimm[5:4|9:6|2|3]
 	{
+		const auto imm = (get_bits(parcel, 12, 11) << 4) | (get_bits(parcel, 10, 7) << 6)
+			| (get_bits(parcel, 6, 6) << 2) | (get_bits(parcel, 5, 5) << 3);
+		if (imm == 0)
+			return 0;
+
+		return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::addi), rd_prime, sp, static_cast<int32_t>(imm));
 	}
 
-	Signature_match(Rv_instruction_type_resolver resolver) : resolver(resolver), instruction(Rv32i_instruction_type::invalid)
+	case 0b00'001: // C.FLD
+		return make_itype(Rv_opcode::load_fp, to_underlying(Rv32_load_fp_funct3::fld), rd_prime, rs1_prime, doubleword_offset);
+
+	case 0b00'010: // C.LW
+		return make_itype(Rv_opcode::load, to_underlying(Rv32_load_funct3::lw), rd_prime, rs1_prime, word_offset);
+
+	case 0b00'011: // C.FLW
+		return make_itype(Rv_opcode::load_fp, to_underlying(Rv32_load_fp_funct3::flw), rd_prime, rs1_prime, word_offset);
+
+	case 0b00'101: // C.FSD
+		return make_stype(Rv_opcode::store_fp, to_underlying(Rv32_store_fp_funct3::fsd), rs1_prime, rd_prime, doubleword_offset);
+
+	case 0b00'110: // C.SW
+		return make_stype(Rv_opcode::store, to_underlying(Rv32_store_funct3::sw), rs1_prime, rd_prime, word_offset);
+
+	case 0b00'111: // C.FSW
+		return make_stype(Rv_opcode::store_fp, to_underlying(Rv32_store_fp_funct3::fsw), rs1_prime, rd_prime, word_offset);
+
+	// Quadrant 1
+
+	case 0b01'000: // C.ADDI, C.NOP
+		return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::addi), rd, rd, ci_imm);
+
+	case 0b01'001: // C.JAL
+		return make_jal(ra, jump_offset);
+
+	case 0b01'010: // C.LI
+		return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::addi), rd, 0, ci_imm);
+
+	case 0b01'011:
 	{
+		if (rd == sp)
+		{
+			// C.ADDI16SP: nzimm[9] in bit 12, nzimm[4|6|8:7|5] in bits 6:2
+			const auto imm = sign_extend((get_bits(parcel, 12, 12) << 9) | (get_bits(parcel, 6, 6) << 4)
+				| (get_bits(parcel, 5, 5) << 6) | (get_bits(parcel, 4, 3) << 7) | (get_bits(parcel, 2, 2) << 5), 10);
+			if (imm == 0)
+				return 0;
+
+			return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::addi), sp, sp, imm);
+		}
+
+		// C.LUI: nzimm[17:12]
+		if (ci_imm == 0)
+			return 0;
+
+		return (static_cast<uint32_t>(ci_imm) << 12) | (rd << 7) | to_underlying(Rv_opcode::lui);
 	}
 
-	/**
-	The instruction type. This is invalid if a resolver is specified.
-	*/
-	Rv32i_instruction_type instruction;
+	case 0b01'100:
+	{
+		const auto shamt = get_bits(parcel, 6, 2);
+		const bool shamt_high = get_bits(parcel, 12, 12) != 0;
+
+		switch (get_bits(parcel, 11, 10))
+		{
+		case 0b00: // C.SRLI. shamt[5] must be 0 on RV32.
+			if (shamt_high)
+				return 0;
+
+			return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::srxi), rs1_prime, rs1_prime, shamt);
+
+		case 0b01: // C.SRAI
+			if (shamt_high)
+				return 0;
+
+			return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::srxi), rs1_prime, rs1_prime, 0b0100000 << 5 | shamt);
+
+		case 0b10: // C.ANDI
+			return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::andi), rs1_prime, rs1_prime, ci_imm);
+
+		default:
+			// C.SUBW and C.ADDW are RV64 only
+			if (shamt_high)
+				return 0;
+
+			switch (get_bits(parcel, 6, 5))
+			{
+			case 0b00: return make_rtype(Rv32_op_funct3::sub, Rv32_op_funct7::sub, rs1_prime, rs1_prime, rd_prime);
+			case 0b01: return make_rtype(Rv32_op_funct3::xor_, Rv32_op_funct7::xor_, rs1_prime, rs1_prime, rd_prime);
+			case 0b10: return make_rtype(Rv32_op_funct3::or_, Rv32_op_funct7::or_, rs1_prime, rs1_prime, rd_prime);
+			default: return make_rtype(Rv32_op_funct3::and_, Rv32_op_funct7::and_, rs1_prime, rs1_prime, rd_prime);
+			}
+		}
+	}
 
-	/**
-	Picks the correct instruction type for the current instruction. Allows differentiating instructions
-	that share the same opcode and funct, but differ in some other bit(s).
-	If null, no resolver is needed and a single instruction type matches the signature.
-	*/
-	Rv_instruction_type_resolver resolver;
-};
+	case 0b01'101: // C.J
+		return make_jal(0, jump_offset);
 
-/**
-Identifies what type of instruction a raw instruction is based on the instruction's signature.
-An instruction signature has fixed bits (opcode, funct3, funct7, etc.) set and all variable 
-bits (rd, rs1, rs2, imm, etc.) cleared.
+	case 0b01'110: // C.BEQZ
+		return make_btype(Rv32_branch_funct3::beq, rs1_prime, 0, branch_offset);
 
-This map uses the signature as the key and a match as a value. A signature match can either be
-a single instruction type or a pointer to a function that will pick the correct instruction type.
-*/
-const map<uint32_t, Signature_match> instruction_signature_map2 = {
-	
-	{ create_utype_signature(Rv_opcode::auipc), Rv32i_instruction_type::auipc },
-	{ create_utype_signature(Rv_opcode::lui), Rv32i_instruction_type::lui },
-
-	{ create_jtype_signature(Rv_opcode::jal), Rv32i_instruction_type::jal },
-	{ create_jtype_signature(Rv_opcode::jalr), Rv32i_instruction_type::jalr },
-
-	{ create_branch_signature(Rv32_branch_funct3::beq), Rv32i_instruction_type::beq },
-	{ create_branch_signature(Rv32_branch_funct3::bge), Rv32i_instruction_type::bge },
-	{ create_branch_signature(Rv32_branch_funct3::bgeu), Rv32i_instruction_type::bgeu },
-	{ create_branch_signature(Rv32_branch_funct3::blt), Rv32i_instruction_type::blt },
-	{ create_branch_signature(Rv32_branch_funct3::bltu), Rv32i_instruction_type::bltu },
-	{ create_branch_signature(Rv32_branch_funct3::bne), Rv32i_instruction_type::bne },
-
-	{ create_op_imm_signature(Rv32_op_imm_funct::addi), Rv32i_instruction_type::addi },
-	{ create_op_imm_signature(Rv32_op_imm_funct::andi), Rv32i_instruction_type::andi },
-	{ create_op_imm_signature(Rv32_op_imm_funct::ori), Rv32i_instruction_type::ori },
-	{ create_op_imm_signature(Rv32_op_imm_funct::slli), Rv32i_instruction_type::slli },
-	{ create_op_imm_signature(Rv32_op_imm_funct::slti), Rv32i_instruction_type::slti },
-	{ create_op_imm_signature(Rv32_op_imm_funct::sltiu), Rv32i_instruction_type::sltiu },
-	{ create_op_imm_signature(Rv32_op_imm_funct::srxi), resolve_op_imm_shift_right },
-	{ create_op_imm_signature(Rv32_op_imm_funct::xori), Rv32i_instruction_type::xori },
-
-	{ create_load_signature(Rv32_load_funct3::lb), Rv32i_instruction_type::lb },
-	{ create_load_signature(Rv32_load_funct3::lbu), Rv32i_instruction_type::lbu },
-	{ create_load_signature(Rv32_load_funct3::lh), Rv32i_instruction_type::lh },
-	{ create_load_signature(Rv32_load_funct3::lhu), Rv32i_instruction_type::lhu },
-	{ create_load_signature(Rv32_load_funct3::lw), Rv32i_instruction_type::lw },
-
-	{ create_op_signature(Rv32_op_funct3::add, Rv32_op_funct7::add), Rv32i_instruction_type::add },
-	{ create_op_signature(Rv32_op_funct3::and_, Rv32_op_funct7::and_), Rv32i_instruction_type::and_ },
-	{ create_op_signature(Rv32_op_funct3::or_, Rv32_op_funct7::or_), Rv32i_instruction_type::or_ },
-	{ create_op_signature(Rv32_op_funct3::sll, Rv32_op_funct7::sll), Rv32i_instruction_type::sll },
-	{ create_op_signature(Rv32_op_funct3::slt, Rv32_op_funct7::slt), Rv32i_instruction_type::slt },
-	{ create_op_signature(Rv32_op_funct3::sltu, Rv32_op_funct7::sltu), Rv32i_instruction_type::sltu },
-	{ create_op_signature(Rv32_op_funct3::sra, Rv32_op_funct7::sra), Rv32i_instruction_type::sra },
-	{ create_op_signature(Rv32_op_funct3::srl, Rv32_op_funct7::srl), Rv32i_instruction_type::srl },
-	{ create_op_signature(Rv32_op_funct3::sub, Rv32_op_funct7::sub), Rv32i_instruction_type::sub },
-	{ create_op_signature(Rv32_op_funct3::xor_, Rv32_op_funct7::xor_), Rv32i_instruction_type::xor_ },
-
-	{ create_store_signature(Rv32_store_funct3::sb), Rv32i_instruction_type::sb },
-	{ create_store_signature(Rv32_store_funct3::sh), Rv32i_instruction_type::sh },
-	{ create_store_signature(Rv32_store_funct3::sw), Rv32i_instruction_type::sw },
-
-	{ create_miscmem_signature(Rv32_miscmem_funct3::fence), Rv32i_instruction_type::fence },
-
-	{ create_system_signature(Rv32_system_funct3::priv), resolve_system_priv },
-};
+	case 0b01'111: // C.BNEZ
+		return make_btype(Rv32_branch_funct3::bne, rs1_prime, 0, branch_offset);
 
-/**
-Maps the raw opcode bits to the correct opcode enum.
-*/
-const auto rv32i_opcode_map = map<uint8_t, Rv_opcode>() = {
-	{ to_underlying(Rv_opcode::auipc), Rv_opcode::auipc },
-	{ to_underlying(Rv_opcode::branch), Rv_opcode::branch },
-	{ to_underlying(Rv_opcode::jal), Rv_opcode::jal },
-	{ to_underlying(Rv_opcode::jalr), Rv_opcode::jalr },
-	{ to_underlying(Rv_opcode::load), Rv_opcode::load },
-	{ to_underlying(Rv_opcode::lui), Rv_opcode::lui },
-	{ to_underlying(Rv_opcode::misc_mem), Rv_opcode::misc_mem },
-	{ to_underlying(Rv_opcode::op), Rv_opcode::op },
-	{ to_underlying(Rv_opcode::op_imm), Rv_opcode::op_imm },
-	{ to_underlying(Rv_opcode::store), Rv_opcode::store },
-	{ to_underlying(Rv_opcode::system), Rv_opcode::system },
-};
+	// Quadrant 2
 
-/**
-Maps the raw opcode bits to the correct instruction mask to use.
-An instruction mask is applied to the raw instruction to get its signature.
+	case 0b10'000: // C.SLLI
+		if (get_bits(parcel, 12, 12) != 0)
+			return 0;
 
-signature = instruction & mask
-*/
-const auto rv32_opcode_mask_map = map<uint8_t, uint32_t>() = {
-	{ to_underlying(Rv_opcode::auipc), rv32i_utype_mask },
-	{ to_underlying(Rv_opcode::branch), rv32i_btype_mask },
-	{ to_underlying(Rv_opcode::jal), rv32i_jtype_mask },
-	{ to_underlying(Rv_opcode::jalr), rv32i_itype_mask },
-	{ to_underlying(Rv_opcode::load), rv32i_itype_mask },
-	{ to_underlying(Rv_opcode::lui), rv32i_utype_mask },
-	{ to_underlying(Rv_opcode::misc_mem), rv32i_itype_mask },
-	{ to_underlying(Rv_opcode::op), rv32i_rtype_mask },
-	{ to_underlying(Rv_opcode::op_imm), rv32i_itype_mask },
-	{ to_underlying(Rv_opcode::store), rv32i_stype_mask },
-	{ to_underlying(Rv_opcode::system), rv32i_itype_mask },
-};
+		return make_itype(Rv_opcode::op_imm, to_underlying(Rv32_op_imm_funct::slli), rd, rd, rs2);
 
-/* ========================================================
+	case 0b10'001: // C.FLDSP: offset[5] in bit 12, offset[4:3|8:6] in bits 6:2
+	{
+		const auto offset = (get_bits(parcel, 12, 12) << 5) | (get_bits(parcel, 6, 5) << 3) | (get_bits(parcel, 4, 2) << 6);
+		return make_itype(Rv_opcode::load_fp, to_underlying(Rv32_load_fp_funct3::fld), rd, sp, static_cast<int32_t>(offset));
+	}
 
-Rv32_decoder
+	case 0b10'010: // C.LWSP: offset[5] in bit 12, offset[4:2|7:6] in bits 6:2
+	{
+		if (rd == 0)
+			return 0;
 
-======================================================== */
+		const auto offset = (get_bits(parcel, 12, 12) << 5) | (get_bits(parcel, 6, 4) << 2) | (get_bits(parcel, 3, 2) << 6);
+		return make_itype(Rv_opcode::load, to_underlying(Rv32_load_funct3::lw), rd, sp, static_cast<int32_t>(offset));
+	}
 
-Rv32i_instruction_type Rv32_decoder::decode_instruction_type(uint32_t instruction)
-{
-	// Opcode is in first 7 bits
-	uint8_t opcode_raw = instruction & 0b1111111;
-	if (!rv32_opcode_mask_map.contains(opcode_raw))
-		return Rv32i_instruction_type::invalid;
+	case 0b10'011: // C.FLWSP: same layout as C.LWSP. f0 is a valid destination.
+	{
+		const auto offset = (get_bits(parcel, 12, 12) << 5) | (get_bits(parcel, 6, 4) << 2) | (get_bits(parcel, 3, 2) << 6);
+		return make_itype(Rv_opcode::load_fp, to_underlying(Rv32_load_fp_funct3::flw), rd, sp, static_cast<int32_t>(offset));
+	}
+
+	case 0b10'100:
+		if (get_bits(parcel, 12, 12) == 0)
+		{
+			if (rs2 != 0) // C.MV
+				return make_rtype(Rv32_op_funct3::add, Rv32_op_funct7::add, rd, 0, rs2);
 
-	// Mask off fixed bits based on the opcode of the instruction to get a unique signature
-	auto mask = rv32_opcode_mask_map.at(opcode_raw);
-	auto sig = instruction & mask;
+			if (rd == 0)
+				return 0;
 
-	// Lookup the instruction type based on the signature
-	if (instruction_signature_map2.contains(sig))
+			// C.JR
+			return make_itype(Rv_opcode::jalr, to_underlying(Rv32_jalr_funct3::jalr), 0, rd, 0);
+		}
+
+		if (rs2 != 0) // C.ADD
+			return make_rtype(Rv32_op_funct3::add, Rv32_op_funct7::add, rd, rd, rs2);
+
+		if (rd == 0) // C.EBREAK
+			return make_itype(Rv_opcode::system, to_underlying(Rv32_system_funct3::priv), 0, 0, to_underlying(Rv32_system_funct12::ebreak));
+
+		// C.JALR
+		return make_itype(Rv_opcode::jalr, to_underlying(Rv32_jalr_funct3::jalr), ra, rd, 0);
+
+	case 0b10'110: // C.SWSP: offset[5:2|7:6] in bits 12:7
 	{
-		const auto v = instruction_signature_map2.at(sig);
-		if (v.resolver != nullptr)
-			return v.resolver(instruction);
+		const auto offset = (get_bits(parcel, 12, 9) << 2) | (get_bits(parcel, 8, 7) << 6);
+		return make_stype(Rv_opcode::store, to_underlying(Rv32_store_funct3::sw), sp, rs2, static_cast<int32_t>(offset));
+	}
 
-		return v.instruction;
+	case 0b10'101: // C.FSDSP: offset[5:3|8:6] in bits 12:7
+	{
+		const auto offset = (get_bits(parcel, 12, 10) << 3) | (get_bits(parcel, 9, 7) << 6);
+		return make_stype(Rv_opcode::store_fp, to_underlying(Rv32_store_fp_funct3::fsd), sp, rs2, static_cast<int32_t>(offset));
 	}
 
-	return Rv32i_instruction_type::invalid;
+	case 0b10'111: // C.FSWSP: same layout as C.SWSP
+	{
+		const auto offset = (get_bits(parcel, 12, 9) << 2) | (get_bits(parcel, 8, 7) << 6);
+		return make_stype(Rv_opcode::store_fp, to_underlying(Rv32_store_fp_funct3::fsw), sp, rs2, static_cast<int32_t>(offset));
+	}
+
+	default:
+		// The reserved funct3 of quadrant 0
+		return 0;
+	}
+}
+
+static consteval array<uint32_t, rvc_expansion_table_size> create_rvc_expansion_table()
+{
+	array<uint32_t, rvc_expansion_table_size> table{};
+	for (uint32_t parcel = 0; parcel < rvc_expansion_table_size; ++parcel)
+	{
+		if ((parcel & 0b11) != 0b11)
+			table[parcel] = expand_rvc(parcel);
+	}
+
+	return table;
+}
+
+static constexpr auto rvc_expansion_table = create_rvc_expansion_table();
+
+/* ========================================================
+
+Rv_decoder
+
+======================================================== */
+
+template <unsigned Xlen>
+Rv32i_instruction_type Rv_decoder<Xlen>::decode_instruction_type(uint32_t instruction)
+{
+	// Opcode is in bits 0-6 and funct3 is in bits 12-14
+	const auto primary_index = ((instruction >> 5) & 0b111'0000000) | (instruction & 0b1111111);
+	const auto& entry = rv_decode_tables<Xlen>.primary[primary_index];
+
+	return rv_decode_tables<Xlen>.secondary[entry.base + ((instruction >> entry.shift) & entry.mask)];
 }
 
-Rv_btype_instruction Rv32_decoder::decode_btype(uint32_t instruction)
+template <unsigned Xlen>
+uint32_t Rv_decoder<Xlen>::expand_compressed(uint16_t instruction) requires (Xlen == 32)
+{
+	return rvc_expansion_table[instruction];
+}
+
+template <unsigned Xlen>
+Rv_btype_instruction Rv_decoder<Xlen>::decode_btype(uint32_t instruction)
 {
 	// 31        25 | 24     20 | 19     15 | 14    12 | 11     7 | 6      0
 	// imm[12|10:5]      rs2         rs1       funct3   imm[4:1|11]  opcode
@@ -279,7 +825,8 @@ Rv_btype_instruction Rv32_decoder::decode_btype(uint32_t instruction)
 	return Rv_btype_instruction(opcode, funct3, rs1, rs2, imm);
 }
 
-Rv_itype_instruction Rv32_decoder::decode_itype(uint32_t instruction)
+template <unsigned Xlen>
+Rv_itype_instruction Rv_decoder<Xlen>::decode_itype(uint32_t instruction)
 {
 	// 31     20 | 19   15 | 14  12 | 11   7 | 6    0
 	// imm[11:0]     rs1     funct3      rd    opcode
@@ -301,7 +848,8 @@ Rv_itype_instruction Rv32_decoder::decode_itype(uint32_t instruction)
 	return Rv_itype_instruction(opcode, funct3, rd, rs1, imm);
 }
 
-Rv_jtype_instruction Rv32_decoder::decode_jtype(uint32_t instruction)
+template <unsigned Xlen>
+Rv_jtype_instruction Rv_decoder<Xlen>::decode_jtype(uint32_t instruction)
 {
 	//   31    | 30         21 |   20    | 19          12 | 11    7 | 6      0
 	// imm[20]     imm[10:1]     imm[11]     imm[19:12]        rd      opcode
@@ -318,7 +866,8 @@ Rv_jtype_instruction Rv32_decoder::decode_jtype(uint32_t instruction)
 	return Rv_jtype_instruction(opcode, rd, imm);
 }
 
-Rv_rtype_instruction Rv32_decoder::decode_rtype(uint32_t instruction)
+template <unsigned Xlen>
+Rv_rtype_instruction Rv_decoder<Xlen>::decode_rtype(uint32_t instruction)
 {
 	// 31        25 | 24     20 | 19     15 | 14    12 | 11     7 | 6      0
 	//    funct7         rs2         rs1       funct3        rd      opcode
@@ -343,7 +892,28 @@ Rv_rtype_instruction Rv32_decoder::decode_rtype(uint32_t instruction)
 	return Rv_rtype_instruction(opcode, funct3, funct7, rd, rs1, rs2);
 }
 
-Rv_stype_instruction Rv32_decoder::decode_stype(uint32_t instruction)
+template <unsigned Xlen>
+Rv_r4type_instruction Rv_decoder<Xlen>::decode_r4type(uint32_t instruction)
+{
+	// 31   27 | 26  25 | 24   20 | 19   15 | 14    12 | 11   7 | 6      0
+	//    rs3      fmt      rs2       rs1        rm         rd     opcode
+
+	const auto opcode = get_opcode(instruction);
+	if (opcode == Rv_opcode::invalid)
+		throw runtime_error("Invalid instruction.");
+
+	const auto rs3 = get_register_id(0b1'1111 & (instruction >> 27));
+	const uint8_t fmt = 0b11 & (instruction >> 25);
+	const auto rs2 = get_register_id(0b1'1111 & (instruction >> 20));
+	const auto rs1 = get_register_id(0b1'1111 & (instruction >> 15));
+	const uint8_t funct3 = 0b111 & (instruction >> 12);
+	const auto rd = get_register_id(0b1'1111 & (instruction >> 7));
+
+	return Rv_r4type_instruction(opcode, funct3, fmt, rd, rs1, rs2, rs3);
+}
+
+template <unsigned Xlen>
+Rv_stype_instruction Rv_decoder<Xlen>::decode_stype(uint32_t instruction)
 {
 	// 31        25 | 24     20 | 19     15 | 14    12 | 11     7 | 6      0
 	//   imm[11:5]       rs2         rs1       funct3    imm[4:0]    opcode
@@ -362,186 +932,717 @@ Rv_stype_instruction Rv32_decoder::decode_stype(uint32_t instruction)
 
 	const uint8_t funct3 = 0b111 & (instruction >> 12);
 
-	return Rv_stype_instruction(opcode, funct3, rs1, rs2, imm);
+	return Rv_stype_instruction(opcode, funct3, rs1, rs2, imm);
+}
+
+template <unsigned Xlen>
+Rv_utype_instruction Rv_decoder<Xlen>::decode_utype(uint32_t instruction)
+{
+	// 31                           12 | 11   7 | 6    0
+	//           imm[31:12]                 rd    opcode
+
+	const auto opcode = get_opcode(instruction);
+	if (opcode == Rv_opcode::invalid)
+		throw runtime_error("Invalid instruction.");
+
+	const uint8_t rd_raw = 0b1'1111 & (instruction >> 7);
+	const auto rd = get_register_id(rd_raw);
+
+	auto imm = Rv_utype_imm::from_instruction(instruction);
+
+	return Rv_utype_instruction(opcode, rd, imm);
+}
+
+template <unsigned Xlen>
+Rv_register_id Rv_decoder<Xlen>::get_register_id(uint8_t encoded_register)
+{
+	// Register encoding uses 5 bits for a total of 32 possible values.
+	// The high three bits are ignored here.
+	return Rv_register_id(static_cast<Rv_register_id>(0b11111 & encoded_register));
+}
+
+template <unsigned Xlen>
+Rv_opcode Rv_decoder<Xlen>::get_opcode(uint32_t instruction)
+{
+	return rv_decode_tables<Xlen>.opcodes[0b1111111 & instruction];
+}
+
+template class Rv_decoder<32>;
+template class Rv_decoder<64>;
+
+/* ========================================================
+
+Rv32_encoder
+
+======================================================== */
+
+uint32_t Rv32_encoder::encode_btype(Rv_opcode opcode, Rv32_branch_funct3 funct3, Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+{
+	return imm.get_encoded() | to_underlying(opcode) | to_underlying(funct3) << 12 | to_underlying(rs1) << 15 | to_underlying(rs2) << 20;
+}
+
+static uint32_t encode_itype(Rv_opcode opcode, uint8_t funct3, Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rs1) << 15) | ((funct3 & 0b111) << 12) | (to_underlying(rd) << 7) | (to_underlying(opcode));
+}
+
+uint32_t Rv32_encoder::encode_jal(Rv_register_id rd, Rv_jtype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rd) << 7) | to_underlying(Rv_opcode::jal);
+}
+
+uint32_t Rv32_encoder::encode_jalr(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rs1) << 15) | (to_underlying(Rv32_jalr_funct3::jalr) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::jalr));
+}
+
+uint32_t Rv32_encoder::encode_load(Rv32_load_funct3 funct3, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::load));
+}
+
+uint32_t Rv32_encoder::encode_miscmem(Rv32_miscmem_funct3 funct3, Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm)
+{
+	return encode_itype(Rv_opcode::misc_mem, to_underlying(funct3), rs1, rd, imm);
+}
+
+uint32_t Rv32_encoder::encode_utype(Rv_opcode opcode, Rv_register_id rd, uint32_t imm)
+{
+	uint32_t val = (0b1111'1111'1111'1111'1111 & imm) << 12;
+	return val | (to_underlying(rd) << 7) | to_underlying(opcode);
+}
+
+uint32_t Rv32_encoder::encode_op(Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return (to_underlying(funct7) << 25) | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::op));
+}
+
+uint32_t Rv32_encoder::encode_op_32(Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return (to_underlying(funct7) << 25) | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::op_32));
+}
+
+uint32_t Rv32_encoder::encode_op_imm(Rv32_op_imm_funct funct, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rs1) << 15) | (to_underlying(funct) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::op_imm));
+}
+
+uint32_t Rv32_encoder::encode_op_imm_32(Rv64_op_imm_32_funct funct, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rs1) << 15) | (to_underlying(funct) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::op_imm_32));
+}
+
+uint32_t Rv32_encoder::encode_op_imm_funct7(Rv32_op_imm_funct funct, Rv32_op_imm_funct7 funct7, Rv_register_id rd, Rv_register_id rs1, uint8_t rs2)
+{
+	// rs2 is a shift amount or selects a unary operation
+	const auto imm = Rv_itype_imm::from_unsigned((to_underlying(funct7) << 5) | (0b11111 & rs2));
+	return encode_op_imm(funct, rd, rs1, imm);
+}
+
+uint32_t Rv32_encoder::encode_store(Rv32_store_funct3 funct3, Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(Rv_opcode::store));
+}
+
+uint32_t Rv32_encoder::encode_system(Rv32_system_funct3 funct3, Rv32_system_funct12 funct12)
+{
+	const auto imm = Rv_itype_imm::from_unsigned(to_underlying(funct12));
+	return encode_itype(Rv_opcode::system, to_underlying(funct3), Rv_register_id::x0, Rv_register_id::x0, imm);
+}
+
+uint32_t Rv32_encoder::encode_csr(Rv32_system_funct3 funct3, Rv_register_id rd, Rv_csr csr, uint8_t rs1)
+{
+	// rs1 is a register or, in the immediate forms, a 5-bit unsigned immediate
+	if (rs1 > 0b11111)
+		throw runtime_error("CSR source out of range.");
+
+	const auto imm = Rv_itype_imm::from_unsigned(to_underlying(csr));
+	return encode_itype(Rv_opcode::system, to_underlying(funct3), Rv_register_id(rs1), rd, imm);
+}
+
+uint32_t Rv32_encoder::encode_load_fp(Rv32_load_fp_funct3 funct3, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+{
+	return encode_itype(Rv_opcode::load_fp, to_underlying(funct3), rs1, rd, imm);
+}
+
+uint32_t Rv32_encoder::encode_store_fp(Rv32_store_fp_funct3 funct3, Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+{
+	return imm.get_encoded() | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(Rv_opcode::store_fp));
+}
+
+uint32_t Rv32_encoder::encode_op_fp(Rv32_op_fp_funct5 funct5, Rv_fp_format fmt, uint8_t funct3, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return (to_underlying(funct5) << 27) | (to_underlying(fmt) << 25) | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15)
+		| ((funct3 & 0b111) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::op_fp));
+}
+
+uint32_t Rv32_encoder::encode_r4type(Rv_opcode opcode, Rv_fp_format fmt, Rv_rounding_mode rm, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3)
+{
+	return (to_underlying(rs3) << 27) | (to_underlying(fmt) << 25) | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15)
+		| (to_underlying(rm) << 12) | (to_underlying(rd) << 7) | (to_underlying(opcode));
+}
+
+uint32_t Rv32_encoder::encode_amo(Rv32_amo_funct3 funct3, Rv32_amo_funct5 funct5, Rv_amo_ordering ordering, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return (to_underlying(funct5) << 27) | (to_underlying(ordering) << 25) | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15)
+		| (to_underlying(funct3) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::amo));
+}
+
+/* --------------------------------------------------------
+Specific instruction encoding helpers
+-----------------------------------------------------------*/
+
+uint32_t Rv32_encoder::encode_add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::add, Rv32_op_funct7::add, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_addi(Rv_register_id rd, Rv_register_id rs1, int16_t imm)
+{
+	const auto immediate = Rv_itype_imm::from_signed(imm);
+	return encode_op_imm(Rv32_op_imm_funct::addi, rd, rs1, immediate);
+}
+
+uint32_t Rv32_encoder::encode_addiw(Rv_register_id rd, Rv_register_id rs1, int16_t imm)
+{
+	const auto immediate = Rv_itype_imm::from_signed(imm);
+	return encode_op_imm_32(Rv64_op_imm_32_funct::addiw, rd, rs1, immediate);
+}
+
+uint32_t Rv32_encoder::encode_addw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::add, Rv32_op_funct7::add, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoadd, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoadd_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoadd, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoand_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoand, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoand_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoand, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amomax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amomax, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amomax_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amomax, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amomaxu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amomaxu, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amomaxu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amomaxu, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amomin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amomin, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amomin_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amomin, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amominu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amominu, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amominu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amominu, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoor, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoor, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoswap_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoswap, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoswap_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoswap, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoxor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::amoxor, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_amoxor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::amoxor, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_and(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::and_, Rv32_op_funct7::and_, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_andi(Rv_register_id rd, Rv_register_id rs1, int16_t imm)
+{
+	const auto immediate = Rv_itype_imm::from_signed(imm);
+	return encode_op_imm(Rv32_op_imm_funct::andi, rd, rs1, immediate);
+}
+
+uint32_t Rv32_encoder::encode_andn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::andn, Rv32_op_funct7::andn, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_auipc(Rv_register_id rd, uint32_t imm)
+{
+	return encode_utype(Rv_opcode::auipc, rd, imm);
+}
+
+uint32_t Rv32_encoder::encode_bclr(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::bclr, Rv32_op_funct7::bclr, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_bclri(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::bclri, Rv32_op_imm_funct7::bclri, rd, rs1, shift_amount);
+}
+
+uint32_t Rv32_encoder::encode_beq(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+{
+	const auto imm = Rv_btype_imm::from_offset(offset);
+	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::beq, rs1, rs2, imm);
+}
+
+uint32_t Rv32_encoder::encode_bext(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::bext, Rv32_op_funct7::bext, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_bexti(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::bexti, Rv32_op_imm_funct7::bexti, rd, rs1, shift_amount);
+}
+
+uint32_t Rv32_encoder::encode_bge(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+{
+	const auto imm = Rv_btype_imm::from_offset(offset);
+	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bge, rs1, rs2, imm);
+}
+
+uint32_t Rv32_encoder::encode_bgeu(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+{
+	const auto imm = Rv_btype_imm::from_offset(offset);
+	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bgeu, rs1, rs2, imm);
+}
+
+uint32_t Rv32_encoder::encode_binv(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::binv, Rv32_op_funct7::binv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_binvi(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::binvi, Rv32_op_imm_funct7::binvi, rd, rs1, shift_amount);
+}
+
+uint32_t Rv32_encoder::encode_blt(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+{
+	const auto imm = Rv_btype_imm::from_offset(offset);
+	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::blt, rs1, rs2, imm);
+}
+
+uint32_t Rv32_encoder::encode_bltu(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+{
+	const auto imm = Rv_btype_imm::from_offset(offset);
+	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bltu, rs1, rs2, imm);
+}
+
+uint32_t Rv32_encoder::encode_bne(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+{
+	const auto imm = Rv_btype_imm::from_offset(offset);
+	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bne, rs1, rs2, imm);
+}
+
+uint32_t Rv32_encoder::encode_bset(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::bset, Rv32_op_funct7::bset, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_bseti(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::bseti, Rv32_op_imm_funct7::bseti, rd, rs1, shift_amount);
+}
+
+uint32_t Rv32_encoder::encode_clz(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, rd, rs1, to_underlying(Rv32_op_imm_unary::clz));
+}
+
+uint32_t Rv32_encoder::encode_cpop(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, rd, rs1, to_underlying(Rv32_op_imm_unary::cpop));
+}
+
+uint32_t Rv32_encoder::encode_csrrc(Rv_register_id rd, Rv_csr csr, Rv_register_id rs1)
+{
+	return encode_csr(Rv32_system_funct3::csrrc, rd, csr, to_underlying(rs1));
+}
+
+uint32_t Rv32_encoder::encode_csrrci(Rv_register_id rd, Rv_csr csr, uint8_t imm)
+{
+	return encode_csr(Rv32_system_funct3::csrrci, rd, csr, imm);
+}
+
+uint32_t Rv32_encoder::encode_csrrs(Rv_register_id rd, Rv_csr csr, Rv_register_id rs1)
+{
+	return encode_csr(Rv32_system_funct3::csrrs, rd, csr, to_underlying(rs1));
+}
+
+uint32_t Rv32_encoder::encode_csrrsi(Rv_register_id rd, Rv_csr csr, uint8_t imm)
+{
+	return encode_csr(Rv32_system_funct3::csrrsi, rd, csr, imm);
+}
+
+uint32_t Rv32_encoder::encode_csrrw(Rv_register_id rd, Rv_csr csr, Rv_register_id rs1)
+{
+	return encode_csr(Rv32_system_funct3::csrrw, rd, csr, to_underlying(rs1));
+}
+
+uint32_t Rv32_encoder::encode_csrrwi(Rv_register_id rd, Rv_csr csr, uint8_t imm)
+{
+	return encode_csr(Rv32_system_funct3::csrrwi, rd, csr, imm);
+}
+
+uint32_t Rv32_encoder::encode_ctz(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, rd, rs1, to_underlying(Rv32_op_imm_unary::ctz));
+}
+
+uint32_t Rv32_encoder::encode_div(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::div, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_divu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::divu, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_divuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::divu, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_divw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::div, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_ebreak()
+{
+	return encode_system(Rv32_system_funct3::priv, Rv32_system_funct12::ebreak);
+}
+
+uint32_t Rv32_encoder::encode_ecall()
+{
+	return encode_system(Rv32_system_funct3::priv, Rv32_system_funct12::ecall);
+}
+
+uint32_t Rv32_encoder::encode_fadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fadd, Rv_fp_format::d, to_underlying(rm), rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_fadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fadd, Rv_fp_format::s, to_underlying(rm), rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_fclass_d(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fmv_to_int, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::fclass), rd, rs1, Rv_register_id::x0);
+}
+
+uint32_t Rv32_encoder::encode_fclass_s(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fmv_to_int, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fclass), rd, rs1, Rv_register_id::x0);
+}
+
+uint32_t Rv32_encoder::encode_fcvt_d_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_fp, Rv_fp_format::d, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv_fp_format::s)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_d_w(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_from_int, Rv_fp_format::d, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::w)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_d_wu(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_from_int, Rv_fp_format::d, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::wu)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_s_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_fp, Rv_fp_format::s, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv_fp_format::d)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_s_w(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_from_int, Rv_fp_format::s, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::w)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_s_wu(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_from_int, Rv_fp_format::s, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::wu)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_w_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_to_int, Rv_fp_format::d, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::w)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_w_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_to_int, Rv_fp_format::s, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::w)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_wu_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_to_int, Rv_fp_format::d, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::wu)));
+}
+
+uint32_t Rv32_encoder::encode_fcvt_wu_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcvt_to_int, Rv_fp_format::s, to_underlying(rm), rd, rs1, Rv_register_id(to_underlying(Rv32_fcvt_int_type::wu)));
+}
+
+uint32_t Rv32_encoder::encode_fdiv_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fdiv, Rv_fp_format::d, to_underlying(rm), rd, rs1, rs2);
 }
 
-Rv_utype_instruction Rv32_decoder::decode_utype(uint32_t instruction)
+uint32_t Rv32_encoder::encode_fdiv_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
 {
-	// 31                           12 | 11   7 | 6    0
-	//           imm[31:12]                 rd    opcode
+	return encode_op_fp(Rv32_op_fp_funct5::fdiv, Rv_fp_format::s, to_underlying(rm), rd, rs1, rs2);
+}
 
-	const auto opcode = get_opcode(instruction);
-	if (opcode == Rv_opcode::invalid)
-		throw runtime_error("Invalid instruction.");
+uint32_t Rv32_encoder::encode_fence(Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm)
+{
+	return encode_miscmem(Rv32_miscmem_funct3::fence, rs1, rd, imm);
+}
 
-	const uint8_t rd_raw = 0b1'1111 & (instruction >> 7);
-	const auto rd = get_register_id(rd_raw);
+uint32_t Rv32_encoder::encode_feq_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcmp, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::feq), rd, rs1, rs2);
+}
 
-	auto imm = Rv_utype_imm::from_instruction(instruction);
+uint32_t Rv32_encoder::encode_feq_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcmp, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::feq), rd, rs1, rs2);
+}
 
-	return Rv_utype_instruction(opcode, rd, imm);
+uint32_t Rv32_encoder::encode_fld(Rv_register_id rd, Rv_register_id rs1, int16_t offset)
+{
+	const auto imm = Rv_itype_imm::from_signed(offset);
+	return encode_load_fp(Rv32_load_fp_funct3::fld, rd, rs1, imm);
 }
 
-Rv_register_id Rv32_decoder::get_register_id(uint8_t encoded_register)
+uint32_t Rv32_encoder::encode_fle_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	// Register encoding uses 5 bits for a total of 32 possible values.
-	// The high three bits are ignored here.
-	return Rv_register_id(static_cast<Rv_register_id>(0b11111 & encoded_register));
+	return encode_op_fp(Rv32_op_fp_funct5::fcmp, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::fle), rd, rs1, rs2);
 }
 
-Rv_opcode Rv32_decoder::get_opcode(uint32_t instruction)
+uint32_t Rv32_encoder::encode_fle_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	const auto opcode_raw = 0b1111111 & instruction;
+	return encode_op_fp(Rv32_op_fp_funct5::fcmp, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fle), rd, rs1, rs2);
+}
 
-	if (rv32i_opcode_map.contains(opcode_raw))
-		return rv32i_opcode_map.at(opcode_raw);
+uint32_t Rv32_encoder::encode_flt_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcmp, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::flt), rd, rs1, rs2);
+}
 
-	return Rv_opcode::invalid;
+uint32_t Rv32_encoder::encode_flt_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_fp(Rv32_op_fp_funct5::fcmp, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::flt), rd, rs1, rs2);
 }
 
-/* ========================================================
+uint32_t Rv32_encoder::encode_flw(Rv_register_id rd, Rv_register_id rs1, int16_t offset)
+{
+	const auto imm = Rv_itype_imm::from_signed(offset);
+	return encode_load_fp(Rv32_load_fp_funct3::flw, rd, rs1, imm);
+}
 
-Rv32_encoder
+uint32_t Rv32_encoder::encode_fmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
+{
+	return encode_r4type(Rv_opcode::madd, Rv_fp_format::d, rm, rd, rs1, rs2, rs3);
+}
 
-======================================================== */
+uint32_t Rv32_encoder::encode_fmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
+{
+	return encode_r4type(Rv_opcode::madd, Rv_fp_format::s, rm, rd, rs1, rs2, rs3);
+}
 
-uint32_t Rv32_encoder::encode_btype(Rv_opcode opcode, Rv32_branch_funct3 funct3, Rv_register_id rs1, Rv_register_id rs2, Rv_btype_imm imm)
+uint32_t Rv32_encoder::encode_fmax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	return imm.get_encoded() | to_underlying(opcode) | to_underlying(funct3) << 12 | to_underlying(rs1) << 15 | to_underlying(rs2) << 20;
+	return encode_op_fp(Rv32_op_fp_funct5::fminmax, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::fmax), rd, rs1, rs2);
 }
 
-static uint32_t encode_itype(Rv_opcode opcode, uint8_t funct3, Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm)
+uint32_t Rv32_encoder::encode_fmax_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	return imm.get_encoded() | (to_underlying(rs1) << 15) | ((funct3 & 0b111) << 12) | (to_underlying(rd) << 7) | (to_underlying(opcode));
+	return encode_op_fp(Rv32_op_fp_funct5::fminmax, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fmax), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_jal(Rv_register_id rd, Rv_jtype_imm imm)
+uint32_t Rv32_encoder::encode_fmin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	return imm.get_encoded() | (to_underlying(rd) << 7) | to_underlying(Rv_opcode::jal);
+	return encode_op_fp(Rv32_op_fp_funct5::fminmax, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::fmin), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_jalr(Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+uint32_t Rv32_encoder::encode_fmin_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	return imm.get_encoded() | (to_underlying(rs1) << 15) | (to_underlying(Rv32_jalr_funct3::jalr) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::jalr));
+	return encode_op_fp(Rv32_op_fp_funct5::fminmax, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fmin), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_load(Rv32_load_funct3 funct3, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+uint32_t Rv32_encoder::encode_fmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
 {
-	return imm.get_encoded() | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::load));
+	return encode_r4type(Rv_opcode::msub, Rv_fp_format::d, rm, rd, rs1, rs2, rs3);
 }
 
-uint32_t Rv32_encoder::encode_miscmem(Rv32_miscmem_funct3 funct3, Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm)
+uint32_t Rv32_encoder::encode_fmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
 {
-	return encode_itype(Rv_opcode::misc_mem, to_underlying(funct3), rs1, rd, imm);
+	return encode_r4type(Rv_opcode::msub, Rv_fp_format::s, rm, rd, rs1, rs2, rs3);
 }
 
-uint32_t Rv32_encoder::encode_utype(Rv_opcode opcode, Rv_register_id rd, uint32_t imm)
+uint32_t Rv32_encoder::encode_fmul_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
 {
-	uint32_t val = (0b1111'1111'1111'1111'1111 & imm) << 12;
-	return val | (to_underlying(rd) << 7) | to_underlying(opcode);
+	return encode_op_fp(Rv32_op_fp_funct5::fmul, Rv_fp_format::d, to_underlying(rm), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_op(Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+uint32_t Rv32_encoder::encode_fmul_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
 {
-	return (to_underlying(funct7) << 25) | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::op));
+	return encode_op_fp(Rv32_op_fp_funct5::fmul, Rv_fp_format::s, to_underlying(rm), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_op_imm(Rv32_op_imm_funct funct, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm)
+uint32_t Rv32_encoder::encode_fmv_w_x(Rv_register_id rd, Rv_register_id rs1)
 {
-	return imm.get_encoded() | (to_underlying(rs1) << 15) | (to_underlying(funct) << 12) | (to_underlying(rd) << 7) | (to_underlying(Rv_opcode::op_imm));
+	return encode_op_fp(Rv32_op_fp_funct5::fmv_from_int, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fmv), rd, rs1, Rv_register_id::x0);
 }
 
-uint32_t Rv32_encoder::encode_store(Rv32_store_funct3 funct3, Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm)
+uint32_t Rv32_encoder::encode_fmv_x_w(Rv_register_id rd, Rv_register_id rs1)
 {
-	return imm.get_encoded() | (to_underlying(rs2) << 20) | (to_underlying(rs1) << 15) | (to_underlying(funct3) << 12) | (to_underlying(Rv_opcode::store));
+	return encode_op_fp(Rv32_op_fp_funct5::fmv_to_int, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fmv), rd, rs1, Rv_register_id::x0);
 }
 
-uint32_t Rv32_encoder::encode_system(Rv32_system_funct3 funct3, Rv32_system_funct12 funct12)
+uint32_t Rv32_encoder::encode_fnmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
 {
-	const auto imm = Rv_itype_imm::from_unsigned(to_underlying(funct12));
-	return encode_itype(Rv_opcode::system, to_underlying(funct3), Rv_register_id::x0, Rv_register_id::x0, imm);
+	return encode_r4type(Rv_opcode::nmadd, Rv_fp_format::d, rm, rd, rs1, rs2, rs3);
 }
 
-/* --------------------------------------------------------
-Specific instruction encoding helpers
------------------------------------------------------------*/
+uint32_t Rv32_encoder::encode_fnmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
+{
+	return encode_r4type(Rv_opcode::nmadd, Rv_fp_format::s, rm, rd, rs1, rs2, rs3);
+}
 
-uint32_t Rv32_encoder::encode_add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+uint32_t Rv32_encoder::encode_fnmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
 {
-	return encode_op(Rv32_op_funct3::add, Rv32_op_funct7::add, rd, rs1, rs2);
+	return encode_r4type(Rv_opcode::nmsub, Rv_fp_format::d, rm, rd, rs1, rs2, rs3);
 }
 
-uint32_t Rv32_encoder::encode_addi(Rv_register_id rd, Rv_register_id rs1, int16_t imm)
+uint32_t Rv32_encoder::encode_fnmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm)
 {
-	const auto immediate = Rv_itype_imm::from_signed(imm);
-	return encode_op_imm(Rv32_op_imm_funct::addi, rd, rs1, immediate);
+	return encode_r4type(Rv_opcode::nmsub, Rv_fp_format::s, rm, rd, rs1, rs2, rs3);
 }
 
-uint32_t Rv32_encoder::encode_and(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+uint32_t Rv32_encoder::encode_fsd(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
 {
-	return encode_op(Rv32_op_funct3::and_, Rv32_op_funct7::and_, rd, rs1, rs2);
+	const auto imm = Rv_stype_imm::from_offset(offset);
+	return encode_store_fp(Rv32_store_fp_funct3::fsd, rs1, rs2, imm);
 }
 
-uint32_t Rv32_encoder::encode_andi(Rv_register_id rd, Rv_register_id rs1, int16_t imm)
+uint32_t Rv32_encoder::encode_fsgnj_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	const auto immediate = Rv_itype_imm::from_signed(imm);
-	return encode_op_imm(Rv32_op_imm_funct::andi, rd, rs1, immediate);
+	return encode_op_fp(Rv32_op_fp_funct5::fsgnj, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::fsgnj), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_auipc(Rv_register_id rd, uint32_t imm)
+uint32_t Rv32_encoder::encode_fsgnj_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	return encode_utype(Rv_opcode::auipc, rd, imm);
+	return encode_op_fp(Rv32_op_fp_funct5::fsgnj, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fsgnj), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_beq(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+uint32_t Rv32_encoder::encode_fsgnjn_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	const auto imm = Rv_btype_imm::from_offset(offset);
-	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::beq, rs1, rs2, imm);
+	return encode_op_fp(Rv32_op_fp_funct5::fsgnj, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::fsgnjn), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_bge(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+uint32_t Rv32_encoder::encode_fsgnjn_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	const auto imm = Rv_btype_imm::from_offset(offset);
-	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bge, rs1, rs2, imm);
+	return encode_op_fp(Rv32_op_fp_funct5::fsgnj, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fsgnjn), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_bgeu(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+uint32_t Rv32_encoder::encode_fsgnjx_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	const auto imm = Rv_btype_imm::from_offset(offset);
-	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bgeu, rs1, rs2, imm);
+	return encode_op_fp(Rv32_op_fp_funct5::fsgnj, Rv_fp_format::d, to_underlying(Rv32_op_fp_funct3::fsgnjx), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_blt(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+uint32_t Rv32_encoder::encode_fsgnjx_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
-	const auto imm = Rv_btype_imm::from_offset(offset);
-	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::blt, rs1, rs2, imm);
+	return encode_op_fp(Rv32_op_fp_funct5::fsgnj, Rv_fp_format::s, to_underlying(Rv32_op_fp_funct3::fsgnjx), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_bltu(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+uint32_t Rv32_encoder::encode_fsqrt_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
 {
-	const auto imm = Rv_btype_imm::from_offset(offset);
-	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bltu, rs1, rs2, imm);
+	return encode_op_fp(Rv32_op_fp_funct5::fsqrt, Rv_fp_format::d, to_underlying(rm), rd, rs1, Rv_register_id::x0);
 }
 
-uint32_t Rv32_encoder::encode_bne(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+uint32_t Rv32_encoder::encode_fsqrt_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm)
 {
-	const auto imm = Rv_btype_imm::from_offset(offset);
-	return encode_btype(Rv_opcode::branch, Rv32_branch_funct3::bne, rs1, rs2, imm);
+	return encode_op_fp(Rv32_op_fp_funct5::fsqrt, Rv_fp_format::s, to_underlying(rm), rd, rs1, Rv_register_id::x0);
 }
 
-uint32_t Rv32_encoder::encode_ebreak()
+uint32_t Rv32_encoder::encode_fsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
 {
-	return encode_system(Rv32_system_funct3::priv, Rv32_system_funct12::ebreak);
+	return encode_op_fp(Rv32_op_fp_funct5::fsub, Rv_fp_format::d, to_underlying(rm), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_ecall()
+uint32_t Rv32_encoder::encode_fsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm)
 {
-	return encode_system(Rv32_system_funct3::priv, Rv32_system_funct12::ecall);
+	return encode_op_fp(Rv32_op_fp_funct5::fsub, Rv_fp_format::s, to_underlying(rm), rd, rs1, rs2);
 }
 
-uint32_t Rv32_encoder::encode_fence(Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm)
+uint32_t Rv32_encoder::encode_fsw(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
 {
-	return encode_miscmem(Rv32_miscmem_funct3::fence, rs1, rd, imm);
+	const auto imm = Rv_stype_imm::from_offset(offset);
+	return encode_store_fp(Rv32_store_fp_funct3::fsw, rs1, rs2, imm);
 }
 
 uint32_t Rv32_encoder::encode_lb(Rv_register_id rd, Rv_register_id rs1, int16_t offset)
@@ -568,28 +1669,170 @@ uint32_t Rv32_encoder::encode_lhu(Rv_register_id rd, Rv_register_id rs1, int16_t
 	return encode_load(Rv32_load_funct3::lhu, rd, rs1, imm);
 }
 
+uint32_t Rv32_encoder::encode_ld(Rv_register_id rd, Rv_register_id rs1, int16_t offset)
+{
+	const auto imm = Rv_itype_imm::from_signed(offset);
+	return encode_load(Rv32_load_funct3::ld, rd, rs1, imm);
+}
+
 uint32_t Rv32_encoder::encode_lw(Rv_register_id rd, Rv_register_id rs1, int16_t offset)
 {
 	const auto imm = Rv_itype_imm::from_signed(offset);
 	return encode_load(Rv32_load_funct3::lw, rd, rs1, imm);
 }
 
+uint32_t Rv32_encoder::encode_lwu(Rv_register_id rd, Rv_register_id rs1, int16_t offset)
+{
+	const auto imm = Rv_itype_imm::from_signed(offset);
+	return encode_load(Rv32_load_funct3::lwu, rd, rs1, imm);
+}
+
+uint32_t Rv32_encoder::encode_lr_d(Rv_register_id rd, Rv_register_id rs1, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::lr, ordering, rd, rs1, Rv_register_id::x0);
+}
+
+uint32_t Rv32_encoder::encode_lr_w(Rv_register_id rd, Rv_register_id rs1, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::lr, ordering, rd, rs1, Rv_register_id::x0);
+}
+
 uint32_t Rv32_encoder::encode_lui(Rv_register_id rd, uint32_t imm)
 {
 	return encode_utype(Rv_opcode::lui, rd, imm);
 }
 
+uint32_t Rv32_encoder::encode_max(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::max, Rv32_op_funct7::minmax, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_maxu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::maxu, Rv32_op_funct7::minmax, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_min(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::min, Rv32_op_funct7::minmax, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_minu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::minu, Rv32_op_funct7::minmax, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_mul(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::mul, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_mulh(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::mulh, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_mulhsu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::mulhsu, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_mulhu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::mulhu, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_mulw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::mul, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
 uint32_t Rv32_encoder::encode_or(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
 	return encode_op(Rv32_op_funct3::or_, Rv32_op_funct7::or_, rd, rs1, rs2);
 }
 
+uint32_t Rv32_encoder::encode_orc_b(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::orc_b, Rv32_op_imm_funct7::orc_b, rd, rs1, to_underlying(Rv32_op_imm_unary::orc_b));
+}
+
 uint32_t Rv32_encoder::encode_ori(Rv_register_id rd, Rv_register_id rs1, int16_t imm)
 {
 	const auto immediate = Rv_itype_imm::from_signed(imm);
 	return encode_op_imm(Rv32_op_imm_funct::ori, rd, rs1, immediate);
 }
 
+uint32_t Rv32_encoder::encode_orn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::orn, Rv32_op_funct7::orn, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_rem(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::rem, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_remu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::remu, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_remuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::remu, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_remw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::rem, Rv32_op_funct7::muldiv, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_rev8(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::rev8, Rv32_op_imm_funct7::rev8, rd, rs1, to_underlying(Rv32_op_imm_unary::rev8));
+}
+
+uint32_t Rv32_encoder::encode_rol(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::rol, Rv32_op_funct7::rotate, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_ror(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::ror, Rv32_op_funct7::rotate, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_rori(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::rori, Rv32_op_imm_funct7::rori, rd, rs1, shift_amount);
+}
+
+uint32_t Rv32_encoder::encode_sext_b(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, rd, rs1, to_underlying(Rv32_op_imm_unary::sext_b));
+}
+
+uint32_t Rv32_encoder::encode_sext_h(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op_imm_funct7(Rv32_op_imm_funct::unary, Rv32_op_imm_funct7::unary, rd, rs1, to_underlying(Rv32_op_imm_unary::sext_h));
+}
+
+uint32_t Rv32_encoder::encode_sh1add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::sh1add, Rv32_op_funct7::shadd, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_sh2add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::sh2add, Rv32_op_funct7::shadd, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_sh3add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::sh3add, Rv32_op_funct7::shadd, rd, rs1, rs2);
+}
+
 uint32_t Rv32_encoder::encode_sll(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
 	return encode_op(Rv32_op_funct3::sll, Rv32_op_funct7::sll, rd, rs1, rs2);
@@ -601,6 +1844,17 @@ uint32_t Rv32_encoder::encode_slli(Rv_register_id rd, Rv_register_id rs1, uint8_
 	return encode_op_imm(Rv32_op_imm_funct::slli, rd, rs1, imm);
 }
 
+uint32_t Rv32_encoder::encode_slliw(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	const auto imm = Rv_itype_imm::from_unsigned(0b11111 & shift_amount);
+	return encode_op_imm_32(Rv64_op_imm_32_funct::slliw, rd, rs1, imm);
+}
+
+uint32_t Rv32_encoder::encode_sllw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::sll, Rv32_op_funct7::sll, rd, rs1, rs2);
+}
+
 uint32_t Rv32_encoder::encode_slt(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
 	return encode_op(Rv32_op_funct3::slt, Rv32_op_funct7::slt, rd, rs1, rs2);
@@ -629,6 +1883,22 @@ uint32_t Rv32_encoder::encode_sb(Rv_register_id rs1, Rv_register_id rs2, int16_t
 	return encode_store(Rv32_store_funct3::sb, rs1, rs2, imm);
 }
 
+uint32_t Rv32_encoder::encode_sc_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::d, Rv32_amo_funct5::sc, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_sc_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering)
+{
+	return encode_amo(Rv32_amo_funct3::w, Rv32_amo_funct5::sc, ordering, rd, rs1, rs2);
+}
+
+uint32_t Rv32_encoder::encode_sd(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
+{
+	const auto imm = Rv_stype_imm::from_offset(offset);
+	return encode_store(Rv32_store_funct3::sd, rs1, rs2, imm);
+}
+
 uint32_t Rv32_encoder::encode_sh(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
 {
 	const auto imm = Rv_stype_imm::from_offset(offset);
@@ -647,6 +1917,17 @@ uint32_t Rv32_encoder::encode_srai(Rv_register_id rd, Rv_register_id rs1, uint8_
 	return encode_op_imm(Rv32_op_imm_funct::srxi, rd, rs1, imm);
 }
 
+uint32_t Rv32_encoder::encode_sraiw(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	const auto imm = Rv_itype_imm::from_unsigned((1 << 10) | (0b11111 & shift_amount));
+	return encode_op_imm_32(Rv64_op_imm_32_funct::srxiw, rd, rs1, imm);
+}
+
+uint32_t Rv32_encoder::encode_sraw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::sra, Rv32_op_funct7::sra, rd, rs1, rs2);
+}
+
 uint32_t Rv32_encoder::encode_srl(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
 	return encode_op(Rv32_op_funct3::srl, Rv32_op_funct7::srl, rd, rs1, rs2);
@@ -658,17 +1939,38 @@ uint32_t Rv32_encoder::encode_srli(Rv_register_id rd, Rv_register_id rs1, uint8_
 	return encode_op_imm(Rv32_op_imm_funct::srxi, rd, rs1, imm);
 }
 
+uint32_t Rv32_encoder::encode_srliw(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount)
+{
+	const auto imm = Rv_itype_imm::from_unsigned(0b11111 & shift_amount);
+	return encode_op_imm_32(Rv64_op_imm_32_funct::srxiw, rd, rs1, imm);
+}
+
+uint32_t Rv32_encoder::encode_srlw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::srl, Rv32_op_funct7::srl, rd, rs1, rs2);
+}
+
 uint32_t Rv32_encoder::encode_sub(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
 {
 	return encode_op(Rv32_op_funct3::sub, Rv32_op_funct7::sub, rd, rs1, rs2);
 }
 
+uint32_t Rv32_encoder::encode_subw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op_32(Rv32_op_funct3::sub, Rv32_op_funct7::sub, rd, rs1, rs2);
+}
+
 uint32_t Rv32_encoder::encode_sw(Rv_register_id rs1, Rv_register_id rs2, int16_t offset)
 {
 	const auto imm = Rv_stype_imm::from_offset(offset);
 	return encode_store(Rv32_store_funct3::sw, rs1, rs2, imm);
 }
 
+uint32_t Rv32_encoder::encode_xnor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2)
+{
+	return encode_op(Rv32_op_funct3::xnor, Rv32_op_funct7::xnor, rd, rs1, rs2);
+}
+
 uint32_t Rv32_encoder::encode_xori(Rv_register_id rd, Rv_register_id rs1, int16_t imm)
 {
 	const auto immediate = Rv_itype_imm::from_signed(imm);
@@ -680,6 +1982,11 @@ uint32_t Rv32_encoder::encode_xor(Rv_register_id rd, Rv_register_id rs1, Rv_regi
 	return encode_op(Rv32_op_funct3::xor_, Rv32_op_funct7::xor_, rd, rs1, rs2);
 }
 
+uint32_t Rv32_encoder::encode_zext_h(Rv_register_id rd, Rv_register_id rs1)
+{
+	return encode_op(Rv32_op_funct3::zext_h, Rv32_op_funct7::zext_h, rd, rs1, Rv_register_id::x0);
+}
+
 /* ========================================================
 
 Rv_btype_imm
@@ -743,11 +2050,6 @@ uint32_t Rv_btype_imm::get_encoded() const
 	return _encoded;
 }
 
-int32_t Rv_btype_imm::get_offset() const
-{
-	return _offset;
-}
-
 /* ========================================================
 
 Rv_itype_imm
@@ -790,25 +2092,6 @@ uint32_t Rv_itype_imm::get_encoded() const
 	return _immediate << 20;
 }
 
-int32_t Rv_itype_imm::get_signed() const
-{
-	// 12-bit immediate is sign extended. If bit 11 is 1, set remaining high bits to 1.
-	if (_immediate & 0b1000'0000'0000)
-		return _immediate | (0b1111'1111'1111'1111'1111'0000'0000'0000);
-
-	return _immediate;
-}
-
-uint32_t Rv_itype_imm::get_unsigned() const
-{
-	return _immediate;
-}
-
-uint8_t Rv_itype_imm::get_shift_amount() const
-{
-	return static_cast<uint8_t>(0b11111 & _immediate);
-}
-
 /* ========================================================
 
 Rv_jtype_imm
@@ -865,11 +2148,6 @@ uint32_t Rv_jtype_imm::get_encoded() const
 	return _encoded;
 }
 
-int32_t Rv_jtype_imm::get_offset() const
-{
-	return _offset;
-}
-
 /* ========================================================
 
 Rv_stype_imm
@@ -916,11 +2194,6 @@ uint32_t Rv_stype_imm::get_encoded() const
 	return _encoded;
 }
 
-int32_t Rv_stype_imm::get_offset() const
-{
-	return _offset;
-}
-
 /* ========================================================
 
 Rv_utype_imm
@@ -945,10 +2218,4 @@ Rv_utype_imm::Rv_utype_imm(uint32_t encoded)
 	_encoded = encoded;
 }
 
-uint32_t Rv_utype_imm::get_decoded() const
-{
-	// The encoded and decoded values are the same
-	return _encoded;
-}
-
 }
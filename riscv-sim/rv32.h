@@ -1,26 +1,58 @@
 #pragma once
 
 #include <cstdint>
-#include <exception>
 
 namespace riscv_sim {
 
-class Rv_ebreak_exception : public std::exception
+/**
+Integer types of a base ISA width (XLEN). Harts and decoders are specialized for RV32 or RV64 at compile time, so
+neither checks the width while it runs.
+*/
+template <unsigned Xlen>
+struct Rv_xlen;
+
+template <>
+struct Rv_xlen<32>
+{
+	using Unsigned = uint32_t;
+	using Signed = int32_t;
+};
+
+template <>
+struct Rv_xlen<64>
 {
-	const char* what() const noexcept override
-	{
-		return "ebreak";
-	}
+	using Unsigned = uint64_t;
+	using Signed = int64_t;
 };
 
-class Rv_ecall_exception : public std::exception
+/**
+Reason an instruction traps, numbered as the exception codes in the mcause CSR. A trapping instruction has no
+effect: PC still points at it and no registers or memory are changed.
+*/
+enum class Rv_trap_cause : uint8_t
 {
-	const char* what() const noexcept override
-	{
-		return "ecall";
-	}
+	instruction_address_misaligned = 0,
+	illegal_instruction = 2,
+	breakpoint = 3, // EBREAK
+	load_address_misaligned = 4,  // LR
+	store_address_misaligned = 6, // SC and AMOs
+	ecall = 11,     // Environment call from M-mode
+
+	none = 0xFF,
 };
 
+/** Gets a short lowercase name for the trap cause, e.g. "illegal-instruction". */
+const char* get_trap_cause_name(Rv_trap_cause cause);
+
+/** Number of 8-bit counters in an AFL-style edge coverage map (see Basic_rv_hart::set_coverage_map). */
+constexpr uint32_t rv_coverage_map_size = 1 << 16;
+
+/** Gets the location AFL-style edge coverage gives the block that starts at the address. */
+constexpr uint32_t get_coverage_location(uint64_t address)
+{
+	return static_cast<uint32_t>((address >> 4) ^ (address << 8)) & (rv_coverage_map_size - 1);
+}
+
 /** 12-bit immediate value used by B-type instructions. */
 struct Rv_btype_imm
 {
@@ -64,7 +96,8 @@ struct Rv_itype_imm
 	/** Gets the decoded immediate value. */
 	uint32_t get_unsigned() const;
 
-	/** For shift immediate instructions, gets the shift amount. */
+	/** For shift immediate instructions, gets the shift amount: 5 bits for RV32 and 6 bits for RV64. */
+	template <unsigned Xlen = 32>
 	uint8_t get_shift_amount() const;
 
 private:
@@ -186,6 +219,8 @@ enum class Rv_opcode : uint8_t
 
 	op = 0b0110011, // Integer register-register operation
 	op_imm = 0b0010011, // Integer register-immediate operation
+	op_32 = 0b0111011, // RV64: 32-bit register-register operation
+	op_imm_32 = 0b0011011, // RV64: 32-bit register-immediate operation
 	lui = 0b0110111, // Load upper immediate
 	auipc = 0b0010111, // Add upper immediate to PR register
 
@@ -200,7 +235,18 @@ enum class Rv_opcode : uint8_t
 	load = 0b0000011, // Memory load
 	store = 0b0100011, // Memory store
 	misc_mem = 0b0001111, // Fence
+	amo = 0b0101111, // A extension: atomic memory operation
 	system = 0b1110011, // Environment call, breakpoint
+
+	// F and D extensions
+
+	load_fp = 0b0000111, // Floating-point load
+	store_fp = 0b0100111, // Floating-point store
+	op_fp = 0b1010011, // Floating-point operation
+	madd = 0b1000011, // Fused multiply-add
+	msub = 0b1000111, // Fused multiply-subtract
+	nmsub = 0b1001011, // Negated fused multiply-subtract
+	nmadd = 0b1001111, // Negated fused multiply-add
 };
 
 enum class Rv32_branch_funct3 : uint8_t
@@ -223,8 +269,10 @@ enum class Rv32_load_funct3 : uint8_t
 	lb = 0b000,
 	lh = 0b001,
 	lw = 0b010,
+	ld = 0b011,  // RV64
 	lbu = 0b100,
 	lhu = 0b101,
+	lwu = 0b110, // RV64
 };
 
 enum class Rv32_miscmem_funct3 : uint8_t
@@ -244,6 +292,35 @@ enum class Rv32_op_funct3 : uint8_t
 	sra = srl,
 	or_ = 0b110,
 	and_ = 0b111,
+
+	// M extension
+	mul = 0b000,
+	mulh = 0b001,
+	mulhsu = 0b010,
+	mulhu = 0b011,
+	div = 0b100,
+	divu = 0b101,
+	rem = 0b110,
+	remu = 0b111,
+
+	// Zba, Zbb and Zbs extensions
+	sh1add = 0b010,
+	sh2add = 0b100,
+	sh3add = 0b110,
+	andn = 0b111,
+	orn = 0b110,
+	xnor = 0b100,
+	max = 0b110,
+	maxu = 0b111,
+	min = 0b100,
+	minu = 0b101,
+	rol = 0b001,
+	ror = 0b101,
+	zext_h = 0b100,
+	bclr = 0b001,
+	bext = 0b101,
+	binv = 0b001,
+	bset = 0b001,
 };
 
 enum class Rv32_op_funct7 : uint8_t
@@ -258,6 +335,20 @@ enum class Rv32_op_funct7 : uint8_t
 	sra = 0b0100000,
 	or_ = 0,
 	and_ = 0,
+	muldiv = 0b0000001, // M extension
+
+	// Zba, Zbb and Zbs extensions
+	shadd = 0b0010000,
+	andn = 0b0100000,
+	orn = 0b0100000,
+	xnor = 0b0100000,
+	minmax = 0b0000101,
+	rotate = 0b0110000,
+	zext_h = 0b0000100, // rs2 is 0
+	bclr = 0b0100100,
+	bext = 0b0100100,
+	binv = 0b0110100,
+	bset = 0b0010100,
 };
 
 enum class Rv32_op_imm_funct : uint8_t
@@ -270,6 +361,52 @@ enum class Rv32_op_imm_funct : uint8_t
 	andi = 0b111,
 	slli = 0b001,
 	srxi = 0b101, // srli and srai share the same funct, difference is bit 30
+
+	// Zbb and Zbs extensions. These share the funct3 of the shifts and are told apart by funct7 and rs2.
+	unary = 0b001,  // clz, ctz, cpop, sext.b and sext.h
+	bclri = 0b001,
+	binvi = 0b001,
+	bseti = 0b001,
+	bexti = 0b101,
+	rori = 0b101,
+	orc_b = 0b101,
+	rev8 = 0b101,
+};
+
+/** funct3 of the RV64 OP-IMM-32 instructions. OP-32 uses the funct3 and funct7 values of OP. */
+enum class Rv64_op_imm_32_funct : uint8_t
+{
+	addiw = 0b000,
+	slliw = 0b001,
+	srxiw = 0b101, // srliw and sraiw are told apart by bit 30, as srli and srai are
+};
+
+/** funct7 of the OP-IMM instructions with a shift amount or a unary operation in the rs2 field. */
+enum class Rv32_op_imm_funct7 : uint8_t
+{
+	slli = 0,
+	srli = 0,
+	srai = 0b0100000,
+	unary = 0b0110000,
+	rori = 0b0110000,
+	bclri = 0b0100100,
+	bexti = 0b0100100,
+	binvi = 0b0110100,
+	bseti = 0b0010100,
+	orc_b = 0b0010100,
+	rev8 = 0b0110100,
+};
+
+/** rs2 field of the unary Zbb instructions in OP-IMM. */
+enum class Rv32_op_imm_unary : uint8_t
+{
+	clz = 0b00000,
+	ctz = 0b00001,
+	cpop = 0b00010,
+	sext_b = 0b00100,
+	sext_h = 0b00101,
+	orc_b = 0b00111,
+	rev8 = 0b11000,
 };
 
 enum class Rv32_store_funct3 : uint8_t
@@ -277,11 +414,132 @@ enum class Rv32_store_funct3 : uint8_t
 	sb = 0b000,
 	sh = 0b001,
 	sw = 0b010,
+	sd = 0b011, // RV64
+};
+
+enum class Rv32_load_fp_funct3 : uint8_t
+{
+	flw = 0b010,
+	fld = 0b011,
+};
+
+enum class Rv32_store_fp_funct3 : uint8_t
+{
+	fsw = 0b010,
+	fsd = 0b011,
+};
+
+/** Operation of an OP-FP instruction, in bits 31:27. */
+enum class Rv32_op_fp_funct5 : uint8_t
+{
+	fadd = 0b00000,
+	fsub = 0b00001,
+	fmul = 0b00010,
+	fdiv = 0b00011,
+	fsgnj = 0b00100,      // FSGNJ, FSGNJN, FSGNJX
+	fminmax = 0b00101,    // FMIN, FMAX
+	fcvt_fp = 0b01000,    // Conversion between formats. rs2 is the source format.
+	fsqrt = 0b01011,
+	fcmp = 0b10100,       // FEQ, FLT, FLE
+	fcvt_to_int = 0b11000,
+	fcvt_from_int = 0b11010,
+	fmv_to_int = 0b11100, // FMV.X.W, FCLASS
+	fmv_from_int = 0b11110,
+};
+
+enum class Rv32_amo_funct3 : uint8_t
+{
+	w = 0b010,
+	d = 0b011, // RV64 only
+};
+
+/** Operation of AMO instructions, in the top five bits of funct7. The low two bits are aq and rl. */
+enum class Rv32_amo_funct5 : uint8_t
+{
+	amoadd = 0b00000,
+	amoswap = 0b00001,
+	lr = 0b00010, // rs2 is 0
+	sc = 0b00011,
+	amoxor = 0b00100,
+	amoor = 0b01000,
+	amoand = 0b01100,
+	amomin = 0b10000,
+	amomax = 0b10100,
+	amominu = 0b11000,
+	amomaxu = 0b11100,
+};
+
+/** Ordering bits of AMO instructions: acquire (aq) and release (rl). */
+enum class Rv_amo_ordering : uint8_t
+{
+	none = 0b00,
+	rl = 0b01,
+	aq = 0b10,
+	aqrl = 0b11,
+};
+
+/** Selects the operation of OP-FP instructions that don't round. Instructions that round hold a rounding mode instead. */
+enum class Rv32_op_fp_funct3 : uint8_t
+{
+	fsgnj = 0b000,
+	fsgnjn = 0b001,
+	fsgnjx = 0b010,
+	fmin = 0b000,
+	fmax = 0b001,
+	fle = 0b000,
+	flt = 0b001,
+	feq = 0b010,
+	fmv = 0b000,
+	fclass = 0b001,
+};
+
+/** Integer type of FCVT instructions, in the rs2 field. */
+enum class Rv32_fcvt_int_type : uint8_t
+{
+	w = 0b00000,  // 32-bit signed
+	wu = 0b00001, // 32-bit unsigned
+};
+
+/** Format of the operands of floating-point instructions, in bits 26:25. */
+enum class Rv_fp_format : uint8_t
+{
+	s = 0b00, // Single precision
+	d = 0b01, // Double precision
+};
+
+/** Rounding mode field (funct3) of floating-point instructions that round, and values of the frm CSR. */
+enum class Rv_rounding_mode : uint8_t
+{
+	rne = 0b000, // Round to nearest, ties to even
+	rtz = 0b001, // Round towards zero
+	rdn = 0b010, // Round down (towards -infinity)
+	rup = 0b011, // Round up (towards +infinity)
+	rmm = 0b100, // Round to nearest, ties to max magnitude
+	dyn = 0b111, // Use the mode in frm. Only valid in instructions.
+};
+
+/** Bits of the fflags CSR. Floating-point instructions set them and they stay set until software clears them. */
+struct Rv_fp_flags
+{
+	static constexpr uint32_t inexact = 1 << 0;        // NX
+	static constexpr uint32_t underflow = 1 << 1;      // UF
+	static constexpr uint32_t overflow = 1 << 2;       // OF
+	static constexpr uint32_t divide_by_zero = 1 << 3; // DZ
+	static constexpr uint32_t invalid = 1 << 4;        // NV
+	static constexpr uint32_t all = 0b11111;
 };
 
 enum class Rv32_system_funct3 : uint8_t
 {
 	priv = 0b000,
+
+	// Zicsr extension
+	csrrw = 0b001,
+	csrrs = 0b010,
+	csrrc = 0b011,
+	csrrwi = 0b101,
+	csrrsi = 0b110,
+	csrrci = 0b111,
 };
 
 enum class Rv32_system_funct12 : uint8_t
@@ -290,17 +548,40 @@ enum class Rv32_system_funct12 : uint8_t
 	ebreak = 1,
 };
 
+/**
+Addresses of the CSRs the hart implements. Addresses with both bits 11:10 set are read-only.
+*/
+enum class Rv_csr : uint16_t
+{
+	// F: floating-point accrued exceptions and rounding mode. fcsr holds frm in bits 7:5 and fflags in bits 4:0.
+	fflags = 0x001,
+	frm = 0x002,
+	fcsr = 0x003,
+
+	// Zicntr: low and high halves of the 64-bit counters
+	cycle = 0xC00,
+	time = 0xC01,
+	instret = 0xC02,
+	cycleh = 0xC80,
+	timeh = 0xC81,
+	instreth = 0xC82,
+
+	// Machine information
+	mhartid = 0xF14,
+};
+
 enum class Rv32_instruction_format
 {
 	btype,
 	itype,
 	jtype,
 	rtype,
+	r4type, // Fused multiply-add
 	stype,
 	utype,
 };
 
-enum class Rv32i_instruction_type
+enum class Rv32i_instruction_type : uint8_t
 {
 	invalid,
 
@@ -360,6 +641,55 @@ enum class Rv32i_instruction_type
 	or_,   // OR
 	and_,  // AND
 
+	// OP - M extension
+
+	mul,    // Multiply, low 32 bits
+	mulh,   // Multiply signed x signed, high 32 bits
+	mulhsu, // Multiply signed x unsigned, high 32 bits
+	mulhu,  // Multiply unsigned x unsigned, high 32 bits
+	div,    // Divide (signed)
+	divu,   // Divide unsigned
+	rem,    // Remainder (signed)
+	remu,   // Remainder unsigned
+
+	// OP - Zba extension
+
+	sh1add, // (rs1 << 1) + rs2
+	sh2add, // (rs1 << 2) + rs2
+	sh3add, // (rs1 << 3) + rs2
+
+	// OP and OP-IMM - Zbb extension. The unary instructions are I-type with the operation in the immediate.
+
+	andn,   // rs1 AND NOT rs2
+	orn,    // rs1 OR NOT rs2
+	xnor,   // NOT (rs1 XOR rs2)
+	clz,    // Count leading zeros
+	ctz,    // Count trailing zeros
+	cpop,   // Count set bits
+	max,    // Maximum (signed)
+	maxu,   // Maximum unsigned
+	min,    // Minimum (signed)
+	minu,   // Minimum unsigned
+	sext_b, // Sign extend byte
+	sext_h, // Sign extend half
+	zext_h, // Zero extend half. R-type with rs2 0.
+	rol,    // Rotate left
+	ror,    // Rotate right
+	rori,   // Rotate right immediate
+	orc_b,  // Each byte to 0xFF if it is not 0
+	rev8,   // Reverse byte order
+
+	// OP and OP-IMM - Zbs extension
+
+	bclr,   // Clear bit rs2 of rs1
+	bclri,
+	bext,   // Extract bit rs2 of rs1
+	bexti,
+	binv,   // Invert bit rs2 of rs1
+	binvi,
+	bset,   // Set bit rs2 of rs1
+	bseti,
+
 	// MISC-MEM
 
 	fence,
@@ -369,6 +699,124 @@ enum class Rv32i_instruction_type
 	ecall,
 	ebreak,
 
+	// SYSTEM - Zicsr extension. rs1 holds a 5-bit immediate in the I forms and the I-type immediate is the CSR address.
+
+	csrrw,  // Atomic read/write CSR
+	csrrs,  // Atomic read and set bits in CSR
+	csrrc,  // Atomic read and clear bits in CSR
+	csrrwi, // csrrw with an immediate
+	csrrsi, // csrrs with an immediate
+	csrrci, // csrrc with an immediate
+
+	// F extension. The register fields of floating-point operands name f registers: xN stands for fN.
+
+	flw,       // Load single
+	fsw,       // Store single
+	fmadd_s,   // rs1 * rs2 + rs3
+	fmsub_s,   // rs1 * rs2 - rs3
+	fnmsub_s,  // -(rs1 * rs2) + rs3
+	fnmadd_s,  // -(rs1 * rs2) - rs3
+	fadd_s,
+	fsub_s,
+	fmul_s,
+	fdiv_s,
+	fsqrt_s,
+	fsgnj_s,   // Sign injection: rs1 with the sign of rs2
+	fsgnjn_s,  // rs1 with the opposite sign of rs2
+	fsgnjx_s,  // rs1 with the sign of rs1 XOR the sign of rs2
+	fmin_s,
+	fmax_s,
+	fcvt_w_s,  // Single to signed integer
+	fcvt_wu_s, // Single to unsigned integer
+	fmv_x_w,   // Move the bits of an f register to an x register
+	feq_s,
+	flt_s,
+	fle_s,
+	fclass_s,  // Classify
+	fcvt_s_w,  // Signed integer to single
+	fcvt_s_wu, // Unsigned integer to single
+	fmv_w_x,   // Move the bits of an x register to an f register
+
+	// D extension
+
+	fld,       // Load double
+	fsd,       // Store double
+	fmadd_d,
+	fmsub_d,
+	fnmsub_d,
+	fnmadd_d,
+	fadd_d,
+	fsub_d,
+	fmul_d,
+	fdiv_d,
+	fsqrt_d,
+	fsgnj_d,
+	fsgnjn_d,
+	fsgnjx_d,
+	fmin_d,
+	fmax_d,
+	fcvt_s_d,  // Double to single
+	fcvt_d_s,  // Single to double
+	feq_d,
+	flt_d,
+	fle_d,
+	fclass_d,
+	fcvt_w_d,
+	fcvt_wu_d,
+	fcvt_d_w,
+	fcvt_d_wu,
+
+	// RV64I. The W instructions operate on the low 32 bits and sign extend their 32-bit result.
+
+	lwu,    // Load word unsigned
+	ld,     // Load doubleword (64-bit)
+	sd,     // Store doubleword
+	addiw,
+	slliw,
+	srliw,
+	sraiw,
+	addw,
+	subw,
+	sllw,
+	srlw,
+	sraw,
+
+	// RV64M
+
+	mulw,
+	divw,
+	divuw,
+	remw,
+	remuw,
+
+	// AMO - A extension. Operands are R-type, aq and rl are in funct7. rs2 is 0 for LR.
+
+	lr_w,      // Load reserved
+	sc_w,      // Store conditional. rd is 0 if it stored, otherwise 1.
+	amoswap_w, // rd = M[rs1], M[rs1] = rs2
+	amoadd_w,  // rd = M[rs1], M[rs1] = M[rs1] + rs2
+	amoxor_w,
+	amoand_w,
+	amoor_w,
+	amomin_w,
+	amomax_w,
+	amominu_w,
+	amomaxu_w,
+
+	// RV64A - doubleword AMOs
+
+	lr_d,
+	sc_d,
+	amoswap_d,
+	amoadd_d,
+	amoxor_d,
+	amoand_d,
+	amoor_d,
+	amomin_d,
+	amomax_d,
+	amominu_d,
+	amomaxu_d,
+
 	// -------------------------------
 
 	_count,
@@ -409,6 +857,17 @@ struct Rv_rtype_instruction
 	Rv_register_id rs2;
 };
 
+struct Rv_r4type_instruction
+{
+	Rv_opcode opcode;
+	uint8_t funct3; // Rounding mode
+	uint8_t fmt;
+	Rv_register_id rd;
+	Rv_register_id rs1;
+	Rv_register_id rs2;
+	Rv_register_id rs3;
+};
+
 struct Rv_stype_instruction
 {
 	Rv_opcode opcode;
@@ -425,20 +884,42 @@ struct Rv_utype_instruction
 	Rv_utype_imm imm;
 };
 
-class Rv32_decoder
+/**
+Decodes the instructions of an XLEN. The RV64 decoder adds the RV64I and RV64M instructions and 6-bit shift amounts.
+The Zba, Zbb, Zbs, F, D and C extensions are only decoded for RV32; their encodings are illegal for RV64.
+*/
+template <unsigned Xlen>
+class Rv_decoder
 {
 public:
 	static Rv32i_instruction_type decode_instruction_type(uint32_t instruction);
+
+	/** Checks if an instruction is a 16-bit compressed (RVC) instruction. Only its low 16 bits are then part of it. */
+	static bool is_compressed(uint32_t instruction);
+
+	/**
+	Expands a compressed instruction into the 32-bit instruction it stands for. Returns 0, which is illegal, for
+	reserved encodings.
+	*/
+	static uint32_t expand_compressed(uint16_t instruction) requires (Xlen == 32);
+
 	static Rv_btype_instruction decode_btype(uint32_t instruction);
 	static Rv_itype_instruction decode_itype(uint32_t instruction);
 	static Rv_jtype_instruction decode_jtype(uint32_t instruction);
 	static Rv_rtype_instruction decode_rtype(uint32_t instruction);
+	static Rv_r4type_instruction decode_r4type(uint32_t instruction);
 	static Rv_stype_instruction decode_stype(uint32_t instruction);
 	static Rv_utype_instruction decode_utype(uint32_t instruction);
 	static Rv_register_id get_register_id(uint8_t encoded_register);
 	static Rv_opcode get_opcode(uint32_t instruction);
 };
 
+using Rv32_decoder = Rv_decoder<32>;
+using Rv64_decoder = Rv_decoder<64>;
+
+extern template class Rv_decoder<32>;
+extern template class Rv_decoder<64>;
+
 class Rv32_encoder
 {
 public:
@@ -449,48 +930,240 @@ public:
 	static uint32_t encode_miscmem(Rv32_miscmem_funct3 funct3, Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm);
 	static uint32_t encode_op(Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_op_imm(Rv32_op_imm_funct funct, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	static uint32_t encode_op_32(Rv32_op_funct3 funct3, Rv32_op_funct7 funct7, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_op_imm_32(Rv64_op_imm_32_funct funct, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	static uint32_t encode_op_imm_funct7(Rv32_op_imm_funct funct, Rv32_op_imm_funct7 funct7, Rv_register_id rd, Rv_register_id rs1, uint8_t rs2);
 	static uint32_t encode_store(Rv32_store_funct3 funct3, Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
 	static uint32_t encode_system(Rv32_system_funct3 funct3, Rv32_system_funct12 funct12);
+	static uint32_t encode_csr(Rv32_system_funct3 funct3, Rv_register_id rd, Rv_csr csr, uint8_t rs1);
 	static uint32_t encode_utype(Rv_opcode opcode, Rv_register_id rd, uint32_t imm);
+	static uint32_t encode_load_fp(Rv32_load_fp_funct3 funct3, Rv_register_id rd, Rv_register_id rs1, Rv_itype_imm imm);
+	static uint32_t encode_store_fp(Rv32_store_fp_funct3 funct3, Rv_register_id rs1, Rv_register_id rs2, Rv_stype_imm imm);
+	static uint32_t encode_op_fp(Rv32_op_fp_funct5 funct5, Rv_fp_format fmt, uint8_t funct3, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_r4type(Rv_opcode opcode, Rv_fp_format fmt, Rv_rounding_mode rm, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3);
+	static uint32_t encode_amo(Rv32_amo_funct3 funct3, Rv32_amo_funct5 funct5, Rv_amo_ordering ordering, Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 
 	static uint32_t encode_add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_addi(Rv_register_id rd, Rv_register_id rs1, int16_t imm);
+	static uint32_t encode_addiw(Rv_register_id rd, Rv_register_id rs1, int16_t imm);
+	static uint32_t encode_addw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_amoadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoadd_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoand_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoand_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amomax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amomax_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amomaxu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amomaxu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amomin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amomin_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amominu_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amominu_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoswap_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoswap_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoxor_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_amoxor_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
 	static uint32_t encode_and(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_andi(Rv_register_id rd, Rv_register_id rs1, int16_t imm);
+	static uint32_t encode_andn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_auipc(Rv_register_id rd, uint32_t imm);
+	static uint32_t encode_bclr(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_bclri(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
 	static uint32_t encode_beq(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
+	static uint32_t encode_bext(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_bexti(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
 	static uint32_t encode_bge(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
 	static uint32_t encode_bgeu(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
+	static uint32_t encode_binv(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_binvi(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
 	static uint32_t encode_blt(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
 	static uint32_t encode_bltu(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
 	static uint32_t encode_bne(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
+	static uint32_t encode_bset(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_bseti(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_clz(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_cpop(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_csrrc(Rv_register_id rd, Rv_csr csr, Rv_register_id rs1);
+	static uint32_t encode_csrrci(Rv_register_id rd, Rv_csr csr, uint8_t imm);
+	static uint32_t encode_csrrs(Rv_register_id rd, Rv_csr csr, Rv_register_id rs1);
+	static uint32_t encode_csrrsi(Rv_register_id rd, Rv_csr csr, uint8_t imm);
+	static uint32_t encode_csrrw(Rv_register_id rd, Rv_csr csr, Rv_register_id rs1);
+	static uint32_t encode_csrrwi(Rv_register_id rd, Rv_csr csr, uint8_t imm);
+	static uint32_t encode_ctz(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_div(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_divu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_divuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_divw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_ebreak();
 	static uint32_t encode_ecall();
+	static uint32_t encode_fadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fclass_d(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_fclass_s(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_fcvt_d_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_d_w(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_d_wu(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_s_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_s_w(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_s_wu(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_w_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_w_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_wu_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fcvt_wu_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fdiv_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fdiv_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
 	static uint32_t encode_fence(Rv_register_id rs1, Rv_register_id rd, Rv_itype_imm imm);
+	static uint32_t encode_feq_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_feq_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fld(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
+	static uint32_t encode_fle_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fle_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_flt_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_flt_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_flw(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
+	static uint32_t encode_fmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fmax_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fmax_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fmin_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fmin_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fmul_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fmul_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fmv_w_x(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_fmv_x_w(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_fnmadd_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fnmadd_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fnmsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fnmsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_register_id rs3, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fsd(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
+	static uint32_t encode_fsgnj_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fsgnj_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fsgnjn_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fsgnjn_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fsgnjx_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fsgnjx_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_fsqrt_d(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fsqrt_s(Rv_register_id rd, Rv_register_id rs1, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fsub_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fsub_s(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_rounding_mode rm = Rv_rounding_mode::dyn);
+	static uint32_t encode_fsw(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
 	static uint32_t encode_lb(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
 	static uint32_t encode_lbu(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
+	static uint32_t encode_ld(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
 	static uint32_t encode_lh(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
 	static uint32_t encode_lhu(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
 	static uint32_t encode_lw(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
+	static uint32_t encode_lwu(Rv_register_id rd, Rv_register_id rs1, int16_t offset);
+	static uint32_t encode_lr_d(Rv_register_id rd, Rv_register_id rs1, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_lr_w(Rv_register_id rd, Rv_register_id rs1, Rv_amo_ordering ordering = Rv_amo_ordering::none);
 	static uint32_t encode_lui(Rv_register_id rd, uint32_t imm);
+	static uint32_t encode_max(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_maxu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_min(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_minu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_mul(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_mulh(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_mulhsu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_mulhu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_mulw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_or(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_orc_b(Rv_register_id rd, Rv_register_id rs1);
 	static uint32_t encode_ori(Rv_register_id rd, Rv_register_id rs1, int16_t imm);
+	static uint32_t encode_orn(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_rem(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_remu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_remuw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_remw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_rev8(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_rol(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_ror(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_rori(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_sext_b(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_sext_h(Rv_register_id rd, Rv_register_id rs1);
+	static uint32_t encode_sh1add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_sh2add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_sh3add(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_sll(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_slli(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_slliw(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_sllw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_slt(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_sltu(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_slti(Rv_register_id rd, Rv_register_id rs1, int16_t imm);
 	static uint32_t encode_sltiu(Rv_register_id rd, Rv_register_id rs1, uint16_t imm);
 	static uint32_t encode_sb(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
+	static uint32_t encode_sc_d(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_sc_w(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2, Rv_amo_ordering ordering = Rv_amo_ordering::none);
+	static uint32_t encode_sd(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
 	static uint32_t encode_sh(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
 	static uint32_t encode_sra(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_srai(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_sraiw(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_sraw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_srl(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_srli(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_srliw(Rv_register_id rd, Rv_register_id rs1, uint8_t shift_amount);
+	static uint32_t encode_srlw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_sub(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_subw(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_sw(Rv_register_id rs1, Rv_register_id rs2, int16_t offset);
+	static uint32_t encode_xnor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
 	static uint32_t encode_xori(Rv_register_id rd, Rv_register_id rs1, int16_t imm);
 	static uint32_t encode_xor(Rv_register_id rd, Rv_register_id rs1, Rv_register_id rs2);
+	static uint32_t encode_zext_h(Rv_register_id rd, Rv_register_id rs1);
 };
 
+// Immediate accessors are defined inline so instruction executors can inline them.
+
+template <unsigned Xlen>
+inline bool Rv_decoder<Xlen>::is_compressed(uint32_t instruction)
+{
+	return (instruction & 0b11) != 0b11;
+}
+
+inline int32_t Rv_btype_imm::get_offset() const
+{
+	return _offset;
+}
+
+inline int32_t Rv_itype_imm::get_signed() const
+{
+	// 12-bit immediate is sign extended. If bit 11 is 1, set remaining high bits to 1.
+	if (_immediate & 0b1000'0000'0000)
+		return _immediate | (0b1111'1111'1111'1111'1111'0000'0000'0000);
+
+	return _immediate;
+}
+
+inline uint32_t Rv_itype_imm::get_unsigned() const
+{
+	return _immediate;
+}
+
+template <unsigned Xlen>
+inline uint8_t Rv_itype_imm::get_shift_amount() const
+{
+	return static_cast<uint8_t>((Xlen - 1) & _immediate);
+}
+
+inline int32_t Rv_jtype_imm::get_offset() const
+{
+	return _offset;
+}
+
+inline int32_t Rv_stype_imm::get_offset() const
+{
+	return _offset;
+}
+
+inline uint32_t Rv_utype_imm::get_decoded() const
+{
+	// The encoded and decoded values are the same
+	return _encoded;
+}
+
 }
@@ -13,47 +13,84 @@ Simple memory subsystem
 
 void Simple_memory_subsystem::write_8(uint32_t address, uint8_t value)
 {
+	notify_written(address, sizeof(value));
+
 	memory[address] = value;
 }
 
 void Simple_memory_subsystem::write_16(uint32_t address, uint16_t value)
 {
+	notify_written(address, sizeof(value));
+
 	memory[address] = 0xFF & value;
 	memory[address + 1] = 0xFF & (value >> 8);
 }
 
 void Simple_memory_subsystem::write_32(uint32_t address, uint32_t value)
 {
+	notify_written(address, sizeof(value));
+
 	memory[address] = 0xFF & value;
 	memory[address + 1] = 0xFF & (value >> 8);
 	memory[address + 2] = 0xFF & (value >> 16);
 	memory[address + 3] = 0xFF & (value >> 24);
 }
 
+void Simple_memory_subsystem::write_64(uint32_t address, uint64_t value)
+{
+	notify_written(address, sizeof(value));
+
+	for (uint32_t i = 0; i < sizeof(value); ++i)
+		memory[address + i] = 0xFF & (value >> (8 * i));
+}
+
 uint8_t Simple_memory_subsystem::read_8(uint32_t address) const
 {
-	if (memory.contains(address))
-		return memory.at(address);
+	notify_read(address, sizeof(uint8_t));
 
-	return 0;
+	return load_8(address);
 }
 
 uint16_t Simple_memory_subsystem::read_16(uint32_t address) const
 {
-	return (read_8(address)
-		| (read_8(address + 1) << 8));
+	notify_read(address, sizeof(uint16_t));
+
+	return (load_8(address)
+		| (load_8(address + 1) << 8));
 }
 
 uint32_t Simple_memory_subsystem::read_32(uint32_t address) const
 {
-	return (read_8(address)
-		| (read_8(address + 1) << 8)
-		| (read_8(address + 2) << 16)
-		| (read_8(address + 3) << 24));
+	notify_read(address, sizeof(uint32_t));
+
+	return (load_8(address)
+		| (load_8(address + 1) << 8)
+		| (load_8(address + 2) << 16)
+		| (load_8(address + 3) << 24));
+}
+
+uint64_t Simple_memory_subsystem::read_64(uint32_t address) const
+{
+	notify_read(address, sizeof(uint64_t));
+
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < sizeof(value); ++i)
+		value |= uint64_t(load_8(address + i)) << (8 * i);
+
+	return value;
+}
+
+uint8_t Simple_memory_subsystem::load_8(uint32_t address) const
+{
+	if (memory.contains(address))
+		return memory.at(address);
+
+	return 0;
 }
 
 void Simple_memory_subsystem::reset()
 {
+	notify_reset();
 	memory.clear();
 }
 
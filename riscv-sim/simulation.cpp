@@ -0,0 +1,295 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+
+#include "elfio/elfio.hpp"
+
+using namespace std;
+using namespace ELFIO;
+
+#define SYS_getcwd 17
+#define SYS_dup 23
+#define SYS_fcntl 25
+#define SYS_faccessat 48
+#define SYS_chdir 49
+#define SYS_openat 56
+#define SYS_close 57
+#define SYS_getdents 61
+#define SYS_lseek 62
+#define SYS_read 63
+#define SYS_write 64
+#define SYS_writev 66
+#define SYS_pread 67
+#define SYS_pwrite 68
+#define SYS_fstatat 79
+#define SYS_fstat 80
+#define SYS_exit 93
+#define SYS_exit_group 94
+#define SYS_kill 129
+#define SYS_rt_sigaction 134
+#define SYS_times 153
+#define SYS_uname 160
+#define SYS_gettimeofday 169
+#define SYS_getpid 172
+#define SYS_getuid 174
+#define SYS_geteuid 175
+#define SYS_getgid 176
+#define SYS_getegid 177
+#define SYS_brk 214
+#define SYS_munmap 215
+#define SYS_mremap 216
+#define SYS_mmap 222
+#define SYS_open 1024
+#define SYS_link 1025
+#define SYS_unlink 1026
+#define SYS_mkdir 1030
+#define SYS_access 1033
+#define SYS_stat 1038
+#define SYS_lstat 1039
+#define SYS_time 1062
+#define SYS_getmainvars 2011
+
+namespace riscv_sim {
+
+Simulation::Simulation(uint32_t hart_count, Rv32_engine engine)
+	: engine(engine), system(make_unique<System>(memory, hart_count, engine))
+{
+}
+
+Mapped_memory& Simulation::get_memory()
+{
+	return memory;
+}
+
+auto Simulation::get_system() -> System&
+{
+	return *system;
+}
+
+void Simulation::set_hart_count(uint32_t hart_count)
+{
+	// The old harts detach from the memory before the new ones attach
+	snapshot.reset();
+	memory.discard_snapshot();
+	system.reset();
+	system = make_unique<System>(memory, hart_count, engine);
+}
+
+void Simulation::set_output(ostream& output)
+{
+	this->output = &output;
+}
+
+void Simulation::load_elf(const string& path, const vector<string>& args, ostream* log)
+{
+	elfio reader;
+
+	// Load ELF data
+	if (!reader.load(path))
+		throw runtime_error("Can't find or process ELF file " + path);
+
+	// Verify 32 bit ELF
+	if (reader.get_class() != ELFCLASS32)
+		throw runtime_error("Only ELF32 is supported.");
+
+	// Verify little endian
+	if (reader.get_encoding() != ELFDATA2LSB)
+		throw runtime_error("Only little endian is supported.");
+
+	// Reset system state. Resetting memory discards its snapshot.
+	snapshot.reset();
+	memory.reset();
+	for (uint32_t i = 0; i < system->get_hart_count(); ++i)
+		system->get_hart(i).reset();
+
+	exit_code.reset();
+
+	// The heap starts right after the data segments
+	uint64_t heap_base = 0;
+
+	Elf_Half sec_num = reader.sections.size();
+	if (log)
+		*log << "Number of sections: " << sec_num << endl;
+
+	for (int i = 0; i < sec_num; ++i) {
+		const section* psec = reader.sections[i];
+		if (log)
+		{
+			*log << " [" << i << "] "
+				<< psec->get_name()
+				<< "\t"
+				<< psec->get_size()
+				<< "\t"
+				<< hex << psec->get_address()
+				<< "\t"
+				<< hex << psec->get_flags()
+				<< endl;
+		}
+
+		// Update heap pointer if needed
+		auto end_addr = psec->get_address() + psec->get_size();
+		if (end_addr > heap_base)
+			heap_base = end_addr;
+
+		// Load any sections into memory with the ALLOC flag
+		if (psec->get_flags() & SHF_ALLOC) {
+
+			// Access section's data
+			const char* section_data = reader.sections[i]->get_data();
+			if (!section_data)
+				continue;
+
+			const auto data = span(reinterpret_cast<const uint8_t*>(section_data), psec->get_size());
+			memory.write_block(static_cast<uint32_t>(psec->get_address()), data);
+		}
+	}
+
+	heap_top = static_cast<uint32_t>(heap_base);
+
+	auto arguments = vector<string>{ path };
+	arguments.insert(arguments.end(), args.begin(), args.end());
+
+	for (uint32_t i = 0; i < system->get_hart_count(); ++i)
+	{
+		auto& hart = system->get_hart(i);
+
+		// Programs built for RV32C flag it in the header
+		constexpr Elf_Word ef_riscv_rvc = 0x0001;
+		hart.set_compressed_enabled((reader.get_flags() & ef_riscv_rvc) != 0);
+
+		// All harts start at the program entry point. Programs tell them apart by mhartid.
+		hart.set_register(Rv_register_id::pc, static_cast<uint32_t>(reader.get_entry()));
+
+		// Stacks start at the top of memory space, below the stacks of the harts before them
+		write_arguments(hart, Mapped_memory::address_space_size - uint64_t(i) * hart_stack_size, arguments);
+	}
+}
+
+void Simulation::write_arguments(Hart& hart, uint64_t stack_top, const vector<string>& arguments)
+{
+	// The strings go at the top, then the pointers to them: argc, argv[0..argc), a null argv[argc] and an empty envp
+	auto pointers = vector<uint32_t>{ static_cast<uint32_t>(arguments.size()) };
+	uint64_t address = stack_top;
+	for (const auto& argument : arguments)
+	{
+		address -= argument.size() + 1;
+		memory.write_block(static_cast<uint32_t>(address), span(reinterpret_cast<const uint8_t*>(argument.c_str()), argument.size() + 1));
+		pointers.push_back(static_cast<uint32_t>(address));
+	}
+
+	pointers.push_back(0);
+	pointers.push_back(0);
+
+	// The ABI keeps sp 16-byte aligned
+	const auto sp = static_cast<uint32_t>((address - pointers.size() * 4) & ~uint64_t(0xF));
+	for (size_t i = 0; i < pointers.size(); ++i)
+		memory.write_32(sp + static_cast<uint32_t>(i * 4), pointers[i]);
+
+	hart.set_register(Rv_register_id::sp, sp);
+}
+
+bool Simulation::handle_ecall(Hart& hart)
+{
+	// Using newlib as the C library.
+
+	// Parameters passed by registers
+	// a7 is the type of syscall
+	// a0-a5 are parameters
+	// return value is passed back in a0
+	// https://git.kernel.org/pub/scm/docs/man-pages/man-pages.git/tree/man2/syscall.2?h=man-pages-5.04#n200
+	// https://stackoverflow.com/questions/59800430/risc-v-ecall-syscall-calling-convention-on-pk-linux
+
+	// List of syscall IDs:
+	// https://github.com/riscvarchive/riscv-newlib/blob/7a526cdc28a3c4acce98e8a99b06562452c90d07/libgloss/riscv/machine/syscall.h#L43
+
+	auto a0 = hart.get_register(Rv_register_id::a0);
+	auto a1 = hart.get_register(Rv_register_id::a1);
+	auto a2 = hart.get_register(Rv_register_id::a2);
+	auto a7 = hart.get_register(Rv_register_id::a7);
+
+	uint32_t ret_val = a0; // TODO : Default to 0?
+
+	switch (a7)
+	{
+	case SYS_exit:
+	case SYS_exit_group:
+		exit_code = static_cast<int32_t>(a0);
+		return false;
+
+	case SYS_brk:
+		heap_top += a0;
+		ret_val = heap_top;
+		break;
+
+	case SYS_write:
+	{
+		/*
+		_write(int file, const void *ptr, size_t len)
+		*/
+
+		uint32_t buf_addr = a1;
+
+		// Buffers that run past the end of the address space are written up to it, as a short write
+		uint32_t count = static_cast<uint32_t>(min<uint64_t>(a2, Mapped_memory::address_space_size - buf_addr));
+
+		// Write straight from guest memory when the buffer is host contiguous, otherwise copy it out first
+		auto buffer = memory.get_read_span(buf_addr, count);
+		auto buffer_copy = vector<uint8_t>();
+		if (buffer.size() != count)
+		{
+			buffer_copy.resize(count);
+			memory.read_block(buf_addr, buffer_copy);
+			buffer = buffer_copy;
+		}
+
+		output->write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+
+		ret_val = static_cast<uint32_t>(buffer.size());
+		break;
+	}
+	}
+
+	// Return value
+	hart.set_register(Rv_register_id::a0, ret_val);
+
+	// Increment PC
+	hart.set_register(Rv_register_id::pc, hart.get_register(Rv_register_id::pc) + 4);
+	return true;
+}
+
+optional<int32_t> Simulation::get_exit_code() const
+{
+	return exit_code;
+}
+
+void Simulation::take_snapshot()
+{
+	snapshot = Snapshot{ {}, heap_top, exit_code };
+	for (uint32_t i = 0; i < system->get_hart_count(); ++i)
+		snapshot->harts.push_back(system->get_hart(i).get_state());
+
+	memory.take_snapshot();
+}
+
+bool Simulation::restore_snapshot()
+{
+	if (!snapshot)
+		return false;
+
+	memory.restore_snapshot();
+	for (uint32_t i = 0; i < system->get_hart_count(); ++i)
+		system->get_hart(i).set_state(snapshot->harts[i]);
+
+	heap_top = snapshot->heap_top;
+	exit_code = snapshot->exit_code;
+	return true;
+}
+
+bool Simulation::has_snapshot() const
+{
+	return snapshot.has_value();
+}
+
+}
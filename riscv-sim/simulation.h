@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mapped-memory.h"
+#include "smp-system.h"
+
+namespace riscv_sim {
+
+/**
+An RV32 program loaded from an ELF file into a memory and harts of its own, with the newlib system calls it makes
+serviced on the host. Simulations share no state, so independent ones can run on different threads at once.
+
+The harts are bound directly to Mapped_memory, so memory accesses are not virtual calls.
+*/
+class Simulation
+{
+public:
+	using System = Smp_system<32, Mapped_memory>;
+	using Hart = System::Hart;
+
+	/** Stack space of each hart. Hart i's stack starts i stacks below the top of memory. */
+	static constexpr uint32_t hart_stack_size = 0x10'0000;
+
+	explicit Simulation(uint32_t hart_count = 1, Rv32_engine engine = Rv32_engine::interpreter);
+
+	Mapped_memory& get_memory();
+	System& get_system();
+
+	/** Replaces the harts with hart_count new ones, which start at the next load. */
+	void set_hart_count(uint32_t hart_count);
+
+	/** Sets where the program's writes to stdout and stderr go. std::cout by default. */
+	void set_output(std::ostream& output);
+
+	/**
+	Resets memory and the harts, and loads the allocated sections of an ELF32 file. All harts start at the entry
+	point with a stack of their own, which holds argc, argv (the path, then args) and an empty envp as newlib's crt0
+	expects. Lists the sections in log if it isn't null. Throws std::runtime_error if the file can't be loaded.
+	*/
+	void load_elf(const std::string& path, const std::vector<std::string>& args = {}, std::ostream* log = nullptr);
+
+	/**
+	Services the system call of the ECALL the hart stopped at and moves PC past it. Returns false, leaving PC at
+	the ECALL, if the call was exit.
+	*/
+	bool handle_ecall(Hart& hart);
+
+	/** Gets the status the program passed to exit, if it has exited since it was loaded. */
+	std::optional<int32_t> get_exit_code() const;
+
+	/**
+	Saves the state of the program: its memory, its harts and its heap, replacing any earlier snapshot. Memory is
+	saved a page at a time as it is written afterwards (see Memory::take_snapshot). Loading a program or changing the
+	hart count discards the snapshot.
+	*/
+	void take_snapshot();
+
+	/** Restores the state saved by take_snapshot. Returns false if there is no snapshot. */
+	bool restore_snapshot();
+
+	bool has_snapshot() const;
+
+private:
+	struct Snapshot
+	{
+		std::vector<Hart::State> harts;
+		uint32_t heap_top;
+		std::optional<int32_t> exit_code;
+	};
+
+
+	/** Writes argc, argv and envp below the top of the hart's stack and points sp at argc. */
+	void write_arguments(Hart& hart, uint64_t stack_top, const std::vector<std::string>& arguments);
+
+	Mapped_memory memory;
+	Rv32_engine engine;
+	std::unique_ptr<System> system; // Registered with the memory, so replaced rather than moved
+
+	std::ostream* output = &std::cout;
+	uint32_t heap_top = 0;
+	std::optional<int32_t> exit_code;
+	std::optional<Snapshot> snapshot;
+};
+
+}
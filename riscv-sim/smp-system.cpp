@@ -0,0 +1,115 @@
+#include "smp-system.h"
+
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "mapped-memory.h"
+#include "paged-memory.h"
+#include "radix-memory.h"
+
+using namespace std;
+
+namespace riscv_sim {
+
+template <unsigned Xlen, typename Memory_type>
+Smp_system<Xlen, Memory_type>::Smp_system(Memory_type& memory, uint32_t hart_count, Rv32_engine engine)
+{
+	harts.reserve(hart_count);
+	for (uint32_t i = 0; i < hart_count; ++i)
+	{
+		harts.push_back(make_unique<Hart>(memory, engine));
+		harts.back()->set_hart_id(i);
+	}
+}
+
+template <unsigned Xlen, typename Memory_type>
+uint32_t Smp_system<Xlen, Memory_type>::get_hart_count() const
+{
+	return static_cast<uint32_t>(harts.size());
+}
+
+template <unsigned Xlen, typename Memory_type>
+auto Smp_system<Xlen, Memory_type>::get_hart(uint32_t index) -> Hart&
+{
+	return *harts.at(index);
+}
+
+template <unsigned Xlen, typename Memory_type>
+vector<Rv_run_result> Smp_system<Xlen, Memory_type>::run(uint64_t max_instructions, const Stop_handler& handler)
+{
+	auto results = vector<Rv_run_result>(harts.size());
+
+	// The first exception wins. The others are most likely caused by the halt it triggers.
+	auto error_mutex = mutex();
+	exception_ptr error;
+	const auto run_guarded = [&](size_t index) {
+		try
+		{
+			results[index] = run_hart(*harts[index], max_instructions, handler);
+		}
+		catch (...)
+		{
+			const auto lock = lock_guard(error_mutex);
+			if (!error)
+				error = current_exception();
+
+			request_halt();
+		}
+	};
+
+	{
+		auto threads = vector<jthread>();
+		threads.reserve(harts.size());
+		for (size_t i = 1; i < harts.size(); ++i)
+			threads.emplace_back(run_guarded, i);
+
+		if (!harts.empty())
+			run_guarded(0);
+	}
+
+	// Harts that had stopped before a halt was requested would otherwise halt at the start of the next run
+	for (auto& hart : harts)
+		hart->clear_halt_request();
+
+	if (error)
+		rethrow_exception(error);
+
+	return results;
+}
+
+template <unsigned Xlen, typename Memory_type>
+void Smp_system<Xlen, Memory_type>::request_halt()
+{
+	for (auto& hart : harts)
+		hart->request_halt();
+}
+
+template <unsigned Xlen, typename Memory_type>
+Rv_run_result Smp_system<Xlen, Memory_type>::run_hart(Hart& hart, uint64_t max_instructions, const Stop_handler& handler)
+{
+	auto total = Rv_run_result();
+	while (total.retired < max_instructions)
+	{
+		const auto result = hart.run(max_instructions - total.retired);
+		total = { total.retired + result.retired, result.reason, result.trap };
+
+		if (result.reason == Rv_stop_reason::budget_exhausted || result.reason == Rv_stop_reason::halted)
+			break;
+
+		if (!handler || !handler(hart, result))
+			break;
+	}
+
+	return total;
+}
+
+// Explicit instantiations for the hart types
+
+template class Smp_system<32, Memory>;
+template class Smp_system<32, Mapped_memory>;
+template class Smp_system<32, Paged_memory>;
+template class Smp_system<64, Memory_64>;
+template class Smp_system<64, Radix_memory>;
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "rv32-hart.h"
+
+namespace riscv_sim {
+
+/**
+Several harts of width Xlen that share one memory, each run by its own host thread.
+
+Hart i reads i from mhartid. The harts run freely: how their memory accesses interleave is up to the host, with the
+ordering described by Basic_memory. Each hart's registers, breakpoints and settings are only touched by the thread
+that runs it, so set them up before run() and read them after it, or from the stop handler of that hart.
+*/
+template <unsigned Xlen, typename Memory_type>
+class Smp_system
+{
+public:
+	using Hart = Basic_rv_hart<Xlen, Memory_type>;
+
+	/**
+	Called on the hart's thread when its run() stops for anything other than its budget or a halt. Returns whether
+	the hart carries on, e.g. after it has serviced an ECALL and moved PC past it. Handlers of different harts run
+	concurrently.
+	*/
+	using Stop_handler = std::function<bool(Hart& hart, const Rv_run_result& result)>;
+
+	Smp_system(Memory_type& memory, uint32_t hart_count, Rv32_engine engine = Rv32_engine::interpreter);
+
+	uint32_t get_hart_count() const;
+	Hart& get_hart(uint32_t index);
+
+	/**
+	Runs every hart for up to max_instructions on its own thread and waits for all of them. Hart 0 runs on the
+	calling thread. Returns a result per hart: the instructions it retired in total and why it last stopped.
+	An exception thrown by a handler halts the other harts and is rethrown once they have stopped.
+	*/
+	std::vector<Rv_run_result> run(uint64_t max_instructions, const Stop_handler& handler);
+
+	/**
+	Halts all harts at their next block boundary. Can be called from any thread, including from handlers. Harts that
+	have already stopped are unaffected: run() drops the request when it returns.
+	*/
+	void request_halt();
+
+private:
+	Rv_run_result run_hart(Hart& hart, uint64_t max_instructions, const Stop_handler& handler);
+
+	std::vector<std::unique_ptr<Hart>> harts; // Registered with the memory by address, so they don't move
+};
+
+extern template class Smp_system<32, Memory>;
+extern template class Smp_system<32, Mapped_memory>;
+extern template class Smp_system<32, Paged_memory>;
+extern template class Smp_system<64, Memory_64>;
+extern template class Smp_system<64, Radix_memory>;
+
+}
@@ -0,0 +1,102 @@
+#include "work-stealing-pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace riscv_sim {
+
+Work_stealing_pool::Work_stealing_pool(uint32_t thread_count)
+	: thread_count(thread_count != 0 ? thread_count : max(thread::hardware_concurrency(), 1u)),
+	queues(make_unique<Task_queue[]>(this->thread_count))
+{
+}
+
+uint32_t Work_stealing_pool::get_thread_count() const
+{
+	return thread_count;
+}
+
+void Work_stealing_pool::run(size_t task_count, const function<void(size_t index)>& task)
+{
+	// Deal out a contiguous range to each thread
+	for (uint32_t i = 0; i < thread_count; ++i)
+	{
+		const size_t begin = task_count * i / thread_count;
+		const size_t end = task_count * (i + 1) / thread_count;
+		auto& tasks = queues[i].tasks;
+		tasks.clear();
+		for (size_t index = begin; index < end; ++index)
+			tasks.push_back(index);
+	}
+
+	auto stopping = atomic<bool>(false);
+	auto error_mutex = mutex();
+	exception_ptr error;
+	const auto work = [&](uint32_t thread) {
+		size_t index;
+		while (!stopping.load(memory_order_relaxed) && take_task(thread, index))
+		{
+			try
+			{
+				task(index);
+			}
+			catch (...)
+			{
+				const auto lock = lock_guard(error_mutex);
+				if (!error)
+					error = current_exception();
+
+				stopping.store(true, memory_order_relaxed);
+			}
+		}
+	};
+
+	{
+		auto threads = vector<jthread>();
+		threads.reserve(thread_count - 1);
+		for (uint32_t i = 1; i < thread_count; ++i)
+			threads.emplace_back(work, i);
+
+		work(0);
+	}
+
+	if (error)
+		rethrow_exception(error);
+}
+
+bool Work_stealing_pool::take_task(uint32_t thread, size_t& index)
+{
+	{
+		auto& own = queues[thread];
+		const auto lock = lock_guard(own.mutex);
+		if (!own.tasks.empty())
+		{
+			index = own.tasks.back();
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	// Steal the oldest task of the next thread that has one. Victims give up the far end of their range, which
+	// they would have reached last.
+	for (uint32_t i = 1; i < thread_count; ++i)
+	{
+		auto& victim = queues[(thread + i) % thread_count];
+		const auto lock = lock_guard(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			index = victim.tasks.front();
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace riscv_sim {
+
+/**
+Runs batches of independent tasks on a set of host threads.
+
+Each thread has a deque of task indices, dealt out in contiguous ranges when a batch starts. A thread takes tasks
+from the back of its own deque and, once that is empty, steals from the front of the others', so threads that drew
+short tasks take over the remaining work of those that drew long ones. Tasks don't add tasks, so a thread that finds
+every deque empty is done.
+
+Threads are started for each batch. The batches this runs, such as simulations, are long enough for that not to
+matter.
+*/
+class Work_stealing_pool
+{
+public:
+	/** Creates a pool of thread_count threads, or of one per host core if it is 0. */
+	explicit Work_stealing_pool(uint32_t thread_count = 0);
+
+	uint32_t get_thread_count() const;
+
+	/**
+	Calls task(i) for each i below task_count and waits for all of them. The calling thread runs tasks too. The first
+	exception a task throws stops the threads from starting more tasks and is rethrown once they have stopped.
+	*/
+	void run(size_t task_count, const std::function<void(size_t index)>& task);
+
+private:
+	// On their own cache lines, so threads working through their own deques don't contend
+	struct alignas(64) Task_queue
+	{
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	/** Takes the next task from the back of the thread's own deque, or steals one. Returns false once all are empty. */
+	bool take_task(uint32_t thread, size_t& index);
+
+	uint32_t thread_count;
+	std::unique_ptr<Task_queue[]> queues;
+};
+
+}
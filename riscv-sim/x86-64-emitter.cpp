@@ -0,0 +1,453 @@
+#include "x86-64-emitter.h"
+
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+namespace riscv_sim {
+
+using enum X86_64_register;
+
+static uint8_t low_bits(X86_64_register reg)
+{
+	return to_underlying(reg) & 0b111;
+}
+
+static uint8_t high_bit(X86_64_register reg)
+{
+	return to_underlying(reg) >> 3;
+}
+
+X86_64_emitter::X86_64_emitter(span<uint8_t> buffer)
+	: buffer(buffer)
+{
+}
+
+size_t X86_64_emitter::get_size() const
+{
+	return position;
+}
+
+bool X86_64_emitter::has_overflowed() const
+{
+	return overflowed;
+}
+
+void X86_64_emitter::push(X86_64_register reg)
+{
+	emit_rex(false, 0, 0, high_bit(reg));
+	emit_8(0x50 + low_bits(reg));
+}
+
+void X86_64_emitter::pop(X86_64_register reg)
+{
+	emit_rex(false, 0, 0, high_bit(reg));
+	emit_8(0x58 + low_bits(reg));
+}
+
+void X86_64_emitter::ret()
+{
+	emit_8(0xC3);
+}
+
+void X86_64_emitter::mfence()
+{
+	emit_8(0x0F);
+	emit_8(0xAE);
+	emit_8(0xF0);
+}
+
+void X86_64_emitter::call(X86_64_register reg)
+{
+	emit_rex(false, 0, 0, high_bit(reg));
+	emit_8(0xFF);
+	emit_modrm_register(2, to_underlying(reg));
+}
+
+void X86_64_emitter::mov(X86_64_register dst, X86_64_register src)
+{
+	emit_rex(false, high_bit(src), 0, high_bit(dst));
+	emit_8(0x89);
+	emit_modrm_register(to_underlying(src), to_underlying(dst));
+}
+
+void X86_64_emitter::mov_64(X86_64_register dst, X86_64_register src)
+{
+	emit_rex(true, high_bit(src), 0, high_bit(dst));
+	emit_8(0x89);
+	emit_modrm_register(to_underlying(src), to_underlying(dst));
+}
+
+void X86_64_emitter::mov_imm(X86_64_register dst, uint32_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	emit_8(0xB8 + low_bits(dst));
+	emit_32(imm);
+}
+
+void X86_64_emitter::mov_imm_64(X86_64_register dst, uint64_t imm)
+{
+	emit_rex(true, 0, 0, high_bit(dst));
+	emit_8(0xB8 + low_bits(dst));
+	emit_64(imm);
+}
+
+void X86_64_emitter::load(X86_64_register dst, X86_64_register base, int32_t disp)
+{
+	emit_rex(false, high_bit(dst), 0, high_bit(base));
+	emit_8(0x8B);
+	emit_modrm_memory(to_underlying(dst), base, disp);
+}
+
+void X86_64_emitter::store(X86_64_register base, int32_t disp, X86_64_register src)
+{
+	emit_rex(false, high_bit(src), 0, high_bit(base));
+	emit_8(0x89);
+	emit_modrm_memory(to_underlying(src), base, disp);
+}
+
+void X86_64_emitter::store_imm(X86_64_register base, int32_t disp, uint32_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(base));
+	emit_8(0xC7);
+	emit_modrm_memory(0, base, disp);
+	emit_32(imm);
+}
+
+void X86_64_emitter::load_sign_extend_64(X86_64_register dst, X86_64_register base, int32_t disp)
+{
+	emit_rex(true, high_bit(dst), 0, high_bit(base));
+	emit_8(0x63);
+	emit_modrm_memory(to_underlying(dst), base, disp);
+}
+
+void X86_64_emitter::load_indexed(X86_64_register dst, X86_64_register base, X86_64_register index, uint8_t size, bool sign_extend)
+{
+	// [base + index] through a SIB byte. rbp and r13 bases need mod 01 with a zero displacement.
+	const bool needs_disp = low_bits(base) == to_underlying(rbp);
+
+	emit_rex(false, high_bit(dst), high_bit(index), high_bit(base));
+	switch (size)
+	{
+	case 1: emit_8(0x0F); emit_8(sign_extend ? 0xBE : 0xB6); break;
+	case 2: emit_8(0x0F); emit_8(sign_extend ? 0xBF : 0xB7); break;
+	default: emit_8(0x8B); break;
+	}
+
+	emit_8(((needs_disp ? 0b01 : 0b00) << 6) | (low_bits(dst) << 3) | 0b100);
+	emit_8((low_bits(index) << 3) | low_bits(base));
+	if (needs_disp)
+		emit_8(0);
+}
+
+void X86_64_emitter::load_scaled_64(X86_64_register dst, X86_64_register base, X86_64_register index)
+{
+	// [base + index * 8] through a SIB byte, with the same rbp and r13 special case as load_indexed
+	const bool needs_disp = low_bits(base) == to_underlying(rbp);
+
+	emit_rex(true, high_bit(dst), high_bit(index), high_bit(base));
+	emit_8(0x8B);
+	emit_8(((needs_disp ? 0b01 : 0b00) << 6) | (low_bits(dst) << 3) | 0b100);
+	emit_8((0b11 << 6) | (low_bits(index) << 3) | low_bits(base));
+	if (needs_disp)
+		emit_8(0);
+}
+
+void X86_64_emitter::alu(X86_64_alu_op op, X86_64_register dst, X86_64_register src)
+{
+	// The r/m32, r32 forms are 01, 09, 21, 29, 31 and 39: (digit << 3) | 1
+	emit_rex(false, high_bit(src), 0, high_bit(dst));
+	emit_8((to_underlying(op) << 3) | 0x01);
+	emit_modrm_register(to_underlying(src), to_underlying(dst));
+}
+
+void X86_64_emitter::alu_load(X86_64_alu_op op, X86_64_register dst, X86_64_register base, int32_t disp)
+{
+	// The r32, r/m32 forms are 03, 0B, 23, 2B, 33 and 3B: (digit << 3) | 3
+	emit_rex(false, high_bit(dst), 0, high_bit(base));
+	emit_8((to_underlying(op) << 3) | 0x03);
+	emit_modrm_memory(to_underlying(dst), base, disp);
+}
+
+void X86_64_emitter::alu_imm(X86_64_alu_op op, X86_64_register dst, int32_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	if (imm >= -128 && imm <= 127)
+	{
+		emit_8(0x83);
+		emit_modrm_register(to_underlying(op), to_underlying(dst));
+		emit_8(static_cast<uint8_t>(imm));
+		return;
+	}
+
+	emit_8(0x81);
+	emit_modrm_register(to_underlying(op), to_underlying(dst));
+	emit_32(static_cast<uint32_t>(imm));
+}
+
+void X86_64_emitter::alu_imm_64(X86_64_alu_op op, X86_64_register dst, int32_t imm)
+{
+	emit_rex(true, 0, 0, high_bit(dst));
+	emit_8(0x81);
+	emit_modrm_register(to_underlying(op), to_underlying(dst));
+	emit_32(static_cast<uint32_t>(imm));
+}
+
+void X86_64_emitter::imul_load(X86_64_register dst, X86_64_register base, int32_t disp)
+{
+	emit_rex(false, high_bit(dst), 0, high_bit(base));
+	emit_8(0x0F);
+	emit_8(0xAF);
+	emit_modrm_memory(to_underlying(dst), base, disp);
+}
+
+void X86_64_emitter::imul_64(X86_64_register dst, X86_64_register src)
+{
+	emit_rex(true, high_bit(dst), 0, high_bit(src));
+	emit_8(0x0F);
+	emit_8(0xAF);
+	emit_modrm_register(to_underlying(dst), to_underlying(src));
+}
+
+void X86_64_emitter::test_imm(X86_64_register dst, uint32_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	emit_8(0xF7);
+	emit_modrm_register(0, to_underlying(dst));
+	emit_32(imm);
+}
+
+void X86_64_emitter::test_64(X86_64_register dst, X86_64_register src)
+{
+	emit_rex(true, high_bit(src), 0, high_bit(dst));
+	emit_8(0x85);
+	emit_modrm_register(to_underlying(src), to_underlying(dst));
+}
+
+void X86_64_emitter::cmp_byte_imm(X86_64_register base, int32_t disp, uint8_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(base));
+	emit_8(0x80);
+	emit_modrm_memory(to_underlying(X86_64_alu_op::cmp), base, disp);
+	emit_8(imm);
+}
+
+void X86_64_emitter::add_byte_imm(X86_64_register base, int32_t disp, uint8_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(base));
+	emit_8(0x80);
+	emit_modrm_memory(to_underlying(X86_64_alu_op::add), base, disp);
+	emit_8(imm);
+}
+
+void X86_64_emitter::shift_cl(X86_64_shift_op op, X86_64_register dst)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	emit_8(0xD3);
+	emit_modrm_register(to_underlying(op), to_underlying(dst));
+}
+
+void X86_64_emitter::shift_imm(X86_64_shift_op op, X86_64_register dst, uint8_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	emit_8(0xC1);
+	emit_modrm_register(to_underlying(op), to_underlying(dst));
+	emit_8(imm);
+}
+
+void X86_64_emitter::shift_imm_64(X86_64_shift_op op, X86_64_register dst, uint8_t imm)
+{
+	emit_rex(true, 0, 0, high_bit(dst));
+	emit_8(0xC1);
+	emit_modrm_register(to_underlying(op), to_underlying(dst));
+	emit_8(imm);
+}
+
+void X86_64_emitter::not_(X86_64_register dst)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	emit_8(0xF7);
+	emit_modrm_register(2, to_underlying(dst));
+}
+
+void X86_64_emitter::bswap(X86_64_register dst)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	emit_8(0x0F);
+	emit_8(0xC8 + low_bits(dst));
+}
+
+void X86_64_emitter::bit_count(X86_64_bit_count_op op, X86_64_register dst, X86_64_register src)
+{
+	// The mandatory prefix goes before REX
+	emit_8(0xF3);
+	emit_rex(false, high_bit(dst), 0, high_bit(src));
+	emit_8(0x0F);
+	emit_8(to_underlying(op));
+	emit_modrm_register(to_underlying(dst), to_underlying(src));
+}
+
+void X86_64_emitter::bit_op(X86_64_bit_op op, X86_64_register dst, X86_64_register src)
+{
+	// The r/m32, r32 forms are 0F A3, AB, B3 and BB: 0xA3 | ((digit - 4) << 3)
+	emit_rex(false, high_bit(src), 0, high_bit(dst));
+	emit_8(0x0F);
+	emit_8(0xA3 | ((to_underlying(op) - 4) << 3));
+	emit_modrm_register(to_underlying(src), to_underlying(dst));
+}
+
+void X86_64_emitter::bit_op_64(X86_64_bit_op op, X86_64_register dst, X86_64_register src)
+{
+	emit_rex(true, high_bit(src), 0, high_bit(dst));
+	emit_8(0x0F);
+	emit_8(0xA3 | ((to_underlying(op) - 4) << 3));
+	emit_modrm_register(to_underlying(src), to_underlying(dst));
+}
+
+void X86_64_emitter::bit_op_imm(X86_64_bit_op op, X86_64_register dst, uint8_t imm)
+{
+	emit_rex(false, 0, 0, high_bit(dst));
+	emit_8(0x0F);
+	emit_8(0xBA);
+	emit_modrm_register(to_underlying(op), to_underlying(dst));
+	emit_8(imm);
+}
+
+void X86_64_emitter::cmov(X86_64_condition condition, X86_64_register dst, X86_64_register src)
+{
+	emit_rex(false, high_bit(dst), 0, high_bit(src));
+	emit_8(0x0F);
+	emit_8(0x40 + to_underlying(condition));
+	emit_modrm_register(to_underlying(dst), to_underlying(src));
+}
+
+void X86_64_emitter::extend(X86_64_register dst, X86_64_register src, uint8_t size, bool sign_extend)
+{
+	// A byte source needs a REX prefix to select spl/bpl/sil/dil instead of ah/ch/dh/bh
+	emit_rex(false, high_bit(dst), 0, high_bit(src), size == 1 && to_underlying(src) >= 4);
+	emit_8(0x0F);
+	if (size == 1)
+		emit_8(sign_extend ? 0xBE : 0xB6);
+	else
+		emit_8(sign_extend ? 0xBF : 0xB7);
+	emit_modrm_register(to_underlying(dst), to_underlying(src));
+}
+
+void X86_64_emitter::lea_scaled(X86_64_register dst, X86_64_register base, X86_64_register index, uint8_t scale)
+{
+	// [base + index * scale] through a SIB byte. rbp and r13 bases need mod 01 with a zero displacement.
+	const bool needs_disp = low_bits(base) == to_underlying(rbp);
+	const uint8_t scale_bits = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+
+	emit_rex(false, high_bit(dst), high_bit(index), high_bit(base));
+	emit_8(0x8D);
+	emit_8(((needs_disp ? 0b01 : 0b00) << 6) | (low_bits(dst) << 3) | 0b100);
+	emit_8((scale_bits << 6) | (low_bits(index) << 3) | low_bits(base));
+	if (needs_disp)
+		emit_8(0);
+}
+
+void X86_64_emitter::setcc_zero_extend(X86_64_condition condition, X86_64_register dst)
+{
+	// setcc dst8. A REX prefix selects spl/bpl/sil/dil instead of ah/ch/dh/bh.
+	emit_rex(false, 0, 0, high_bit(dst), to_underlying(dst) >= 4);
+	emit_8(0x0F);
+	emit_8(0x90 + to_underlying(condition));
+	emit_modrm_register(0, to_underlying(dst));
+
+	// movzx dst, dst8
+	emit_rex(false, high_bit(dst), 0, high_bit(dst), to_underlying(dst) >= 4);
+	emit_8(0x0F);
+	emit_8(0xB6);
+	emit_modrm_register(to_underlying(dst), to_underlying(dst));
+}
+
+void X86_64_emitter::jmp(Label& label)
+{
+	emit_8(0xE9);
+	emit_label_reference(label);
+}
+
+void X86_64_emitter::jcc(X86_64_condition condition, Label& label)
+{
+	emit_8(0x0F);
+	emit_8(0x80 + to_underlying(condition));
+	emit_label_reference(label);
+}
+
+void X86_64_emitter::bind(Label& label)
+{
+	label.position = static_cast<ptrdiff_t>(position);
+
+	for (const auto fixup : label.fixups)
+	{
+		if (fixup + 4 > buffer.size())
+			continue;
+
+		const auto rel = static_cast<int32_t>(label.position - static_cast<ptrdiff_t>(fixup + 4));
+		memcpy(buffer.data() + fixup, &rel, sizeof(rel));
+	}
+
+	label.fixups.clear();
+}
+
+void X86_64_emitter::emit_8(uint8_t value)
+{
+	if (position >= buffer.size())
+	{
+		overflowed = true;
+		++position;
+		return;
+	}
+
+	buffer[position++] = value;
+}
+
+void X86_64_emitter::emit_32(uint32_t value)
+{
+	for (int i = 0; i < 4; ++i)
+		emit_8(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+void X86_64_emitter::emit_64(uint64_t value)
+{
+	emit_32(static_cast<uint32_t>(value));
+	emit_32(static_cast<uint32_t>(value >> 32));
+}
+
+void X86_64_emitter::emit_rex(bool w, uint8_t reg, uint8_t index, uint8_t base, bool force)
+{
+	const uint8_t rex = 0x40 | (w << 3) | ((reg & 1) << 2) | ((index & 1) << 1) | (base & 1);
+	if (rex != 0x40 || force)
+		emit_8(rex);
+}
+
+void X86_64_emitter::emit_modrm_register(uint8_t reg, uint8_t rm)
+{
+	emit_8(0b11'000'000 | ((reg & 0b111) << 3) | (rm & 0b111));
+}
+
+void X86_64_emitter::emit_modrm_memory(uint8_t reg, X86_64_register base, int32_t disp)
+{
+	// Always [base + disp32]. rsp and r12 bases need a SIB byte.
+	emit_8(0b10'000'000 | ((reg & 0b111) << 3) | low_bits(base));
+	if (low_bits(base) == to_underlying(rsp))
+		emit_8(0b00'100'100);
+
+	emit_32(static_cast<uint32_t>(disp));
+}
+
+void X86_64_emitter::emit_label_reference(Label& label)
+{
+	if (label.position >= 0)
+	{
+		emit_32(static_cast<uint32_t>(label.position - static_cast<ptrdiff_t>(position + 4)));
+		return;
+	}
+
+	label.fixups.push_back(position);
+	emit_32(0);
+}
+
+}
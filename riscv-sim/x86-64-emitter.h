@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace riscv_sim {
+
+enum class X86_64_register : uint8_t
+{
+	rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi,
+	r8, r9, r10, r11, r12, r13, r14, r15,
+};
+
+/** Condition codes, numbered as in the Jcc and SETcc opcodes. */
+enum class X86_64_condition : uint8_t
+{
+	o, no, b, ae, e, ne, be, a, s, ns, p, np, l, ge, le, g,
+};
+
+/** Two-operand integer operations, numbered as the /digit used by their immediate forms (opcode 81). */
+enum class X86_64_alu_op : uint8_t
+{
+	add = 0, or_ = 1, and_ = 4, sub = 5, xor_ = 6, cmp = 7,
+};
+
+/** Shift operations, numbered as the /digit used by opcodes C1 and D3. */
+enum class X86_64_shift_op : uint8_t
+{
+	rol = 0, ror = 1, shl = 4, shr = 5, sar = 7,
+};
+
+/** Bit count operations, numbered as the opcode byte after F3 0F. lzcnt and tzcnt need ABM and BMI1, popcnt needs POPCNT. */
+enum class X86_64_bit_count_op : uint8_t
+{
+	popcnt = 0xB8, tzcnt = 0xBC, lzcnt = 0xBD,
+};
+
+/** Single bit operations, numbered as the /digit used by their immediate forms (opcode 0F BA). All set CF to the old bit. */
+enum class X86_64_bit_op : uint8_t
+{
+	bt = 4, bts = 5, btr = 6, btc = 7,
+};
+
+/**
+Writes x86-64 machine code into a caller-provided buffer.
+
+Only the small subset of instructions needed by the RV32 JIT is supported. Register operands are 32-bit unless the
+method name says otherwise. Memory operands are [base + disp32] or [base + index]. If the buffer fills up, further
+writes are dropped and has_overflowed() returns true.
+*/
+class X86_64_emitter
+{
+public:
+	/** A jump target. Jumps to a label can be emitted before the label is bound. */
+	struct Label
+	{
+		std::ptrdiff_t position = -1;
+		std::vector<size_t> fixups; // Offsets of rel32 fields that refer to the label
+	};
+
+	X86_64_emitter(std::span<uint8_t> buffer);
+
+	size_t get_size() const;
+	bool has_overflowed() const;
+
+	void push(X86_64_register reg);
+	void pop(X86_64_register reg);
+	void ret();
+
+	/** mfence. */
+	void mfence();
+
+	/** call reg (64-bit absolute address in the register). */
+	void call(X86_64_register reg);
+
+	void mov(X86_64_register dst, X86_64_register src);
+	void mov_64(X86_64_register dst, X86_64_register src);
+	void mov_imm(X86_64_register dst, uint32_t imm);
+	void mov_imm_64(X86_64_register dst, uint64_t imm);
+
+	/** mov dst, dword [base + disp] */
+	void load(X86_64_register dst, X86_64_register base, int32_t disp);
+
+	/** mov dword [base + disp], src */
+	void store(X86_64_register base, int32_t disp, X86_64_register src);
+
+	/** mov dword [base + disp], imm */
+	void store_imm(X86_64_register base, int32_t disp, uint32_t imm);
+
+	/** movsxd dst, dword [base + disp]: sign extends into the 64-bit register */
+	void load_sign_extend_64(X86_64_register dst, X86_64_register base, int32_t disp);
+
+	/** Zero or sign extending load of size 1, 2 or 4 bytes from [base + index] (64-bit registers). */
+	void load_indexed(X86_64_register dst, X86_64_register base, X86_64_register index, uint8_t size, bool sign_extend);
+
+	/** mov dst, qword [base + index * 8] (64-bit registers): loads an entry of a table of pointers. */
+	void load_scaled_64(X86_64_register dst, X86_64_register base, X86_64_register index);
+
+	/** op dst, src */
+	void alu(X86_64_alu_op op, X86_64_register dst, X86_64_register src);
+
+	/** op dst, dword [base + disp] */
+	void alu_load(X86_64_alu_op op, X86_64_register dst, X86_64_register base, int32_t disp);
+
+	/** op dst, imm */
+	void alu_imm(X86_64_alu_op op, X86_64_register dst, int32_t imm);
+
+	/** op on the 64-bit register with a sign-extended imm. */
+	void alu_imm_64(X86_64_alu_op op, X86_64_register dst, int32_t imm);
+
+	/** imul dst, dword [base + disp] */
+	void imul_load(X86_64_register dst, X86_64_register base, int32_t disp);
+
+	/** imul on 64-bit registers. */
+	void imul_64(X86_64_register dst, X86_64_register src);
+
+	/** test dst, imm */
+	void test_imm(X86_64_register dst, uint32_t imm);
+
+	/** test on 64-bit registers. */
+	void test_64(X86_64_register dst, X86_64_register src);
+
+	/** cmp byte [base + disp], imm */
+	void cmp_byte_imm(X86_64_register base, int32_t disp, uint8_t imm);
+
+	/** add byte [base + disp], imm */
+	void add_byte_imm(X86_64_register base, int32_t disp, uint8_t imm);
+
+	/** op dst, cl */
+	void shift_cl(X86_64_shift_op op, X86_64_register dst);
+
+	/** op dst, imm */
+	void shift_imm(X86_64_shift_op op, X86_64_register dst, uint8_t imm);
+
+	/** op on the 64-bit register with an immediate count. */
+	void shift_imm_64(X86_64_shift_op op, X86_64_register dst, uint8_t imm);
+
+	/** not dst */
+	void not_(X86_64_register dst);
+
+	/** bswap dst */
+	void bswap(X86_64_register dst);
+
+	/** op dst, src */
+	void bit_count(X86_64_bit_count_op op, X86_64_register dst, X86_64_register src);
+
+	/** op dst, src: the bit index is src modulo 32 */
+	void bit_op(X86_64_bit_op op, X86_64_register dst, X86_64_register src);
+
+	/** op dst, src on 64-bit registers: the bit index is src modulo 64 */
+	void bit_op_64(X86_64_bit_op op, X86_64_register dst, X86_64_register src);
+
+	/** op dst, imm */
+	void bit_op_imm(X86_64_bit_op op, X86_64_register dst, uint8_t imm);
+
+	/** cmovcc dst, src */
+	void cmov(X86_64_condition condition, X86_64_register dst, X86_64_register src);
+
+	/** Zero or sign extends the low 1 or 2 bytes of src into dst. */
+	void extend(X86_64_register dst, X86_64_register src, uint8_t size, bool sign_extend);
+
+	/** lea dst, [base + index * scale] with a scale of 1, 2, 4 or 8. The address is truncated to 32 bits. */
+	void lea_scaled(X86_64_register dst, X86_64_register base, X86_64_register index, uint8_t scale);
+
+	/** Sets the low byte of dst to the condition and zero extends it to 32 bits. Doesn't change flags. */
+	void setcc_zero_extend(X86_64_condition condition, X86_64_register dst);
+
+	void jmp(Label& label);
+	void jcc(X86_64_condition condition, Label& label);
+
+	/** Binds the label to the current position and patches earlier jumps to it. */
+	void bind(Label& label);
+
+private:
+	void emit_8(uint8_t value);
+	void emit_32(uint32_t value);
+	void emit_64(uint64_t value);
+
+	/** Emits a REX prefix if any bit is needed. */
+	void emit_rex(bool w, uint8_t reg, uint8_t index, uint8_t base, bool force = false);
+
+	void emit_modrm_register(uint8_t reg, uint8_t rm);
+	void emit_modrm_memory(uint8_t reg, X86_64_register base, int32_t disp);
+
+	/** Emits a rel32 that refers to the label. */
+	void emit_label_reference(Label& label);
+
+	std::span<uint8_t> buffer;
+	size_t position = 0;
+	bool overflowed = false;
+};
+
+}